@@ -17,6 +17,13 @@ extern int getConfigSwapInterval();
 extern int getConfigMaxDynamicLights();
 extern const char *getConfigStartingScene();
 extern bool getConfigWfoReversePolygons();
+extern int getConfigWorkerThreads();
+extern int getConfigModelLodCount();
+extern int getConfigModelLodTrianglePercent();
+extern int getConfigModelLodPixelError();
+extern int getConfigGpuMemoryBudget();
+extern int getConfigResourceEvictAfterFrames();
+extern int getConfigTextureUploadKbPerFrame();
 extern const char *getConfigEngineScriptLocation();
 
 #endif
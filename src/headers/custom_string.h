@@ -21,4 +21,6 @@ extern void setChars(struct String *string, const char *chars);
 extern unsigned long getLength(struct String *string);
 extern const char* getChars(struct String *string);
 
+extern unsigned int hashChars(const char *chars);
+
 #endif
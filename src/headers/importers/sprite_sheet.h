@@ -3,7 +3,10 @@
 
 #include <json-c/json.h>
 struct Py3dResourceManager;
+struct TextureAtlas;
+struct TextureImage;
 
-extern void importSprites(struct Py3dResourceManager *manager, json_object *resourceDescriptor);
+// image is the sheet's already decoded file or NULL, it is taken over when it becomes the sheet's texture
+extern void importSprites(struct Py3dResourceManager *manager, struct TextureAtlas *atlas, json_object *resourceDescriptor, struct TextureImage *image);
 
 #endif
@@ -1,7 +1,14 @@
 #ifndef PY3DENGINE_IMPORTERS_TEXTURE_H
 #define PY3DENGINE_IMPORTERS_TEXTURE_H
 
+#include <json-c/json.h>
+
 struct Texture;
+struct TextureImage;
+extern void applyTextureParameters(struct Texture *texture, json_object *paramMap);
 extern void importTexture(struct Texture **texturePtr, json_object *textureDesc);
+// Uses an image that was already decoded for the descriptor's file, the texture takes it over when
+// the upload succeeds. A NULL or empty image falls back to loading the file
+extern void importTextureFromImage(struct Texture **texturePtr, json_object *textureDesc, struct TextureImage *image);
 
 #endif
@@ -0,0 +1,55 @@
+#ifndef PY3DENGINE_IMPORTERS_TEXTURE_ATLAS_H
+#define PY3DENGINE_IMPORTERS_TEXTURE_ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <json-c/json.h>
+
+// Width and height of every atlas page in pixels
+#define TEXTURE_ATLAS_PAGE_SIZE 2048
+
+struct Texture;
+struct Py3dResourceManager;
+struct AtlasPage;
+struct AtlasImage;
+
+// Packs images into shared pages during scene import so sprites from different sheets
+// can be drawn without rebinding textures. Pages are textures owned by the resource manager,
+// the atlas only tracks the free space left on them and can be deleted once import is done.
+struct TextureAtlas {
+    struct AtlasPage *_pages;
+    size_t _numPages;
+    int _pageSize;
+
+    // where every named image went, so a file packed once is found again instead of being packed twice
+    struct AtlasImage *_images;
+    size_t _numImages;
+    size_t _imagesCapacity;
+};
+
+extern void allocTextureAtlas(struct TextureAtlas **atlasPtr);
+extern void deleteTextureAtlas(struct TextureAtlas **atlasPtr);
+
+// Copies an RGBA image onto a page whose texture parameters match textureParams.
+// On success pageOut receives the page texture and offset the pixel position of the image on it.
+// A non NULL fileName records the image so findInTextureAtlas can return it later
+extern bool packIntoTextureAtlas(
+    struct TextureAtlas *atlas,
+    struct Py3dResourceManager *manager,
+    const char *fileName,
+    const unsigned char *rgbaPixels,
+    int width,
+    int height,
+    json_object *textureParams,
+    struct Texture **pageOut,
+    int offset[2]
+);
+extern bool findInTextureAtlas(
+    struct TextureAtlas *atlas,
+    const char *fileName,
+    json_object *textureParams,
+    struct Texture **pageOut,
+    int offset[2]
+);
+
+#endif
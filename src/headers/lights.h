@@ -4,17 +4,29 @@
 #define LIGHT_TYPE_UNKNOWN 0
 #define LIGHT_TYPE_POINT 1
 
+// Laid out to match std140 so the array can be copied straight into the LightBlock uniform buffer:
+//   struct Light {
+//       int used; int enabled; int lightType;
+//       vec3 position; vec3 diffuse; vec3 specular; vec3 ambient;
+//       float intensity; vec3 attenuation;
+//   };
+//   layout(std140, binding = 0) uniform LightBlock { Light gLights[MAX_DYNAMIC_LIGHTS]; };
 struct LightData {
     // TODO: find a way to remove the OpenGL stuff
     GLint used;
     GLint enabled;
     GLint type;
+    GLint _pad0;
     float position[3];
+    float _pad1;
     float diffuse[3];
+    float _pad2;
     float specular[3];
+    float _pad3;
     float ambient[3];
     float intensity;
     float attenuation[3];
+    float _pad4;
 };
 
 extern void LightData_Alloc(struct LightData **ptr, unsigned int count);
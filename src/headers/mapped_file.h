@@ -0,0 +1,39 @@
+#ifndef PY3DENGINE_MAPPED_FILE_H
+#define PY3DENGINE_MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct MappedFileHandles;
+
+// Read only view of a whole file, pages are loaded by the OS as they are touched
+struct MappedFile {
+    const unsigned char *data;
+    size_t size;
+    struct MappedFileHandles *_handles;
+};
+
+extern bool allocMappedFile(struct MappedFile **mappedFilePtr, const char *path);
+extern void deleteMappedFile(struct MappedFile **mappedFilePtr);
+// Hash of the whole contents, caches use it to tell whether their source file changed
+extern uint64_t hashMappedFile(const struct MappedFile *mappedFile);
+
+// Writes a file next to a temporary one and moves it into place on commit, so a reader mapping the file
+// never sees it half written. Cache files are stored in the writing machine's byte order, they are local artifacts
+struct MappedFileWriter {
+    FILE *file;
+    char *path;
+    char *tempPath;
+};
+
+// path followed by extension, free with free()
+extern char *allocPathWithExtension(const char *path, const char *extension);
+extern bool allocMappedFileWriter(struct MappedFileWriter **writerPtr, const char *path);
+// Deleting a writer that was not committed removes everything it wrote
+extern void deleteMappedFileWriter(struct MappedFileWriter **writerPtr);
+// Closes the file and moves it into place, nothing is left behind when either fails
+extern bool commitMappedFileWriter(struct MappedFileWriter *writer);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PY3DENGINE_MESH_CACHE_H
+#define PY3DENGINE_MESH_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "mesh/vertex_format.h"
+#include "resources/model.h"
+
+// Imported meshes are written next to their source file as "<source><MESH_CACHE_EXTENSION>"
+#define MESH_CACHE_EXTENSION ".meshcache"
+#define MESH_CACHE_VERSION 4
+// Every vertex and index blob starts on this boundary inside the file
+#define MESH_CACHE_BLOB_ALIGNMENT 64
+#define MESH_CACHE_NAME_SIZE 72
+
+struct MeshCache;
+struct MeshCacheWriter;
+
+// One object's buffers exactly as they are uploaded, pointers stay valid until the cache is deleted
+struct MeshCacheObject {
+    const char *name;
+    struct VertexFormat format;
+    const void *vertices;
+    size_t numVertices;
+    const void *indices;
+    size_t indexSize;
+    size_t numIndices;
+    struct ModelLod lods[MODEL_MAX_LODS];
+    size_t numLods;
+    float boundsCenter[3];
+    float boundsRadius;
+};
+
+// Maps the cache that belongs to sourcePath, fails when there is none or when it was built from
+// a different version of the source
+extern bool allocMeshCache(struct MeshCache **cachePtr, const char *sourcePath);
+extern void deleteMeshCache(struct MeshCache **cachePtr);
+extern size_t getMeshCacheObjectCount(const struct MeshCache *cache);
+extern bool getMeshCacheObject(const struct MeshCache *cache, size_t index, struct MeshCacheObject *object);
+
+// Objects are streamed into a temporary file that only replaces the cache on commit,
+// deleting an uncommitted writer throws its output away
+extern bool allocMeshCacheWriter(struct MeshCacheWriter **writerPtr, const char *sourcePath, size_t maxObjects);
+extern void deleteMeshCacheWriter(struct MeshCacheWriter **writerPtr);
+extern bool appendMeshCacheObject(struct MeshCacheWriter *writer, const struct MeshCacheObject *object);
+extern bool commitMeshCacheWriter(struct MeshCacheWriter *writer);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PY3DENGINE_MESH_OPTIMIZER_H
+#define PY3DENGINE_MESH_OPTIMIZER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of entries the triangle reordering assumes the GPU's post transform cache holds,
+// small enough to behave well on hardware with a FIFO cache of any realistic size
+#define MESH_VERTEX_CACHE_SIZE 16
+
+struct VertexPNT;
+
+// Tipsify (Sander, Nehab, Barczak 2007), reorders triangles in place so consecutive triangles
+// reuse recently transformed vertices. Runs in linear time in the number of indices
+extern bool optimizeVertexCache(uint32_t *indices, size_t numIndices, size_t numVertices, unsigned int cacheSize);
+
+// Renumbers vertices in the order the index buffer first touches them, so vertex fetches walk memory forward
+extern bool optimizeVertexFetch(struct VertexPNT *vertices, size_t numVertices, uint32_t *indices, size_t numIndices);
+
+// Average number of vertices transformed per triangle with a FIFO cache of the given size, 0.5 is the best possible
+extern float calcAverageCacheMissRatio(const uint32_t *indices, size_t numIndices, size_t numVertices, unsigned int cacheSize);
+
+#endif
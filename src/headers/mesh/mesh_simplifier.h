@@ -0,0 +1,31 @@
+#ifndef PY3DENGINE_MESH_SIMPLIFIER_H
+#define PY3DENGINE_MESH_SIMPLIFIER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct VertexPNT;
+struct MeshSimplifier;
+
+// Quadric error metric edge collapse (Garland, Heckbert 1997). Vertices are never moved or created,
+// every collapse folds one vertex into a neighbour so all levels of detail share one vertex buffer.
+// Open borders and texture or normal seams are kept in place by constraint planes
+extern bool allocMeshSimplifier(
+    struct MeshSimplifier **simplifierPtr,
+    const struct VertexPNT *vertices, size_t numVertices,
+    const uint32_t *indices, size_t numIndices
+);
+extern void deleteMeshSimplifier(struct MeshSimplifier **simplifierPtr);
+
+// Continues from the previous result until at most targetNumIndices remain or no collapse below maxError
+// is left, returns the number of indices now in the simplified mesh
+extern size_t simplifyMesh(struct MeshSimplifier *simplifier, size_t targetNumIndices, float maxError);
+extern const uint32_t *getMeshSimplifierIndices(const struct MeshSimplifier *simplifier);
+// Largest distance between the simplified surface and the original one, in model units
+extern float getMeshSimplifierError(const struct MeshSimplifier *simplifier);
+
+// Bounding sphere around the vertices, centred on their bounding box
+extern void calcMeshBoundingSphere(const struct VertexPNT *vertices, size_t numVertices, float center[3], float *radius);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PY3DENGINE_VERTEX_FORMAT_H
+#define PY3DENGINE_VERTEX_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Attribute encodings, all of them are decoded by the vertex fetch hardware so shaders always see
+// a vec3 position, a vec3 normal and a vec2 texcoord regardless of how the model is stored
+#define VERTEX_POSITION_FLOAT3 0
+#define VERTEX_POSITION_SNORM16 1 // normalized over the mesh bounds, see VertexFormat.positionScale
+
+#define VERTEX_NORMAL_FLOAT3 0
+#define VERTEX_NORMAL_SNORM_10_10_10_2 1
+
+#define VERTEX_TEXCOORD_FLOAT2 0
+#define VERTEX_TEXCOORD_HALF2 1
+
+// Positions are only quantised when the step between two representable values stays below this,
+// in world units, so large meshes keep full precision
+#define VERTEX_POSITION_QUANTIZATION_TOLERANCE (1.0f / 1024.0f)
+// Half floats lose sub texel precision past this magnitude
+#define VERTEX_TEXCOORD_HALF_MAX_MAGNITUDE 1.0f
+
+struct VertexPNT;
+
+struct VertexFormat {
+    unsigned char position;
+    unsigned char normal;
+    unsigned char texCoord;
+    unsigned int stride;
+    unsigned int positionOffset;
+    unsigned int normalOffset;
+    unsigned int texCoordOffset;
+
+    // quantised positions decode as snorm * positionScale + positionBias
+    float positionScale[3];
+    float positionBias[3];
+};
+
+extern void initVertexFormatPNT(struct VertexFormat *format);
+extern bool isVertexFormatQuantized(const struct VertexFormat *format);
+
+// Picks the most compact encoding per attribute that keeps the mesh within the precision limits above
+extern void chooseVertexFormat(struct VertexFormat *format, const struct VertexPNT *vertices, size_t numVertices);
+// Returns a malloc'ed buffer of numVertices * format->stride bytes
+extern void *encodeVertices(const struct VertexFormat *format, const struct VertexPNT *vertices, size_t numVertices);
+
+// Row vector matrix that turns decoded quantised positions back into model space
+extern void calcVertexFormatDequantizationMatrix(const struct VertexFormat *format, float dst[16]);
+
+#endif
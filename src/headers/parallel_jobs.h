@@ -0,0 +1,20 @@
+#ifndef PY3DENGINE_PARALLEL_JOBS_H
+#define PY3DENGINE_PARALLEL_JOBS_H
+
+#include <stddef.h>
+
+#define PARALLEL_JOBS_MAX_THREADS 64
+
+typedef void (*ParallelJobFunction)(void *jobData, size_t jobIndex);
+
+// Number of threads a batch of jobs is spread over, the "worker_threads" config value or one per processor
+extern size_t getParallelJobWorkerCount();
+
+// Calls job(jobData, i) once for every i in [0, numJobs) and returns when all of them have finished.
+// The calling thread works through the batch alongside the pool's workers, jobs are handed out in index order.
+// Jobs run concurrently, so they must not touch python objects or the GL context
+extern void runParallelJobs(ParallelJobFunction job, void *jobData, size_t numJobs);
+// Stops the worker threads, the next batch starts them again
+extern void finalizeParallelJobs();
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PY3DCAMERA_H
+#define PY3DCAMERA_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+struct Py3dCamera;
+extern PyTypeObject Py3dCamera_Type;
+
+extern int PyInit_Py3dCamera(PyObject *module);
+extern int Py3dCamera_FindCtor(PyObject *module);
+extern void Py3dCamera_FinalizeCtor();
+extern struct Py3dCamera *Py3dCamera_New();
+extern int Py3dCamera_Check(PyObject *obj);
+
+extern float Py3dCamera_GetFovXInDegrees(struct Py3dCamera *self);
+extern float Py3dCamera_GetNearZ(struct Py3dCamera *self);
+extern float Py3dCamera_GetFarZ(struct Py3dCamera *self);
+
+// Bumped whenever a projection parameter changes so rendering contexts only rebuild the projection when needed
+extern unsigned int Py3dCamera_GetVersion(struct Py3dCamera *self);
+
+extern PyObject *Py3dCamera_Parse(struct Py3dCamera *self, PyObject *args, PyObject *kwds);
+
+#endif
@@ -9,6 +9,7 @@
 struct Py3dGameObject;
 struct Py3dCollisionEvent;
 struct Py3dScene;
+struct RenderQueue;
 extern PyTypeObject Py3dGameObject_Type;
 
 extern int PyInit_Py3dGameObject(PyObject *module);
@@ -32,6 +33,7 @@ extern PyObject *Py3dGameObject_Start(struct Py3dGameObject *self, PyObject *arg
 extern PyObject *Py3dGameObject_Activate(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dGameObject_Update(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dGameObject_Render(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
+extern void Py3dGameObject_FillRenderQueue(struct Py3dGameObject *self, PyObject *args, struct RenderQueue *queue);
 extern PyObject *Py3dGameObject_Deactivate(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dGameObject_End(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
 extern void Py3dGameObject_Collide(struct Py3dGameObject *self, struct Py3dCollisionEvent *event);
@@ -56,6 +58,10 @@ extern Py_ssize_t Py3dGameObject_GetComponentCountInt(struct Py3dGameObject *sel
 extern struct Py3dScene *Py3dGameObject_GetScene(struct Py3dGameObject *self);
 extern struct Py3dScene *Py3d_GetSceneForGameObject(struct Py3dGameObject *self);
 
+// Counters bumped by every position/orientation/scale change and every enable/visibility change
+extern unsigned int Py3dGameObject_GetTransformVersion(struct Py3dGameObject *self);
+extern unsigned int Py3dGameObject_GetStateVersion(struct Py3dGameObject *self);
+
 extern const float *Py3dGameObject_GetPositionFA(struct Py3dGameObject *self);
 extern PyObject *Py3dGameObject_GetPosition(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dGameObject_Move(struct Py3dGameObject *self, PyObject *args, PyObject *kwds);
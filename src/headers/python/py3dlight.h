@@ -21,6 +21,12 @@ extern void Py3dLight_GetAmbient(struct Py3dLight *self, float dst[3]);
 extern void Py3dLight_GetIntensity(struct Py3dLight *self, float *dst);
 extern void Py3dLight_GetAttenuation(struct Py3dLight *self, float dst[3]);
 
+// Bumped whenever a light parameter changes so the scene can skip re-marshalling unchanged lights
+extern unsigned int Py3dLight_GetVersion(struct Py3dLight *self);
+// Index of the light in its scene's light slot array, -1 while unregistered
+extern Py_ssize_t Py3dLight_GetSceneSlot(const struct Py3dLight *self);
+extern void Py3dLight_SetSceneSlot(struct Py3dLight *self, Py_ssize_t slot);
+
 extern PyObject *Py3dLight_Parse(struct Py3dLight *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dLight_Attach(struct Py3dLight *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dLight_Detach(struct Py3dLight *self, PyObject *args, PyObject *kwds);
@@ -7,12 +7,16 @@
 struct Model;
 struct Shader;
 struct Material;
+struct Py3dGameObject;
+struct RenderQueue;
 
 struct Py3dModelRenderer {
     PyObject_HEAD
     struct Shader *shader;
     struct Model *model;
     struct Material *material;
+    // level of detail drawn last frame, switching away from it needs a margin so models do not flicker
+    size_t lod;
 };
 
 extern int PyInit_Py3dModelRenderer(PyObject *module);
@@ -20,5 +24,6 @@ extern int Py3dModelRenderer_FindCtor(PyObject *module);
 extern void Py3dModelRenderer_FinalizeCtor();
 extern struct Py3dModelRenderer *Py3dModelRenderer_New();
 extern int Py3dModelRenderer_Check(PyObject *obj);
+extern int Py3dModelRenderer_Enqueue(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue);
 
 #endif
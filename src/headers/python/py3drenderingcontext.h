@@ -7,6 +7,23 @@
 struct Py3dScene;
 struct Py3dGameObject;
 struct Py3dRenderingContext;
+
+// Per frame values shared by every shader through the FrameBlock uniform buffer. Laid out std140:
+//   layout(std140, row_major, binding = 1) uniform FrameBlock {
+//       mat4 gViewMtx; mat4 gProjMtx; mat4 gVPMtx;
+//       vec3 gCamPosW; float gTime; vec2 gViewportSize;
+//   };
+// Matrices are stored row major, so shaders keep the "vec4(pos, 1.0) * mtx" convention
+struct FrameData {
+    float viewMtx[16];
+    float projMtx[16];
+    float vpMtx[16];
+    float camPosW[3];
+    float time;
+    float viewportSize[2];
+    float _pad[2];
+};
+
 extern PyTypeObject Py3dRenderingContext_Type;
 
 extern int PyInit_Py3dRenderingContext(PyObject *module);
@@ -15,9 +32,14 @@ extern void Py3dRenderingContext_FinalizeCtor();
 
 extern struct Py3dRenderingContext *Py3dRenderingContext_New(struct Py3dScene *scene);
 extern int Py3dRenderingContext_Check(PyObject *obj);
+// Brings the cached camera matrices up to date with the scene's active camera, once per frame
+extern int Py3dRenderingContext_BeginFrame(struct Py3dRenderingContext *self);
 extern int Py3dRenderingContext_SetCamera(struct Py3dRenderingContext *self, struct Py3dGameObject *newCamera);
 extern float* Py3dRenderingContext_GetCameraPosW(struct Py3dRenderingContext *self);
 extern float* Py3dRenderingContext_GetCameraVPMtx(struct Py3dRenderingContext *self);
+extern void Py3dRenderingContext_GetCameraDepthRange(struct Py3dRenderingContext *self, float *nearZ, float *farZ);
+extern float Py3dRenderingContext_GetCameraPixelScale(struct Py3dRenderingContext *self);
+extern void Py3dRenderingContext_GetFrameData(struct Py3dRenderingContext *self, struct FrameData *dst);
 
 #endif
 
@@ -4,15 +4,42 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include <stdbool.h>
+#include <stddef.h>
+
 struct Py3dScene;
-struct ListNode;
 struct BaseResource;
+struct ResourceNameSlot;
+struct ResourceTypeIndex;
+struct ResourceNameBlock;
+struct ResourceCacheEntry;
 
 struct Py3dResourceManager {
     PyObject_HEAD
     struct Py3dScene *owner;
 
-    struct ListNode *_root;
+    // every stored resource in the order it was stored. Resources without a cache entry are owned by
+    // the manager and deleted in this order, shared ones belong to the entry next to them
+    struct BaseResource **_resources;
+    struct ResourceCacheEntry **_resourceEntries;
+    size_t _numResources;
+    size_t _resourcesCapacity;
+
+    // open addressing table from interned name to position in _resources, unnamed resources have no slot
+    struct ResourceNameSlot *_slots;
+    size_t _slotsCapacity;
+    size_t _numSlotsUsed;
+
+    // resources of one type name each, in store order
+    struct ResourceTypeIndex *_typeIndexes;
+    size_t _numTypeIndexes;
+
+    struct ResourceNameBlock *_names;
+
+    // one reference to every resource cache entry this manager shows, released when the manager is cleared
+    struct ResourceCacheEntry **_heldEntries;
+    size_t _numHeldEntries;
+    size_t _heldEntriesCapacity;
 };
 
 extern PyTypeObject Py3dResourceManager_Type;
@@ -28,6 +55,20 @@ extern PyObject *Py3dResourceManager_GetOwner(struct Py3dResourceManager *self,
 extern void Py3dResourceManager_SetOwnerInC(struct Py3dResourceManager *self, struct Py3dScene *newOwner);
 
 extern void Py3dResourceManager_StoreResource(struct Py3dResourceManager *self, struct BaseResource *resource);
+extern size_t Py3dResourceManager_GetResourceCount(struct Py3dResourceManager *self);
+
+// Makes every resource of a cached import visible through this manager and holds the entry until the manager is cleared
+extern void Py3dResourceManager_StoreSharedResources(struct Py3dResourceManager *self, struct ResourceCacheEntry *entry);
+// Hands the resources stored since firstIndex over to a new resource cache entry under key. Fails, and
+// leaves them owned by this manager, when one of them points at a resource only this manager owns
+extern bool Py3dResourceManager_ShareResources(struct Py3dResourceManager *self, size_t firstIndex, const char *key);
+// Makes a resource this manager holds reachable under a second name, fails when the name is taken by another resource
+extern bool Py3dResourceManager_AliasResource(struct Py3dResourceManager *self, const char *alias, struct BaseResource *resource);
 extern struct BaseResource *Py3dResourceManager_GetResource(struct Py3dResourceManager *self, const char *name);
+// False when nothing is stored under name. The entry is NULL for resources only this manager owns
+extern bool Py3dResourceManager_GetResourceEntry(struct Py3dResourceManager *self, const char *name, struct ResourceCacheEntry **entryOut);
+extern struct BaseResource *Py3dResourceManager_GetResourceOfType(struct Py3dResourceManager *self, const char *name, const char *typeName);
+// The returned array is valid until the next resource is stored
+extern size_t Py3dResourceManager_GetResourcesOfType(struct Py3dResourceManager *self, const char *typeName, struct BaseResource *const **resourcesOut);
 
 #endif
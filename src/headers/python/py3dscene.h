@@ -5,12 +5,18 @@
 #include <Python.h>
 
 #include <GLFW/glfw3.h>
+#include <stdbool.h>
 
 struct PhysicsSpace;
 struct Py3dResourceManager;
 struct LightData;
 struct Py3dLight;
-struct LightListNode;
+struct LightSlot;
+struct RenderQueue;
+struct UniformBuffer;
+struct LightClusters;
+struct DeferredRenderer;
+struct Py3dRenderingContext;
 
 struct Py3dScene {
     PyObject_HEAD
@@ -25,7 +31,21 @@ struct Py3dScene {
     int cursorMode;
     struct LightData *lightData;
     ssize_t numLights;
-    struct LightListNode *lightList;
+    size_t lightDataCapacity;
+    unsigned int lightDataVersion;
+    unsigned int lightBlockVersion;
+    struct LightSlot *lightSlots;
+    Py_ssize_t numLightSlots;
+    Py_ssize_t lightSlotCapacity;
+    struct RenderQueue *renderQueue;
+    struct UniformBuffer *lightBlock;
+    struct UniformBuffer *frameBlock;
+    struct LightClusters *lightClusters;
+    unsigned int clusterLightVersion;
+    bool lightClustersBuilt;
+    int renderPath;
+    struct DeferredRenderer *deferred;
+    struct Py3dRenderingContext *renderingContext;
 };
 extern PyTypeObject Py3dScene_Type;
 
@@ -63,6 +83,12 @@ PyObject *Py3dScene_SetCursorMode(struct Py3dScene *self, PyObject *args, PyObje
 
 extern void Py3dScene_GetDynamicLightData(struct Py3dScene *self, struct LightData **lightDataPtr, size_t *numLightsPtr);
 extern void Py3dScene_MarshalLightData(struct Py3dScene *self);
+extern void Py3dScene_UploadLightData(struct Py3dScene *self);
+extern void Py3dScene_PrepareLightClusters(struct Py3dScene *self, struct Py3dRenderingContext *rc);
+extern void Py3dScene_UploadFrameData(struct Py3dScene *self, struct Py3dRenderingContext *rc);
+extern void Py3dScene_SetRenderPath(struct Py3dScene *self, int renderPath);
+extern int Py3dScene_GetRenderPath(struct Py3dScene *self);
+extern struct DeferredRenderer *Py3dScene_GetDeferredRenderer(struct Py3dScene *self);
 
 extern int Py3dScene_RegisterLight(struct Py3dScene *self, struct Py3dLight *newLightComponent);
 extern int Py3dScene_UnRegisterLight(struct Py3dScene *self, const struct Py3dLight *lightComponent);
@@ -7,6 +7,8 @@
 struct Sprite;
 struct Model;
 struct Shader;
+struct Py3dGameObject;
+struct RenderQueue;
 
 struct Py3dSpriteRenderer {
     PyObject_HEAD
@@ -22,6 +24,7 @@ extern void Py3dSpriteRenderer_FinalizeCtor();
 
 extern int Py3dSpriteRenderer_Check(PyObject *obj);
 extern struct Py3dSpriteRenderer *Py3dSpriteRenderer_New();
+extern int Py3dSpriteRenderer_Enqueue(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue);
 extern PyObject *Py3dSpriteRenderer_Render(struct Py3dSpriteRenderer *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dSpriteRenderer_Parse(struct Py3dSpriteRenderer *self, PyObject *args, PyObject *kwds);
 
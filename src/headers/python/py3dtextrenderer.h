@@ -5,12 +5,15 @@
 #include <Python.h>
 
 struct Py3dTextRenderer;
+struct Py3dGameObject;
+struct RenderQueue;
 extern PyTypeObject Py3dTextRenderer_Type;
 
 extern int PyInit_Py3dTextRenderer(PyObject *module);
 
 extern int Py3dTextRenderer_Check(PyObject *obj);
 extern struct Py3dTextRenderer *Py3dTextRenderer_New();
+extern int Py3dTextRenderer_Enqueue(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue);
 extern PyObject *Py3dTextRenderer_Render(struct Py3dTextRenderer *self, PyObject *args, PyObject *kwds);
 extern PyObject *Py3dTextRenderer_Parse(struct Py3dTextRenderer *self, PyObject *args, PyObject *kwds);
 
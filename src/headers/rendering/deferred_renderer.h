@@ -0,0 +1,63 @@
+#ifndef PY3DENGINE_DEFERRED_RENDERER_H
+#define PY3DENGINE_DEFERRED_RENDERER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RENDER_PATH_FORWARD 0
+#define RENDER_PATH_DEFERRED 1
+
+// G-buffer attachments, all sampled by the lighting passes through the matching texture unit
+#define GBUFFER_POSITION 0 // world position, alpha is 1 where geometry was drawn
+#define GBUFFER_NORMAL 1   // world normal, alpha holds the material's specular power
+#define GBUFFER_DIFFUSE 2  // material diffuse map
+#define GBUFFER_SPECULAR 3 // material specular color
+#define GBUFFER_AMBIENT 4  // material ambient color
+#define GBUFFER_NUM_COLOR_TARGETS 5
+#define GBUFFER_DEPTH_UNIT GBUFFER_NUM_COLOR_TARGETS
+
+#define DEFERRED_NUM_LIGHT_UNIFORMS 5
+
+struct Shader;
+struct LightData;
+struct FrameData;
+
+// Deferred shading: models are drawn once into the G-buffer, then every light is accumulated
+// over the screen rectangle its range covers, so lighting cost follows covered pixels instead of
+// objects times lights. Only needs GL 4.5 core features so it also runs on Mesa's llvmpipe.
+struct DeferredRenderer {
+    unsigned int _fbo;
+    unsigned int _colorTargets[GBUFFER_NUM_COLOR_TARGETS];
+    unsigned int _depthTarget;
+    int _width;
+    int _height;
+
+    // empty vertex array for the full screen triangle, core profile refuses to draw without one
+    unsigned int _screenVao;
+
+    struct Shader *_geometryShader;
+    struct Shader *_ambientShader;
+    struct Shader *_lightShader;
+    int _lightUniforms[DEFERRED_NUM_LIGHT_UNIFORMS];
+};
+
+extern void allocDeferredRenderer(struct DeferredRenderer **rendererPtr);
+extern void deleteDeferredRenderer(struct DeferredRenderer **rendererPtr);
+
+extern struct Shader *getDeferredGeometryShader(struct DeferredRenderer *renderer);
+
+// Creates or resizes the G-buffer. Has to succeed before packets are queued with the geometry
+// shader, they can not be drawn anywhere else
+extern bool prepareDeferredGeometryPass(struct DeferredRenderer *renderer, int width, int height);
+extern void beginDeferredGeometryPass(struct DeferredRenderer *renderer);
+extern void endDeferredGeometryPass(struct DeferredRenderer *renderer);
+extern void drawDeferredLighting(
+    struct DeferredRenderer *renderer,
+    const struct LightData *lights,
+    size_t numLights,
+    const struct FrameData *frameData,
+    float nearZ,
+    float farZ
+);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PY3DENGINE_GL_STATE_H
+#define PY3DENGINE_GL_STATE_H
+
+#include <stddef.h>
+
+// Tracks the program, vertex array and 2D texture bindings last issued through these functions so
+// redundant binds never reach the driver. All engine code must bind through here (or call
+// invalidateGLStateCache) for the cache to stay truthful.
+#define GL_STATE_MAX_TEXTURE_UNITS 16
+
+struct GLStateCounters {
+    size_t programBinds;
+    size_t programBindsAvoided;
+    size_t vertexArrayBinds;
+    size_t vertexArrayBindsAvoided;
+    size_t textureBinds;
+    size_t textureBindsAvoided;
+    size_t activeTextureChanges;
+    size_t activeTextureChangesAvoided;
+};
+
+extern void useGLProgram(unsigned int program);
+extern void bindGLVertexArray(unsigned int vao);
+extern void bindGLTexture2D(unsigned int unit, unsigned int texture);
+
+// must be called when an object is deleted, GL reuses names and a stale entry would skip a real bind
+extern void forgetGLProgram(unsigned int program);
+extern void forgetGLVertexArray(unsigned int vao);
+extern void forgetGLTexture2D(unsigned int texture);
+extern void invalidateGLStateCache();
+
+// counters accumulate over a frame, ending the frame publishes them as the last frame's totals
+extern void endGLStateFrame();
+extern void getGLStateLastFrameCounters(struct GLStateCounters *dst);
+
+// PY3D_GL_DEBUG builds check glGetError after risky calls. Release builds never query the driver
+// because glGetError forces it to synchronise with the render thread
+#ifdef PY3D_GL_DEBUG
+extern void checkGLError(const char *what);
+#else
+#define checkGLError(what) ((void) 0)
+#endif
+
+#endif
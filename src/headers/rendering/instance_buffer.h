@@ -0,0 +1,37 @@
+#ifndef PY3DENGINE_INSTANCE_BUFFER_H
+#define PY3DENGINE_INSTANCE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Per instance vertex attributes consumed by instanced shader variants:
+//   layout(location = 3) in mat4 instWMtx;
+//   layout(location = 7) in mat4 instWITMtx;
+// Matrices are stored transposed so that "vec4(posL, 1.0) * instWMtx" matches the
+// row vector convention the non instanced shaders use with gWMtx
+#define INSTANCE_W_MTX_ATTRIB_INDEX 3
+#define INSTANCE_WIT_MTX_ATTRIB_INDEX 7
+// Vertex buffer binding every instance attribute reads from, model attributes use the slots below it
+#define INSTANCE_BUFFER_BINDING INSTANCE_W_MTX_ATTRIB_INDEX
+
+struct InstanceData {
+    float wMtx[16];
+    float witMtx[16];
+};
+
+struct InstanceBuffer {
+    unsigned int _vbo;
+    size_t _gpuCapacity;
+    struct InstanceData *_instances;
+    size_t _numInstances;
+    size_t _capacity;
+};
+
+extern void allocInstanceBuffer(struct InstanceBuffer **bufferPtr);
+extern void deleteInstanceBuffer(struct InstanceBuffer **bufferPtr);
+
+extern void beginInstanceBufferFrame(struct InstanceBuffer *buffer, size_t maxInstances);
+extern bool appendInstance(struct InstanceBuffer *buffer, const float wMtx[16], const float witMtx[16]);
+extern void uploadInstances(struct InstanceBuffer *buffer, size_t firstInstance, size_t numInstances);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef PY3DENGINE_LIGHT_CLUSTERS_H
+#define PY3DENGINE_LIGHT_CLUSTERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The view frustum is split into X * Y screen tiles and Z exponentially spaced depth slices
+#define LIGHT_CLUSTER_GRID_X 16
+#define LIGHT_CLUSTER_GRID_Y 9
+#define LIGHT_CLUSTER_GRID_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_GRID_X * LIGHT_CLUSTER_GRID_Y * LIGHT_CLUSTER_GRID_Z)
+
+// A light stops being assigned to a cluster once its attenuated contribution drops below this
+#define LIGHT_CLUSTER_INFLUENCE_CUTOFF (1.0f / 256.0f)
+
+struct LightData;
+
+// Clustered forward lighting. Every registered light is binned on the CPU into the clusters its
+// range overlaps, shaders walk only the lights of the cluster a fragment falls into:
+//   layout(std430, binding = 0) readonly buffer ClusterLightBuffer { Light gClusterLights[]; };
+//   layout(std430, binding = 1) readonly buffer ClusterGridBuffer {
+//       uvec4 gClusterDims;        // grid x, y, z and total light count
+//       vec4 gClusterDepthParams;  // slice scale, slice bias, near, far
+//       uvec2 gClusters[];         // offset into gClusterLightIndices, light count
+//   };
+//   layout(std430, binding = 2) readonly buffer ClusterIndexBuffer { uint gClusterLightIndices[]; };
+// A fragment finds its cluster with
+//   uvec2 tile = uvec2(gl_FragCoord.xy / gViewportSize * vec2(gClusterDims.xy));
+//   uint slice = uint(max(log(1.0 / gl_FragCoord.w) * gClusterDepthParams.x + gClusterDepthParams.y, 0.0));
+//   uint cluster = tile.x + gClusterDims.x * (tile.y + gClusterDims.y * min(slice, gClusterDims.z - 1));
+// The Light struct matches the one documented in lights.h, std430 gives it the same layout
+struct LightClusterHeader {
+    uint32_t dims[4];
+    float depthParams[4];
+};
+
+struct LightClusterBounds;
+
+struct LightClusters {
+    unsigned int _lightSsbo;
+    size_t _lightSsboSize;
+    unsigned int _gridSsbo;
+    unsigned int _indexSsbo;
+    size_t _indexSsboSize;
+
+    struct LightClusterHeader _header;
+    uint32_t *_grid;
+    uint32_t *_indices;
+    size_t _numIndices;
+    size_t _indexCapacity;
+
+    struct LightClusterBounds *_bounds;
+    size_t _boundsCapacity;
+};
+
+extern float calcLightInfluenceRange(const struct LightData *light);
+extern bool calcLightScreenBounds(
+    const float viewPos[3],
+    float range,
+    const float projMtx[16],
+    float nearZ,
+    float farZ,
+    float ndcMin[2],
+    float ndcMax[2],
+    float depthRange[2]
+);
+
+extern void allocLightClusters(struct LightClusters **clustersPtr);
+extern void deleteLightClusters(struct LightClusters **clustersPtr);
+
+extern bool buildLightClusters(
+    struct LightClusters *clusters,
+    const struct LightData *lights,
+    size_t numLights,
+    const float viewMtx[16],
+    const float projMtx[16],
+    float nearZ,
+    float farZ
+);
+extern void uploadLightClusterLights(struct LightClusters *clusters, const struct LightData *lights, size_t numLights);
+extern void uploadLightClusters(struct LightClusters *clusters);
+extern void bindLightClusters(struct LightClusters *clusters);
+
+#endif
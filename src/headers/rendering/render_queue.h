@@ -0,0 +1,112 @@
+#ifndef PY3DENGINE_RENDER_QUEUE_H
+#define PY3DENGINE_RENDER_QUEUE_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Packets are drawn layer by layer: lit models first, then sprites, then screen space text.
+// Models are sorted by state inside their layer, sprites and text keep the order they were queued in.
+// Python render calls are queued in the sprite layer, so they keep scene graph order with sprites
+#define DRAW_PACKET_LAYER_MODEL 0
+#define DRAW_PACKET_LAYER_SPRITE 1
+#define DRAW_PACKET_LAYER_TEXT 2
+
+struct Shader;
+struct Material;
+struct Texture;
+struct Model;
+struct Py3dScene;
+struct Py3dGameObject;
+struct Py3dRenderingContext;
+struct DrawPacket;
+struct InstanceBuffer;
+struct SpriteBatch;
+
+// Describes what the queue had to (re)bind before handing a packet to its draw function.
+// Draw functions use the "changed" flags to skip re-uploading uniforms that are still current.
+struct RenderQueueState {
+    struct Py3dScene *scene;
+    struct Py3dRenderingContext *rc;
+    struct Shader *shader;
+    struct Material *material;
+    struct Texture *texture;
+    struct Model *model;
+    struct InstanceBuffer *instances;
+    struct SpriteBatch *sprites;
+    bool shaderChanged;
+    bool materialChanged;
+    bool textureChanged;
+    bool modelChanged;
+    // set by draw functions that bind GL objects without the queue, the next run binds everything again
+    bool stateLost;
+};
+
+// Called once per run of consecutive packets that share shader, material, texture, model, level of detail
+// and draw function
+typedef void (*DrawPacketFunc)(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state);
+
+struct DrawPacket {
+    uint64_t sortKey;
+    size_t sequence;
+    struct Shader *shader;
+    struct Material *material;
+    struct Texture *texture;
+    struct Model *model;
+    size_t lod;
+    PyObject *renderer;
+    struct Py3dGameObject *owner;
+    DrawPacketFunc draw;
+};
+
+struct RenderQueue {
+    struct DrawPacket *packets;
+    size_t numPackets;
+    size_t capacity;
+    struct InstanceBuffer *instances;
+    struct SpriteBatch *sprites;
+
+    // when set, builtin model renderers draw with this shader instead of their own, the deferred path
+    // points it at the G-buffer shader while the queue is filled
+    struct Shader *geometryShader;
+    // the camera the queue is filled for, renderers use it to pick a level of detail
+    struct Py3dRenderingContext *rc;
+};
+
+extern void allocRenderQueue(struct RenderQueue **queuePtr);
+extern void deleteRenderQueue(struct RenderQueue **queuePtr);
+extern void clearRenderQueue(struct RenderQueue *queue);
+
+extern uint64_t calcDrawPacketSortKey(
+    unsigned int layer,
+    struct Shader *shader,
+    struct Material *material,
+    struct Texture *texture,
+    struct Model *model
+);
+extern struct DrawPacket *pushDrawPacket(
+    struct RenderQueue *queue,
+    unsigned int layer,
+    struct Shader *shader,
+    struct Material *material,
+    struct Texture *texture,
+    struct Model *model,
+    PyObject *renderer,
+    struct Py3dGameObject *owner,
+    DrawPacketFunc draw
+);
+extern void setDrawPacketLod(struct DrawPacket *packet, size_t lod);
+extern void sortRenderQueue(struct RenderQueue *queue);
+extern void submitRenderQueue(struct RenderQueue *queue, struct Py3dScene *scene, struct Py3dRenderingContext *rc);
+// Draws only the packets whose layer lies in [firstLayer, lastLayer], used when passes have to run between layers
+extern void submitRenderQueueLayers(
+    struct RenderQueue *queue,
+    struct Py3dScene *scene,
+    struct Py3dRenderingContext *rc,
+    unsigned int firstLayer,
+    unsigned int lastLayer
+);
+
+#endif
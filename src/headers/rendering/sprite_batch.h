@@ -0,0 +1,27 @@
+#ifndef PY3DENGINE_SPRITE_BATCH_H
+#define PY3DENGINE_SPRITE_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct Model;
+struct VertexPNT;
+
+// Collects sprites that share a sheet as pre-transformed quads and draws them with one call.
+// Positions are written in world space and coordinates already point into the sheet, so the
+// sprite shader draws a batch with identity gWMtx and gTexMtx
+struct SpriteBatch {
+    struct Model *_model;
+    struct VertexPNT *_vertices;
+    size_t _numSprites;
+    size_t _capacity;
+};
+
+extern void allocSpriteBatch(struct SpriteBatch **batchPtr);
+extern void deleteSpriteBatch(struct SpriteBatch **batchPtr);
+
+extern void beginSpriteBatch(struct SpriteBatch *batch, size_t maxSprites);
+extern bool appendSprite(struct SpriteBatch *batch, const float wMtx[16], const float texMtx[9]);
+extern void flushSpriteBatch(struct SpriteBatch *batch);
+
+#endif
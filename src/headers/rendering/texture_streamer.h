@@ -0,0 +1,17 @@
+#ifndef PY3DENGINE_RENDERING_TEXTURE_STREAMER_H
+#define PY3DENGINE_RENDERING_TEXTURE_STREAMER_H
+
+struct Texture;
+
+// Uploads the finer mip levels of queued textures through a pixel unpack buffer, coarsest levels
+// first and within the configured per frame budget. Textures stay bindable the whole time, they
+// just sample from the finest level that has arrived so far
+extern void queueTextureStreaming(struct Texture *texture);
+extern void cancelTextureStreaming(struct Texture *texture);
+
+// Called once per frame before rendering
+extern void updateTextureStreaming();
+// Releases the pixel buffer, must run while the GL context is still current
+extern void finalizeTextureStreaming();
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef PY3DENGINE_UNIFORM_BUFFER_H
+#define PY3DENGINE_UNIFORM_BUFFER_H
+
+#include <stddef.h>
+
+// A uniform buffer object that is refilled wholesale (typically once per frame) and attached to
+// one of the fixed binding points declared in resources/shader.h
+struct UniformBuffer {
+    unsigned int _ubo;
+    unsigned int _binding;
+    size_t _size;
+};
+
+extern void allocUniformBuffer(struct UniformBuffer **bufferPtr, unsigned int binding);
+extern void deleteUniformBuffer(struct UniformBuffer **bufferPtr);
+
+extern void updateUniformBuffer(struct UniformBuffer *buffer, const void *data, size_t size);
+extern void bindUniformBuffer(struct UniformBuffer *buffer);
+extern size_t getUniformBufferSize(struct UniformBuffer *buffer);
+
+#endif
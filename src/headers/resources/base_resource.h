@@ -2,19 +2,38 @@
 #define PY3DENGINE_BASE_RESOURCE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Most resources a single resource can point at, see getDependencies
+#define RESOURCE_MAX_DEPENDENCIES 4
 
 struct String;
 
 struct BaseResource {
+    unsigned int _id;
     unsigned int _type;
     struct String *_typeName;
     struct String *_name;
     void (*delete)(struct BaseResource **);
+    // other resources this one points at and must not outlive, NULL when there are none
+    size_t (*getDependencies)(struct BaseResource *, struct BaseResource *dependencies[RESOURCE_MAX_DEPENDENCIES]);
+
+    // residency bookkeeping, see resources/residency.h. Resources that can give their GL objects
+    // back and rebuild them later set evict and restore, everything else is only accounted for
+    size_t _gpuBytes;
+    uint64_t _lastUsedFrame;
+    bool _evicted;
+    bool (*evict)(struct BaseResource *);
+    bool (*restore)(struct BaseResource *);
+    struct BaseResource *_lruPrev;
+    struct BaseResource *_lruNext;
 };
 
 extern void initializeBaseResource(struct BaseResource *resource);
 extern void finalizeBaseResource(struct BaseResource *resource);
 extern void deleteResource(struct BaseResource **resource);
+extern size_t getResourceDependencies(struct BaseResource *resource, struct BaseResource *dependencies[RESOURCE_MAX_DEPENDENCIES]);
 
 extern bool resourceTypesEqual(struct BaseResource *r1, struct BaseResource *r2);
 extern bool resourceNamesEqual(struct BaseResource *r1, struct BaseResource *r2);
@@ -24,4 +43,6 @@ extern void setResourceName(struct BaseResource *resource, const char *newName);
 
 extern struct String *getResourceTypeName(struct BaseResource *resource);
 
+extern unsigned int getResourceId(struct BaseResource *resource);
+
 #endif
@@ -1,11 +1,14 @@
 #ifndef PY3DENGINE_MODEL_H
 #define PY3DENGINE_MODEL_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "resources/base_resource.h"
+#include "mesh/vertex_format.h"
 
 #define RESOURCE_TYPE_NAME_MODEL "Model"
+#define MODEL_MAX_LODS 8
 
 struct VertexPNT {
     float position[3];
@@ -13,12 +16,40 @@ struct VertexPNT {
     float texCoord[2];
 };
 
+// A range of the model's index buffer that draws the whole mesh at a lower level of detail,
+// error is the largest distance to the full detail surface in model units
+struct ModelLod {
+    size_t firstIndex;
+    size_t numIndices;
+    float error;
+};
+
+struct ModelEvictedData;
+
 struct Model {
     struct BaseResource _base;
 
     unsigned int _vao;
     unsigned int _vbo;
     size_t _sizeInVertices;
+    bool _hasInstanceAttribs;
+
+    // indexed models draw with glDrawElements, indices are 16 bit whenever every vertex fits
+    unsigned int _ibo;
+    size_t _sizeInIndices;
+    unsigned int _indexType;
+
+    // every level of detail shares the vertex buffer, level 0 is the full detail mesh
+    struct ModelLod _lods[MODEL_MAX_LODS];
+    size_t _numLods;
+    float _boundsCenter[3];
+    float _boundsRadius;
+
+    // CPU copies of the buffers while the GL objects are evicted, see resources/residency.h
+    struct ModelEvictedData *_evicted;
+
+    struct VertexFormat _format;
+    float _dequantizationMtx[16];
 };
 
 extern bool isResourceTypeModel(struct BaseResource *resource);
@@ -26,9 +57,23 @@ extern void allocModel(struct Model **modelPtr);
 extern void deleteModel(struct Model **modelPtr);
 
 extern void setModelPNTBuffer(struct Model *model, struct VertexPNT *buffer, size_t bufferSizeInVertices);
+extern void setModelVertexBuffer(struct Model *model, const void *vertices, size_t numVertices, const struct VertexFormat *format);
+extern void setModelIndexBuffer(struct Model *model, const uint32_t *indices, size_t numIndices);
+extern void setModelPackedIndexBuffer(struct Model *model, const void *indices, size_t numIndices, size_t indexSize);
+extern size_t packModelIndices(uint32_t *indices, size_t numIndices, size_t numVertices);
+extern void setModelLods(struct Model *model, const struct ModelLod *lods, size_t numLods);
+extern void setModelBounds(struct Model *model, const float center[3], float radius);
+extern size_t selectModelLod(const struct Model *model, float pixelsPerUnit, size_t currentLod, float maxPixelError);
+extern const float *calcModelWorldMatrix(const struct Model *model, const float wMtx[16], float scratch[16]);
 
+extern void updateModelPNTBuffer(struct Model *model, struct VertexPNT *buffer, size_t bufferSizeInVertices);
 extern void bindModel(struct Model *model);
 extern void unbindModel(struct Model *model);
 extern void renderModel(struct Model *model);
+extern void renderModelLod(struct Model *model, size_t lod);
+
+extern void setModelInstanceBuffer(struct Model *model, unsigned int instanceVbo);
+extern void renderModelInstanced(struct Model *model, size_t numInstances, size_t firstInstance);
+extern void renderModelInstancedLod(struct Model *model, size_t lod, size_t numInstances, size_t firstInstance);
 
 #endif
@@ -0,0 +1,30 @@
+#ifndef PY3DENGINE_RESOURCES_RESIDENCY_H
+#define PY3DENGINE_RESOURCES_RESIDENCY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct BaseResource;
+
+// Tracks how much GPU memory resources hold and evicts the least recently used ones once the
+// configured budget is exceeded. Evicted resources rebuild their GL objects the next time they are used
+
+// Called by resources whenever their GL objects change size, 0 means they hold nothing
+extern void setResourceGpuBytes(struct BaseResource *resource, size_t numBytes);
+extern size_t getResourceGpuBytes(struct BaseResource *resource);
+
+// Stamps the resource with the current frame and restores it when it was evicted. Called at bind time,
+// returns false when the resource has no GL objects to use
+extern bool useResource(struct BaseResource *resource);
+extern bool isResourceEvicted(struct BaseResource *resource);
+extern bool evictResource(struct BaseResource *resource);
+extern void forgetResourceResidency(struct BaseResource *resource);
+
+// Evicts resources that went unused for the configured number of frames until the total fits the
+// budget, then starts the next frame. Must run while no draw is pending
+extern void endResidencyFrame();
+extern uint64_t getResidencyFrame();
+extern size_t getResidentGpuBytes();
+
+#endif
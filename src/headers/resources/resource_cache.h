@@ -0,0 +1,40 @@
+#ifndef PY3DENGINE_RESOURCES_RESOURCE_CACHE_H
+#define PY3DENGINE_RESOURCES_RESOURCE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct String;
+struct BaseResource;
+struct ResourceCacheEntry;
+
+// Process wide store for everything one import produced, keyed by the imported file's canonical path
+// and the parameters it was imported with. Scenes that import the same thing share one copy, the
+// resources are deleted when the last reference to their entry is released
+
+// Absolute path with every link and "." or ".." resolved, NULL when the file does not exist. Free with free()
+extern char *allocCanonicalPath(const char *path);
+extern void buildResourceCacheKey(struct String **keyPtr, const char *path, const char *params);
+extern bool hasResourceCacheEntry(const char *key);
+
+// Returns a new reference, or NULL when nothing is cached under key
+extern struct ResourceCacheEntry *acquireResourceCacheEntry(const char *key);
+// Takes ownership of the resources and returns the first reference to the new entry. The entry keeps
+// its dependencies alive, because its resources point into theirs
+extern struct ResourceCacheEntry *addResourceCacheEntry(
+    const char *key,
+    struct BaseResource **resources,
+    size_t numResources,
+    struct ResourceCacheEntry **dependencies,
+    size_t numDependencies
+);
+extern void retainResourceCacheEntry(struct ResourceCacheEntry *entry);
+extern void releaseResourceCacheEntry(struct ResourceCacheEntry **entryPtr);
+
+extern size_t getResourceCacheEntryResources(struct ResourceCacheEntry *entry, struct BaseResource *const **resourcesOut);
+extern const char *getResourceCacheEntryKey(struct ResourceCacheEntry *entry);
+
+// Reports entries that are still referenced at shutdown and leaks them, releasing one afterwards does nothing
+extern void finalizeResourceCache();
+
+#endif
@@ -7,8 +7,27 @@
 
 #define RESOURCE_TYPE_NAME_SHADER "Shader"
 
+// Uniform buffer binding points shared by every shader program. A program that declares a block
+// with the matching name is attached to the binding when it is linked
+#define SHADER_LIGHT_BLOCK_BINDING 0
+#define SHADER_LIGHT_BLOCK_NAME "LightBlock"
+#define SHADER_FRAME_BLOCK_BINDING 1
+#define SHADER_FRAME_BLOCK_NAME "FrameBlock"
+#define SHADER_NUM_UNIFORM_BLOCK_BINDINGS 2
+
+// Shader storage buffer binding points used by clustered lighting, see rendering/light_clusters.h
+#define SHADER_CLUSTER_LIGHT_BUFFER_BINDING 0
+#define SHADER_CLUSTER_LIGHT_BUFFER_NAME "ClusterLightBuffer"
+#define SHADER_CLUSTER_GRID_BUFFER_BINDING 1
+#define SHADER_CLUSTER_GRID_BUFFER_NAME "ClusterGridBuffer"
+#define SHADER_CLUSTER_INDEX_BUFFER_BINDING 2
+#define SHADER_CLUSTER_INDEX_BUFFER_NAME "ClusterIndexBuffer"
+#define SHADER_NUM_STORAGE_BLOCK_BINDINGS 3
+
+#define SHADER_INVALID_UNIFORM_HANDLE -1
+
 struct Texture;
-struct UniformListNode;
+struct ShaderUniform;
 
 struct Shader {
     struct BaseResource _base;
@@ -17,7 +36,19 @@ struct Shader {
     unsigned int _fragShader;
     unsigned int _program;
 
-    struct UniformListNode *uniformList;
+    // active uniforms with a location, addressed by handle (index) or by name through the hash table
+    struct ShaderUniform *_uniforms;
+    size_t _numUniforms;
+    int *_uniformTable;
+    size_t _uniformTableSize;
+
+    // data size of each shared uniform block declared by the program, 0 when it is not declared
+    size_t _uniformBlockSizes[SHADER_NUM_UNIFORM_BLOCK_BINDINGS];
+    bool _storageBlocksDeclared[SHADER_NUM_STORAGE_BLOCK_BINDINGS];
+
+    // optional variant that reads world matrices from per instance attributes, owned by this shader
+    struct Shader *_instancedVariant;
+    bool _isInstanced;
 };
 
 extern bool isResourceTypeShader(struct BaseResource *resource);
@@ -27,9 +58,20 @@ extern void deleteShader(struct Shader **shaderPtr);
 
 extern void initShaderFromFiles(struct Shader *shader, const char *vertexShaderFileName, const char *fragShaderFileName);
 extern void initShader(struct Shader *shader, const char *vertexShaderSource, const char *fragShaderSource);
+extern void setShaderInstancedVariant(struct Shader *shader, struct Shader *instancedVariant);
+extern struct Shader *getShaderInstancedVariant(struct Shader *shader);
+extern bool isShaderInstanced(struct Shader *shader);
+extern size_t getShaderUniformBlockSize(struct Shader *shader, unsigned int binding);
+extern bool isShaderStorageBlockDeclared(struct Shader *shader, unsigned int binding);
 extern void enableShader(struct Shader *shader);
 extern void disableShader(struct Shader *shader);
 
+// Handles stay valid for the lifetime of the shader, resolve them once and set uniforms without a name lookup
+extern int getShaderUniformHandle(struct Shader *shader, const char *name);
+extern bool setShaderFloatArrayUniformByHandle(struct Shader *shader, int handle, const float *src, size_t numElements);
+extern bool setShaderMatrixUniformByHandle(struct Shader *shader, int handle, const float *src, size_t dimensions);
+extern bool setShaderIntUniformByHandle(struct Shader *shader, int handle, const GLint *src, size_t dimensions);
+
 extern bool setShaderFloatArrayUniform(struct Shader *shader, const char *name, const float *src, size_t numElements);
 extern bool setShaderMatrixUniform(struct Shader *shader, const char *name, const float *src, size_t dimensions);
 extern bool setShaderIntUniform(struct Shader *shader, const char *name, const GLint *src, size_t dimensions);
@@ -4,15 +4,29 @@
 #define RESOURCE_TYPE_NAME_TEXTURE "Texture"
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "resources/base_resource.h"
 
+struct String;
+struct TextureEvictedData;
+struct TextureImage;
+
 struct Texture {
     struct BaseResource base;
 
     unsigned int _id;
     int _width;
     int _height;
+    int _numLevels;
+
+    // levels below the base level are still waiting in _stream for the texture streamer
+    int _baseLevel;
+    struct TextureImage *_stream;
+
+    // evicted textures reload from their source file, or from a CPU copy when they were built at runtime
+    struct String *_sourcePath;
+    struct TextureEvictedData *_evicted;
 };
 
 extern bool isResourceTypeTexture(struct BaseResource *resource);
@@ -20,10 +34,20 @@ extern void allocTexture(struct Texture **texturePtr);
 extern void deleteTexture(struct Texture **texturePtr);
 
 extern void initTexture(struct Texture *texture, const char *fileName);
+// Takes ownership of the image on success. The coarsest levels are uploaded right away, the rest are streamed
+extern bool initTextureFromImage(struct Texture *texture, struct TextureImage *image, const char *sourcePath);
+extern void initEmptyTexture(struct Texture *texture, int width, int height);
+extern void setTextureRegion(struct Texture *texture, int x, int y, int width, int height, const unsigned char *rgbaPixels);
 extern void setTextureParam(struct Texture *texture, const char *paramName, const char *paramValue);
+extern void bindTexture(struct Texture *texture, unsigned int unit);
 
 extern unsigned int getTextureId(struct Texture *texture);
 extern int getTextureWidth(struct Texture *texture);
 extern int getTextureHeight(struct Texture *texture);
 
+// Used by the texture streamer, streamTextureLevel reads from the bound pixel unpack buffer
+extern const struct TextureImage *getTextureStreamImage(struct Texture *texture);
+extern int getTextureBaseLevel(struct Texture *texture);
+extern void streamTextureLevel(struct Texture *texture, int level, size_t bufferOffset);
+
 #endif
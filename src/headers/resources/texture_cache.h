@@ -0,0 +1,29 @@
+#ifndef PY3DENGINE_RESOURCES_TEXTURE_CACHE_H
+#define PY3DENGINE_RESOURCES_TEXTURE_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decoded images are written next to their source file as "<source><TEXTURE_CACHE_EXTENSION>"
+#define TEXTURE_CACHE_EXTENSION ".texcache"
+#define TEXTURE_CACHE_VERSION 1
+// Texel data starts on this boundary inside the file
+#define TEXTURE_CACHE_BLOB_ALIGNMENT 64
+
+struct TextureImage;
+
+// Identifies the contents of a source image, the cache is only used when all of it matches
+struct TextureCacheSourceKey {
+    uint64_t size;
+    uint64_t hash;
+};
+
+extern bool readTextureCacheSourceKey(const char *sourcePath, struct TextureCacheSourceKey *key);
+
+// Maps the cache that belongs to sourcePath into image, the texels are read in place and the
+// mapping is released by freeTextureImage
+extern bool loadTextureCache(struct TextureImage *image, const char *sourcePath, const struct TextureCacheSourceKey *key);
+// Writes into a temporary file that only replaces the cache once it is complete
+extern bool writeTextureCache(const struct TextureImage *image, const char *sourcePath, const struct TextureCacheSourceKey *key);
+
+#endif
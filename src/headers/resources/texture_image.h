@@ -0,0 +1,39 @@
+#ifndef PY3DENGINE_RESOURCES_TEXTURE_IMAGE_H
+#define PY3DENGINE_RESOURCES_TEXTURE_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Enough levels for a 32768 texel wide image
+#define TEXTURE_IMAGE_MAX_LEVELS 16
+#define TEXTURE_IMAGE_BYTES_PER_PIXEL 4
+
+struct MappedFile;
+
+struct TextureImageLevel {
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// Decoded RGBA8 texels of every mip level, level 0 first, stored back to back in one allocation
+// or straight out of a mapped texture cache. Nothing in here touches GL, so images can be prepared on any thread
+struct TextureImage {
+    const unsigned char *pixels;
+    size_t size;
+    int numLevels;
+    struct TextureImageLevel levels[TEXTURE_IMAGE_MAX_LEVELS];
+
+    void *_storage;
+    struct MappedFile *_mapping;
+};
+
+// Reads the texture cache next to fileName when it matches the file's contents, otherwise decodes
+// the image, builds its mip chain and writes the cache for the next load
+extern bool loadTextureImage(struct TextureImage *image, const char *fileName);
+extern bool initTextureImage(struct TextureImage *image, const unsigned char *rgbaPixels, int width, int height, bool mipmapped);
+extern void layoutTextureImage(struct TextureImage *image, int width, int height, bool mipmapped);
+extern void freeTextureImage(struct TextureImage *image);
+
+#endif
@@ -1,20 +1,25 @@
 #ifndef PY3DENGINE_OBJECT_LIST_H
 #define PY3DENGINE_OBJECT_LIST_H
 
-struct FaceListNode;
+#include <stdbool.h>
+#include <stddef.h>
+
+// Each triangle is stored as three (position, texcoord, normal) index triples, 1 based with 0 for a missing attribute
+#define OBJECT_LIST_INDICES_PER_FACE 9
+#define OBJECT_LIST_NAME_SIZE 64
 
 struct ObjectListNode {
     struct ObjectListNode *next;
-    struct FaceListNode *faceList;
     char *name;
     int *indexBuffer;
     size_t indexBufferSize;
+    size_t indexBufferCapacity;
 };
 
-extern void appendFaceToObjectList(struct ObjectListNode **objectListPtr, char *name, int indexBuffer[9]);
+// Returns the object with the given name, appending a new one to the end of the list if there is none
+extern struct ObjectListNode *findOrAppendObject(struct ObjectListNode **objectListPtr, const char *name);
+extern bool appendFaceToObject(struct ObjectListNode *objectListNode, const int indexBuffer[OBJECT_LIST_INDICES_PER_FACE]);
+extern bool appendFacesToObject(struct ObjectListNode *objectListNode, const int *indexBuffer, size_t numFaces);
 extern void deleteObjectListNode(struct ObjectListNode **objectListNodePtr);
 
-extern void flattenObjectList(struct ObjectListNode *objectList);
-extern void getIndexBuffer(struct ObjectListNode *objectListNode, const char *name, int **dst, size_t *dstSize);
-
 #endif
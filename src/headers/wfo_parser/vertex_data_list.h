@@ -1,15 +1,20 @@
 #ifndef PY3DENGINE_VERTEX_DATA_LIST_H
 #define PY3DENGINE_VERTEX_DATA_LIST_H
 
-struct VectorListNode {
-    struct VectorListNode *next;
-    int size;
-    float elements[3];
+#include <stdbool.h>
+#include <stddef.h>
+
+// Flat array of vertex attribute components that grows geometrically, so appending is amortised O(1)
+// and the parsed data is handed to vertex buffer generation without being copied
+struct VertexDataList {
+    float *elements;
+    size_t size;
+    size_t capacity;
 };
 
-extern void appendVector2(struct VectorListNode **vecListNodePtr, float x, float y);
-extern void appendVector3(struct VectorListNode **vecListNodePtr, float x, float y, float z);
-extern void deleteVectorList(struct VectorListNode **vecListNodePtr);
-extern void flattenVectorList(struct VectorListNode *vecList, float **dstPtr, size_t *dstSizePtr);
+extern bool reserveVertexDataList(struct VertexDataList *list, size_t capacity);
+extern bool appendVector2(struct VertexDataList *list, float x, float y);
+extern bool appendVector3(struct VertexDataList *list, float x, float y, float z);
+extern void freeVertexDataList(struct VertexDataList *list);
 
 #endif
@@ -5,9 +5,13 @@
 
 struct Py3dResourceManager;
 
+typedef void (*MaterialTextureVisitor)(const char *textureName, void *data);
+
 extern void importWaveFrontFile(struct Py3dResourceManager *manager, const char *filePath);
 extern void parseWaveFrontFile(struct Py3dResourceManager *manager, FILE *wfo);
 extern void importMaterialFile(struct Py3dResourceManager *manager, const char *filePath);
 extern void parseMaterialFile(struct Py3dResourceManager *manager, FILE *mtl);
+// Calls visit with every texture name the material file looks up, in file order, without importing anything
+extern void forEachMaterialFileTexture(const char *filePath, MaterialTextureVisitor visit, void *data);
 
 #endif
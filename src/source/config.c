@@ -32,6 +32,34 @@
 #define WFO_REVERSE_POLYGONS_DEFAULT true
 #define WFO_REVERSE_POLYGONS_CONFIG_NAME "wfo_reverse_polygons"
 
+// 0 uses one worker thread per online processor
+#define WORKER_THREADS_DEFAULT 0
+#define WORKER_THREADS_CONFIG_NAME "worker_threads"
+
+// Levels of detail generated per imported model including the full detail one, 1 turns generation off
+#define MODEL_LOD_COUNT_DEFAULT 4
+#define MODEL_LOD_COUNT_CONFIG_NAME "model_lod_count"
+
+// Share of the previous level's triangles each coarser level tries to keep
+#define MODEL_LOD_TRIANGLE_PERCENT_DEFAULT 50
+#define MODEL_LOD_TRIANGLE_PERCENT_CONFIG_NAME "model_lod_triangle_percent"
+
+// Largest on screen deviation from the full detail mesh a level of detail may cause
+#define MODEL_LOD_PIXEL_ERROR_DEFAULT 1
+#define MODEL_LOD_PIXEL_ERROR_CONFIG_NAME "model_lod_pixel_error"
+
+// Megabytes of model and texture data kept on the GPU before unused ones are evicted, 0 never evicts
+#define GPU_MEMORY_BUDGET_DEFAULT 0
+#define GPU_MEMORY_BUDGET_CONFIG_NAME "gpu_memory_budget_mb"
+
+// Frames a resource has to go unused before it may be evicted
+#define RESOURCE_EVICT_AFTER_FRAMES_DEFAULT 600
+#define RESOURCE_EVICT_AFTER_FRAMES_CONFIG_NAME "resource_evict_after_frames"
+
+// Kilobytes of streamed texture mip levels copied to the GPU each frame
+#define TEXTURE_UPLOAD_KB_PER_FRAME_DEFAULT 4096
+#define TEXTURE_UPLOAD_KB_PER_FRAME_CONFIG_NAME "texture_upload_kb_per_frame"
+
 #define ENGINE_SCRIPT_LOCATION_DEFAULT NULL
 #define ENGINE_SCRIPT_LOCATION_CONFIG_NAME "engine_script_location"
 
@@ -45,6 +73,13 @@ struct Configuration {
     int max_dynamic_lights;
     struct String *startingScene;
     bool wfo_reverse_polygons;
+    int worker_threads;
+    int model_lod_count;
+    int model_lod_triangle_percent;
+    int model_lod_pixel_error;
+    int gpu_memory_budget;
+    int resource_evict_after_frames;
+    int texture_upload_kb_per_frame;
     struct String *engineScriptLocation;
 } config = {
     .screen_width = SCREEN_WIDTH_DEFAULT,
@@ -56,6 +91,13 @@ struct Configuration {
     .max_dynamic_lights = MAX_DYNAMIC_LIGHTS_DEFAULT,
     .startingScene = NULL,
     .wfo_reverse_polygons = WFO_REVERSE_POLYGONS_DEFAULT,
+    .worker_threads = WORKER_THREADS_DEFAULT,
+    .model_lod_count = MODEL_LOD_COUNT_DEFAULT,
+    .model_lod_triangle_percent = MODEL_LOD_TRIANGLE_PERCENT_DEFAULT,
+    .model_lod_pixel_error = MODEL_LOD_PIXEL_ERROR_DEFAULT,
+    .gpu_memory_budget = GPU_MEMORY_BUDGET_DEFAULT,
+    .resource_evict_after_frames = RESOURCE_EVICT_AFTER_FRAMES_DEFAULT,
+    .texture_upload_kb_per_frame = TEXTURE_UPLOAD_KB_PER_FRAME_DEFAULT,
     .engineScriptLocation = NULL
 };
 
@@ -174,6 +216,20 @@ void parseConfig(FILE *configFile) {
     getStringFromObject(config_root, STARTING_SCENE_CONFIG_NAME, config.startingScene, STARTING_SCENE_DEFAULT);
     trace_log("[Config]: Attempting to set \"%s\" from config", WFO_REVERSE_POLYGONS_CONFIG_NAME);
     getBoolFromObject(config_root, WFO_REVERSE_POLYGONS_CONFIG_NAME, &config.wfo_reverse_polygons, WFO_REVERSE_POLYGONS_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", WORKER_THREADS_CONFIG_NAME);
+    getIntFromObject(config_root, WORKER_THREADS_CONFIG_NAME, &config.worker_threads, WORKER_THREADS_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", MODEL_LOD_COUNT_CONFIG_NAME);
+    getIntFromObject(config_root, MODEL_LOD_COUNT_CONFIG_NAME, &config.model_lod_count, MODEL_LOD_COUNT_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", MODEL_LOD_TRIANGLE_PERCENT_CONFIG_NAME);
+    getIntFromObject(config_root, MODEL_LOD_TRIANGLE_PERCENT_CONFIG_NAME, &config.model_lod_triangle_percent, MODEL_LOD_TRIANGLE_PERCENT_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", MODEL_LOD_PIXEL_ERROR_CONFIG_NAME);
+    getIntFromObject(config_root, MODEL_LOD_PIXEL_ERROR_CONFIG_NAME, &config.model_lod_pixel_error, MODEL_LOD_PIXEL_ERROR_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", GPU_MEMORY_BUDGET_CONFIG_NAME);
+    getIntFromObject(config_root, GPU_MEMORY_BUDGET_CONFIG_NAME, &config.gpu_memory_budget, GPU_MEMORY_BUDGET_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", RESOURCE_EVICT_AFTER_FRAMES_CONFIG_NAME);
+    getIntFromObject(config_root, RESOURCE_EVICT_AFTER_FRAMES_CONFIG_NAME, &config.resource_evict_after_frames, RESOURCE_EVICT_AFTER_FRAMES_DEFAULT);
+    trace_log("[Config]: Attempting to set \"%s\" from config", TEXTURE_UPLOAD_KB_PER_FRAME_CONFIG_NAME);
+    getIntFromObject(config_root, TEXTURE_UPLOAD_KB_PER_FRAME_CONFIG_NAME, &config.texture_upload_kb_per_frame, TEXTURE_UPLOAD_KB_PER_FRAME_DEFAULT);
     trace_log("[Config]: Attempting to set \"%s\" from config", ENGINE_SCRIPT_LOCATION_CONFIG_NAME);
     getStringFromObject(config_root, ENGINE_SCRIPT_LOCATION_CONFIG_NAME, config.engineScriptLocation, ENGINE_SCRIPT_LOCATION_DEFAULT);
 
@@ -242,6 +298,34 @@ bool getConfigWfoReversePolygons() {
     return config.wfo_reverse_polygons;
 }
 
+int getConfigWorkerThreads() {
+    return config.worker_threads;
+}
+
+int getConfigModelLodCount() {
+    return config.model_lod_count;
+}
+
+int getConfigModelLodTrianglePercent() {
+    return config.model_lod_triangle_percent;
+}
+
+int getConfigModelLodPixelError() {
+    return config.model_lod_pixel_error;
+}
+
+int getConfigGpuMemoryBudget() {
+    return config.gpu_memory_budget;
+}
+
+int getConfigResourceEvictAfterFrames() {
+    return config.resource_evict_after_frames;
+}
+
+int getConfigTextureUploadKbPerFrame() {
+    return config.texture_upload_kb_per_frame;
+}
+
 const char *getConfigEngineScriptLocation() {
     return getChars(config.engineScriptLocation);
 }
\ No newline at end of file
@@ -124,4 +124,18 @@ const char *getChars(struct String *string) {
     if (string == NULL) return NULL;
 
     return string->_c_str;
+}
+
+// 32 bit FNV-1a
+unsigned int hashChars(const char *chars) {
+    if (chars == NULL) return 0;
+
+    unsigned int hash = 2166136261u;
+    while ((*chars) != 0) {
+        hash ^= (unsigned char) (*chars);
+        hash *= 16777619u;
+        ++chars;
+    }
+
+    return hash;
 }
\ No newline at end of file
@@ -10,8 +10,13 @@
 #include "python/python_wrapper.h"
 #include "engine.h"
 #include "importers/scene.h"
+#include "parallel_jobs.h"
 #include "physics/collision.h"
 #include "python/py3dscene.h"
+#include "rendering/gl_state.h"
+#include "rendering/texture_streamer.h"
+#include "resources/residency.h"
+#include "resources/resource_cache.h"
 
 extern PyObject *Py3dErr_SceneError;
 
@@ -22,6 +27,10 @@ static PyObject *sceneDict = NULL;
 static struct Py3dScene *activeScene = NULL;
 static struct Py3dScene *sceneAwaitingActivation = NULL;
 
+// framebuffer size is only queried when GLFW reports a change, rendering contexts read these every frame
+static int renderTargetWidth = 0;
+static int renderTargetHeight = 0;
+
 GLFWwindow *glfwWindow = NULL;
 
 static void error_callback(int code, const char* description) {
@@ -66,6 +75,9 @@ static void resizeEngine() {
     int newWidth, newHeight;
     glfwGetFramebufferSize(glfwWindow, &newWidth, &newHeight);
     glViewport(0, 0, newWidth, newHeight);
+
+    renderTargetWidth = newWidth;
+    renderTargetHeight = newHeight;
 }
 
 static void doSceneActivation() {
@@ -118,7 +130,7 @@ int initializeEngine(int argc, char **argv){
         glfwSetWindowPos(glfwWindow, getConfigScreenLeft(), getConfigScreenTop());
     }
 
-    glfwSetWindowSizeCallback(glfwWindow, resize_window_callback);
+    glfwSetFramebufferSizeCallback(glfwWindow, resize_window_callback);
     glfwSetKeyCallback(glfwWindow, glfw_key_callback);
 
     glfwMakeContextCurrent(glfwWindow);
@@ -126,6 +138,7 @@ int initializeEngine(int argc, char **argv){
     gladLoadGL(glfwGetProcAddress);
 
     glfwSwapInterval(getConfigSwapInterval());
+    resizeEngine();
     glClearColor(0.25f, 0.25f, 0.25f, 1.0f);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -155,9 +168,12 @@ void runEngine() {
         updateStats(dt);
 
         doSceneActivation();
+        updateTextureStreaming();
 
         Py3dScene_Update(activeScene, dt);
         Py3dScene_Render(activeScene);
+        endGLStateFrame();
+        endResidencyFrame();
 
         glfwSwapBuffers(glfwWindow);
         glfwPollEvents();
@@ -191,11 +207,14 @@ void finalizeEngine() {
 
     endLoadedScenes();
 
+    finalizeTextureStreaming();
     glfwDestroyWindow(glfwWindow);
 
     Py_CLEAR(activeScene);
     Py_CLEAR(sceneDict);
     forceGarbageCollection();
+    finalizeResourceCache();
+    finalizeParallelJobs();
 
     trace_log("[Engine]: Post scene de-allocation python object dump");
     dumpPythonObjects();
@@ -210,15 +229,11 @@ void finalizeEngine() {
 }
 
 void getRenderingTargetDimensions(int *width, int *height) {
-    int w = 0, h = 0;
-
-    glfwGetFramebufferSize(glfwWindow, &w, &h);
-
     if (width != NULL) {
-        (*width) = w;
+        (*width) = renderTargetWidth;
     }
     if (height != NULL) {
-        (*height) = h;
+        (*height) = renderTargetHeight;
     }
 }
 
@@ -11,14 +11,37 @@ const char *spriteVertexShader =
 "layout(location = 0) in vec3 posL;\n"
 "layout(location = 2) in vec2 inTexC;\n"
 "\n"
-"uniform mat4 gWVPMtx;\n"
+"layout(std140, row_major) uniform FrameBlock {\n"
+"   mat4 gViewMtx;\n"
+"   mat4 gProjMtx;\n"
+"   mat4 gVPMtx;\n"
+"   vec3 gCamPosW;\n"
+"   float gTime;\n"
+"   vec2 gViewportSize;\n"
+"};\n"
+"\n"
+"uniform mat4 gWMtx;\n"
 "uniform mat3 gTexMtx;\n"
 "\n"
 "out vec2 texCoord;\n"
 "\n"
 "void main() {\n"
 "   texCoord = (vec3(inTexC, 1.0) * gTexMtx).xy;\n"
-"   gl_Position = (vec4(posL, 1.0) * gWVPMtx);\n"
+"   gl_Position = (vec4(posL, 1.0) * gWMtx) * gVPMtx;\n"
+"}\n";
+
+// text is laid out on the CPU straight into clip space with char map coordinates
+const char *textVertexShader =
+"#version 460 core\n"
+"\n"
+"layout(location = 0) in vec3 posL;\n"
+"layout(location = 2) in vec2 inTexC;\n"
+"\n"
+"out vec2 texCoord;\n"
+"\n"
+"void main() {\n"
+"   texCoord = inTexC;\n"
+"   gl_Position = vec4(posL, 1.0);\n"
 "}\n";
 
 const char *spriteFragShader =
@@ -72,18 +95,23 @@ static void importQuadModel(struct Py3dResourceManager *rm) {
     quad = NULL;
 }
 
-static void importSpriteShader(struct Py3dResourceManager *rm) {
+static void importBuiltInShader(
+    struct Py3dResourceManager *rm,
+    const char *name,
+    const char *vertexShaderSource,
+    const char *fragShaderSource
+) {
     if (Py3dResourceManager_Check((PyObject *) rm) != 1) return;
 
     struct Shader *shader = NULL;
     allocShader(&shader);
     if (shader == NULL) {
-        critical_log("%s", "[BuiltInImporter]: Unable to allocate Sprite Shader");
+        critical_log("[BuiltInImporter]: Unable to allocate %s", name);
         return;
     }
 
-    setResourceName((struct BaseResource *) shader, "SpriteShaderBuiltIn");
-    initShader(shader, spriteVertexShader, spriteFragShader);
+    setResourceName((struct BaseResource *) shader, name);
+    initShader(shader, vertexShaderSource, fragShaderSource);
 
     Py3dResourceManager_StoreResource(rm, (struct BaseResource *) shader);
     shader = NULL;
@@ -128,6 +156,14 @@ void importBuiltInResources(struct Py3dResourceManager *rm) {
     Py3dResourceManager_StoreResource(rm, (struct BaseResource *) script);
     script = NULL;
 
+    importBuiltinComponent(&script, "CameraComponent");
+    if (script == NULL) {
+        error_log("%s", "[BuiltInImporter]: Unable to load CameraComponent builtin");
+    }
+    Py3dResourceManager_StoreResource(rm, (struct BaseResource *) script);
+    script = NULL;
+
     importQuadModel(rm);
-    importSpriteShader(rm);
+    importBuiltInShader(rm, "SpriteShaderBuiltIn", spriteVertexShader, spriteFragShader);
+    importBuiltInShader(rm, "TextShaderBuiltIn", textVertexShader, spriteFragShader);
 }
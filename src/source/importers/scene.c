@@ -1,17 +1,27 @@
 #include <json-c/json.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "logger.h"
+#include "config.h"
+#include "custom_string.h"
+#include "parallel_jobs.h"
 #include "wfo_parser/wfo_parser.h"
 #include "python/py3dgameobject.h"
 #include "json_parser.h"
 #include "resources/shader.h"
 #include "resources/python_script.h"
+#include "resources/texture_image.h"
+#include "resources/resource_cache.h"
 #include "importers/texture.h"
 #include "importers/shader.h"
 #include "importers/component.h"
 #include "importers/scene.h"
 #include "importers/sprite_sheet.h"
+#include "importers/texture_atlas.h"
 #include "importers/builtins.h"
+#include "rendering/deferred_renderer.h"
 #include "python/py3dscene.h"
 #include "python/py3dresourcemanager.h"
 
@@ -26,27 +36,39 @@ static const char *getResourceExt(const char *resourcePath) {
     return ((*curPos) == '.') ? curPos : NULL;
 }
 
-static void importResourceByDescriptor(struct Py3dResourceManager *manager, const char *resourcePath) {
-    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || resourcePath == NULL) return;
+// Models, materials, textures and shaders are shared with other scenes through the resource cache.
+// Texture and sprite sheet files that are not cached yet are decoded on the worker pool before anything
+// is imported, every import and GL upload still happens on this thread in the order the scene lists them
+#define BUILTIN_RESOURCES_CACHE_PATH "<builtins>"
 
-    json_object *resourceDescriptor = json_object_from_file(resourcePath);
+struct ResourceImport {
+    const char *path;
+    json_object *descriptor;
+    const char *imagePath;
+    char *canonicalImagePath;
+    struct TextureImage image;
+    struct String *cacheKey;
+};
+
+static void importResourceByDescriptor(struct Py3dResourceManager *manager, struct TextureAtlas *atlas, struct ResourceImport *import) {
+    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || import == NULL) return;
+
+    json_object *resourceDescriptor = import->descriptor;
     if (resourceDescriptor == NULL) {
-        error_log("[SceneImporter]: Could not parse json from \"%s\"", resourcePath);
+        error_log("[SceneImporter]: Could not parse json from \"%s\"", import->path);
         return;
     }
 
     json_object *json_type = json_object_object_get(resourceDescriptor, "type");
     if (json_type == NULL || !json_object_is_type(json_type, json_type_string)) {
         error_log("[SceneImporter]: Resource descriptor must have a \"type\" field of type string");
-        json_object_put(resourceDescriptor);
-        resourceDescriptor = NULL;
         return;
     }
 
     const char *typeName = json_object_get_string(json_type);
     if (strcmp(typeName, "Texture") == 0) {
         struct BaseResource *newTexture = NULL;
-        importTexture((struct Texture **) &newTexture, resourceDescriptor);
+        importTextureFromImage((struct Texture **) &newTexture, resourceDescriptor, &import->image);
         Py3dResourceManager_StoreResource(manager, newTexture);
         newTexture = NULL;
     } else if (strcmp(typeName, "Shader") == 0) {
@@ -60,18 +82,16 @@ static void importResourceByDescriptor(struct Py3dResourceManager *manager, cons
         Py3dResourceManager_StoreResource(manager, newScript);
         newScript = NULL;
     } else if (strcmp(typeName, "SpriteSheet") == 0) {
-        importSprites(manager, resourceDescriptor);
+        importSprites(manager, atlas, resourceDescriptor, &import->image);
     } else {
         error_log("[SceneImporter]: Could not identity resource type \"%s\"", typeName);
     }
-
-    json_object_put(resourceDescriptor);
-    resourceDescriptor = NULL;
 }
 
-static void importResourceByPath(struct Py3dResourceManager *manager, const char *resourcePath) {
-    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || resourcePath == NULL) return;
+static void importResourceByPath(struct Py3dResourceManager *manager, struct TextureAtlas *atlas, struct ResourceImport *import) {
+    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || import == NULL || import->path == NULL) return;
 
+    const char *resourcePath = import->path;
     const char *ext = getResourceExt(resourcePath);
     if (ext == NULL) return;
 
@@ -80,12 +100,186 @@ static void importResourceByPath(struct Py3dResourceManager *manager, const char
     } else if (strcmp(ext, ".mtl") == 0) {
         importMaterialFile(manager, resourcePath);
     } else if (strcmp(ext, ".json") == 0) {
-        importResourceByDescriptor(manager, resourcePath);
+        importResourceByDescriptor(manager, atlas, import);
     } else {
         error_log("[SceneImporter]: Unable to determine resource type \"%s\"", resourcePath);
     }
 }
 
+static const char *getDescriptorImagePath(json_object *resourceDescriptor) {
+    if (resourceDescriptor == NULL) return NULL;
+
+    json_object *json_type = json_object_object_get(resourceDescriptor, "type");
+    if (json_type == NULL || !json_object_is_type(json_type, json_type_string)) return NULL;
+
+    const char *typeName = json_object_get_string(json_type);
+    if (strcmp(typeName, "Texture") != 0 && strcmp(typeName, "SpriteSheet") != 0) return NULL;
+
+    json_object *json_filename = json_object_object_get(resourceDescriptor, "filename");
+    if (json_filename == NULL || !json_object_is_type(json_filename, json_type_string)) return NULL;
+
+    return json_object_get_string(json_filename);
+}
+
+// Everything that changes what an import produces is part of its key. Sprite sheets are packed into
+// atlas pages this scene owns and components are cheap to load, so neither is shared. Materials look
+// their textures up by name in this scene, their key is built when they are imported
+static void buildImportCacheKey(struct ResourceImport *import, const char *ext) {
+    char params[128];
+    const char *importParams = NULL;
+
+    if (strcmp(ext, ".obj") == 0) {
+        snprintf(
+            params, sizeof(params), "wfo;reverse=%d;lods=%d;lodpercent=%d",
+            getConfigWfoReversePolygons() ? 1 : 0, getConfigModelLodCount(), getConfigModelLodTrianglePercent()
+        );
+        importParams = params;
+    } else if (strcmp(ext, ".json") == 0 && import->descriptor != NULL) {
+        json_object *json_type = json_object_object_get(import->descriptor, "type");
+        if (json_type == NULL || !json_object_is_type(json_type, json_type_string)) return;
+
+        const char *typeName = json_object_get_string(json_type);
+        if (strcmp(typeName, "Texture") != 0 && strcmp(typeName, "Shader") != 0) return;
+
+        importParams = json_object_to_json_string_ext(import->descriptor, JSON_C_TO_STRING_PLAIN);
+    }
+
+    if (importParams == NULL) return;
+
+    buildResourceCacheKey(&import->cacheKey, import->path, importParams);
+}
+
+// Reads every descriptor up front so the image files behind them are known before the first import
+static void prepareResourceImports(struct ResourceImport *imports, json_object *resourceArray, size_t resourceCount) {
+    for (size_t i = 0; i < resourceCount; ++i) {
+        json_object *curResourceName = json_object_array_get_idx(resourceArray, i);
+        if (curResourceName == NULL || !json_object_is_type(curResourceName, json_type_string)) continue;
+
+        struct ResourceImport *import = &imports[i];
+        import->path = json_object_get_string(curResourceName);
+
+        const char *ext = getResourceExt(import->path);
+        if (ext == NULL) continue;
+
+        if (strcmp(ext, ".json") == 0) {
+            import->descriptor = json_object_from_file(import->path);
+        }
+        buildImportCacheKey(import, ext);
+
+        // another scene already holds what this import would produce, there is nothing to decode
+        if (import->descriptor == NULL || hasResourceCacheEntry(getChars(import->cacheKey))) continue;
+
+        import->imagePath = getDescriptorImagePath(import->descriptor);
+        if (import->imagePath == NULL) continue;
+
+        // a file listed twice is decoded once, the later import loads it again from the texture cache.
+        // Paths are compared resolved, two workers writing the same cache file would corrupt it
+        import->canonicalImagePath = allocCanonicalPath(import->imagePath);
+        const char *imagePath = import->canonicalImagePath != NULL ? import->canonicalImagePath : import->imagePath;
+        for (size_t j = 0; j < i; ++j) {
+            if (imports[j].imagePath == NULL) continue;
+
+            const char *otherPath = imports[j].canonicalImagePath != NULL ? imports[j].canonicalImagePath : imports[j].imagePath;
+            if (strcmp(otherPath, imagePath) == 0) {
+                import->imagePath = NULL;
+                break;
+            }
+        }
+    }
+}
+
+struct MaterialKeyBuilder {
+    struct Py3dResourceManager *manager;
+    char *params;
+    size_t length;
+    size_t capacity;
+    bool shareable;
+};
+
+static void appendMaterialKeyParams(struct MaterialKeyBuilder *builder, const char *text) {
+    size_t length = strlen(text);
+    if (builder->length + length >= builder->capacity) {
+        size_t newCapacity = builder->capacity > 0 ? builder->capacity * 2 : 256;
+        while (builder->length + length >= newCapacity) newCapacity *= 2;
+
+        char *newParams = realloc(builder->params, newCapacity);
+        if (newParams == NULL) {
+            critical_log("%s", "[SceneImporter]: Memory allocation failure while building material cache key");
+            builder->shareable = false;
+            return;
+        }
+        builder->params = newParams;
+        builder->capacity = newCapacity;
+    }
+
+    memcpy(builder->params + builder->length, text, length + 1);
+    builder->length += length;
+}
+
+// a texture name becomes the key of the entry it resolves to here, missing names resolve to nothing
+static void addMaterialTextureToKey(const char *textureName, void *data) {
+    struct MaterialKeyBuilder *builder = data;
+    if (!builder->shareable) return;
+
+    struct ResourceCacheEntry *entry = NULL;
+    bool found = Py3dResourceManager_GetResourceEntry(builder->manager, textureName, &entry);
+    if (found && entry == NULL) {
+        trace_log("[SceneImporter]: Texture \"%s\" is only owned by this scene", textureName);
+        builder->shareable = false;
+        return;
+    }
+
+    appendMaterialKeyParams(builder, ";");
+    appendMaterialKeyParams(builder, textureName);
+    appendMaterialKeyParams(builder, "=");
+    appendMaterialKeyParams(builder, found ? getResourceCacheEntryKey(entry) : "");
+}
+
+// Two scenes can declare different textures under the same name, a material is only reused when every
+// texture it names resolves to the same entry. Materials naming textures only this scene owns are not shared
+static void buildMaterialCacheKey(struct Py3dResourceManager *manager, struct ResourceImport *import) {
+    struct MaterialKeyBuilder builder = {manager, NULL, 0, 0, true};
+    appendMaterialKeyParams(&builder, "mtl");
+    forEachMaterialFileTexture(import->path, addMaterialTextureToKey, &builder);
+
+    if (builder.shareable && builder.params != NULL) {
+        buildResourceCacheKey(&import->cacheKey, import->path, builder.params);
+    }
+    free(builder.params);
+}
+
+static void importSharedResource(struct Py3dResourceManager *manager, struct TextureAtlas *atlas, struct ResourceImport *import) {
+    const char *ext = getResourceExt(import->path);
+    if (ext != NULL && strcmp(ext, ".mtl") == 0) {
+        buildMaterialCacheKey(manager, import);
+    }
+
+    if (import->cacheKey == NULL) {
+        importResourceByPath(manager, atlas, import);
+        return;
+    }
+
+    const char *key = getChars(import->cacheKey);
+    struct ResourceCacheEntry *entry = acquireResourceCacheEntry(key);
+    if (entry != NULL) {
+        trace_log("[SceneImporter]: Reusing \"%s\" imported by another scene", import->path);
+        Py3dResourceManager_StoreSharedResources(manager, entry);
+        releaseResourceCacheEntry(&entry);
+        return;
+    }
+
+    size_t firstIndex = Py3dResourceManager_GetResourceCount(manager);
+    importResourceByPath(manager, atlas, import);
+    Py3dResourceManager_ShareResources(manager, firstIndex, key);
+}
+
+static void decodeResourceImageJob(void *jobData, size_t jobIndex) {
+    struct ResourceImport *import = &((struct ResourceImport *) jobData)[jobIndex];
+    if (import->imagePath == NULL) return;
+
+    loadTextureImage(&import->image, import->imagePath);
+}
+
 static void importResources(struct Py3dResourceManager *manager, json_object *resourceArray) {
     if (Py3dResourceManager_Check((PyObject *) manager) != 1 || resourceArray == NULL) return;
 
@@ -95,14 +289,82 @@ static void importResources(struct Py3dResourceManager *manager, json_object *re
     }
 
     size_t resourceCount = json_object_array_length(resourceArray);
+    if (resourceCount == 0) return;
+
+    struct ResourceImport *imports = calloc(resourceCount, sizeof(struct ResourceImport));
+    if (imports == NULL) {
+        critical_log("%s", "[SceneImporter]: Memory allocation failure while importing resources");
+        return;
+    }
+
+    prepareResourceImports(imports, resourceArray, resourceCount);
+    runParallelJobs(decodeResourceImageJob, imports, resourceCount);
+
+    // sprite sheets imported by this scene share atlas pages, the packer state is only needed during import
+    struct TextureAtlas *atlas = NULL;
+    allocTextureAtlas(&atlas);
+
     for (size_t i = 0; i < resourceCount; ++i) {
-        json_object *curResourceName = json_object_array_get_idx(resourceArray, i);
-        if (curResourceName == NULL || !json_object_is_type(curResourceName, json_type_string)) {
+        struct ResourceImport *import = &imports[i];
+        if (import->path == NULL) {
             error_log("%s", "[SceneImporter]: Resources names must be of type string");
             continue;
         }
 
-        importResourceByPath(manager, json_object_get_string(curResourceName));
+        importSharedResource(manager, atlas, import);
+
+        // images that became textures were taken over, anything left was not used
+        freeTextureImage(&import->image);
+        free(import->canonicalImagePath);
+        import->canonicalImagePath = NULL;
+        deleteString(&import->cacheKey);
+        if (import->descriptor != NULL) {
+            json_object_put(import->descriptor);
+            import->descriptor = NULL;
+        }
+    }
+
+    deleteTextureAtlas(&atlas);
+    free(imports);
+}
+
+static void importSharedBuiltInResources(struct Py3dResourceManager *manager) {
+    struct String *key = NULL;
+    buildResourceCacheKey(&key, BUILTIN_RESOURCES_CACHE_PATH, NULL);
+    if (key == NULL) {
+        importBuiltInResources(manager);
+        return;
+    }
+
+    struct ResourceCacheEntry *entry = acquireResourceCacheEntry(getChars(key));
+    if (entry != NULL) {
+        Py3dResourceManager_StoreSharedResources(manager, entry);
+        releaseResourceCacheEntry(&entry);
+    } else {
+        size_t firstIndex = Py3dResourceManager_GetResourceCount(manager);
+        importBuiltInResources(manager);
+        Py3dResourceManager_ShareResources(manager, firstIndex, getChars(key));
+    }
+
+    deleteString(&key);
+}
+
+static void importRenderPath(struct Py3dScene *scene, json_object *sceneDescriptor) {
+    json_object *render_path = json_object_object_get(sceneDescriptor, "render_path");
+    if (render_path == NULL) return;
+
+    if (!json_object_is_type(render_path, json_type_string)) {
+        warning_log("%s", "[SceneImporter]: Scene property \"render_path\" must be a string, using forward rendering");
+        return;
+    }
+
+    const char *render_path_cstr = json_object_get_string(render_path);
+    if (strcmp(render_path_cstr, "deferred") == 0) {
+        Py3dScene_SetRenderPath(scene, RENDER_PATH_DEFERRED);
+    } else if (strcmp(render_path_cstr, "forward") == 0) {
+        Py3dScene_SetRenderPath(scene, RENDER_PATH_FORWARD);
+    } else {
+        warning_log("[SceneImporter]: Unknown render path \"%s\", using forward rendering", render_path_cstr);
     }
 }
 
@@ -133,13 +395,14 @@ struct Py3dScene *importScene(json_object *sceneDescriptor) {
     struct Py3dScene *newScene = Py3dScene_New();
     if (newScene == NULL) return NULL;
     Py3dScene_SetNameCStr(newScene, scene_name_cstr);
+    importRenderPath(newScene, sceneDescriptor);
 
     struct Py3dResourceManager *manager = Py3dResourceManager_New();
 
     Py3dScene_SetResourceManager(newScene, (PyObject *) manager);
     Py3dResourceManager_SetOwnerInC(manager, (struct Py3dScene *) newScene);
 
-    importBuiltInResources(manager);
+    importSharedBuiltInResources(manager);
 
     json_object *resourceArray = json_object_object_get(sceneDescriptor, "resources");
     importResources(manager, resourceArray);
@@ -37,6 +37,27 @@ void importShader(struct Shader **shaderPtr, json_object *shaderDesc) {
     );
     setResourceName((struct BaseResource *) newShader, json_object_get_string(json_name));
 
+    // shaders opt in to instanced rendering by supplying a vertex shader that reads its
+    // world matrices from per instance attributes, the fragment shader is shared
+    json_object *instanced_vertex_shader_file_name = json_object_object_get(shaderDesc, "instanced_vertex_shader_source_file");
+    if (instanced_vertex_shader_file_name != NULL) {
+        if (!json_object_is_type(instanced_vertex_shader_file_name, json_type_string)) {
+            error_log("%s", "[SceneImporter]: Shader description attribute \"instanced_vertex_shader_source_file\" must be of type \"string\"");
+        } else {
+            struct Shader *instancedVariant = NULL;
+            allocShader(&instancedVariant);
+            if (instancedVariant != NULL) {
+                initShaderFromFiles(
+                    instancedVariant,
+                    json_object_get_string(instanced_vertex_shader_file_name),
+                    json_object_get_string(fragment_shader_file_name)
+                );
+                setShaderInstancedVariant(newShader, instancedVariant);
+                instancedVariant = NULL;
+            }
+        }
+    }
+
     (*shaderPtr) = newShader;
     newShader = NULL;
 }
@@ -1,5 +1,11 @@
+#include <SOIL/SOIL.h>
+#include <stdlib.h>
+
+#include "custom_string.h"
 #include "importers/sprite_sheet.h"
+#include "importers/texture_atlas.h"
 #include "resources/texture.h"
+#include "resources/texture_image.h"
 #include "resources/sprite.h"
 #include "importers/texture.h"
 #include "python/py3dresourcemanager.h"
@@ -15,7 +21,58 @@ static int getIntegerFromJsonArray(json_object *array, size_t index, int *dst) {
     return 1;
 }
 
-void importSprites(struct Py3dResourceManager *manager, json_object *resourceDescriptor) {
+// Descriptors opt out of packing with "atlas": false
+static bool isAtlasAllowed(json_object *resourceDescriptor) {
+    json_object *json_atlas = json_object_object_get(resourceDescriptor, "atlas");
+    return json_atlas == NULL || !json_object_is_type(json_atlas, json_type_boolean) || json_object_get_boolean(json_atlas);
+}
+
+// Packs the sheet image into the atlas, on success the sprites are imported against the atlas page
+// and their bounds are shifted by offset so calcSpriteTextureMtx addresses the right region
+static bool packSpriteSheet(
+    struct TextureAtlas *atlas,
+    struct Py3dResourceManager *manager,
+    json_object *resourceDescriptor,
+    const char *fileName,
+    const struct TextureImage *image,
+    struct Texture **pageOut,
+    int offset[2]
+) {
+    if (atlas == NULL || !isAtlasAllowed(resourceDescriptor)) return false;
+
+    // atlas pages hold a single level, so only level 0 of a decoded image is packed
+    unsigned char *imageData = NULL;
+    int width = 0, height = 0;
+    if (image != NULL && image->pixels != NULL) {
+        width = image->levels[0].width;
+        height = image->levels[0].height;
+    } else {
+        imageData = SOIL_load_image(fileName, &width, &height, NULL, SOIL_LOAD_RGBA);
+        if (imageData == NULL) return false;
+    }
+
+    bool packed = packIntoTextureAtlas(
+        atlas,
+        manager,
+        fileName,
+        imageData != NULL ? imageData : image->pixels,
+        width,
+        height,
+        json_object_object_get(resourceDescriptor, "texture_parameters"),
+        pageOut,
+        offset
+    );
+    free(imageData);
+    imageData = NULL;
+
+    if (!packed) {
+        trace_log("[SpriteSheetImporter]: \"%s\" does not fit in an atlas page, it will keep its own texture", fileName);
+    }
+
+    return packed;
+}
+
+void importSprites(struct Py3dResourceManager *manager, struct TextureAtlas *atlas, json_object *resourceDescriptor, struct TextureImage *image) {
     if (Py3dResourceManager_Check((PyObject *) manager) != 1 || resourceDescriptor == NULL) return;
 
     json_object *texture_name_json = json_object_object_get(resourceDescriptor, "filename");
@@ -36,17 +93,36 @@ void importSprites(struct Py3dResourceManager *manager, json_object *resourceDes
         return;
     }
 
-    struct BaseResource *spriteSheetResource = Py3dResourceManager_GetResource(manager, texture_name);
+    // a sheet file that is already on a page is reused, whichever descriptor packed it
     struct Texture *spriteSheetTexture = NULL;
-    if (!isResourceTypeTexture(spriteSheetResource)) {
+    int atlasOffset[2] = {0};
+    json_object *textureParams = json_object_object_get(resourceDescriptor, "texture_parameters");
+    bool inAtlas = isAtlasAllowed(resourceDescriptor) && findInTextureAtlas(atlas, texture_name, textureParams, &spriteSheetTexture, atlasOffset);
+
+    struct BaseResource *spriteSheetResource = inAtlas ? NULL : Py3dResourceManager_GetResource(manager, texture_name);
+    if (inAtlas) {
+        trace_log("[SpriteSheetImporter]: Reusing \"%s\" already packed into \"%s\"", texture_name, getChars(getResourceName((struct BaseResource *) spriteSheetTexture)));
+    } else if (spriteSheetResource == NULL && packSpriteSheet(atlas, manager, resourceDescriptor, texture_name, image, &spriteSheetTexture, atlasOffset)) {
+        inAtlas = true;
+        trace_log("[SpriteSheetImporter]: Packed \"%s\" into \"%s\"", texture_name, getChars(getResourceName((struct BaseResource *) spriteSheetTexture)));
+    } else if (!isResourceTypeTexture(spriteSheetResource)) {
         // TODO: what happens if we have a resource with the same name that's not a texture? Nuthin good
-        importTexture(&spriteSheetTexture, resourceDescriptor);
+        importTextureFromImage(&spriteSheetTexture, resourceDescriptor, image);
         Py3dResourceManager_StoreResource(manager, (struct BaseResource *) spriteSheetTexture);
     } else {
         spriteSheetTexture = (struct Texture *) spriteSheetResource;
     }
     spriteSheetResource = NULL;
 
+    // packed sheets have no texture of their own, their name leads to the page the sprites sample instead
+    json_object *sheet_name_json = json_object_object_get(resourceDescriptor, "name");
+    if (inAtlas && sheet_name_json != NULL && json_object_is_type(sheet_name_json, json_type_string)) {
+        const char *sheet_name = json_object_get_string(sheet_name_json);
+        if (!Py3dResourceManager_AliasResource(manager, sheet_name, (struct BaseResource *) spriteSheetTexture)) {
+            warning_log("[SpriteSheetImporter]: Could not make atlas page reachable as \"%s\"", sheet_name);
+        }
+    }
+
     json_object_object_foreach(sprites_map, sprite_name, dimensions) {
         if (!json_object_is_type(dimensions, json_type_array) || json_object_array_length(dimensions) != 4) {
             error_log("[SpriteSheetImporter]: Sprite with name \"%s\" must be an array with four numbers", sprite_name);
@@ -65,6 +141,9 @@ void importSprites(struct Py3dResourceManager *manager, json_object *resourceDes
 
         if (importedBounds == 0) continue;
 
+        bounds[0] += atlasOffset[0];
+        bounds[1] += atlasOffset[1];
+
         struct Sprite *newSprite = NULL;
         allocSprite(&newSprite);
         if (newSprite == NULL) continue;
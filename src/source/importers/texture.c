@@ -3,9 +3,30 @@
 
 #include "logger.h"
 #include "resources/texture.h"
+#include "resources/texture_image.h"
 #include "importers/texture.h"
 
+void applyTextureParameters(struct Texture *texture, json_object *paramMap) {
+    if (texture == NULL || paramMap == NULL || !json_object_is_type(paramMap, json_type_object)) return;
+
+    json_object_object_foreach(paramMap, key, val) {
+        if (!json_object_is_type(val, json_type_string)) {
+            error_log(
+                "[TextureImporter]: Texture parameter \"%s\", should be a string representing a valid GLenum value",
+                key
+            );
+            continue;
+        }
+
+        setTextureParam(texture, key, json_object_get_string(val));
+    }
+}
+
 void importTexture(struct Texture **texturePtr, json_object *textureDesc) {
+    importTextureFromImage(texturePtr, textureDesc, NULL);
+}
+
+void importTextureFromImage(struct Texture **texturePtr, json_object *textureDesc, struct TextureImage *image) {
     if (texturePtr == NULL || (*texturePtr) != NULL || textureDesc == NULL) return;
 
     json_object *json_name = json_object_object_get(textureDesc, "name");
@@ -25,23 +46,13 @@ void importTexture(struct Texture **texturePtr, json_object *textureDesc) {
     if (newTexture == NULL) return;
 
     setResourceName((struct BaseResource *) newTexture, json_object_get_string(json_name));
-    initTexture(newTexture, json_object_get_string(json_texture_path));
-
-    json_object *json_tex_param_map = json_object_object_get(textureDesc, "texture_parameters");
-    if (json_tex_param_map != NULL && json_object_is_type(json_tex_param_map, json_type_object)) {
-        json_object_object_foreach(json_tex_param_map, key, val) {
-            if (!json_object_is_type(val, json_type_string)) {
-                error_log(
-                    "[TextureImporter]: Texture parameter \"%s\", should be a string representing a valid GLenum value",
-                    key
-                );
-                continue;
-            }
-
-            setTextureParam(newTexture, key, json_object_get_string(val));
-        }
+    const char *texturePath = json_object_get_string(json_texture_path);
+    if (image == NULL || image->pixels == NULL || !initTextureFromImage(newTexture, image, texturePath)) {
+        initTexture(newTexture, texturePath);
     }
 
+    applyTextureParameters(newTexture, json_object_object_get(textureDesc, "texture_parameters"));
+
     (*texturePtr) = newTexture;
     newTexture = NULL;
 }
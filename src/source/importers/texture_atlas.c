@@ -0,0 +1,373 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "custom_string.h"
+#include "logger.h"
+#include "resources/texture.h"
+#include "importers/texture.h"
+#include "importers/texture_atlas.h"
+#include "python/py3dresourcemanager.h"
+
+// Every image is surrounded by a copy of its own edge pixels so linear filtering
+// near a sprite's border never samples its neighbour on the page
+#define TEXTURE_ATLAS_PADDING 1
+
+// Top edge of the packed area on a page, the skyline is kept sorted by x and covers the full page width
+struct SkylineNode {
+    int x;
+    int y;
+    int width;
+};
+
+struct AtlasPage {
+    struct Texture *texture;
+    struct String *paramKey;
+    struct SkylineNode *nodes;
+    size_t numNodes;
+    size_t capacity;
+};
+
+struct AtlasImage {
+    struct String *fileName;
+    struct String *paramKey;
+    struct Texture *page;
+    int offset[2];
+};
+
+// Images only share a page when they want the same sampler state, the key is the parameters' json
+static const char *getParamKey(json_object **textureParams) {
+    if ((*textureParams) != NULL && json_object_is_type((*textureParams), json_type_object)) {
+        return json_object_to_json_string_ext((*textureParams), JSON_C_TO_STRING_PLAIN | JSON_C_TO_STRING_NOSLASHESCAPE);
+    }
+
+    (*textureParams) = NULL;
+    return "";
+}
+
+static bool addAtlasImage(struct TextureAtlas *atlas, const char *fileName, const char *paramKey, struct Texture *page, const int offset[2]) {
+    if (atlas->_numImages == atlas->_imagesCapacity) {
+        size_t newCapacity = atlas->_imagesCapacity > 0 ? atlas->_imagesCapacity * 2 : 16;
+        struct AtlasImage *newImages = realloc(atlas->_images, newCapacity * sizeof(struct AtlasImage));
+        if (newImages == NULL) {
+            critical_log("%s", "[TextureAtlas]: Could not grow packed image list");
+            return false;
+        }
+
+        atlas->_images = newImages;
+        atlas->_imagesCapacity = newCapacity;
+    }
+
+    struct AtlasImage *image = &atlas->_images[atlas->_numImages];
+    memset(image, 0, sizeof(struct AtlasImage));
+    allocString(&image->fileName, fileName);
+    allocString(&image->paramKey, paramKey);
+    image->page = page;
+    image->offset[0] = offset[0];
+    image->offset[1] = offset[1];
+    atlas->_numImages++;
+
+    return true;
+}
+
+// Height the skyline would have if a rect of the given width was placed at node index, or -1 if it does not fit
+static int skylineFit(struct AtlasPage *page, size_t index, int width, int height, int pageSize) {
+    int x = page->nodes[index].x;
+    if (x + width > pageSize) return -1;
+
+    int y = 0;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; ++i) {
+        if (i == page->numNodes) return -1;
+
+        if (page->nodes[i].y > y) y = page->nodes[i].y;
+        if (y + height > pageSize) return -1;
+
+        remaining -= page->nodes[i].width;
+    }
+
+    return y;
+}
+
+static bool findSkylinePosition(struct AtlasPage *page, int width, int height, int pageSize, size_t *indexOut, int pos[2]) {
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    bool found = false;
+
+    for (size_t i = 0; i < page->numNodes; ++i) {
+        int y = skylineFit(page, i, width, height, pageSize);
+        if (y < 0) continue;
+
+        // bottom-left rule, lowest resulting top edge wins and the narrower segment breaks ties
+        if (y + height < bestTop || (y + height == bestTop && page->nodes[i].width < bestWidth)) {
+            bestTop = y + height;
+            bestWidth = page->nodes[i].width;
+            (*indexOut) = i;
+            pos[0] = page->nodes[i].x;
+            pos[1] = y;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+static bool addSkylineLevel(struct AtlasPage *page, size_t index, int x, int y, int width) {
+    if (page->numNodes == page->capacity) {
+        size_t newCapacity = page->capacity * 2;
+        struct SkylineNode *newNodes = realloc(page->nodes, newCapacity * sizeof(struct SkylineNode));
+        if (newNodes == NULL) {
+            critical_log("%s", "[TextureAtlas]: Could not grow atlas skyline");
+            return false;
+        }
+
+        page->nodes = newNodes;
+        page->capacity = newCapacity;
+    }
+
+    memmove(&page->nodes[index + 1], &page->nodes[index], (page->numNodes - index) * sizeof(struct SkylineNode));
+    page->nodes[index] = (struct SkylineNode) {x, y, width};
+    page->numNodes++;
+
+    // trim or drop the nodes the new level now covers
+    size_t i = index + 1;
+    while (i < page->numNodes) {
+        struct SkylineNode *prev = &page->nodes[i - 1];
+        struct SkylineNode *cur = &page->nodes[i];
+
+        int overlap = prev->x + prev->width - cur->x;
+        if (overlap <= 0) break;
+
+        cur->x += overlap;
+        cur->width -= overlap;
+        if (cur->width > 0) break;
+
+        memmove(cur, cur + 1, (page->numNodes - i - 1) * sizeof(struct SkylineNode));
+        page->numNodes--;
+    }
+
+    // merge neighbours at the same height to keep the skyline short
+    for (i = 0; i + 1 < page->numNodes;) {
+        if (page->nodes[i].y == page->nodes[i + 1].y) {
+            page->nodes[i].width += page->nodes[i + 1].width;
+            memmove(&page->nodes[i + 1], &page->nodes[i + 2], (page->numNodes - i - 2) * sizeof(struct SkylineNode));
+            page->numNodes--;
+        } else {
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+static struct AtlasPage *addAtlasPage(
+    struct TextureAtlas *atlas,
+    struct Py3dResourceManager *manager,
+    const char *paramKey,
+    json_object *textureParams
+) {
+    struct AtlasPage *newPages = realloc(atlas->_pages, (atlas->_numPages + 1) * sizeof(struct AtlasPage));
+    if (newPages == NULL) {
+        critical_log("%s", "[TextureAtlas]: Could not allocate a new atlas page");
+        return NULL;
+    }
+    atlas->_pages = newPages;
+
+    struct AtlasPage *page = &atlas->_pages[atlas->_numPages];
+    memset(page, 0, sizeof(struct AtlasPage));
+
+    page->capacity = 16;
+    page->nodes = calloc(page->capacity, sizeof(struct SkylineNode));
+    if (page->nodes == NULL) {
+        critical_log("%s", "[TextureAtlas]: Could not allocate atlas skyline");
+        return NULL;
+    }
+    page->nodes[0] = (struct SkylineNode) {0, 0, atlas->_pageSize};
+    page->numNodes = 1;
+
+    allocTexture(&page->texture);
+    initEmptyTexture(page->texture, atlas->_pageSize, atlas->_pageSize);
+    if (getTextureId(page->texture) == 0) {
+        deleteTexture(&page->texture);
+        free(page->nodes);
+        page->nodes = NULL;
+        return NULL;
+    }
+    applyTextureParameters(page->texture, textureParams);
+
+    char pageName[32] = {0};
+    snprintf(pageName, sizeof(pageName), "AtlasPage%zu", atlas->_numPages);
+    setResourceName((struct BaseResource *) page->texture, pageName);
+    Py3dResourceManager_StoreResource(manager, (struct BaseResource *) page->texture);
+
+    allocString(&page->paramKey, paramKey);
+    atlas->_numPages++;
+
+    trace_log("[TextureAtlas]: Created atlas page \"%s\"", pageName);
+
+    return page;
+}
+
+// Builds a copy of the image with its outermost pixels repeated into the padding border
+static unsigned char *extrudeImage(const unsigned char *rgbaPixels, int width, int height) {
+    int paddedWidth = width + 2 * TEXTURE_ATLAS_PADDING;
+    int paddedHeight = height + 2 * TEXTURE_ATLAS_PADDING;
+
+    unsigned char *padded = malloc(((size_t) paddedWidth) * ((size_t) paddedHeight) * 4);
+    if (padded == NULL) return NULL;
+
+    for (int py = 0; py < paddedHeight; ++py) {
+        int sy = py - TEXTURE_ATLAS_PADDING;
+        if (sy < 0) sy = 0;
+        if (sy >= height) sy = height - 1;
+
+        for (int px = 0; px < paddedWidth; ++px) {
+            int sx = px - TEXTURE_ATLAS_PADDING;
+            if (sx < 0) sx = 0;
+            if (sx >= width) sx = width - 1;
+
+            memcpy(&padded[(((size_t) py) * paddedWidth + px) * 4], &rgbaPixels[(((size_t) sy) * width + sx) * 4], 4);
+        }
+    }
+
+    return padded;
+}
+
+void allocTextureAtlas(struct TextureAtlas **atlasPtr) {
+    if (atlasPtr == NULL || (*atlasPtr) != NULL) return;
+
+    struct TextureAtlas *newAtlas = calloc(1, sizeof(struct TextureAtlas));
+    if (newAtlas == NULL) return;
+
+    newAtlas->_pages = NULL;
+    newAtlas->_numPages = 0;
+    newAtlas->_pageSize = TEXTURE_ATLAS_PAGE_SIZE;
+    newAtlas->_images = NULL;
+    newAtlas->_numImages = 0;
+    newAtlas->_imagesCapacity = 0;
+
+    (*atlasPtr) = newAtlas;
+    newAtlas = NULL;
+}
+
+void deleteTextureAtlas(struct TextureAtlas **atlasPtr) {
+    if (atlasPtr == NULL || (*atlasPtr) == NULL) return;
+
+    struct TextureAtlas *atlas = (*atlasPtr);
+    for (size_t i = 0; i < atlas->_numPages; ++i) {
+        // page textures belong to the resource manager
+        atlas->_pages[i].texture = NULL;
+        deleteString(&atlas->_pages[i].paramKey);
+        free(atlas->_pages[i].nodes);
+        atlas->_pages[i].nodes = NULL;
+    }
+
+    free(atlas->_pages);
+    atlas->_pages = NULL;
+    atlas->_numPages = 0;
+
+    for (size_t i = 0; i < atlas->_numImages; ++i) {
+        deleteString(&atlas->_images[i].fileName);
+        deleteString(&atlas->_images[i].paramKey);
+        atlas->_images[i].page = NULL;
+    }
+
+    free(atlas->_images);
+    atlas->_images = NULL;
+    atlas->_numImages = 0;
+    atlas->_imagesCapacity = 0;
+
+    free(atlas);
+    atlas = NULL;
+    (*atlasPtr) = NULL;
+}
+
+bool packIntoTextureAtlas(
+    struct TextureAtlas *atlas,
+    struct Py3dResourceManager *manager,
+    const char *fileName,
+    const unsigned char *rgbaPixels,
+    int width,
+    int height,
+    json_object *textureParams,
+    struct Texture **pageOut,
+    int offset[2]
+) {
+    if (atlas == NULL || manager == NULL || rgbaPixels == NULL || pageOut == NULL || offset == NULL) return false;
+
+    int paddedWidth = width + 2 * TEXTURE_ATLAS_PADDING;
+    int paddedHeight = height + 2 * TEXTURE_ATLAS_PADDING;
+    if (width <= 0 || height <= 0 || paddedWidth > atlas->_pageSize || paddedHeight > atlas->_pageSize) return false;
+
+    const char *paramKey = getParamKey(&textureParams);
+
+    struct AtlasPage *page = NULL;
+    size_t nodeIndex = 0;
+    int pos[2] = {0};
+    for (size_t i = 0; i < atlas->_numPages && page == NULL; ++i) {
+        struct AtlasPage *candidate = &atlas->_pages[i];
+        if (!stringEqualsCStr(candidate->paramKey, paramKey)) continue;
+
+        if (findSkylinePosition(candidate, paddedWidth, paddedHeight, atlas->_pageSize, &nodeIndex, pos)) {
+            page = candidate;
+        }
+    }
+
+    if (page == NULL) {
+        page = addAtlasPage(atlas, manager, paramKey, textureParams);
+        if (page == NULL) return false;
+
+        if (!findSkylinePosition(page, paddedWidth, paddedHeight, atlas->_pageSize, &nodeIndex, pos)) return false;
+    }
+
+    unsigned char *padded = extrudeImage(rgbaPixels, width, height);
+    if (padded == NULL) {
+        critical_log("%s", "[TextureAtlas]: Could not allocate padded image");
+        return false;
+    }
+
+    if (!addSkylineLevel(page, nodeIndex, pos[0], pos[1] + paddedHeight, paddedWidth)) {
+        free(padded);
+        return false;
+    }
+
+    setTextureRegion(page->texture, pos[0], pos[1], paddedWidth, paddedHeight, padded);
+    free(padded);
+    padded = NULL;
+
+    (*pageOut) = page->texture;
+    offset[0] = pos[0] + TEXTURE_ATLAS_PADDING;
+    offset[1] = pos[1] + TEXTURE_ATLAS_PADDING;
+
+    // the image is on the page either way, a failed record only means a later import packs it again
+    if (fileName != NULL) {
+        addAtlasImage(atlas, fileName, paramKey, page->texture, offset);
+    }
+
+    return true;
+}
+
+bool findInTextureAtlas(
+    struct TextureAtlas *atlas,
+    const char *fileName,
+    json_object *textureParams,
+    struct Texture **pageOut,
+    int offset[2]
+) {
+    if (atlas == NULL || fileName == NULL || pageOut == NULL || offset == NULL) return false;
+
+    const char *paramKey = getParamKey(&textureParams);
+    for (size_t i = 0; i < atlas->_numImages; ++i) {
+        struct AtlasImage *image = &atlas->_images[i];
+        if (!stringEqualsCStr(image->fileName, fileName) || !stringEqualsCStr(image->paramKey, paramKey)) continue;
+
+        (*pageOut) = image->page;
+        offset[0] = image->offset[0];
+        offset[1] = image->offset[1];
+
+        return true;
+    }
+
+    return false;
+}
@@ -17,10 +17,23 @@ static FILE *warningfd;
 static FILE *errorfd;
 static FILE *criticalfd;
 
+// Parallel jobs log from worker threads, the stream stays locked so a line is never split by another thread's
 static void level_log(FILE *fd, const char *level, const char *message, va_list args) {
+#ifndef _WIN32
+    flockfile(fd);
+#else
+    _lock_file(fd);
+#endif
+
     fprintf(fd, "[%s]: ", level);
     vfprintf(fd, message, args);
     fprintf(fd, "\n");
+
+#ifndef _WIN32
+    funlockfile(fd);
+#else
+    _unlock_file(fd);
+#endif
 }
 
 void initLogger() {
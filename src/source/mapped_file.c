@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "logger.h"
+#include "mapped_file.h"
+
+#define MAPPED_FILE_TEMP_EXTENSION ".tmp"
+
+#ifdef _WIN32
+struct MappedFileHandles {
+    HANDLE file;
+    HANDLE mapping;
+};
+#endif
+
+static bool mapFile(struct MappedFile *mappedFile, const char *path) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    mappedFile->data = data;
+    mappedFile->size = (size_t) fileStat.st_size;
+#else
+    mappedFile->_handles = calloc(1, sizeof(struct MappedFileHandles));
+    if (mappedFile->_handles == NULL) return false;
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    mappedFile->_handles->file = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) return false;
+
+    mappedFile->_handles->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappedFile->_handles->mapping == NULL) return false;
+
+    mappedFile->data = MapViewOfFile(mappedFile->_handles->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mappedFile->data == NULL) return false;
+
+    mappedFile->size = (size_t) fileSize.QuadPart;
+#endif
+
+    return true;
+}
+
+static void unmapFile(struct MappedFile *mappedFile) {
+#ifndef _WIN32
+    if (mappedFile->data != NULL) {
+        munmap((void *) mappedFile->data, mappedFile->size);
+    }
+#else
+    if (mappedFile->_handles != NULL) {
+        if (mappedFile->data != NULL) UnmapViewOfFile(mappedFile->data);
+        if (mappedFile->_handles->mapping != NULL) CloseHandle(mappedFile->_handles->mapping);
+        if (mappedFile->_handles->file != NULL) CloseHandle(mappedFile->_handles->file);
+        free(mappedFile->_handles);
+    }
+#endif
+
+    mappedFile->data = NULL;
+    mappedFile->size = 0;
+    mappedFile->_handles = NULL;
+}
+
+// Empty files can not be mapped and fail like missing ones
+bool allocMappedFile(struct MappedFile **mappedFilePtr, const char *path) {
+    if (mappedFilePtr == NULL || (*mappedFilePtr) != NULL || path == NULL) return false;
+
+    struct MappedFile *newMappedFile = calloc(1, sizeof(struct MappedFile));
+    if (newMappedFile == NULL) {
+        critical_log("%s", "[MappedFile]: Memory allocation failure");
+        return false;
+    }
+
+    if (!mapFile(newMappedFile, path)) {
+        unmapFile(newMappedFile);
+        free(newMappedFile);
+        return false;
+    }
+
+    (*mappedFilePtr) = newMappedFile;
+
+    return true;
+}
+
+void deleteMappedFile(struct MappedFile **mappedFilePtr) {
+    if (mappedFilePtr == NULL || (*mappedFilePtr) == NULL) return;
+
+    unmapFile(*mappedFilePtr);
+    free(*mappedFilePtr);
+    (*mappedFilePtr) = NULL;
+}
+
+// Mixes eight bytes per step so hashing stays well below the cost of reading the file in
+uint64_t hashMappedFile(const struct MappedFile *mappedFile) {
+    if (mappedFile == NULL) return 0;
+
+    const unsigned char *bytes = mappedFile->data;
+    size_t numBytes = mappedFile->size;
+    uint64_t hash = 14695981039346656037ull ^ (uint64_t) numBytes;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= numBytes; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < numBytes; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+char *allocPathWithExtension(const char *path, const char *extension) {
+    if (path == NULL || extension == NULL) return NULL;
+
+    size_t pathLength = strlen(path);
+    size_t extensionLength = strlen(extension);
+
+    char *newPath = malloc(pathLength + extensionLength + 1);
+    if (newPath == NULL) return NULL;
+
+    memcpy(newPath, path, pathLength);
+    memcpy(newPath + pathLength, extension, extensionLength + 1);
+
+    return newPath;
+}
+
+bool allocMappedFileWriter(struct MappedFileWriter **writerPtr, const char *path) {
+    if (writerPtr == NULL || (*writerPtr) != NULL || path == NULL) return false;
+
+    struct MappedFileWriter *newWriter = calloc(1, sizeof(struct MappedFileWriter));
+    if (newWriter != NULL) {
+        newWriter->path = allocPathWithExtension(path, "");
+        newWriter->tempPath = allocPathWithExtension(path, MAPPED_FILE_TEMP_EXTENSION);
+    }
+    if (newWriter == NULL || newWriter->path == NULL || newWriter->tempPath == NULL) {
+        critical_log("%s", "[MappedFile]: Memory allocation failure while creating file writer");
+        deleteMappedFileWriter(&newWriter);
+        return false;
+    }
+
+    newWriter->file = fopen(newWriter->tempPath, "wb");
+    if (newWriter->file == NULL) {
+        warning_log("[MappedFile]: Could not open \"%s\" for writing", newWriter->tempPath);
+        deleteMappedFileWriter(&newWriter);
+        return false;
+    }
+
+    (*writerPtr) = newWriter;
+
+    return true;
+}
+
+void deleteMappedFileWriter(struct MappedFileWriter **writerPtr) {
+    if (writerPtr == NULL || (*writerPtr) == NULL) return;
+
+    struct MappedFileWriter *writer = (*writerPtr);
+    if (writer->file != NULL) {
+        fclose(writer->file);
+        remove(writer->tempPath);
+    }
+
+    free(writer->tempPath);
+    free(writer->path);
+    free(writer);
+    (*writerPtr) = NULL;
+}
+
+bool commitMappedFileWriter(struct MappedFileWriter *writer) {
+    if (writer == NULL || writer->file == NULL) return false;
+
+    bool closed = fclose(writer->file) == 0;
+    writer->file = NULL;
+
+    if (!closed) {
+        warning_log("[MappedFile]: Failed writing \"%s\"", writer->tempPath);
+        remove(writer->tempPath);
+        return false;
+    }
+
+#ifdef _WIN32
+    remove(writer->path);
+#endif
+    if (rename(writer->tempPath, writer->path) != 0) {
+        warning_log("[MappedFile]: Could not move \"%s\" into place", writer->tempPath);
+        remove(writer->tempPath);
+        return false;
+    }
+
+    return true;
+}
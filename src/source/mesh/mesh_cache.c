@@ -0,0 +1,376 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "mesh/mesh_cache.h"
+
+#define MESH_CACHE_MAGIC "P3DMESH"
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numObjects;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    uint32_t reversePolygons;
+    int32_t lodCount;
+    int32_t lodTrianglePercent;
+    uint32_t padding;
+};
+
+struct MeshCacheLod {
+    uint64_t firstIndex;
+    uint64_t numIndices;
+    float error;
+    uint32_t padding;
+};
+
+// Table of contents entry, offsets are from the start of the file
+struct MeshCacheEntry {
+    char name[MESH_CACHE_NAME_SIZE];
+    uint8_t position;
+    uint8_t normal;
+    uint8_t texCoord;
+    uint8_t padding;
+    uint32_t stride;
+    uint32_t positionOffset;
+    uint32_t normalOffset;
+    uint32_t texCoordOffset;
+    float positionScale[3];
+    float positionBias[3];
+    uint32_t indexSize;
+    uint64_t numVertices;
+    uint64_t numIndices;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsCenter[3];
+    float boundsRadius;
+    uint32_t numLods;
+    uint32_t lodPadding;
+    struct MeshCacheLod lods[MODEL_MAX_LODS];
+};
+
+// The source file together with the import options the cached geometry was built with
+struct MeshCacheSourceKey {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+    uint32_t reversePolygons;
+    int32_t lodCount;
+    int32_t lodTrianglePercent;
+};
+
+struct MeshCache {
+    struct MappedFile *file;
+    const unsigned char *data;
+    size_t size;
+    const struct MeshCacheHeader *header;
+    const struct MeshCacheEntry *entries;
+};
+
+struct MeshCacheWriter {
+    struct MappedFileWriter *output;
+    struct MeshCacheHeader header;
+    struct MeshCacheEntry *entries;
+    size_t maxObjects;
+    uint64_t offset;
+    bool failed;
+};
+
+static bool readSourceKey(const char *sourcePath, struct MeshCacheSourceKey *key) {
+    struct stat sourceStat;
+    if (stat(sourcePath, &sourceStat) != 0) return false;
+
+    struct MappedFile *source = NULL;
+    if (!allocMappedFile(&source, sourcePath)) return false;
+
+    key->size = (uint64_t) source->size;
+    key->mtime = (int64_t) sourceStat.st_mtime;
+    key->hash = hashMappedFile(source);
+    key->reversePolygons = getConfigWfoReversePolygons() ? 1 : 0;
+    key->lodCount = getConfigModelLodCount();
+    key->lodTrianglePercent = getConfigModelLodTrianglePercent();
+    deleteMappedFile(&source);
+
+    return true;
+}
+
+static bool isBlobInFile(uint64_t offset, uint64_t numBytes, size_t fileSize) {
+    return offset % MESH_CACHE_BLOB_ALIGNMENT == 0 && offset <= fileSize && numBytes <= fileSize - offset;
+}
+
+static bool isEntryValid(const struct MeshCacheEntry *entry, size_t fileSize) {
+    if (memchr(entry->name, 0, MESH_CACHE_NAME_SIZE) == NULL) return false;
+    if (entry->indexSize != sizeof(uint16_t) && entry->indexSize != sizeof(uint32_t)) return false;
+    if (entry->stride == 0 || entry->numVertices == 0 || entry->numIndices == 0) return false;
+    if (entry->numVertices > SIZE_MAX / entry->stride || entry->numIndices > SIZE_MAX / entry->indexSize) return false;
+
+    if (entry->numLods == 0 || entry->numLods > MODEL_MAX_LODS) return false;
+    for (uint32_t i = 0; i < entry->numLods; ++i) {
+        const struct MeshCacheLod *lod = &entry->lods[i];
+        if (lod->numIndices == 0 || lod->firstIndex > entry->numIndices) return false;
+        if (lod->numIndices > entry->numIndices - lod->firstIndex) return false;
+    }
+
+    return isBlobInFile(entry->vertexOffset, entry->numVertices * entry->stride, fileSize) &&
+           isBlobInFile(entry->indexOffset, entry->numIndices * entry->indexSize, fileSize);
+}
+
+static bool isCacheValid(const struct MeshCache *cache, const struct MeshCacheSourceKey *key) {
+    if (cache->size < sizeof(struct MeshCacheHeader)) return false;
+
+    const struct MeshCacheHeader *header = cache->header;
+    if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0) return false;
+    if (header->version != MESH_CACHE_VERSION || header->fileSize != cache->size) return false;
+    if (header->sourceSize != key->size || header->sourceMtime != key->mtime || header->sourceHash != key->hash) return false;
+    if (header->reversePolygons != key->reversePolygons) return false;
+    if (header->lodCount != key->lodCount || header->lodTrianglePercent != key->lodTrianglePercent) return false;
+
+    size_t maxEntries = (cache->size - sizeof(struct MeshCacheHeader)) / sizeof(struct MeshCacheEntry);
+    if (header->numObjects > maxEntries) return false;
+
+    for (uint32_t i = 0; i < header->numObjects; ++i) {
+        if (!isEntryValid(&cache->entries[i], cache->size)) return false;
+    }
+
+    return true;
+}
+
+bool allocMeshCache(struct MeshCache **cachePtr, const char *sourcePath) {
+    if (cachePtr == NULL || (*cachePtr) != NULL || sourcePath == NULL) return false;
+
+    struct MeshCacheSourceKey key;
+    if (!readSourceKey(sourcePath, &key)) return false;
+
+    char *path = allocPathWithExtension(sourcePath, MESH_CACHE_EXTENSION);
+    if (path == NULL) return false;
+
+    struct MeshCache *newCache = calloc(1, sizeof(struct MeshCache));
+    if (newCache == NULL) {
+        critical_log("%s", "[MeshCache]: Memory allocation failure while opening mesh cache");
+        free(path);
+        return false;
+    }
+
+    if (!allocMappedFile(&newCache->file, path)) {
+        free(newCache);
+        free(path);
+        return false;
+    }
+
+    newCache->data = newCache->file->data;
+    newCache->size = newCache->file->size;
+    newCache->header = (const struct MeshCacheHeader *) newCache->data;
+    newCache->entries = (const struct MeshCacheEntry *) (newCache->data + sizeof(struct MeshCacheHeader));
+
+    if (!isCacheValid(newCache, &key)) {
+        trace_log("[MeshCache]: \"%s\" is stale or damaged, it will be rebuilt", path);
+        deleteMappedFile(&newCache->file);
+        free(newCache);
+        free(path);
+        return false;
+    }
+
+    free(path);
+    (*cachePtr) = newCache;
+
+    return true;
+}
+
+void deleteMeshCache(struct MeshCache **cachePtr) {
+    if (cachePtr == NULL || (*cachePtr) == NULL) return;
+
+    deleteMappedFile(&(*cachePtr)->file);
+    free(*cachePtr);
+    (*cachePtr) = NULL;
+}
+
+size_t getMeshCacheObjectCount(const struct MeshCache *cache) {
+    if (cache == NULL) return 0;
+
+    return cache->header->numObjects;
+}
+
+bool getMeshCacheObject(const struct MeshCache *cache, size_t index, struct MeshCacheObject *object) {
+    if (cache == NULL || object == NULL || index >= cache->header->numObjects) return false;
+
+    const struct MeshCacheEntry *entry = &cache->entries[index];
+
+    object->name = entry->name;
+    object->format.position = entry->position;
+    object->format.normal = entry->normal;
+    object->format.texCoord = entry->texCoord;
+    object->format.stride = entry->stride;
+    object->format.positionOffset = entry->positionOffset;
+    object->format.normalOffset = entry->normalOffset;
+    object->format.texCoordOffset = entry->texCoordOffset;
+    memcpy(object->format.positionScale, entry->positionScale, sizeof(entry->positionScale));
+    memcpy(object->format.positionBias, entry->positionBias, sizeof(entry->positionBias));
+    object->vertices = cache->data + entry->vertexOffset;
+    object->numVertices = (size_t) entry->numVertices;
+    object->indices = cache->data + entry->indexOffset;
+    object->indexSize = entry->indexSize;
+    object->numIndices = (size_t) entry->numIndices;
+    object->numLods = entry->numLods;
+    for (uint32_t i = 0; i < entry->numLods; ++i) {
+        object->lods[i].firstIndex = (size_t) entry->lods[i].firstIndex;
+        object->lods[i].numIndices = (size_t) entry->lods[i].numIndices;
+        object->lods[i].error = entry->lods[i].error;
+    }
+    memcpy(object->boundsCenter, entry->boundsCenter, sizeof(entry->boundsCenter));
+    object->boundsRadius = entry->boundsRadius;
+
+    return true;
+}
+
+bool allocMeshCacheWriter(struct MeshCacheWriter **writerPtr, const char *sourcePath, size_t maxObjects) {
+    if (writerPtr == NULL || (*writerPtr) != NULL || sourcePath == NULL || maxObjects == 0) return false;
+
+    struct MeshCacheSourceKey key;
+    if (!readSourceKey(sourcePath, &key)) return false;
+
+    struct MeshCacheWriter *newWriter = calloc(1, sizeof(struct MeshCacheWriter));
+    if (newWriter == NULL) {
+        critical_log("%s", "[MeshCache]: Memory allocation failure while creating mesh cache writer");
+        return false;
+    }
+
+    newWriter->entries = calloc(maxObjects, sizeof(struct MeshCacheEntry));
+    char *path = allocPathWithExtension(sourcePath, MESH_CACHE_EXTENSION);
+    if (path == NULL || newWriter->entries == NULL) {
+        critical_log("%s", "[MeshCache]: Memory allocation failure while creating mesh cache writer");
+        free(path);
+        deleteMeshCacheWriter(&newWriter);
+        return false;
+    }
+
+    bool opened = allocMappedFileWriter(&newWriter->output, path);
+    free(path);
+    if (!opened) {
+        warning_log("[MeshCache]: Meshes of \"%s\" will not be cached", sourcePath);
+        deleteMeshCacheWriter(&newWriter);
+        return false;
+    }
+
+    memcpy(newWriter->header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    newWriter->header.version = MESH_CACHE_VERSION;
+    newWriter->header.sourceSize = key.size;
+    newWriter->header.sourceMtime = key.mtime;
+    newWriter->header.sourceHash = key.hash;
+    newWriter->header.reversePolygons = key.reversePolygons;
+    newWriter->header.lodCount = key.lodCount;
+    newWriter->header.lodTrianglePercent = key.lodTrianglePercent;
+    newWriter->maxObjects = maxObjects;
+
+    // the header and table of contents are written on commit, blobs start after the space reserved for them
+    newWriter->offset = sizeof(struct MeshCacheHeader) + maxObjects * sizeof(struct MeshCacheEntry);
+
+    (*writerPtr) = newWriter;
+
+    return true;
+}
+
+void deleteMeshCacheWriter(struct MeshCacheWriter **writerPtr) {
+    if (writerPtr == NULL || (*writerPtr) == NULL) return;
+
+    struct MeshCacheWriter *writer = (*writerPtr);
+    deleteMappedFileWriter(&writer->output);
+    free(writer->entries);
+    free(writer);
+    (*writerPtr) = NULL;
+}
+
+static bool writeBlob(struct MeshCacheWriter *writer, const void *data, size_t numBytes, uint64_t *offset) {
+    static const unsigned char zeros[MESH_CACHE_BLOB_ALIGNMENT] = {0};
+
+    size_t padding = (size_t) ((MESH_CACHE_BLOB_ALIGNMENT - writer->offset % MESH_CACHE_BLOB_ALIGNMENT) % MESH_CACHE_BLOB_ALIGNMENT);
+    if (fseek(writer->output->file, (long) writer->offset, SEEK_SET) != 0) return false;
+    if (padding > 0 && fwrite(zeros, 1, padding, writer->output->file) != padding) return false;
+
+    (*offset) = writer->offset + padding;
+    if (fwrite(data, 1, numBytes, writer->output->file) != numBytes) return false;
+
+    writer->offset = (*offset) + numBytes;
+
+    return true;
+}
+
+bool appendMeshCacheObject(struct MeshCacheWriter *writer, const struct MeshCacheObject *object) {
+    if (writer == NULL || writer->output == NULL || writer->failed || object == NULL || object->name == NULL) return false;
+    if (object->vertices == NULL || object->numVertices == 0 || object->indices == NULL || object->numIndices == 0) return false;
+    if (object->numLods == 0 || object->numLods > MODEL_MAX_LODS) return false;
+
+    if (writer->header.numObjects >= writer->maxObjects) {
+        error_log("[MeshCache]: \"%s\" does not fit in the table of contents of \"%s\"", object->name, writer->output->path);
+        writer->failed = true;
+        return false;
+    }
+
+    struct MeshCacheEntry *entry = &writer->entries[writer->header.numObjects];
+    strncpy(entry->name, object->name, MESH_CACHE_NAME_SIZE - 1);
+    entry->position = object->format.position;
+    entry->normal = object->format.normal;
+    entry->texCoord = object->format.texCoord;
+    entry->stride = object->format.stride;
+    entry->positionOffset = object->format.positionOffset;
+    entry->normalOffset = object->format.normalOffset;
+    entry->texCoordOffset = object->format.texCoordOffset;
+    memcpy(entry->positionScale, object->format.positionScale, sizeof(entry->positionScale));
+    memcpy(entry->positionBias, object->format.positionBias, sizeof(entry->positionBias));
+    entry->indexSize = (uint32_t) object->indexSize;
+    entry->numVertices = object->numVertices;
+    entry->numIndices = object->numIndices;
+    memcpy(entry->boundsCenter, object->boundsCenter, sizeof(entry->boundsCenter));
+    entry->boundsRadius = object->boundsRadius;
+    entry->numLods = (uint32_t) object->numLods;
+    for (size_t i = 0; i < object->numLods; ++i) {
+        entry->lods[i].firstIndex = object->lods[i].firstIndex;
+        entry->lods[i].numIndices = object->lods[i].numIndices;
+        entry->lods[i].error = object->lods[i].error;
+    }
+
+    bool written = writeBlob(writer, object->vertices, object->numVertices * object->format.stride, &entry->vertexOffset) &&
+                   writeBlob(writer, object->indices, object->numIndices * object->indexSize, &entry->indexOffset);
+    if (!written) {
+        warning_log("[MeshCache]: Failed writing \"%s\", meshes will not be cached", writer->output->tempPath);
+        writer->failed = true;
+        return false;
+    }
+
+    writer->header.numObjects++;
+
+    return true;
+}
+
+bool commitMeshCacheWriter(struct MeshCacheWriter *writer) {
+    if (writer == NULL || writer->output == NULL || writer->failed) return false;
+
+    writer->header.fileSize = writer->offset;
+
+    FILE *file = writer->output->file;
+    bool written = fseek(file, 0, SEEK_SET) == 0 &&
+                   fwrite(&writer->header, sizeof(struct MeshCacheHeader), 1, file) == 1 &&
+                   fwrite(writer->entries, sizeof(struct MeshCacheEntry), writer->maxObjects, file) == writer->maxObjects;
+    if (!written) {
+        warning_log("[MeshCache]: Failed writing \"%s\", meshes will not be cached", writer->output->tempPath);
+        deleteMappedFileWriter(&writer->output);
+        return false;
+    }
+
+    if (!commitMappedFileWriter(writer->output)) {
+        deleteMappedFileWriter(&writer->output);
+        return false;
+    }
+
+    trace_log("[MeshCache]: Wrote %u objects to \"%s\"", writer->header.numObjects, writer->output->path);
+    deleteMappedFileWriter(&writer->output);
+
+    return true;
+}
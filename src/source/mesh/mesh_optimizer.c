@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "resources/model.h"
+#include "mesh/mesh_optimizer.h"
+
+#define NO_VERTEX UINT32_MAX
+
+// Triangles that use each vertex, stored as one flat array addressed through per vertex offsets
+struct VertexAdjacency {
+    uint32_t *offsets;
+    uint32_t *triangles;
+};
+
+static bool buildVertexAdjacency(struct VertexAdjacency *adjacency, const uint32_t *indices, size_t numIndices, size_t numVertices, uint32_t *liveCounts) {
+    adjacency->offsets = calloc(numVertices + 1, sizeof(uint32_t));
+    adjacency->triangles = malloc(numIndices * sizeof(uint32_t));
+    if (adjacency->offsets == NULL || adjacency->triangles == NULL) return false;
+
+    for (size_t i = 0; i < numIndices; ++i) {
+        liveCounts[indices[i]]++;
+    }
+
+    for (size_t v = 0; v < numVertices; ++v) {
+        adjacency->offsets[v + 1] = adjacency->offsets[v] + liveCounts[v];
+    }
+
+    // offsets[v] is used as a fill cursor and restored afterwards
+    for (size_t i = 0; i < numIndices; ++i) {
+        adjacency->triangles[adjacency->offsets[indices[i]]++] = (uint32_t) (i / 3);
+    }
+    for (size_t v = numVertices; v > 0; --v) {
+        adjacency->offsets[v] = adjacency->offsets[v - 1];
+    }
+    adjacency->offsets[0] = 0;
+
+    return true;
+}
+
+static void deleteVertexAdjacency(struct VertexAdjacency *adjacency) {
+    free(adjacency->offsets);
+    adjacency->offsets = NULL;
+    free(adjacency->triangles);
+    adjacency->triangles = NULL;
+}
+
+// Falls back to recently emitted vertices that still have triangles left, then to the input order
+static uint32_t skipDeadEnd(
+    const uint32_t *liveCounts,
+    uint32_t *deadEndStack,
+    size_t *deadEndSize,
+    size_t *cursor,
+    size_t numVertices
+) {
+    while ((*deadEndSize) > 0) {
+        uint32_t vertex = deadEndStack[--(*deadEndSize)];
+        if (liveCounts[vertex] > 0) return vertex;
+    }
+
+    while ((*cursor) < numVertices) {
+        uint32_t vertex = (uint32_t) (*cursor)++;
+        if (liveCounts[vertex] > 0) return vertex;
+    }
+
+    return NO_VERTEX;
+}
+
+// Picks the candidate that is still in the cache and will stay there while its remaining triangles are emitted
+static uint32_t getNextVertex(
+    const uint32_t *candidates,
+    size_t numCandidates,
+    const uint32_t *liveCounts,
+    const uint32_t *cacheTimes,
+    uint32_t timestamp,
+    unsigned int cacheSize
+) {
+    uint32_t best = NO_VERTEX;
+    int64_t bestPriority = -1;
+
+    for (size_t i = 0; i < numCandidates; ++i) {
+        uint32_t vertex = candidates[i];
+        if (liveCounts[vertex] == 0) continue;
+
+        int64_t priority = 0;
+        int64_t age = (int64_t) timestamp - (int64_t) cacheTimes[vertex];
+        if (age + 2 * (int64_t) liveCounts[vertex] <= (int64_t) cacheSize) {
+            priority = age;
+        }
+
+        if (priority > bestPriority) {
+            bestPriority = priority;
+            best = vertex;
+        }
+    }
+
+    return best;
+}
+
+bool optimizeVertexCache(uint32_t *indices, size_t numIndices, size_t numVertices, unsigned int cacheSize) {
+    if (indices == NULL || numIndices == 0 || numIndices % 3 != 0 || numVertices == 0 || cacheSize == 0) return false;
+
+    const size_t numTriangles = numIndices / 3;
+
+    uint32_t *liveCounts = calloc(numVertices, sizeof(uint32_t));
+    uint32_t *cacheTimes = calloc(numVertices, sizeof(uint32_t));
+    uint32_t *deadEndStack = malloc(numIndices * sizeof(uint32_t));
+    uint32_t *candidates = malloc(numIndices * sizeof(uint32_t));
+    bool *emitted = calloc(numTriangles, sizeof(bool));
+    uint32_t *output = malloc(numIndices * sizeof(uint32_t));
+    struct VertexAdjacency adjacency = {NULL, NULL};
+
+    bool ok = liveCounts != NULL && cacheTimes != NULL && deadEndStack != NULL && candidates != NULL && emitted != NULL && output != NULL;
+    ok = ok && buildVertexAdjacency(&adjacency, indices, numIndices, numVertices, liveCounts);
+    if (!ok) {
+        critical_log("%s", "[MeshOptimizer]: Could not allocate vertex cache optimization scratch memory");
+    } else {
+        uint32_t timestamp = cacheSize + 1;
+        size_t deadEndSize = 0;
+        size_t cursor = 1;
+        size_t numOutput = 0;
+
+        uint32_t fanVertex = 0;
+        while (fanVertex != NO_VERTEX) {
+            size_t numCandidates = 0;
+
+            // emit every remaining triangle around the fan vertex
+            for (uint32_t a = adjacency.offsets[fanVertex]; a < adjacency.offsets[fanVertex + 1]; ++a) {
+                uint32_t triangle = adjacency.triangles[a];
+                if (emitted[triangle]) continue;
+
+                for (int corner = 0; corner < 3; ++corner) {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    output[numOutput++] = vertex;
+                    deadEndStack[deadEndSize++] = vertex;
+                    candidates[numCandidates++] = vertex;
+                    liveCounts[vertex]--;
+
+                    if (timestamp - cacheTimes[vertex] > cacheSize) {
+                        cacheTimes[vertex] = timestamp++;
+                    }
+                }
+
+                emitted[triangle] = true;
+            }
+
+            fanVertex = getNextVertex(candidates, numCandidates, liveCounts, cacheTimes, timestamp, cacheSize);
+            if (fanVertex == NO_VERTEX) {
+                fanVertex = skipDeadEnd(liveCounts, deadEndStack, &deadEndSize, &cursor, numVertices);
+            }
+        }
+
+        memcpy(indices, output, numIndices * sizeof(uint32_t));
+    }
+
+    deleteVertexAdjacency(&adjacency);
+    free(output);
+    free(emitted);
+    free(candidates);
+    free(deadEndStack);
+    free(cacheTimes);
+    free(liveCounts);
+
+    return ok;
+}
+
+bool optimizeVertexFetch(struct VertexPNT *vertices, size_t numVertices, uint32_t *indices, size_t numIndices) {
+    if (vertices == NULL || numVertices == 0 || indices == NULL || numIndices == 0) return false;
+
+    uint32_t *remap = malloc(numVertices * sizeof(uint32_t));
+    struct VertexPNT *reordered = malloc(numVertices * sizeof(struct VertexPNT));
+    if (remap == NULL || reordered == NULL) {
+        critical_log("%s", "[MeshOptimizer]: Could not allocate vertex fetch optimization scratch memory");
+        free(reordered);
+        free(remap);
+        return false;
+    }
+
+    memset(remap, 0xFF, numVertices * sizeof(uint32_t));
+
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < numIndices; ++i) {
+        uint32_t vertex = indices[i];
+        if (remap[vertex] == NO_VERTEX) {
+            remap[vertex] = nextVertex;
+            reordered[nextVertex] = vertices[vertex];
+            nextVertex++;
+        }
+
+        indices[i] = remap[vertex];
+    }
+
+    // vertices the index buffer never references keep their data at the end
+    for (size_t v = 0; v < numVertices; ++v) {
+        if (remap[v] == NO_VERTEX) {
+            reordered[nextVertex++] = vertices[v];
+        }
+    }
+
+    memcpy(vertices, reordered, numVertices * sizeof(struct VertexPNT));
+
+    free(reordered);
+    free(remap);
+
+    return true;
+}
+
+float calcAverageCacheMissRatio(const uint32_t *indices, size_t numIndices, size_t numVertices, unsigned int cacheSize) {
+    if (indices == NULL || numIndices < 3 || numVertices == 0 || cacheSize == 0) return 0.0f;
+
+    // a vertex is a hit while fewer than cacheSize misses happened since it was last loaded
+    uint32_t *loadedAt = malloc(numVertices * sizeof(uint32_t));
+    if (loadedAt == NULL) return 0.0f;
+    memset(loadedAt, 0xFF, numVertices * sizeof(uint32_t));
+
+    uint32_t misses = 0;
+    for (size_t i = 0; i < numIndices; ++i) {
+        uint32_t vertex = indices[i];
+        if (loadedAt[vertex] == NO_VERTEX || misses - loadedAt[vertex] >= cacheSize) {
+            loadedAt[vertex] = misses;
+            misses++;
+        }
+    }
+
+    free(loadedAt);
+
+    return ((float) misses) / ((float) (numIndices / 3));
+}
@@ -0,0 +1,655 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "resources/model.h"
+#include "mesh/mesh_simplifier.h"
+
+#define EMPTY_EDGE UINT64_MAX
+// Constraint planes along borders and seams count this many times more than the faces around them
+#define BORDER_PLANE_WEIGHT 10.0
+// Collapses that turn any remaining triangle by more than about 75 degrees are rejected
+#define MIN_FLIP_COSINE 0.25
+#define BORDER_COUNT_MAX UINT8_MAX
+
+// Symmetric 4x4 matrix of the summed squared distances to a set of planes, plus the face area behind it
+struct Quadric {
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double area;
+};
+
+// Open addressing set of directed edges, the key is the first vertex in the high 32 bits
+struct EdgeSet {
+    uint64_t *keys;
+    size_t capacity;
+};
+
+struct Collapse {
+    float cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+struct MeshSimplifier {
+    const struct VertexPNT *vertices;
+    size_t numVertices;
+    uint32_t *indices;
+    size_t numIndices;
+    float error;
+
+    // vertices with the same position form one group, represented by its first vertex,
+    // every member is linked into a circular list of that position's attribute variations
+    uint32_t *positionGroups;
+    uint32_t *nextWedges;
+    struct Quadric *quadrics;
+
+    // rebuilt on every pass
+    struct EdgeSet halfEdges;
+    struct EdgeSet borderEdges;
+    uint8_t *borderCounts;
+    uint8_t *locked;
+    uint32_t *wedgeRemap;
+    uint32_t *adjacencyOffsets;
+    uint32_t *adjacencyTriangles;
+    struct Collapse *collapses;
+};
+
+static uint64_t makeEdgeKey(uint32_t from, uint32_t to) {
+    return (((uint64_t) from) << 32) | to;
+}
+
+static uint64_t makeUndirectedEdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? makeEdgeKey(a, b) : makeEdgeKey(b, a);
+}
+
+static size_t hashEdgeKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+
+    return (size_t) key;
+}
+
+static bool allocEdgeSet(struct EdgeSet *set, size_t maxEdges) {
+    set->capacity = 16;
+    while (set->capacity < maxEdges * 2) {
+        set->capacity *= 2;
+    }
+
+    set->keys = malloc(set->capacity * sizeof(uint64_t));
+
+    return set->keys != NULL;
+}
+
+static void clearEdgeSet(struct EdgeSet *set) {
+    memset(set->keys, 0xFF, set->capacity * sizeof(uint64_t));
+}
+
+// Returns false when the edge was already in the set
+static bool insertEdge(struct EdgeSet *set, uint64_t key) {
+    size_t mask = set->capacity - 1;
+    for (size_t slot = hashEdgeKey(key) & mask; ; slot = (slot + 1) & mask) {
+        if (set->keys[slot] == key) return false;
+        if (set->keys[slot] == EMPTY_EDGE) {
+            set->keys[slot] = key;
+            return true;
+        }
+    }
+}
+
+static bool containsEdge(const struct EdgeSet *set, uint64_t key) {
+    size_t mask = set->capacity - 1;
+    for (size_t slot = hashEdgeKey(key) & mask; set->keys[slot] != EMPTY_EDGE; slot = (slot + 1) & mask) {
+        if (set->keys[slot] == key) return true;
+    }
+
+    return false;
+}
+
+static void addPlaneToQuadric(struct Quadric *q, double a, double b, double c, double d, double weight) {
+    q->a2 += weight * a * a;
+    q->ab += weight * a * b;
+    q->ac += weight * a * c;
+    q->ad += weight * a * d;
+    q->b2 += weight * b * b;
+    q->bc += weight * b * c;
+    q->bd += weight * b * d;
+    q->c2 += weight * c * c;
+    q->cd += weight * c * d;
+    q->d2 += weight * d * d;
+}
+
+static void addQuadric(struct Quadric *dst, const struct Quadric *src) {
+    dst->a2 += src->a2;
+    dst->ab += src->ab;
+    dst->ac += src->ac;
+    dst->ad += src->ad;
+    dst->b2 += src->b2;
+    dst->bc += src->bc;
+    dst->bd += src->bd;
+    dst->c2 += src->c2;
+    dst->cd += src->cd;
+    dst->d2 += src->d2;
+    dst->area += src->area;
+}
+
+// Area weighted mean of the squared distances from p to the quadric's planes
+static double evalQuadric(const struct Quadric *q, const float p[3]) {
+    double x = p[0], y = p[1], z = p[2];
+    double error =
+        q->a2 * x * x + q->b2 * y * y + q->c2 * z * z + q->d2 +
+        2.0 * (q->ab * x * y + q->ac * x * z + q->bc * y * z + q->ad * x + q->bd * y + q->cd * z);
+
+    if (error < 0.0) error = 0.0;
+
+    return q->area > 0.0 ? error / q->area : error;
+}
+
+static void subVec3d(const float a[3], const float b[3], double dst[3]) {
+    dst[0] = (double) a[0] - b[0];
+    dst[1] = (double) a[1] - b[1];
+    dst[2] = (double) a[2] - b[2];
+}
+
+static void crossVec3d(const double a[3], const double b[3], double dst[3]) {
+    dst[0] = a[1] * b[2] - a[2] * b[1];
+    dst[1] = a[2] * b[0] - a[0] * b[2];
+    dst[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double dotVec3d(const double a[3], const double b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void calcTriangleNormal(const float *p0, const float *p1, const float *p2, double dst[3]) {
+    double e0[3], e1[3];
+    subVec3d(p1, p0, e0);
+    subVec3d(p2, p0, e1);
+    crossVec3d(e0, e1, dst);
+}
+
+static const float *getGroupPosition(const struct MeshSimplifier *s, uint32_t group) {
+    return s->vertices[group].position;
+}
+
+static uint32_t hashPosition(const float position[3]) {
+    uint32_t bits[3];
+    memcpy(bits, position, sizeof(bits));
+
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+static bool samePosition(const float a[3], const float b[3]) {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// Welds vertices that only differ by their normal or texture coordinate
+static bool buildPositionGroups(struct MeshSimplifier *s) {
+    size_t capacity = 16;
+    while (capacity < s->numVertices * 2) {
+        capacity *= 2;
+    }
+
+    uint32_t *slots = malloc(capacity * sizeof(uint32_t));
+    if (slots == NULL) return false;
+    memset(slots, 0xFF, capacity * sizeof(uint32_t));
+
+    size_t mask = capacity - 1;
+    for (uint32_t v = 0; v < s->numVertices; ++v) {
+        const float *position = s->vertices[v].position;
+        size_t slot = hashPosition(position) & mask;
+        while (slots[slot] != UINT32_MAX && !samePosition(s->vertices[slots[slot]].position, position)) {
+            slot = (slot + 1) & mask;
+        }
+
+        if (slots[slot] == UINT32_MAX) {
+            slots[slot] = v;
+            s->positionGroups[v] = v;
+            s->nextWedges[v] = v;
+            continue;
+        }
+
+        uint32_t group = slots[slot];
+        s->positionGroups[v] = group;
+        s->nextWedges[v] = s->nextWedges[group];
+        s->nextWedges[group] = v;
+    }
+
+    free(slots);
+
+    return true;
+}
+
+// Half edges without a twin run along an open border or along a seam between attribute variations
+static void findBorderEdges(struct MeshSimplifier *s) {
+    clearEdgeSet(&s->halfEdges);
+    clearEdgeSet(&s->borderEdges);
+    memset(s->borderCounts, 0, s->numVertices);
+
+    for (size_t i = 0; i < s->numIndices; i += 3) {
+        for (int corner = 0; corner < 3; ++corner) {
+            insertEdge(&s->halfEdges, makeEdgeKey(s->indices[i + corner], s->indices[i + (corner + 1) % 3]));
+        }
+    }
+
+    for (size_t i = 0; i < s->numIndices; i += 3) {
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t a = s->indices[i + corner];
+            uint32_t b = s->indices[i + (corner + 1) % 3];
+            if (containsEdge(&s->halfEdges, makeEdgeKey(b, a))) continue;
+
+            uint32_t groupA = s->positionGroups[a];
+            uint32_t groupB = s->positionGroups[b];
+            if (!insertEdge(&s->borderEdges, makeUndirectedEdgeKey(groupA, groupB))) continue;
+
+            if (s->borderCounts[groupA] < BORDER_COUNT_MAX) s->borderCounts[groupA]++;
+            if (s->borderCounts[groupB] < BORDER_COUNT_MAX) s->borderCounts[groupB]++;
+        }
+    }
+}
+
+static void buildQuadrics(struct MeshSimplifier *s) {
+    memset(s->quadrics, 0, s->numVertices * sizeof(struct Quadric));
+
+    for (size_t i = 0; i < s->numIndices; i += 3) {
+        uint32_t groups[3];
+        const float *positions[3];
+        for (int corner = 0; corner < 3; ++corner) {
+            groups[corner] = s->positionGroups[s->indices[i + corner]];
+            positions[corner] = getGroupPosition(s, groups[corner]);
+        }
+
+        double normal[3];
+        calcTriangleNormal(positions[0], positions[1], positions[2], normal);
+        double length = sqrt(dotVec3d(normal, normal));
+        if (length == 0.0) continue;
+
+        for (int axis = 0; axis < 3; ++axis) {
+            normal[axis] /= length;
+        }
+        double d = -(normal[0] * positions[0][0] + normal[1] * positions[0][1] + normal[2] * positions[0][2]);
+        double area = length * 0.5;
+
+        for (int corner = 0; corner < 3; ++corner) {
+            addPlaneToQuadric(&s->quadrics[groups[corner]], normal[0], normal[1], normal[2], d, area);
+            s->quadrics[groups[corner]].area += area;
+
+            // a plane through the border edge that stands upright on the face keeps the border from sliding
+            uint32_t a = s->indices[i + corner];
+            uint32_t b = s->indices[i + (corner + 1) % 3];
+            if (containsEdge(&s->halfEdges, makeEdgeKey(b, a))) continue;
+
+            double edge[3], borderNormal[3];
+            subVec3d(positions[(corner + 1) % 3], positions[corner], edge);
+            crossVec3d(edge, normal, borderNormal);
+            double borderLength = sqrt(dotVec3d(borderNormal, borderNormal));
+            if (borderLength == 0.0) continue;
+
+            for (int axis = 0; axis < 3; ++axis) {
+                borderNormal[axis] /= borderLength;
+            }
+            const float *p = positions[corner];
+            double borderD = -(borderNormal[0] * p[0] + borderNormal[1] * p[1] + borderNormal[2] * p[2]);
+            double weight = dotVec3d(edge, edge) * BORDER_PLANE_WEIGHT;
+
+            addPlaneToQuadric(&s->quadrics[groups[corner]], borderNormal[0], borderNormal[1], borderNormal[2], borderD, weight);
+            addPlaneToQuadric(&s->quadrics[groups[(corner + 1) % 3]], borderNormal[0], borderNormal[1], borderNormal[2], borderD, weight);
+        }
+    }
+}
+
+// Triangles around every position group, stored as one flat array addressed through per group offsets
+static void buildGroupAdjacency(struct MeshSimplifier *s) {
+    uint32_t *offsets = s->adjacencyOffsets;
+    memset(offsets, 0, (s->numVertices + 1) * sizeof(uint32_t));
+
+    for (size_t i = 0; i < s->numIndices; ++i) {
+        offsets[s->positionGroups[s->indices[i]] + 1]++;
+    }
+    for (size_t v = 0; v < s->numVertices; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    // offsets[v] is used as a fill cursor and restored afterwards
+    for (size_t i = 0; i < s->numIndices; ++i) {
+        s->adjacencyTriangles[offsets[s->positionGroups[s->indices[i]]]++] = (uint32_t) (i / 3);
+    }
+    for (size_t v = s->numVertices; v > 0; --v) {
+        offsets[v] = offsets[v - 1];
+    }
+    offsets[0] = 0;
+}
+
+// Vertices on a border or seam only slide along it, corners where more than two of them meet stay put
+static bool canCollapse(const struct MeshSimplifier *s, uint32_t from, uint32_t to) {
+    uint8_t borderCount = s->borderCounts[from];
+    if (borderCount == 0) return true;
+    if (borderCount != 2) return false;
+
+    return containsEdge(&s->borderEdges, makeUndirectedEdgeKey(from, to));
+}
+
+static float calcCollapseCost(const struct MeshSimplifier *s, uint32_t from, uint32_t to) {
+    struct Quadric merged = s->quadrics[from];
+    addQuadric(&merged, &s->quadrics[to]);
+
+    return (float) evalQuadric(&merged, getGroupPosition(s, to));
+}
+
+static size_t findCollapses(struct MeshSimplifier *s) {
+    size_t numCollapses = 0;
+
+    for (size_t i = 0; i < s->numIndices; i += 3) {
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t a = s->positionGroups[s->indices[i + corner]];
+            uint32_t b = s->positionGroups[s->indices[i + (corner + 1) % 3]];
+
+            float costAB = canCollapse(s, a, b) ? calcCollapseCost(s, a, b) : FLT_MAX;
+            float costBA = canCollapse(s, b, a) ? calcCollapseCost(s, b, a) : FLT_MAX;
+            if (costAB == FLT_MAX && costBA == FLT_MAX) continue;
+
+            struct Collapse *collapse = &s->collapses[numCollapses++];
+            collapse->cost = costAB <= costBA ? costAB : costBA;
+            collapse->from = costAB <= costBA ? a : b;
+            collapse->to = costAB <= costBA ? b : a;
+        }
+    }
+
+    return numCollapses;
+}
+
+static int compareCollapses(const void *a, const void *b) {
+    float costA = ((const struct Collapse *) a)->cost;
+    float costB = ((const struct Collapse *) b)->cost;
+
+    return (costA > costB) - (costA < costB);
+}
+
+// Counts the triangles the collapse removes, or returns 0 when one of the others would fold over
+static size_t checkCollapse(const struct MeshSimplifier *s, uint32_t from, uint32_t to) {
+    size_t removed = 0;
+    const float *target = getGroupPosition(s, to);
+
+    for (uint32_t a = s->adjacencyOffsets[from]; a < s->adjacencyOffsets[from + 1]; ++a) {
+        const uint32_t *triangle = &s->indices[s->adjacencyTriangles[a] * 3];
+        uint32_t groups[3];
+        for (int corner = 0; corner < 3; ++corner) {
+            groups[corner] = s->positionGroups[triangle[corner]];
+        }
+
+        if (groups[0] == to || groups[1] == to || groups[2] == to) {
+            removed++;
+            continue;
+        }
+
+        const float *before[3], *after[3];
+        for (int corner = 0; corner < 3; ++corner) {
+            before[corner] = getGroupPosition(s, groups[corner]);
+            after[corner] = groups[corner] == from ? target : before[corner];
+        }
+
+        double normalBefore[3], normalAfter[3];
+        calcTriangleNormal(before[0], before[1], before[2], normalBefore);
+        calcTriangleNormal(after[0], after[1], after[2], normalAfter);
+        double lengthBefore = sqrt(dotVec3d(normalBefore, normalBefore));
+        if (lengthBefore == 0.0) continue;
+
+        double lengthAfter = sqrt(dotVec3d(normalAfter, normalAfter));
+        if (dotVec3d(normalBefore, normalAfter) <= MIN_FLIP_COSINE * lengthBefore * lengthAfter) return 0;
+    }
+
+    return removed;
+}
+
+static float calcAttributeDistance(const struct VertexPNT *a, const struct VertexPNT *b) {
+    float distance = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        float delta = a->normal[axis] - b->normal[axis];
+        distance += delta * delta;
+    }
+    for (int axis = 0; axis < 2; ++axis) {
+        float delta = a->texCoord[axis] - b->texCoord[axis];
+        distance += delta * delta;
+    }
+
+    return distance;
+}
+
+// Every attribute variation of the removed position continues as the closest variation of the kept one
+static void remapWedges(struct MeshSimplifier *s, uint32_t from, uint32_t to) {
+    uint32_t wedge = from;
+    do {
+        uint32_t best = to;
+        float bestDistance = FLT_MAX;
+        uint32_t candidate = to;
+        do {
+            float distance = calcAttributeDistance(&s->vertices[wedge], &s->vertices[candidate]);
+            if (distance < bestDistance) {
+                best = candidate;
+                bestDistance = distance;
+            }
+            candidate = s->nextWedges[candidate];
+        } while (candidate != to);
+
+        s->wedgeRemap[wedge] = best;
+        wedge = s->nextWedges[wedge];
+    } while (wedge != from);
+}
+
+static void lockNeighbourhood(struct MeshSimplifier *s, uint32_t group) {
+    for (uint32_t a = s->adjacencyOffsets[group]; a < s->adjacencyOffsets[group + 1]; ++a) {
+        const uint32_t *triangle = &s->indices[s->adjacencyTriangles[a] * 3];
+        for (int corner = 0; corner < 3; ++corner) {
+            s->locked[s->positionGroups[triangle[corner]]] = 1;
+        }
+    }
+}
+
+// Rewrites the index buffer through the collapses of this pass and drops the triangles that became degenerate
+static void applyCollapses(struct MeshSimplifier *s) {
+    size_t numIndices = 0;
+    for (size_t i = 0; i < s->numIndices; i += 3) {
+        uint32_t a = s->wedgeRemap[s->indices[i]];
+        uint32_t b = s->wedgeRemap[s->indices[i + 1]];
+        uint32_t c = s->wedgeRemap[s->indices[i + 2]];
+
+        uint32_t groupA = s->positionGroups[a];
+        uint32_t groupB = s->positionGroups[b];
+        uint32_t groupC = s->positionGroups[c];
+        if (groupA == groupB || groupB == groupC || groupA == groupC) continue;
+
+        s->indices[numIndices++] = a;
+        s->indices[numIndices++] = b;
+        s->indices[numIndices++] = c;
+    }
+
+    s->numIndices = numIndices;
+}
+
+// One round of independent collapses, the neighbourhood of every collapse is locked for the rest of the
+// pass so the adjacency and the costs computed up front stay valid
+static size_t runSimplificationPass(struct MeshSimplifier *s, size_t targetNumIndices, float maxError) {
+    findBorderEdges(s);
+    buildGroupAdjacency(s);
+
+    size_t numCollapses = findCollapses(s);
+    qsort(s->collapses, numCollapses, sizeof(struct Collapse), compareCollapses);
+
+    memset(s->locked, 0, s->numVertices);
+    for (uint32_t v = 0; v < s->numVertices; ++v) {
+        s->wedgeRemap[v] = v;
+    }
+
+    float maxCost = maxError * maxError;
+    size_t numTriangles = s->numIndices / 3;
+    size_t targetNumTriangles = targetNumIndices / 3;
+    size_t numCollapsed = 0;
+    for (size_t i = 0; i < numCollapses && numTriangles > targetNumTriangles; ++i) {
+        const struct Collapse *collapse = &s->collapses[i];
+        if (collapse->cost > maxCost) break;
+        if (s->locked[collapse->from] || s->locked[collapse->to]) continue;
+
+        size_t removed = checkCollapse(s, collapse->from, collapse->to);
+        if (removed == 0) continue;
+
+        remapWedges(s, collapse->from, collapse->to);
+        addQuadric(&s->quadrics[collapse->to], &s->quadrics[collapse->from]);
+        lockNeighbourhood(s, collapse->from);
+
+        numTriangles = numTriangles > removed ? numTriangles - removed : 0;
+        if (collapse->cost > s->error) s->error = collapse->cost;
+        numCollapsed++;
+    }
+
+    if (numCollapsed > 0) {
+        applyCollapses(s);
+    }
+
+    return numCollapsed;
+}
+
+static void freeMeshSimplifier(struct MeshSimplifier *s) {
+    free(s->indices);
+    free(s->positionGroups);
+    free(s->nextWedges);
+    free(s->quadrics);
+    free(s->halfEdges.keys);
+    free(s->borderEdges.keys);
+    free(s->borderCounts);
+    free(s->locked);
+    free(s->wedgeRemap);
+    free(s->adjacencyOffsets);
+    free(s->adjacencyTriangles);
+    free(s->collapses);
+    free(s);
+}
+
+// The vertices are referenced, not copied, and have to outlive the simplifier
+bool allocMeshSimplifier(
+    struct MeshSimplifier **simplifierPtr,
+    const struct VertexPNT *vertices, size_t numVertices,
+    const uint32_t *indices, size_t numIndices
+) {
+    if (
+        simplifierPtr == NULL || (*simplifierPtr) != NULL ||
+        vertices == NULL || numVertices == 0 || numVertices >= UINT32_MAX ||
+        indices == NULL || numIndices == 0 || numIndices % 3 != 0
+    ) return false;
+
+    struct MeshSimplifier *newSimplifier = calloc(1, sizeof(struct MeshSimplifier));
+    if (newSimplifier == NULL) {
+        critical_log("%s", "[MeshSimplifier]: Memory allocation failure");
+        return false;
+    }
+
+    newSimplifier->vertices = vertices;
+    newSimplifier->numVertices = numVertices;
+    newSimplifier->numIndices = numIndices;
+    newSimplifier->error = 0.0f;
+    newSimplifier->indices = malloc(numIndices * sizeof(uint32_t));
+    newSimplifier->positionGroups = malloc(numVertices * sizeof(uint32_t));
+    newSimplifier->nextWedges = malloc(numVertices * sizeof(uint32_t));
+    newSimplifier->quadrics = malloc(numVertices * sizeof(struct Quadric));
+    newSimplifier->borderCounts = malloc(numVertices);
+    newSimplifier->locked = malloc(numVertices);
+    newSimplifier->wedgeRemap = malloc(numVertices * sizeof(uint32_t));
+    newSimplifier->adjacencyOffsets = malloc((numVertices + 1) * sizeof(uint32_t));
+    newSimplifier->adjacencyTriangles = malloc(numIndices * sizeof(uint32_t));
+    newSimplifier->collapses = malloc(numIndices * sizeof(struct Collapse));
+    bool allocated =
+        newSimplifier->indices != NULL && newSimplifier->positionGroups != NULL &&
+        newSimplifier->nextWedges != NULL && newSimplifier->quadrics != NULL &&
+        newSimplifier->borderCounts != NULL && newSimplifier->locked != NULL &&
+        newSimplifier->wedgeRemap != NULL && newSimplifier->adjacencyOffsets != NULL &&
+        newSimplifier->adjacencyTriangles != NULL && newSimplifier->collapses != NULL &&
+        allocEdgeSet(&newSimplifier->halfEdges, numIndices) &&
+        allocEdgeSet(&newSimplifier->borderEdges, numIndices);
+    if (!allocated || !buildPositionGroups(newSimplifier)) {
+        critical_log("%s", "[MeshSimplifier]: Memory allocation failure");
+        freeMeshSimplifier(newSimplifier);
+        return false;
+    }
+
+    for (size_t i = 0; i < numIndices; ++i) {
+        if (indices[i] >= numVertices) {
+            error_log("[MeshSimplifier]: Index %u is out of range for %zu vertices", indices[i], numVertices);
+            freeMeshSimplifier(newSimplifier);
+            return false;
+        }
+    }
+    memcpy(newSimplifier->indices, indices, numIndices * sizeof(uint32_t));
+
+    findBorderEdges(newSimplifier);
+    buildQuadrics(newSimplifier);
+
+    (*simplifierPtr) = newSimplifier;
+
+    return true;
+}
+
+void deleteMeshSimplifier(struct MeshSimplifier **simplifierPtr) {
+    if (simplifierPtr == NULL || (*simplifierPtr) == NULL) return;
+
+    freeMeshSimplifier(*simplifierPtr);
+    (*simplifierPtr) = NULL;
+}
+
+size_t simplifyMesh(struct MeshSimplifier *simplifier, size_t targetNumIndices, float maxError) {
+    if (simplifier == NULL) return 0;
+
+    while (simplifier->numIndices > targetNumIndices) {
+        if (runSimplificationPass(simplifier, targetNumIndices, maxError) == 0) break;
+    }
+
+    return simplifier->numIndices;
+}
+
+const uint32_t *getMeshSimplifierIndices(const struct MeshSimplifier *simplifier) {
+    if (simplifier == NULL) return NULL;
+
+    return simplifier->indices;
+}
+
+float getMeshSimplifierError(const struct MeshSimplifier *simplifier) {
+    if (simplifier == NULL) return 0.0f;
+
+    return sqrtf(simplifier->error);
+}
+
+void calcMeshBoundingSphere(const struct VertexPNT *vertices, size_t numVertices, float center[3], float *radius) {
+    if (center == NULL || radius == NULL) return;
+
+    center[0] = center[1] = center[2] = 0.0f;
+    (*radius) = 0.0f;
+    if (vertices == NULL || numVertices == 0) return;
+
+    float minPos[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maxPos[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t i = 0; i < numVertices; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            if (vertices[i].position[axis] < minPos[axis]) minPos[axis] = vertices[i].position[axis];
+            if (vertices[i].position[axis] > maxPos[axis]) maxPos[axis] = vertices[i].position[axis];
+        }
+    }
+
+    for (int axis = 0; axis < 3; ++axis) {
+        center[axis] = (minPos[axis] + maxPos[axis]) * 0.5f;
+    }
+
+    float maxDistanceSquared = 0.0f;
+    for (size_t i = 0; i < numVertices; ++i) {
+        float distanceSquared = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            float delta = vertices[i].position[axis] - center[axis];
+            distanceSquared += delta * delta;
+        }
+        if (distanceSquared > maxDistanceSquared) maxDistanceSquared = distanceSquared;
+    }
+
+    (*radius) = sqrtf(maxDistanceSquared);
+}
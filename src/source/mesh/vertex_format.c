@@ -0,0 +1,211 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "util.h"
+#include "resources/model.h"
+#include "mesh/vertex_format.h"
+
+#define SNORM16_MAX 32767.0f
+#define SNORM10_MAX 511.0f
+
+static float clampUnit(float v) {
+    if (v > 1.0f) return 1.0f;
+    if (v < -1.0f) return -1.0f;
+
+    return v;
+}
+
+static int16_t encodeSnorm16(float v) {
+    return (int16_t) lrintf(clampUnit(v) * SNORM16_MAX);
+}
+
+// x, y and z in the low 30 bits, the matching GL type is GL_INT_2_10_10_10_REV
+static uint32_t encodeNormal1010102(const float n[3]) {
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    float inv = length > 0.0f ? 1.0f / length : 0.0f;
+
+    uint32_t packed = 0;
+    for (int i = 0; i < 3; ++i) {
+        int32_t component = (int32_t) lrintf(clampUnit(n[i] * inv) * SNORM10_MAX);
+        packed |= (((uint32_t) component) & 0x3FFu) << (10 * i);
+    }
+
+    return packed;
+}
+
+// IEEE 754 binary16 with round to nearest even, values past the half range saturate to infinity
+static uint16_t encodeHalf(float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t mantissa = bits & 0x007FFFFFu;
+    int32_t exponent = (int32_t) ((bits >> 23) & 0xFFu) - 127 + 15;
+
+    if (((bits >> 23) & 0xFFu) == 0xFFu) {
+        return (uint16_t) (sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+    }
+
+    if (exponent >= 31) return (uint16_t) (sign | 0x7C00u);
+
+    if (exponent <= 0) {
+        if (exponent < -10) return (uint16_t) sign;
+
+        mantissa |= 0x00800000u;
+        uint32_t shift = (uint32_t) (14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+            half++;
+        }
+
+        return (uint16_t) (sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t) exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+        half++; // a carry into the exponent is still the correctly rounded value
+    }
+
+    return (uint16_t) half;
+}
+
+static void layoutVertexFormat(struct VertexFormat *format) {
+    unsigned int offset = 0;
+
+    format->positionOffset = offset;
+    offset += format->position == VERTEX_POSITION_SNORM16 ? 4 * sizeof(int16_t) : 3 * sizeof(float);
+
+    format->normalOffset = offset;
+    offset += format->normal == VERTEX_NORMAL_SNORM_10_10_10_2 ? sizeof(uint32_t) : 3 * sizeof(float);
+
+    format->texCoordOffset = offset;
+    offset += format->texCoord == VERTEX_TEXCOORD_HALF2 ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+
+    format->stride = offset;
+}
+
+void initVertexFormatPNT(struct VertexFormat *format) {
+    if (format == NULL) return;
+
+    format->position = VERTEX_POSITION_FLOAT3;
+    format->normal = VERTEX_NORMAL_FLOAT3;
+    format->texCoord = VERTEX_TEXCOORD_FLOAT2;
+    Vec3Fill(format->positionScale, 1.0f);
+    Vec3Fill(format->positionBias, 0.0f);
+    layoutVertexFormat(format);
+}
+
+bool isVertexFormatQuantized(const struct VertexFormat *format) {
+    if (format == NULL) return false;
+
+    return format->position == VERTEX_POSITION_SNORM16;
+}
+
+void chooseVertexFormat(struct VertexFormat *format, const struct VertexPNT *vertices, size_t numVertices) {
+    if (format == NULL) return;
+
+    initVertexFormatPNT(format);
+    if (vertices == NULL || numVertices == 0) return;
+
+    float minPos[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maxPos[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    float maxTexCoord = 0.0f;
+    for (size_t i = 0; i < numVertices; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            if (vertices[i].position[axis] < minPos[axis]) minPos[axis] = vertices[i].position[axis];
+            if (vertices[i].position[axis] > maxPos[axis]) maxPos[axis] = vertices[i].position[axis];
+        }
+
+        for (int axis = 0; axis < 2; ++axis) {
+            float magnitude = fabsf(vertices[i].texCoord[axis]);
+            if (magnitude > maxTexCoord) maxTexCoord = magnitude;
+        }
+    }
+
+    float maxHalfExtent = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        float halfExtent = (maxPos[axis] - minPos[axis]) * 0.5f;
+        if (halfExtent > maxHalfExtent) maxHalfExtent = halfExtent;
+
+        // flat axes still need a non zero scale to stay invertible
+        format->positionScale[axis] = halfExtent > 0.0f ? halfExtent : 1.0f;
+        format->positionBias[axis] = (maxPos[axis] + minPos[axis]) * 0.5f;
+    }
+
+    if (maxHalfExtent / SNORM16_MAX <= VERTEX_POSITION_QUANTIZATION_TOLERANCE) {
+        format->position = VERTEX_POSITION_SNORM16;
+    } else {
+        Vec3Fill(format->positionScale, 1.0f);
+        Vec3Fill(format->positionBias, 0.0f);
+    }
+
+    // unit normals lose well under a tenth of a degree in 10 bits per axis
+    format->normal = VERTEX_NORMAL_SNORM_10_10_10_2;
+
+    if (maxTexCoord <= VERTEX_TEXCOORD_HALF_MAX_MAGNITUDE) {
+        format->texCoord = VERTEX_TEXCOORD_HALF2;
+    }
+
+    layoutVertexFormat(format);
+}
+
+void *encodeVertices(const struct VertexFormat *format, const struct VertexPNT *vertices, size_t numVertices) {
+    if (format == NULL || vertices == NULL || numVertices == 0) return NULL;
+
+    unsigned char *encoded = calloc(numVertices, format->stride);
+    if (encoded == NULL) {
+        critical_log("%s", "[VertexFormat]: Could not allocate encoded vertex buffer");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < numVertices; ++i) {
+        unsigned char *dst = encoded + i * format->stride;
+        const struct VertexPNT *src = &vertices[i];
+
+        if (format->position == VERTEX_POSITION_SNORM16) {
+            int16_t position[4] = {0};
+            for (int axis = 0; axis < 3; ++axis) {
+                position[axis] = encodeSnorm16((src->position[axis] - format->positionBias[axis]) / format->positionScale[axis]);
+            }
+            memcpy(dst + format->positionOffset, position, sizeof(position));
+        } else {
+            memcpy(dst + format->positionOffset, src->position, sizeof(src->position));
+        }
+
+        if (format->normal == VERTEX_NORMAL_SNORM_10_10_10_2) {
+            uint32_t normal = encodeNormal1010102(src->normal);
+            memcpy(dst + format->normalOffset, &normal, sizeof(normal));
+        } else {
+            memcpy(dst + format->normalOffset, src->normal, sizeof(src->normal));
+        }
+
+        if (format->texCoord == VERTEX_TEXCOORD_HALF2) {
+            uint16_t texCoord[2] = {encodeHalf(src->texCoord[0]), encodeHalf(src->texCoord[1])};
+            memcpy(dst + format->texCoordOffset, texCoord, sizeof(texCoord));
+        } else {
+            memcpy(dst + format->texCoordOffset, src->texCoord, sizeof(src->texCoord));
+        }
+    }
+
+    return encoded;
+}
+
+void calcVertexFormatDequantizationMatrix(const struct VertexFormat *format, float dst[16]) {
+    if (dst == NULL) return;
+
+    Mat4Identity(dst);
+    if (format == NULL || !isVertexFormatQuantized(format)) return;
+
+    dst[0] = format->positionScale[0];
+    dst[5] = format->positionScale[1];
+    dst[10] = format->positionScale[2];
+    dst[12] = format->positionBias[0];
+    dst[13] = format->positionBias[1];
+    dst[14] = format->positionBias[2];
+}
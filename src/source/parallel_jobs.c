@@ -0,0 +1,238 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "logger.h"
+#include "config.h"
+#include "parallel_jobs.h"
+
+struct JobBatch {
+    ParallelJobFunction job;
+    void *jobData;
+    size_t numJobs;
+    atomic_size_t nextJob;
+};
+
+// Workers are started by the first batch and sleep between batches until finalizeParallelJobs.
+// A batch is published under the lock, every awake worker joins it and the caller waits for the
+// ones that joined before it returns
+struct WorkerPool {
+#ifndef _WIN32
+    pthread_mutex_t lock;
+    pthread_cond_t batchPublished;
+    pthread_cond_t batchFinished;
+    pthread_t threads[PARALLEL_JOBS_MAX_THREADS];
+#else
+    SRWLOCK lock;
+    CONDITION_VARIABLE batchPublished;
+    CONDITION_VARIABLE batchFinished;
+    HANDLE threads[PARALLEL_JOBS_MAX_THREADS];
+#endif
+    size_t numThreads;
+    bool started;
+    bool stopping;
+
+    struct JobBatch *batch;
+    size_t batchGeneration;
+    size_t numWorking;
+};
+
+#ifndef _WIN32
+static struct WorkerPool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .batchPublished = PTHREAD_COND_INITIALIZER,
+    .batchFinished = PTHREAD_COND_INITIALIZER
+};
+#else
+static struct WorkerPool pool = {
+    .lock = SRWLOCK_INIT,
+    .batchPublished = CONDITION_VARIABLE_INIT,
+    .batchFinished = CONDITION_VARIABLE_INIT
+};
+#endif
+
+static void lockPool() {
+#ifndef _WIN32
+    pthread_mutex_lock(&pool.lock);
+#else
+    AcquireSRWLockExclusive(&pool.lock);
+#endif
+}
+
+static void unlockPool() {
+#ifndef _WIN32
+    pthread_mutex_unlock(&pool.lock);
+#else
+    ReleaseSRWLockExclusive(&pool.lock);
+#endif
+}
+
+#ifndef _WIN32
+static void waitPool(pthread_cond_t *condition) {
+    pthread_cond_wait(condition, &pool.lock);
+}
+
+static void wakePool(pthread_cond_t *condition) {
+    pthread_cond_broadcast(condition);
+}
+#else
+static void waitPool(CONDITION_VARIABLE *condition) {
+    SleepConditionVariableSRW(condition, &pool.lock, INFINITE, 0);
+}
+
+static void wakePool(CONDITION_VARIABLE *condition) {
+    WakeAllConditionVariable(condition);
+}
+#endif
+
+static void runJobsFromBatch(struct JobBatch *batch) {
+    while (true) {
+        size_t jobIndex = atomic_fetch_add(&batch->nextJob, 1);
+        if (jobIndex >= batch->numJobs) return;
+
+        batch->job(batch->jobData, jobIndex);
+    }
+}
+
+static void runWorker() {
+    size_t seenGeneration = 0;
+
+    lockPool();
+    while (true) {
+        while (!pool.stopping && (pool.batch == NULL || pool.batchGeneration == seenGeneration)) {
+            waitPool(&pool.batchPublished);
+        }
+        if (pool.stopping) break;
+
+        struct JobBatch *batch = pool.batch;
+        seenGeneration = pool.batchGeneration;
+        pool.numWorking++;
+        unlockPool();
+
+        runJobsFromBatch(batch);
+
+        lockPool();
+        pool.numWorking--;
+        if (pool.numWorking == 0) {
+            wakePool(&pool.batchFinished);
+        }
+    }
+    unlockPool();
+}
+
+#ifndef _WIN32
+static void *workerMain(void *unused) {
+    runWorker();
+
+    return NULL;
+}
+#else
+static DWORD WINAPI workerMain(LPVOID unused) {
+    runWorker();
+
+    return 0;
+}
+#endif
+
+size_t getParallelJobWorkerCount() {
+    int configured = getConfigWorkerThreads();
+    long numProcessors = 1;
+
+    if (configured > 0) {
+        numProcessors = configured;
+    } else {
+#ifndef _WIN32
+        numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        numProcessors = (long) systemInfo.dwNumberOfProcessors;
+#endif
+    }
+
+    if (numProcessors < 1) return 1;
+    if (numProcessors > PARALLEL_JOBS_MAX_THREADS) return PARALLEL_JOBS_MAX_THREADS;
+
+    return (size_t) numProcessors;
+}
+
+// The calling thread is one of the workers, if a thread can not be started the others pick up its share
+static void startWorkers() {
+    pool.started = true;
+
+    size_t numWorkers = getParallelJobWorkerCount();
+    for (size_t i = 1; i < numWorkers; ++i) {
+#ifndef _WIN32
+        bool started = pthread_create(&pool.threads[pool.numThreads], NULL, workerMain, NULL) == 0;
+#else
+        pool.threads[pool.numThreads] = CreateThread(NULL, 0, workerMain, NULL, 0, NULL);
+        bool started = pool.threads[pool.numThreads] != NULL;
+#endif
+        if (!started) {
+            warning_log("[ParallelJobs]: Could only start %zu of %zu worker threads", pool.numThreads, numWorkers - 1);
+            break;
+        }
+
+        pool.numThreads++;
+    }
+
+    trace_log("[ParallelJobs]: Started %zu worker threads", pool.numThreads);
+}
+
+void runParallelJobs(ParallelJobFunction job, void *jobData, size_t numJobs) {
+    if (job == NULL || numJobs == 0) return;
+
+    struct JobBatch batch = {job, jobData, numJobs};
+    atomic_init(&batch.nextJob, 0);
+
+    lockPool();
+    if (!pool.started) {
+        startWorkers();
+    }
+
+    // a batch started from inside a job, or while the pool is shutting down, runs on the calling thread alone
+    bool shared = numJobs > 1 && pool.numThreads > 0 && pool.batch == NULL && !pool.stopping;
+    if (shared) {
+        pool.batch = &batch;
+        pool.batchGeneration++;
+        wakePool(&pool.batchPublished);
+    }
+    unlockPool();
+
+    runJobsFromBatch(&batch);
+    if (!shared) return;
+
+    // every job has been handed out, workers that have not joined yet will not see this batch anymore
+    lockPool();
+    pool.batch = NULL;
+    while (pool.numWorking > 0) {
+        waitPool(&pool.batchFinished);
+    }
+    unlockPool();
+}
+
+void finalizeParallelJobs() {
+    lockPool();
+    pool.stopping = true;
+    wakePool(&pool.batchPublished);
+    unlockPool();
+
+    for (size_t i = 0; i < pool.numThreads; ++i) {
+#ifndef _WIN32
+        pthread_join(pool.threads[i], NULL);
+#else
+        WaitForSingleObject(pool.threads[i], INFINITE);
+        CloseHandle(pool.threads[i]);
+#endif
+    }
+
+    pool.numThreads = 0;
+    pool.started = false;
+    pool.stopping = false;
+}
@@ -0,0 +1,193 @@
+#include "python/py3dcamera.h"
+#include "logger.h"
+#include "python/component_helper.h"
+#include "python/python_util.h"
+
+static PyObject *Py3dCamera_Ctor = NULL;
+
+struct Py3dCamera {
+    PyObject_HEAD
+    float fovXInDegrees;
+    float nearZ;
+    float farZ;
+    unsigned int version;
+};
+
+static int Py3dCamera_Init(struct Py3dCamera *self, PyObject *args, PyObject *kwds) {
+    if (Py3d_CallSuperInit((PyObject *) self, args, kwds) == -1) return -1;
+
+    self->fovXInDegrees = 0.0f;
+    self->nearZ = 0.0f;
+    self->farZ = 0.0f;
+    self->version = 0;
+
+    return 0;
+}
+
+static PyObject *getFloatValue(float value) {
+    return PyFloat_FromDouble((double) value);
+}
+
+static int setFloatValue(struct Py3dCamera *self, float *dst, PyObject *value, const char *name) {
+    if (value == NULL) {
+        PyErr_Format(PyExc_AttributeError, "CameraComponent attribute \"%s\" cannot be deleted", name);
+        return -1;
+    }
+
+    const double newValue = PyFloat_AsDouble(value);
+    if (PyErr_Occurred()) return -1;
+
+    (*dst) = (float) newValue;
+    self->version++;
+
+    return 0;
+}
+
+static PyObject *Py3dCamera_GetFovXAttr(struct Py3dCamera *self, void *closure) {
+    return getFloatValue(self->fovXInDegrees);
+}
+
+static int Py3dCamera_SetFovXAttr(struct Py3dCamera *self, PyObject *value, void *closure) {
+    return setFloatValue(self, &self->fovXInDegrees, value, "fov_x_in_degrees");
+}
+
+static PyObject *Py3dCamera_GetNearZAttr(struct Py3dCamera *self, void *closure) {
+    return getFloatValue(self->nearZ);
+}
+
+static int Py3dCamera_SetNearZAttr(struct Py3dCamera *self, PyObject *value, void *closure) {
+    return setFloatValue(self, &self->nearZ, value, "near_z");
+}
+
+static PyObject *Py3dCamera_GetFarZAttr(struct Py3dCamera *self, void *closure) {
+    return getFloatValue(self->farZ);
+}
+
+static int Py3dCamera_SetFarZAttr(struct Py3dCamera *self, PyObject *value, void *closure) {
+    return setFloatValue(self, &self->farZ, value, "far_z");
+}
+
+// attribute names match the ones python camera components exposed before the camera was native
+static PyGetSetDef Py3dCamera_GetSet[] = {
+    {"fov_x_in_degrees", (getter) Py3dCamera_GetFovXAttr, (setter) Py3dCamera_SetFovXAttr, "Horizontal field of view in degrees", NULL},
+    {"near_z", (getter) Py3dCamera_GetNearZAttr, (setter) Py3dCamera_SetNearZAttr, "Distance to the near clip plane", NULL},
+    {"far_z", (getter) Py3dCamera_GetFarZAttr, (setter) Py3dCamera_SetFarZAttr, "Distance to the far clip plane", NULL},
+    {NULL}
+};
+
+static PyMethodDef Py3dCamera_Methods[] = {
+    {"parse", (PyCFunction) Py3dCamera_Parse, METH_VARARGS, "Handle parse messages"},
+    {NULL}
+};
+
+static void Py3dCamera_Dealloc(struct Py3dCamera *self) {
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+PyTypeObject Py3dCamera_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "py3dengineEXT.CameraComponent",
+    .tp_doc = "A perspective camera",
+    .tp_basicsize = sizeof(struct Py3dCamera),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_init = (initproc) Py3dCamera_Init,
+    .tp_new = PyType_GenericNew,
+    .tp_methods = Py3dCamera_Methods,
+    .tp_getset = Py3dCamera_GetSet,
+    .tp_dealloc = (destructor) Py3dCamera_Dealloc,
+};
+
+int PyInit_Py3dCamera(PyObject *module) {
+    Py3dCamera_Type.tp_base = Py3d_GetComponentType();
+    if (PyType_Ready(&Py3dCamera_Type) < 0) return 0;
+
+    if (PyModule_AddObject(module, "CameraComponent", (PyObject *) &Py3dCamera_Type) < 0) return 0;
+
+    Py_INCREF(&Py3dCamera_Type);
+
+    return 1;
+}
+
+int Py3dCamera_FindCtor(PyObject *module) {
+    if (PyObject_HasAttrString(module, "CameraComponent") == 0) {
+        critical_log("%s", "[Python]: Py3dCamera has not been initialized properly");
+
+        return 0;
+    }
+
+    Py3dCamera_Ctor = PyObject_GetAttrString(module, "CameraComponent");
+
+    return 1;
+}
+
+void Py3dCamera_FinalizeCtor() {
+    Py_CLEAR(Py3dCamera_Ctor);
+}
+
+struct Py3dCamera *Py3dCamera_New() {
+    if (Py3dCamera_Ctor == NULL) {
+        critical_log("%s", "[Python]: Py3dCamera has not been initialized properly");
+
+        return NULL;
+    }
+
+    struct Py3dCamera *py3dCamera = (struct Py3dCamera *) PyObject_CallNoArgs(Py3dCamera_Ctor);
+    if (py3dCamera == NULL) {
+        critical_log("%s", "[Python]: Failed to allocate CameraComponent in python interpreter");
+        handleException();
+
+        return NULL;
+    }
+
+    return py3dCamera;
+}
+
+int Py3dCamera_Check(PyObject *obj) {
+    if (obj == NULL) return 0;
+
+    // rendering contexts check every frame, a plain type check avoids the generic isinstance machinery
+    return PyObject_TypeCheck(obj, &Py3dCamera_Type);
+}
+
+float Py3dCamera_GetFovXInDegrees(struct Py3dCamera *self) {
+    if (self == NULL) return 0.0f;
+
+    return self->fovXInDegrees;
+}
+
+float Py3dCamera_GetNearZ(struct Py3dCamera *self) {
+    if (self == NULL) return 0.0f;
+
+    return self->nearZ;
+}
+
+float Py3dCamera_GetFarZ(struct Py3dCamera *self) {
+    if (self == NULL) return 0.0f;
+
+    return self->farZ;
+}
+
+unsigned int Py3dCamera_GetVersion(struct Py3dCamera *self) {
+    if (self == NULL) return 0;
+
+    return self->version;
+}
+
+PyObject *Py3dCamera_Parse(struct Py3dCamera *self, PyObject *args, PyObject *kwds) {
+    PyObject *superParseRet = Py3d_CallSuperMethod((PyObject *) self, "parse", args, kwds);
+    if (superParseRet == NULL) return NULL;
+    Py_CLEAR(superParseRet);
+
+    const char *compName = "CameraComponent";
+
+    PyObject *parseDataDict = NULL, *py3dResourceManager = NULL;
+    if (PyArg_ParseTuple(args, "O!O", &PyDict_Type, &parseDataDict, &py3dResourceManager) != 1) return NULL;
+
+    if (!Py3d_GetFloatParseData(parseDataDict, "fov_x_in_degrees", &self->fovXInDegrees, compName)) return NULL;
+    if (!Py3d_GetFloatParseData(parseDataDict, "near_z", &self->nearZ, compName)) return NULL;
+    if (!Py3d_GetFloatParseData(parseDataDict, "far_z", &self->farZ, compName)) return NULL;
+    self->version++;
+
+    Py_RETURN_NONE;
+}
@@ -12,7 +12,9 @@
 #include "python/py3dscene.h"
 #include "python/py3dtextrenderer.h"
 #include "python/py3dlight.h"
+#include "python/py3dcamera.h"
 #include "engine.h"
+#include "rendering/gl_state.h"
 
 PyObject *Py3dErr_SceneError = NULL;
 
@@ -76,6 +78,23 @@ static PyObject *Py3dEngine_GetUptime(PyObject *self, PyObject *args, PyObject *
     return PyFloat_FromDouble(getUptime());
 }
 
+static PyObject *Py3dEngine_GetGLStateStats(PyObject *self, PyObject *args, PyObject *kwds) {
+    struct GLStateCounters counters;
+    getGLStateLastFrameCounters(&counters);
+
+    return Py_BuildValue(
+        "{s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n}",
+        "program_binds", (Py_ssize_t) counters.programBinds,
+        "program_binds_avoided", (Py_ssize_t) counters.programBindsAvoided,
+        "vertex_array_binds", (Py_ssize_t) counters.vertexArrayBinds,
+        "vertex_array_binds_avoided", (Py_ssize_t) counters.vertexArrayBindsAvoided,
+        "texture_binds", (Py_ssize_t) counters.textureBinds,
+        "texture_binds_avoided", (Py_ssize_t) counters.textureBindsAvoided,
+        "active_texture_changes", (Py_ssize_t) counters.activeTextureChanges,
+        "active_texture_changes_avoided", (Py_ssize_t) counters.activeTextureChangesAvoided
+    );
+}
+
 static PyMethodDef Py3dEngine_Methods[] = {
     {"quit", (PyCFunction) Py3dEngine_Quit, METH_NOARGS, "Stop the engine and begin tear down"},
     {"load_scene", (PyCFunction) Py3dEngine_LoadScene, METH_VARARGS, "Load the specified scene into the engine and prepare it for activation"},
@@ -84,6 +103,7 @@ static PyMethodDef Py3dEngine_Methods[] = {
     {"get_fps", (PyCFunction) Py3dEngine_GetFPS, METH_VARARGS, "Get the \"Frames Per Second\" value from the last time stats were calculated"},
     {"get_ms", (PyCFunction) Py3dEngine_GetMS, METH_VARARGS, "Get the \"Milliseconds Per Frame\" value from the last time stats were calculated"},
     {"get_uptime", (PyCFunction) Py3dEngine_GetUptime, METH_VARARGS, "Get the current engine uptime in seconds"},
+    {"get_gl_state_stats", (PyCFunction) Py3dEngine_GetGLStateStats, METH_VARARGS, "Get the number of OpenGL binds issued and avoided during the last frame"},
     {NULL}
 };
 
@@ -183,6 +203,13 @@ PyInit_py3dEngineEXT(void) {
         return NULL;
     }
 
+    if (!PyInit_Py3dCamera(newModule)) {
+        critical_log("%s", "[Python]: Failed to attach CameraComponent to py3dengine module");
+
+        Py_CLEAR(newModule);
+        return NULL;
+    }
+
     Py3dErr_SceneError = PyErr_NewException("py3dengineEXT.SceneError", NULL, NULL);
     if (Py3dErr_SceneError == NULL) {
         critical_log("%s", "[Python]: Failed to create SceneError");
@@ -259,6 +286,10 @@ int initPy3dEngineExtObjects() {
         return false;
     }
 
+    if (!Py3dCamera_FindCtor(module)) {
+        return false;
+    }
+
     return true;
 }
 
@@ -277,4 +308,5 @@ void finalizePy3dEngineExtModule() {
     Py3dCollisionEvent_FinalizeCtor();
     Py3dScene_FinalizeCtor();
     Py3dLight_FinalizeCtor();
+    Py3dCamera_FinalizeCtor();
 }
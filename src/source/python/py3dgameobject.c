@@ -8,6 +8,10 @@
 #include "python/python_util.h"
 #include "python/py3drenderingcontext.h"
 #include "python/py3dscene.h"
+#include "python/py3dmodelrenderer.h"
+#include "python/py3dspriterenderer.h"
+#include "python/py3dtextrenderer.h"
+#include "rendering/render_queue.h"
 #include "math/vector3.h"
 #include "math/quaternion.h"
 #include "util.h"
@@ -27,6 +31,8 @@ struct Py3dGameObject {
     PyObject *orientation;
     PyObject *scale;
     int matrixCacheDirty;
+    unsigned int transformVersion;
+    unsigned int stateVersion;
     float wMatrixCache[16];
     float witMatrixCache[16];
 };
@@ -82,6 +88,8 @@ static int Py3dGameObject_Init(struct Py3dGameObject *self, PyObject *args, PyOb
     self->orientation = (PyObject *) Py3dQuaternion_New(0.0f, 0.0f, 0.0f, 1.0f);
     self->scale = (PyObject *) Py3dVector3_New(1.0f, 1.0f, 1.0f);
     self->matrixCacheDirty = 0;
+    self->transformVersion = 0;
+    self->stateVersion = 0;
     Mat4Identity(self->wMatrixCache);
     Mat4Identity(self->witMatrixCache);
 
@@ -306,6 +314,7 @@ PyObject *Py3dGameObject_Enable(struct Py3dGameObject *self, PyObject *args, PyO
 }
 
 void Py3dGameObject_EnableBool(struct Py3dGameObject *self, bool enable) {
+    if (self->enabled != enable) self->stateVersion++;
     self->enabled = enable;
 }
 
@@ -328,6 +337,7 @@ PyObject *Py3dGameObject_MakeVisible(struct Py3dGameObject *self, PyObject *args
 }
 
 void Py3dGameObject_MakeVisibleBool(struct Py3dGameObject *self, bool make_visible) {
+    if (self->visible != make_visible) self->stateVersion++;
     self->visible = make_visible;
 }
 
@@ -392,6 +402,98 @@ PyObject *Py3dGameObject_Render(struct Py3dGameObject *self, PyObject *args, PyO
     return passMessage(self, "visible", "render", args);
 }
 
+static int enqueueNativeRenderer(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue) {
+    return Py3dModelRenderer_Enqueue(component, owner, queue) ||
+        Py3dSpriteRenderer_Enqueue(component, owner, queue) ||
+        Py3dTextRenderer_Enqueue(component, owner, queue);
+}
+
+// Calls render on the components and game objects the packets were queued for, python code binds GL
+// objects directly so the queue has to bind everything again afterwards
+static void drawPythonRenderPackets(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    PyObject *args = Py_BuildValue("(O)", state->rc);
+    if (args == NULL) {
+        handleException();
+        return;
+    }
+
+    for (size_t i = 0; i < numPackets; ++i) {
+        PyObject *messageHandler = getCallable(packets[i].renderer, "render");
+        if (messageHandler == NULL) {
+            PyErr_Clear();
+            continue;
+        }
+
+        PyObject *ret = PyObject_Call(messageHandler, args, NULL);
+        if (ret == NULL) {
+            handleException();
+        }
+        Py_CLEAR(ret);
+        Py_CLEAR(messageHandler);
+    }
+
+    state->stateLost = true;
+    Py_CLEAR(args);
+}
+
+static void enqueuePythonRender(PyObject *renderer, struct Py3dGameObject *owner, struct RenderQueue *queue) {
+    if (pushDrawPacket(queue, DRAW_PACKET_LAYER_SPRITE, NULL, NULL, NULL, NULL, renderer, owner, drawPythonRenderPackets) == NULL) {
+        critical_log("%s", "[GameObject]: Could not queue python render call");
+    }
+}
+
+void Py3dGameObject_FillRenderQueue(struct Py3dGameObject *self, PyObject *args, struct RenderQueue *queue) {
+    if (self == NULL || args == NULL || queue == NULL) return;
+
+    if (self->visible == false) return;
+
+    Py_ssize_t componentCount = PySequence_Size(self->componentsList);
+    for (Py_ssize_t i = 0; i < componentCount; ++i) {
+        PyObject *curComponent = Py_NewRef(PyList_GetItem(self->componentsList, i));
+
+        if (!Py3d_IsComponentSubclass(curComponent)) {
+            warning_log("[GameObject]: GameObject list has non component item.");
+        } else if (componentAcceptsMessage(curComponent, "visible")) {
+            // builtin renderers go to the queue, everything else gets its python render message when
+            // the queue reaches the sprite layer, after opaque models and in scene graph order with sprites
+            if (!enqueueNativeRenderer(curComponent, self, queue)) {
+                enqueuePythonRender(curComponent, self, queue);
+            }
+        }
+
+        Py_CLEAR(curComponent);
+    }
+
+    Py_ssize_t childCount = PySequence_Size(self->childrenList);
+    for (Py_ssize_t i = 0; i < childCount; ++i) {
+        PyObject *curChild = Py_NewRef(PyList_GetItem(self->childrenList, i));
+        if (!Py3dGameObject_Check(curChild)) {
+            warning_log("[GameObject]: Child list has non Game Object child. Will not pass render message.");
+            Py_CLEAR(curChild);
+            continue;
+        }
+
+        if (!Py_IS_TYPE(curChild, &Py3dGameObject_Type)) {
+            // python subclasses may override render, so they keep receiving the message through the queue
+            enqueuePythonRender(curChild, (struct Py3dGameObject *) curChild, queue);
+            Py_CLEAR(curChild);
+            continue;
+        }
+
+        if (Py_EnterRecursiveCall(" in GameObject::FillRenderQueue") != 0) {
+            critical_log("%s", "[GameObject]: Hit max recursion depth while filling render queue");
+            handleException();
+            Py_CLEAR(curChild);
+            continue;
+        }
+
+        Py3dGameObject_FillRenderQueue((struct Py3dGameObject *) curChild, args, queue);
+        Py_LeaveRecursiveCall();
+
+        Py_CLEAR(curChild);
+    }
+}
+
 PyObject *Py3dGameObject_Deactivate(struct Py3dGameObject *self, PyObject *args, PyObject *kwds) {
     return passMessage(self, NULL, "deactivate", args);
 }
@@ -701,6 +803,14 @@ static PyObject *getCallable(PyObject *obj, const char *callableName) {
     return callable;
 }
 
+unsigned int Py3dGameObject_GetTransformVersion(struct Py3dGameObject *self) {
+    return self->transformVersion;
+}
+
+unsigned int Py3dGameObject_GetStateVersion(struct Py3dGameObject *self) {
+    return self->stateVersion;
+}
+
 const float *Py3dGameObject_GetPositionFA(struct Py3dGameObject *self) {
     return ((struct Py3dVector3 *) self->position)->elements;
 }
@@ -720,6 +830,7 @@ PyObject *Py3dGameObject_Move(struct Py3dGameObject *self, PyObject *args, PyObj
     self->position = result; // New Ref acquired from PyNumber_Add call
 
     self->matrixCacheDirty = 1;
+    self->transformVersion++;
 
     Py_RETURN_NONE;
 }
@@ -732,6 +843,7 @@ PyObject *Py3dGameObject_SetPosition(struct Py3dGameObject *self, PyObject *args
     self->position = Py_NewRef(newPosition);
 
     self->matrixCacheDirty = 1;
+    self->transformVersion++;
 
     Py_RETURN_NONE;
 }
@@ -754,6 +866,7 @@ PyObject *Py3dGameObject_Rotate(struct Py3dGameObject *self, PyObject *args, PyO
     self->orientation = result; // New Ref acquired from PyNumber_Multiply call
 
     self->matrixCacheDirty = 1;
+    self->transformVersion++;
 
     Py_RETURN_NONE;
 }
@@ -766,6 +879,7 @@ PyObject *Py3dGameObject_SetOrientation(struct Py3dGameObject *self, PyObject *a
     self->orientation = Py_NewRef(newOrientation);
 
     self->matrixCacheDirty = 1;
+    self->transformVersion++;
 
     Py_RETURN_NONE;
 }
@@ -788,6 +902,7 @@ PyObject *Py3dGameObject_Stretch(struct Py3dGameObject *self, PyObject *args, Py
     self->scale = result; // New Ref acquired from PyNumber_Multiply call
 
     self->matrixCacheDirty = 1;
+    self->transformVersion++;
 
     Py_RETURN_NONE;
 }
@@ -800,6 +915,7 @@ PyObject *Py3dGameObject_SetScale(struct Py3dGameObject *self, PyObject *args, P
     self->scale = Py_NewRef(newScale);
 
     self->matrixCacheDirty = 1;
+    self->transformVersion++;
 
     Py_RETURN_NONE;
 }
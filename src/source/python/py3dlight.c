@@ -19,6 +19,8 @@ struct Py3dLight {
     float ambient[3];
     float intensity;
     float attenuation[3];
+    unsigned int version;
+    Py_ssize_t sceneSlot;
 };
 
 static int Py3dLight_Init(struct Py3dLight *self, PyObject *args, PyObject *kwds) {
@@ -30,6 +32,8 @@ static int Py3dLight_Init(struct Py3dLight *self, PyObject *args, PyObject *kwds
     Vec3Fill(self->ambient, 0.0f);
     self->intensity = 0.0f;
     Vec3Fill(self->attenuation, 0.0f);
+    self->version = 0;
+    self->sceneSlot = -1;
 
     return 0;
 }
@@ -155,6 +159,24 @@ void Py3dLight_GetAttenuation(struct Py3dLight *self, float dst[3]) {
     Vec3Copy(dst, self->attenuation);
 }
 
+unsigned int Py3dLight_GetVersion(struct Py3dLight *self) {
+    if (self == NULL) return 0;
+
+    return self->version;
+}
+
+Py_ssize_t Py3dLight_GetSceneSlot(const struct Py3dLight *self) {
+    if (self == NULL) return -1;
+
+    return self->sceneSlot;
+}
+
+void Py3dLight_SetSceneSlot(struct Py3dLight *self, Py_ssize_t slot) {
+    if (self == NULL) return;
+
+    self->sceneSlot = slot;
+}
+
 PyObject *Py3dLight_Parse(struct Py3dLight *self, PyObject *args, PyObject *kwds) {
     PyObject *superParseRet = Py3d_CallSuperMethod((PyObject *) self, "parse", args, kwds);
     if (superParseRet == NULL) return NULL;
@@ -171,6 +193,7 @@ PyObject *Py3dLight_Parse(struct Py3dLight *self, PyObject *args, PyObject *kwds
     if (!Py3d_GetVector3ParseData(parseDataDict, "ambient", self->ambient, compName)) return NULL;
     if (!Py3d_GetFloatParseData(parseDataDict, "intensity", &self->intensity, compName)) return NULL;
     if (!Py3d_GetVector3ParseData(parseDataDict, "attenuation", self->attenuation, compName)) return NULL;
+    self->version++;
 
     Py_RETURN_NONE;
 }
@@ -215,7 +238,7 @@ PyObject *Py3dLight_Detach(struct Py3dLight *self, PyObject *args, PyObject *kwd
     Py_RETURN_NONE;
 }
 
-static PyObject *setFloatArrayValue(float dst[3], PyObject *args) {
+static PyObject *setFloatArrayValue(struct Py3dLight *self, float dst[3], PyObject *args) {
     struct Py3dVector3 *newColorAsVec3 = NULL;
     if (PyArg_ParseTuple(args, "O!", &Py3dVector3_Type, &newColorAsVec3)) {
         // TODO: implement this
@@ -228,6 +251,7 @@ static PyObject *setFloatArrayValue(float dst[3], PyObject *args) {
 
     if (PyArg_ParseTuple(args, "(fff)", &components[0], &components[1], &components[2])) {
         Vec3Copy(dst, components);
+        self->version++;
         Py_RETURN_NONE;
     }
     PyErr_Clear();
@@ -253,6 +277,7 @@ PyObject *Py3dLight_SetType(struct Py3dLight *self, PyObject *args, PyObject *kw
     if (!PyArg_ParseTuple(args, "i", &newType)) return NULL;
 
     self->lightType = newType; //TODO: since this is an enum, add additional validation
+    self->version++;
 
     Py_RETURN_NONE;
 }
@@ -263,7 +288,7 @@ PyObject *Py3dLight_SetDiffuseColor(struct Py3dLight *self, PyObject *args, PyOb
         return NULL;
     }
 
-    return setFloatArrayValue(self->diffuse, args);
+    return setFloatArrayValue(self, self->diffuse, args);
 }
 
 PyObject *Py3dLight_SetSpecularColor(struct Py3dLight *self, PyObject *args, PyObject *kwds) {
@@ -272,7 +297,7 @@ PyObject *Py3dLight_SetSpecularColor(struct Py3dLight *self, PyObject *args, PyO
         return NULL;
     }
 
-    return setFloatArrayValue(self->specular, args);
+    return setFloatArrayValue(self, self->specular, args);
 }
 
 PyObject *Py3dLight_SetAmbientColor(struct Py3dLight *self, PyObject *args, PyObject *kwds) {
@@ -281,7 +306,7 @@ PyObject *Py3dLight_SetAmbientColor(struct Py3dLight *self, PyObject *args, PyOb
         return NULL;
     }
 
-    return setFloatArrayValue(self->ambient, args);
+    return setFloatArrayValue(self, self->ambient, args);
 }
 
 PyObject *Py3dLight_SetIntensity(struct Py3dLight *self, PyObject *args, PyObject *kwds) {
@@ -294,6 +319,7 @@ PyObject *Py3dLight_SetIntensity(struct Py3dLight *self, PyObject *args, PyObjec
     if (!PyArg_ParseTuple(args, "f", &newIntensity)) return NULL;
 
     self->intensity = newIntensity;
+    self->version++;
 
     Py_RETURN_NONE;
 }
@@ -304,5 +330,5 @@ PyObject *Py3dLight_SetAttenuation(struct Py3dLight *self, PyObject *args, PyObj
         return NULL;
     }
 
-    return setFloatArrayValue(self->attenuation, args);
+    return setFloatArrayValue(self, self->attenuation, args);
 }
\ No newline at end of file
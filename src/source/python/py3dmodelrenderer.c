@@ -1,7 +1,10 @@
 #include <glad/gl.h>
+#include <math.h>
+#include <stddef.h>
 
 #include "python/py3dmodelrenderer.h"
 #include "python/component_helper.h"
+#include "config.h"
 #include "lights.h"
 #include "logger.h"
 #include "python/python_util.h"
@@ -11,6 +14,8 @@
 #include "resources/shader.h"
 #include "resources/material.h"
 #include "resources/model.h"
+#include "rendering/render_queue.h"
+#include "rendering/instance_buffer.h"
 #include "util.h"
 #include "python/py3dscene.h"
 
@@ -29,63 +34,63 @@ struct ShaderParam {
         SHADER_PARAM_TYPE_INT,
         "gLights",
         "used",
-        0,
+        offsetof(struct LightData, used),
         1,
     },
     {
         SHADER_PARAM_TYPE_INT,
         "gLights",
         "enabled",
-        0 + sizeof(GLint),
+        offsetof(struct LightData, enabled),
         1,
     },
     {
         SHADER_PARAM_TYPE_INT,
         "gLights",
         "lightType",
-        0 + sizeof(GLint) + sizeof(GLint),
+        offsetof(struct LightData, type),
         1,
     },
     {
         SHADER_PARAM_TYPE_FLOAT,
         "gLights",
         "position",
-        0 + sizeof(GLint) + sizeof(GLint) + sizeof(GLint),
+        offsetof(struct LightData, position),
         3,
     },
     {
         SHADER_PARAM_TYPE_FLOAT,
         "gLights",
         "diffuse",
-        0 + sizeof(GLint) + sizeof(GLint) + sizeof(GLint) + (sizeof(float) * 3),
+        offsetof(struct LightData, diffuse),
         3,
     },
     {
         SHADER_PARAM_TYPE_FLOAT,
         "gLights",
         "specular",
-        0 + sizeof(GLint) + sizeof(GLint) + sizeof(GLint) + (sizeof(float) * 3) + (sizeof(float) * 3),
+        offsetof(struct LightData, specular),
         3,
     },
     {
         SHADER_PARAM_TYPE_FLOAT,
         "gLights",
         "ambient",
-        0 + sizeof(GLint) + sizeof(GLint) + sizeof(GLint) + (sizeof(float) * 3) + (sizeof(float) * 3) + (sizeof(float) * 3),
+        offsetof(struct LightData, ambient),
         3,
     },
     {
         SHADER_PARAM_TYPE_FLOAT,
         "gLights",
         "intensity",
-        0 + sizeof(GLint) + sizeof(GLint) + sizeof(GLint) + (sizeof(float) * 3) + (sizeof(float) * 3) + (sizeof(float) * 3) + (sizeof(float) * 3),
+        offsetof(struct LightData, intensity),
         1,
     },
     {
         SHADER_PARAM_TYPE_FLOAT,
         "gLights",
         "attenuation",
-        0 + sizeof(GLint) + sizeof(GLint) + sizeof(GLint) + (sizeof(float) * 3) + (sizeof(float) * 3) + (sizeof(float) * 3) + (sizeof(float) * 3) + sizeof(float),
+        offsetof(struct LightData, attenuation),
         3,
     },
 };
@@ -107,6 +112,181 @@ static void setShaderParam(struct Shader *shader, int curLight, int curParam, st
 
 static PyObject *Py3dModelRenderer_Ctor = NULL;
 
+static void setFrameUniforms(struct Shader *shader, struct Py3dScene *scene, struct Py3dRenderingContext *rc) {
+    // shaders that declare the frame block already see the camera through the scene's uniform buffer
+    if (getShaderUniformBlockSize(shader, SHADER_FRAME_BLOCK_BINDING) == 0) {
+        setShaderFloatArrayUniform(shader, "gCamPos", Py3dRenderingContext_GetCameraPosW(rc), 3);
+        setShaderMatrixUniform(shader, "gVPMtx", Py3dRenderingContext_GetCameraVPMtx(rc), 4);
+    }
+
+    // clustered shaders walk the per cluster light lists instead of a fixed size light array
+    if (isShaderStorageBlockDeclared(shader, SHADER_CLUSTER_GRID_BUFFER_BINDING)) {
+        Py3dScene_PrepareLightClusters(scene, rc);
+        return;
+    }
+
+    // shaders that declare the light block read the scene's uniform buffer directly
+    if (getShaderUniformBlockSize(shader, SHADER_LIGHT_BLOCK_BINDING) > 0) return;
+
+    struct LightData *lightData = NULL;
+    size_t numLights = 0;
+    Py3dScene_GetDynamicLightData(scene, &lightData, &numLights);
+
+    for (int curLight = 0; curLight < numLights; ++curLight) {
+        for (int curParam = 0; curParam < 9; ++curParam) {
+            setShaderParam(shader, curLight, curParam, lightData);
+        }
+    }
+}
+
+static void setMaterialUniforms(struct Shader *shader, struct Material *material) {
+    setShaderFloatArrayUniform(shader, "gMaterial.ambient", getMaterialAmbientColor(material), 3);
+    setShaderFloatArrayUniform(shader, "gMaterial.specular", getMaterialSpecularColor(material), 3);
+    setShaderFloatArrayUniform(shader, "gMaterial.specPower", getMaterialSpecPower(material), 1);
+}
+
+// per object uniforms are set for every packet, so their handles are resolved once per run
+struct ObjectUniformHandles {
+    int wMtx;
+    int witMtx;
+    int wvpMtx;
+};
+
+static void resolveObjectUniformHandles(struct Shader *shader, struct ObjectUniformHandles *handles) {
+    handles->wMtx = getShaderUniformHandle(shader, "gWMtx");
+    handles->witMtx = getShaderUniformHandle(shader, "gWITMtx");
+
+    // shaders with the frame block combine gWMtx with gVPMtx themselves
+    if (getShaderUniformBlockSize(shader, SHADER_FRAME_BLOCK_BINDING) > 0) {
+        handles->wvpMtx = SHADER_INVALID_UNIFORM_HANDLE;
+    } else {
+        handles->wvpMtx = getShaderUniformHandle(shader, "gWVPMtx");
+    }
+}
+
+static void setObjectUniforms(
+    struct Shader *shader,
+    const struct ObjectUniformHandles *handles,
+    struct Model *model,
+    struct Py3dGameObject *owner,
+    struct Py3dRenderingContext *rc
+) {
+    // normals are not quantised, so the inverse transpose stays the owner's own
+    float wMtxScratch[16];
+    const float *wMtx = calcModelWorldMatrix(model, Py3dGameObject_GetWorldMatrix(owner), wMtxScratch);
+    setShaderMatrixUniformByHandle(shader, handles->wMtx, wMtx, 4);
+    setShaderMatrixUniformByHandle(shader, handles->witMtx, Py3dGameObject_GetWITMatrix(owner), 4);
+
+    if (handles->wvpMtx == SHADER_INVALID_UNIFORM_HANDLE) return;
+
+    float wvpMtx[16] = {0.0f};
+    Mat4Identity(wvpMtx);
+    Mat4Mult(wvpMtx, wMtx, Py3dRenderingContext_GetCameraVPMtx(rc));
+    setShaderMatrixUniformByHandle(shader, handles->wvpMtx, wvpMtx, 4);
+}
+
+// Picks the level of detail whose error stays below the configured number of pixels at the distance
+// of the model's bounding sphere. Models the camera is inside of always draw in full detail
+static size_t updateModelLod(struct Py3dModelRenderer *self, struct Py3dGameObject *owner, struct Py3dRenderingContext *rc) {
+    if (rc == NULL || self->model->_numLods <= 1) {
+        self->lod = 0;
+        return self->lod;
+    }
+
+    // row vectors, so the rows of the upper 3x3 are the transformed model axes
+    const float *wMtx = Py3dGameObject_GetWorldMatrix(owner);
+    float centerW[3];
+    float scale = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        centerW[axis] = self->model->_boundsCenter[0] * wMtx[axis] +
+            self->model->_boundsCenter[1] * wMtx[4 + axis] +
+            self->model->_boundsCenter[2] * wMtx[8 + axis] +
+            wMtx[12 + axis];
+
+        float axisScale = sqrtf(Vec3Dot(&wMtx[axis * 4], &wMtx[axis * 4]));
+        if (axisScale > scale) scale = axisScale;
+    }
+
+    float toCenter[3];
+    Vec3Subtract(toCenter, centerW, Py3dRenderingContext_GetCameraPosW(rc));
+    float distance = sqrtf(Vec3Dot(toCenter, toCenter)) - self->model->_boundsRadius * scale;
+    if (distance <= 0.0f) {
+        self->lod = 0;
+        return self->lod;
+    }
+
+    float pixelsPerUnit = Py3dRenderingContext_GetCameraPixelScale(rc) * scale / distance;
+    self->lod = selectModelLod(self->model, pixelsPerUnit, self->lod, (float) getConfigModelLodPixelError());
+
+    return self->lod;
+}
+
+// Streams the world matrices of a run into the queue's instance buffer and draws it with a single call
+static void drawModelRunInstanced(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    struct InstanceBuffer *instances = state->instances;
+    if (instances == NULL || instances->_vbo == 0) {
+        error_log("%s", "[ModelRenderer]: Instance buffer is unavailable, skipping instanced draw");
+        return;
+    }
+
+    size_t firstInstance = instances->_numInstances;
+    float wMtxScratch[16];
+    for (size_t i = 0; i < numPackets; ++i) {
+        struct Py3dGameObject *owner = packets[i].owner;
+        const float *wMtx = calcModelWorldMatrix(state->model, Py3dGameObject_GetWorldMatrix(owner), wMtxScratch);
+        if (!appendInstance(instances, wMtx, Py3dGameObject_GetWITMatrix(owner))) {
+            error_log("%s", "[ModelRenderer]: Instance buffer is full, skipping instanced draw");
+            instances->_numInstances = firstInstance;
+            return;
+        }
+    }
+
+    uploadInstances(instances, firstInstance, numPackets);
+    setModelInstanceBuffer(state->model, instances->_vbo);
+    renderModelInstancedLod(state->model, packets[0].lod, numPackets, firstInstance);
+}
+
+static void drawModelRun(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    if (state->materialChanged) {
+        setMaterialUniforms(state->shader, state->material);
+    }
+
+    if (isShaderInstanced(state->shader)) {
+        drawModelRunInstanced(packets, numPackets, state);
+        return;
+    }
+
+    struct ObjectUniformHandles handles;
+    resolveObjectUniformHandles(state->shader, &handles);
+
+    for (size_t i = 0; i < numPackets; ++i) {
+        setObjectUniforms(state->shader, &handles, state->model, packets[i].owner, state->rc);
+        renderModelLod(state->model, packets[i].lod);
+    }
+}
+
+static void drawModelPacket(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    // uniform values live in the program object, so anything that is constant for the frame
+    // only needs to be uploaded when this shader's run of packets begins
+    if (state->shaderChanged) {
+        const GLint diffuseMapUnit = 0;
+        setShaderIntUniform(state->shader, "gMaterial.diffuse", &diffuseMapUnit, 1);
+        setFrameUniforms(state->shader, state->scene, state->rc);
+    }
+
+    drawModelRun(packets, numPackets, state);
+}
+
+// G-buffer shaders only write surface attributes, lights are applied later by the deferred renderer
+static void drawModelPacketDeferred(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    if (state->shaderChanged) {
+        const GLint diffuseMapUnit = 0;
+        setShaderIntUniform(state->shader, "gMaterial.diffuse", &diffuseMapUnit, 1);
+    }
+
+    drawModelRun(packets, numPackets, state);
+}
+
 static PyObject *Py3dModelRenderer_Render(struct Py3dModelRenderer *self, PyObject *args, PyObject *kwds) {
     if (self->shader == NULL || self->model == NULL || self->material == NULL) {
         PyErr_SetString(PyExc_ValueError, "ModelRendererComponent is not correctly configured");
@@ -123,31 +303,16 @@ static PyObject *Py3dModelRenderer_Render(struct Py3dModelRenderer *self, PyObje
     if (scene == NULL) return NULL;
 
     enableShader(self->shader);
-    setShaderFloatArrayUniform(self->shader, "gCamPos", Py3dRenderingContext_GetCameraPosW(rc), 3);
-    setShaderMatrixUniform(self->shader, "gWMtx", Py3dGameObject_GetWorldMatrix(owner), 4);
-    setShaderMatrixUniform(self->shader, "gWITMtx", Py3dGameObject_GetWITMatrix(owner), 4);
     setShaderTextureUniform(self->shader, "gMaterial.diffuse", self->material->_diffuseMap);
-    setShaderFloatArrayUniform(self->shader, "gMaterial.ambient", getMaterialAmbientColor(self->material), 3);
-    setShaderFloatArrayUniform(self->shader, "gMaterial.specular", getMaterialSpecularColor(self->material), 3);
-    setShaderFloatArrayUniform(self->shader, "gMaterial.specPower", getMaterialSpecPower(self->material), 1);
-
-    struct LightData *lightData = NULL;
-    size_t numLights = 0;
-    Py3dScene_GetDynamicLightData(scene, &lightData, &numLights);
-
-    for (int curLight = 0; curLight < numLights; ++curLight) {
-        for (int curParam = 0; curParam < 9; ++curParam) {
-            setShaderParam(self->shader, curLight, curParam, lightData);
-        }
-    }
+    setFrameUniforms(self->shader, scene, rc);
+    setMaterialUniforms(self->shader, self->material);
 
-    float wvpMtx[16] = {0.0f};
-    Mat4Identity(wvpMtx);
-    Mat4Mult(wvpMtx, Py3dGameObject_GetWorldMatrix(owner), Py3dRenderingContext_GetCameraVPMtx(rc));
-    setShaderMatrixUniform(self->shader, "gWVPMtx", wvpMtx, 4);
+    struct ObjectUniformHandles handles;
+    resolveObjectUniformHandles(self->shader, &handles);
+    setObjectUniforms(self->shader, &handles, self->model, owner, rc);
 
     bindModel(self->model);
-    renderModel(self->model);
+    renderModelLod(self->model, updateModelLod(self, owner, rc));
     unbindModel(self->model);
 
     disableShader(self->shader);
@@ -238,6 +403,7 @@ static int Py3dModelRenderer_Init(struct Py3dModelRenderer *self, PyObject *args
     self->material = NULL;
     self->model = NULL;
     self->shader = NULL;
+    self->lod = 0;
 
     return 0;
 }
@@ -301,6 +467,42 @@ struct Py3dModelRenderer *Py3dModelRenderer_New() {
     return py3dModelRenderer;
 }
 
+int Py3dModelRenderer_Enqueue(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue) {
+    // subclasses may override render, so only the exact builtin type skips python dispatch
+    if (component == NULL || !Py_IS_TYPE(component, &Py3dModelRenderer_Type)) return 0;
+
+    struct Py3dModelRenderer *self = (struct Py3dModelRenderer *) component;
+    if (self->shader == NULL || self->model == NULL || self->material == NULL) return 0;
+
+    struct Shader *baseShader = self->shader;
+    DrawPacketFunc draw = drawModelPacket;
+    if (queue->geometryShader != NULL) {
+        baseShader = queue->geometryShader;
+        draw = drawModelPacketDeferred;
+    }
+
+    // objects that share an instanced variant end up adjacent after sorting and are drawn in one call
+    struct Shader *shader = getShaderInstancedVariant(baseShader);
+    if (shader == NULL) {
+        shader = baseShader;
+    }
+
+    struct DrawPacket *packet = pushDrawPacket(
+        queue,
+        DRAW_PACKET_LAYER_MODEL,
+        shader,
+        self->material,
+        self->material->_diffuseMap,
+        self->model,
+        component,
+        owner,
+        draw
+    );
+    setDrawPacketLod(packet, updateModelLod(self, owner, queue->rc));
+
+    return 1;
+}
+
 int Py3dModelRenderer_Check(PyObject *obj) {
     return PyObject_IsInstance(obj, (PyObject *) &Py3dModelRenderer_Type);
 }
@@ -1,9 +1,12 @@
 #include "python/py3drenderingcontext.h"
+#include <stdbool.h>
+
 #include "python/component_helper.h"
 #include "python/python_util.h"
 #include "logger.h"
 #include "python/py3dgameobject.h"
 #include "python/py3dscene.h"
+#include "python/py3dcamera.h"
 #include "engine.h"
 #include "util.h"
 
@@ -11,8 +14,12 @@ struct PerspectiveCamera {
     float fovXInDegrees;
     float nearPlaneDistance;
     float farPlaceDistance;
+    float vMtx[16];
+    float pMtx[16];
     float vpMtx[16];
     float posW[3];
+    int viewportWidth;
+    int viewportHeight;
 };
 
 static void initPerspectiveCamera(struct PerspectiveCamera *camera) {
@@ -21,18 +28,29 @@ static void initPerspectiveCamera(struct PerspectiveCamera *camera) {
     camera->fovXInDegrees = 0.0f;
     camera->nearPlaneDistance = 0.0f;
     camera->farPlaceDistance = 0.0f;
+    memset(camera->vMtx, 0, sizeof(float) * 16);
+    memset(camera->pMtx, 0, sizeof(float) * 16);
     memset(camera->vpMtx, 0, sizeof(float) * 16);
     memset(camera->posW, 0, sizeof(float) * 3);
+    camera->viewportWidth = 0;
+    camera->viewportHeight = 0;
 }
 
+// A scene keeps one context alive for its whole lifetime, matrices are only rebuilt when their inputs change
 struct Py3dRenderingContext {
     PyObject_HEAD
     struct Py3dScene *scene;
     struct PerspectiveCamera camera;
+    struct Py3dGameObject *cameraObject;
+    PyObject *cameraComponent;
+    unsigned int cameraTransformVersion;
+    unsigned int cameraParamVersion;
 };
 
 static PyObject *Py3dRenderingContext_Ctor = NULL;
 static int Py3dRenderingContext_Init(struct Py3dRenderingContext *self, PyObject *args, PyObject *kwds);
+static int Py3dRenderingContext_Traverse(struct Py3dRenderingContext *self, visitproc visit, void *arg);
+static int Py3dRenderingContext_Clear(struct Py3dRenderingContext *self);
 static void Py3dRenderingContext_Dealloc(struct Py3dRenderingContext *self);
 static PyMethodDef Py3dRenderingContext_Methods[] = {
         {NULL}
@@ -44,11 +62,13 @@ PyTypeObject Py3dRenderingContext_Type = {
     .tp_doc = "Represents the current rendering pass",
     .tp_basicsize = sizeof(struct Py3dRenderingContext),
     .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
     .tp_init = (initproc) Py3dRenderingContext_Init,
     .tp_methods = Py3dRenderingContext_Methods,
     .tp_dealloc = (destructor) Py3dRenderingContext_Dealloc,
-    .tp_new = PyType_GenericNew
+    .tp_new = PyType_GenericNew,
+    .tp_traverse = (traverseproc) Py3dRenderingContext_Traverse,
+    .tp_clear = (inquiry) Py3dRenderingContext_Clear
 };
 
 extern int PyInit_Py3dRenderingContext(PyObject *module) {
@@ -152,26 +172,27 @@ static int extractCameraFromComponent(PyObject *component, struct PerspectiveCam
     return 1;
 }
 
-static int extractPerspectiveCameraFromGameObject(struct Py3dGameObject *go, struct PerspectiveCamera *camera) {
-    if (go == NULL || camera == NULL) return 0;
+// Returns a new reference to the first component of the object that describes a camera, native camera
+// components are preferred, python components only need fov_x_in_degrees, near_z and far_z attributes
+static PyObject *findCameraComponent(struct Py3dGameObject *go, struct PerspectiveCamera *camera) {
+    if (go == NULL || camera == NULL) return NULL;
 
     const Py_ssize_t componentCount = Py3dGameObject_GetComponentCountInt(go);
     for (Py_ssize_t i = 0; i < componentCount; ++i) {
         PyObject *curComponent = Py3dGameObject_GetComponentByIndexInt(go, i);
         if (curComponent == NULL) {
-            return 0;
+            return NULL;
         } else if (!Py3d_IsComponentSubclass(curComponent)) {
             Py_CLEAR(curComponent);
-            return 0;
+            return NULL;
         }
 
-        const int extractRet = extractCameraFromComponent(curComponent, camera);
-        Py_CLEAR(curComponent);
+        if (Py3dCamera_Check(curComponent) || extractCameraFromComponent(curComponent, camera) == 1) return curComponent;
 
-        if (extractRet == 1) return 1;
+        Py_CLEAR(curComponent);
     }
 
-    return 0;
+    return NULL;
 }
 
 static void buildPerspectiveMatrix(
@@ -199,25 +220,119 @@ static void buildPerspectiveMatrix(
     dst[15] = 0.0f;
 }
 
-static void setCamera(struct Py3dRenderingContext *self, struct Py3dGameObject *newCamera) {
-    if (extractPerspectiveCameraFromGameObject(newCamera, &self->camera) != 1) return;
+// native camera components start out stale so their parameters are copied on first use
+static void resetCameraParamVersion(struct Py3dRenderingContext *self) {
+    if (self->cameraComponent != NULL && Py3dCamera_Check(self->cameraComponent)) {
+        self->cameraParamVersion = Py3dCamera_GetVersion((struct Py3dCamera *) self->cameraComponent) - 1;
+    }
+}
+
+static void bindCamera(struct Py3dRenderingContext *self, struct Py3dGameObject *newCamera) {
+    Py_CLEAR(self->cameraComponent);
+    Py_CLEAR(self->cameraObject);
+    self->cameraObject = (struct Py3dGameObject *) Py_NewRef(newCamera);
+    self->cameraComponent = findCameraComponent(newCamera, &self->camera);
+
+    // force every cached matrix to be rebuilt for the new camera
+    self->cameraTransformVersion = Py3dGameObject_GetTransformVersion(newCamera) - 1;
+    resetCameraParamVersion(self);
+    self->camera.viewportWidth = 0;
+    self->camera.viewportHeight = 0;
+}
+
+// Returns true when a projection parameter differs from the cached one
+static bool refreshCameraParams(struct Py3dRenderingContext *self) {
+    if (self->cameraComponent == NULL) {
+        // the camera may get its component after it was activated
+        self->cameraComponent = findCameraComponent(self->cameraObject, &self->camera);
+        if (self->cameraComponent == NULL) return false;
+
+        resetCameraParamVersion(self);
+    }
+
+    struct PerspectiveCamera *camera = &self->camera;
+    if (Py3dCamera_Check(self->cameraComponent)) {
+        struct Py3dCamera *cameraComponent = (struct Py3dCamera *) self->cameraComponent;
+        const unsigned int version = Py3dCamera_GetVersion(cameraComponent);
+        if (version == self->cameraParamVersion) return false;
+
+        self->cameraParamVersion = version;
+        camera->fovXInDegrees = Py3dCamera_GetFovXInDegrees(cameraComponent);
+        camera->nearPlaneDistance = Py3dCamera_GetNearZ(cameraComponent);
+        camera->farPlaceDistance = Py3dCamera_GetFarZ(cameraComponent);
+
+        return true;
+    }
+
+    // python camera components cannot report changes, so their attributes are still read every frame
+    struct PerspectiveCamera extracted = (*camera);
+    if (extractCameraFromComponent(self->cameraComponent, &extracted) != 1) return false;
+
+    const bool changed = extracted.fovXInDegrees != camera->fovXInDegrees ||
+        extracted.nearPlaneDistance != camera->nearPlaneDistance ||
+        extracted.farPlaceDistance != camera->farPlaceDistance;
+    (*camera) = extracted;
+
+    return changed;
+}
+
+int Py3dRenderingContext_BeginFrame(struct Py3dRenderingContext *self) {
+    if (self == NULL || self->scene == NULL) {
+        PyErr_SetString(PyExc_ValueError, "Rendering Context is not bound to a scene");
+        return 0;
+    }
+
+    PyObject *activeCamera = self->scene->activeCamera;
+    if (activeCamera != (PyObject *) self->cameraObject) {
+        if (activeCamera == NULL || !Py3dGameObject_Check(activeCamera)) {
+            error_log("[Py3dRenderingContext]: Scene without GameObject as active camera discovered");
+            PyErr_SetString(PyExc_TypeError, "Scene without GameObject as active camera discovered");
+            return 0;
+        }
+
+        bindCamera(self, (struct Py3dGameObject *) activeCamera);
+    }
+
+    bool projectionDirty = refreshCameraParams(self);
+    if (self->cameraComponent == NULL) return 1;
 
     // TODO: when rendering targets are invented get the dimensions from it
     // right now, the glfw window is the rendering target
     // fyi the rendering target will come from the camera
     int width = 0, height = 0;
     getRenderingTargetDimensions(&width, &height);
+    if (width != self->camera.viewportWidth || height != self->camera.viewportHeight) {
+        self->camera.viewportWidth = width;
+        self->camera.viewportHeight = height;
+        projectionDirty = true;
+    }
+
+    if (projectionDirty && width > 0 && height > 0) {
+        buildPerspectiveMatrix(self->camera.pMtx, &self->camera, width, height);
+    }
+
+    bool viewDirty = false;
+    const unsigned int transformVersion = Py3dGameObject_GetTransformVersion(self->cameraObject);
+    if (transformVersion != self->cameraTransformVersion) {
+        self->cameraTransformVersion = transformVersion;
+        Py3dGameObject_CalculateViewMatrix(self->cameraObject, self->camera.vMtx);
+        Vec3Copy(self->camera.posW, Py3dGameObject_GetPositionFA(self->cameraObject));
+        viewDirty = true;
+    }
+
+    if (projectionDirty || viewDirty) {
+        Mat4Mult(self->camera.vpMtx, self->camera.vMtx, self->camera.pMtx);
+    }
 
-    float vMtx[16] = {0.0f};
-    float pMtx[16] = {0.0f};
-    Py3dGameObject_CalculateViewMatrix(newCamera, vMtx);
-    buildPerspectiveMatrix(pMtx, &self->camera, width, height);
-    Mat4Mult(self->camera.vpMtx, vMtx, pMtx);
-    Vec3Copy(self->camera.posW, Py3dGameObject_GetPositionFA(newCamera));
+    return 1;
 }
 
 static int Py3dRenderingContext_Init(struct Py3dRenderingContext *self, PyObject *args, PyObject *kwds) {
     self->scene = NULL;
+    self->cameraObject = NULL;
+    self->cameraComponent = NULL;
+    self->cameraTransformVersion = 0;
+    self->cameraParamVersion = 0;
     initPerspectiveCamera(&self->camera);
 
     struct Py3dScene *scene = NULL;
@@ -225,31 +340,30 @@ static int Py3dRenderingContext_Init(struct Py3dRenderingContext *self, PyObject
     self->scene = (struct Py3dScene *) Py_NewRef(scene);
     scene = NULL;
 
-    struct Py3dGameObject *activeCamera = NULL;
-    PyObject *getActiveCameraRet = Py3dScene_GetActiveCamera(self->scene);
-    if (getActiveCameraRet == NULL) {
-        return -1;
-    } else if (!Py3dGameObject_Check(getActiveCameraRet)) {
-        Py_CLEAR(getActiveCameraRet);
-        error_log("[Py3dRenderingContext]: Scene without GameObject as active camera discovered");
-        PyErr_SetString(PyExc_TypeError, "Scene without GameObject as active camera discovered");
-        return -1;
-    } else {
-        activeCamera = (struct Py3dGameObject *) getActiveCameraRet;
-        getActiveCameraRet = NULL;
-    }
+    return 0;
+}
 
-    setCamera(self, activeCamera);
-    Py_CLEAR(activeCamera);
+static int Py3dRenderingContext_Traverse(struct Py3dRenderingContext *self, visitproc visit, void *arg) {
+    Py_VISIT(self->scene);
+    Py_VISIT(self->cameraObject);
+    Py_VISIT(self->cameraComponent);
+
+    return 0;
+}
+
+static int Py3dRenderingContext_Clear(struct Py3dRenderingContext *self) {
+    Py_CLEAR(self->scene);
+    Py_CLEAR(self->cameraObject);
+    Py_CLEAR(self->cameraComponent);
 
     return 0;
 }
 
 static void Py3dRenderingContext_Dealloc(struct Py3dRenderingContext *self) {
-    // This is gonna spam the logs
-    //trace_log("%s", "[RenderingContext]: Deallocating Rendering Context");
+    trace_log("%s", "[RenderingContext]: Deallocating Rendering Context");
 
-    Py_CLEAR(self->scene);
+    PyObject_GC_UnTrack(self);
+    Py3dRenderingContext_Clear(self);
     Py_TYPE(self)->tp_free((PyObject *) self);
 }
 
@@ -265,4 +379,35 @@ float* Py3dRenderingContext_GetCameraVPMtx(struct Py3dRenderingContext *self)
     if (self == NULL) return NULL;
 
     return self->camera.vpMtx;
+}
+
+void Py3dRenderingContext_GetCameraDepthRange(struct Py3dRenderingContext *self, float *nearZ, float *farZ)
+{
+    if (self == NULL || nearZ == NULL || farZ == NULL) return;
+
+    (*nearZ) = self->camera.nearPlaneDistance;
+    (*farZ) = self->camera.farPlaceDistance;
+}
+
+// On screen height in pixels of one world unit at distance 1 from the camera, divide by the
+// distance to get the scale anywhere else
+float Py3dRenderingContext_GetCameraPixelScale(struct Py3dRenderingContext *self)
+{
+    if (self == NULL) return 0.0f;
+
+    return self->camera.pMtx[5] * (float) self->camera.viewportHeight * 0.5f;
+}
+
+void Py3dRenderingContext_GetFrameData(struct Py3dRenderingContext *self, struct FrameData *dst)
+{
+    if (self == NULL || dst == NULL) return;
+
+    memset(dst, 0, sizeof(struct FrameData));
+    memcpy(dst->viewMtx, self->camera.vMtx, sizeof(float) * 16);
+    memcpy(dst->projMtx, self->camera.pMtx, sizeof(float) * 16);
+    memcpy(dst->vpMtx, self->camera.vpMtx, sizeof(float) * 16);
+    Vec3Copy(dst->camPosW, self->camera.posW);
+    dst->time = getUptime();
+    dst->viewportSize[0] = (float) self->camera.viewportWidth;
+    dst->viewportSize[1] = (float) self->camera.viewportHeight;
 }
\ No newline at end of file
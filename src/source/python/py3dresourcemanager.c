@@ -1,39 +1,243 @@
+#include <stdlib.h>
+#include <string.h>
+
 #include "python/py3dresourcemanager.h"
 #include "python/python_util.h"
 #include "logger.h"
 #include "custom_string.h"
 #include "resources/base_resource.h"
+#include "resources/resource_cache.h"
 #include "python/py3dscene.h"
 
-struct ListNode {
-    struct BaseResource *resource;
+#define RESOURCE_MANAGER_MIN_SLOTS 64
+#define RESOURCE_MANAGER_MIN_RESOURCES 32
+#define RESOURCE_NAME_BLOCK_SIZE 4096
+
+struct ResourceNameSlot {
+    const char *name;
+    unsigned int hash;
+    size_t index;
+};
+
+struct ResourceTypeIndex {
+    const char *typeName;
+    struct BaseResource **resources;
+    size_t numResources;
+    size_t capacity;
+};
 
-    struct ListNode *next;
+// Names are copied into blocks owned by the manager, so a slot's key can not change underneath the
+// table when a resource is renamed
+struct ResourceNameBlock {
+    struct ResourceNameBlock *next;
+    size_t used;
+    size_t capacity;
+    char chars[];
 };
 
 static PyObject *Py3dResourceManager_Ctor = NULL;
 
-static void allocListNode(struct ListNode **listNodePtr) {
-    if (listNodePtr == NULL || (*listNodePtr) != NULL) return;
+static const char *internName(struct Py3dResourceManager *self, const char *name) {
+    size_t numBytes = strlen(name) + 1;
+
+    struct ResourceNameBlock *block = self->_names;
+    if (block == NULL || block->capacity - block->used < numBytes) {
+        size_t capacity = numBytes > RESOURCE_NAME_BLOCK_SIZE ? numBytes : RESOURCE_NAME_BLOCK_SIZE;
+        block = malloc(sizeof(struct ResourceNameBlock) + capacity);
+        if (block == NULL) return NULL;
+
+        block->next = self->_names;
+        block->used = 0;
+        block->capacity = capacity;
+        self->_names = block;
+    }
+
+    char *interned = block->chars + block->used;
+    memcpy(interned, name, numBytes);
+    block->used += numBytes;
+
+    return interned;
+}
+
+// Returns the slot holding name, or the empty slot where it belongs. The table is never full
+static struct ResourceNameSlot *findSlot(struct ResourceNameSlot *slots, size_t capacity, const char *name, unsigned int hash) {
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    while (slots[i].name != NULL) {
+        if (slots[i].hash == hash && strcmp(slots[i].name, name) == 0) break;
+
+        i = (i + 1) & mask;
+    }
+
+    return &slots[i];
+}
+
+// Keeps the load factor at or below 0.75
+static bool reserveSlots(struct Py3dResourceManager *self, size_t numSlotsUsed) {
+    if (self->_slotsCapacity > 0 && numSlotsUsed * 4 <= self->_slotsCapacity * 3) return true;
+
+    size_t newCapacity = self->_slotsCapacity > 0 ? self->_slotsCapacity * 2 : RESOURCE_MANAGER_MIN_SLOTS;
+    while (numSlotsUsed * 4 > newCapacity * 3) newCapacity *= 2;
+
+    struct ResourceNameSlot *newSlots = calloc(newCapacity, sizeof(struct ResourceNameSlot));
+    if (newSlots == NULL) {
+        critical_log("%s", "[ResourceManager]: Could not grow resource name table");
+        return false;
+    }
+
+    for (size_t i = 0; i < self->_slotsCapacity; ++i) {
+        struct ResourceNameSlot *oldSlot = &self->_slots[i];
+        if (oldSlot->name == NULL) continue;
+
+        (*findSlot(newSlots, newCapacity, oldSlot->name, oldSlot->hash)) = (*oldSlot);
+    }
+
+    free(self->_slots);
+    self->_slots = newSlots;
+    self->_slotsCapacity = newCapacity;
+
+    return true;
+}
+
+static bool reserveResourceArray(struct BaseResource ***resourcesPtr, size_t *capacity, size_t numResources) {
+    if (numResources <= (*capacity)) return true;
+
+    size_t newCapacity = (*capacity) > 0 ? (*capacity) * 2 : RESOURCE_MANAGER_MIN_RESOURCES;
+    while (newCapacity < numResources) newCapacity *= 2;
+
+    struct BaseResource **newResources = realloc((*resourcesPtr), newCapacity * sizeof(struct BaseResource *));
+    if (newResources == NULL) {
+        critical_log("%s", "[ResourceManager]: Could not grow resource list");
+        return false;
+    }
+
+    (*resourcesPtr) = newResources;
+    (*capacity) = newCapacity;
+
+    return true;
+}
+
+// Grows the resource list and the entry list next to it together
+static bool reserveResources(struct Py3dResourceManager *self, size_t numResources) {
+    if (numResources <= self->_resourcesCapacity) return true;
+
+    size_t capacity = self->_resourcesCapacity;
+    if (!reserveResourceArray(&self->_resources, &capacity, numResources)) return false;
+
+    struct ResourceCacheEntry **newEntries = realloc(self->_resourceEntries, capacity * sizeof(struct ResourceCacheEntry *));
+    if (newEntries == NULL) {
+        critical_log("%s", "[ResourceManager]: Could not grow resource list");
+        return false;
+    }
+
+    self->_resourceEntries = newEntries;
+    self->_resourcesCapacity = capacity;
+
+    return true;
+}
+
+static bool holdEntry(struct Py3dResourceManager *self, struct ResourceCacheEntry *entry) {
+    for (size_t i = 0; i < self->_numHeldEntries; ++i) {
+        if (self->_heldEntries[i] == entry) return true;
+    }
+
+    if (self->_numHeldEntries == self->_heldEntriesCapacity) {
+        size_t newCapacity = self->_heldEntriesCapacity > 0 ? self->_heldEntriesCapacity * 2 : 16;
+        struct ResourceCacheEntry **newEntries = realloc(self->_heldEntries, newCapacity * sizeof(struct ResourceCacheEntry *));
+        if (newEntries == NULL) {
+            critical_log("%s", "[ResourceManager]: Could not grow held entry list");
+            return false;
+        }
+
+        self->_heldEntries = newEntries;
+        self->_heldEntriesCapacity = newCapacity;
+    }
+
+    retainResourceCacheEntry(entry);
+    self->_heldEntries[self->_numHeldEntries++] = entry;
+
+    return true;
+}
+
+static struct ResourceTypeIndex *findTypeIndex(struct Py3dResourceManager *self, const char *typeName) {
+    for (size_t i = 0; i < self->_numTypeIndexes; ++i) {
+        if (strcmp(self->_typeIndexes[i].typeName, typeName) == 0) return &self->_typeIndexes[i];
+    }
+
+    return NULL;
+}
+
+// There are only a handful of resource types, so the indexes are searched linearly
+static struct ResourceTypeIndex *getOrAddTypeIndex(struct Py3dResourceManager *self, const char *typeName) {
+    struct ResourceTypeIndex *typeIndex = findTypeIndex(self, typeName);
+    if (typeIndex != NULL) return typeIndex;
+
+    const char *interned = internName(self, typeName);
+    if (interned == NULL) return NULL;
 
-    struct ListNode *newNode = calloc(1, sizeof(struct ListNode));
-    newNode->resource = NULL;
+    struct ResourceTypeIndex *newIndexes = realloc(self->_typeIndexes, (self->_numTypeIndexes + 1) * sizeof(struct ResourceTypeIndex));
+    if (newIndexes == NULL) return NULL;
 
-    (*listNodePtr) = newNode;
-    newNode = NULL;
+    self->_typeIndexes = newIndexes;
+    typeIndex = &self->_typeIndexes[self->_numTypeIndexes++];
+    typeIndex->typeName = interned;
+    typeIndex->resources = NULL;
+    typeIndex->numResources = 0;
+    typeIndex->capacity = 0;
+
+    return typeIndex;
 }
 
-static void deleteListNode(struct ListNode **listNodePtr) {
-    if (listNodePtr == NULL || (*listNodePtr) == NULL) return;
+// The manager is emptied before any resource is deleted, so a delete that reaches back into it sees no stale entries
+static void deleteAllResources(struct Py3dResourceManager *self) {
+    struct BaseResource **resources = self->_resources;
+    struct ResourceCacheEntry **resourceEntries = self->_resourceEntries;
+    size_t numResources = self->_numResources;
+    struct ResourceCacheEntry **heldEntries = self->_heldEntries;
+    size_t numHeldEntries = self->_numHeldEntries;
+    struct ResourceTypeIndex *typeIndexes = self->_typeIndexes;
+    size_t numTypeIndexes = self->_numTypeIndexes;
+    struct ResourceNameBlock *names = self->_names;
+
+    free(self->_slots);
+    self->_slots = NULL;
+    self->_slotsCapacity = 0;
+    self->_numSlotsUsed = 0;
+    self->_resources = NULL;
+    self->_resourceEntries = NULL;
+    self->_numResources = 0;
+    self->_resourcesCapacity = 0;
+    self->_typeIndexes = NULL;
+    self->_numTypeIndexes = 0;
+    self->_names = NULL;
+    self->_heldEntries = NULL;
+    self->_numHeldEntries = 0;
+    self->_heldEntriesCapacity = 0;
+
+    // owned resources may point into shared ones, so they go first
+    for (size_t i = 0; i < numResources; ++i) {
+        if (resourceEntries[i] != NULL) continue;
+
+        deleteResource(&resources[i]);
+    }
+    free(resources);
+    free(resourceEntries);
 
-    struct ListNode *listNode = (*listNodePtr);
-    deleteResource(&listNode->resource);
+    for (size_t i = numHeldEntries; i > 0; --i) {
+        releaseResourceCacheEntry(&heldEntries[i - 1]);
+    }
+    free(heldEntries);
 
-    deleteListNode(&listNode->next);
+    for (size_t i = 0; i < numTypeIndexes; ++i) {
+        free(typeIndexes[i].resources);
+    }
+    free(typeIndexes);
 
-    free(listNode);
-    listNode = NULL;
-    (*listNodePtr) = NULL;
+    while (names != NULL) {
+        struct ResourceNameBlock *next = names->next;
+        free(names);
+        names = next;
+    }
 }
 
 static int Py3dResourceManager_Traverse(struct Py3dResourceManager *self, visitproc visit, void *arg) {
@@ -43,7 +247,7 @@ static int Py3dResourceManager_Traverse(struct Py3dResourceManager *self, visitp
 
 static int Py3dResourceManager_Clear(struct Py3dResourceManager *self) {
     Py_CLEAR(self->owner);
-    deleteListNode(&self->_root);
+    deleteAllResources(self);
     return 0;
 }
 
@@ -53,8 +257,20 @@ static void Py3dResourceManager_Dealloc(struct Py3dResourceManager *self) {
 }
 
 static int Py3dResourceManager_Init(struct Py3dResourceManager *self, PyObject *args, PyObject *kwds) {
-    self->_root = NULL;
     self->owner = NULL;
+    self->_resources = NULL;
+    self->_resourceEntries = NULL;
+    self->_numResources = 0;
+    self->_resourcesCapacity = 0;
+    self->_slots = NULL;
+    self->_slotsCapacity = 0;
+    self->_numSlotsUsed = 0;
+    self->_typeIndexes = NULL;
+    self->_numTypeIndexes = 0;
+    self->_names = NULL;
+    self->_heldEntries = NULL;
+    self->_numHeldEntries = 0;
+    self->_heldEntriesCapacity = 0;
 
     return 0;
 }
@@ -149,54 +365,246 @@ extern void Py3dResourceManager_SetOwnerInC(struct Py3dResourceManager *self, st
     self->owner = (struct Py3dScene *) Py_NewRef(newOwner);
 }
 
-void Py3dResourceManager_StoreResource(struct Py3dResourceManager *self, struct BaseResource *resource) {
-    if (Py3dResourceManager_Check((PyObject *) self) != 1 || resource == NULL) return;
-
-    struct ListNode *prevNode = NULL, *curNode = self->_root;
-    while (curNode != NULL) {
-        if (resourceNamesEqual(curNode->resource, resource)) {
+static void storeResource(struct Py3dResourceManager *self, struct BaseResource *resource, struct ResourceCacheEntry *entry) {
+    // unnamed resources are owned like any other but can not be looked up by name
+    const char *name = getChars(getResourceName(resource));
+    struct ResourceNameSlot *slot = NULL;
+    unsigned int hash = 0;
+    if (name != NULL && name[0] != 0) {
+        if (!reserveSlots(self, self->_numSlotsUsed + 1)) return;
+
+        hash = hashChars(name);
+        slot = findSlot(self->_slots, self->_slotsCapacity, name, hash);
+        if (slot->name != NULL) {
             error_log(
                 "[ResourceManager]: A name collision occurred while storing resource named \"%s\". The resource will likely be leaked.",
-                getChars(getResourceName(resource))
+                name
             );
             return;
         }
+    }
+
+    const char *typeName = getChars(getResourceTypeName(resource));
+    struct ResourceTypeIndex *typeIndex = getOrAddTypeIndex(self, typeName != NULL ? typeName : "");
+    if (typeIndex == NULL || !reserveResourceArray(&typeIndex->resources, &typeIndex->capacity, typeIndex->numResources + 1)) return;
+    if (!reserveResources(self, self->_numResources + 1)) return;
+
+    if (slot != NULL) {
+        const char *interned = internName(self, name);
+        if (interned == NULL) {
+            critical_log("[ResourceManager]: Memory allocation failure while storing resource named \"%s\"", name);
+            return;
+        }
 
-        prevNode = curNode;
-        curNode = curNode->next;
+        slot->name = interned;
+        slot->hash = hash;
+        slot->index = self->_numResources;
+        self->_numSlotsUsed++;
     }
 
-    struct ListNode *newNode = NULL;
-    allocListNode(&newNode);
-    if (newNode == NULL) return;
+    self->_resources[self->_numResources] = resource;
+    self->_resourceEntries[self->_numResources] = entry;
+    self->_numResources++;
+    typeIndex->resources[typeIndex->numResources++] = resource;
+}
+
+void Py3dResourceManager_StoreResource(struct Py3dResourceManager *self, struct BaseResource *resource) {
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || resource == NULL) return;
+
+    storeResource(self, resource, NULL);
+}
 
-    newNode->resource = resource;
-    newNode->next = NULL;
+size_t Py3dResourceManager_GetResourceCount(struct Py3dResourceManager *self) {
+    if (Py3dResourceManager_Check((PyObject *) self) != 1) return 0;
 
-    if (prevNode == NULL) {
-        self->_root = newNode;
-    } else {
-        prevNode->next = newNode;
+    return self->_numResources;
+}
+
+void Py3dResourceManager_StoreSharedResources(struct Py3dResourceManager *self, struct ResourceCacheEntry *entry) {
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || entry == NULL) return;
+
+    if (!holdEntry(self, entry)) return;
+
+    struct BaseResource *const *resources = NULL;
+    size_t numResources = getResourceCacheEntryResources(entry, &resources);
+    for (size_t i = 0; i < numResources; ++i) {
+        storeResource(self, resources[i], entry);
     }
 }
 
-struct BaseResource *Py3dResourceManager_GetResource(struct Py3dResourceManager *self, const char *name) {
-    if (Py3dResourceManager_Check((PyObject *) self) != 1 || name == NULL) return NULL;
-
-    struct ListNode *curNode = self->_root;
-    while (curNode != NULL) {
-        struct BaseResource *curResource = curNode->resource;
-        if (curResource == NULL) {
-            critical_log("%s", "[ResourceManager]: NULL pointer detected in resource list. Memory leak likely.");
-            continue;
+static bool findResourceIndex(struct Py3dResourceManager *self, struct BaseResource *resource, size_t *indexOut) {
+    const char *name = getChars(getResourceName(resource));
+    if (name != NULL && name[0] != 0 && self->_slots != NULL) {
+        struct ResourceNameSlot *slot = findSlot(self->_slots, self->_slotsCapacity, name, hashChars(name));
+        if (slot->name != NULL && self->_resources[slot->index] == resource) {
+            (*indexOut) = slot->index;
+            return true;
         }
+    }
+
+    for (size_t i = 0; i < self->_numResources; ++i) {
+        if (self->_resources[i] != resource) continue;
+
+        (*indexOut) = i;
+        return true;
+    }
+
+    return false;
+}
 
-        if (stringEqualsCStr(curResource->_name, name)) {
-            return curNode->resource;
+// Collects the entries the new one has to keep alive, false when a dependency can not be shared
+static bool collectShareDependencies(
+    struct Py3dResourceManager *self,
+    size_t firstIndex,
+    struct ResourceCacheEntry ***dependenciesPtr,
+    size_t *numDependenciesPtr
+) {
+    size_t capacity = 0;
+    for (size_t i = firstIndex; i < self->_numResources; ++i) {
+        struct BaseResource *dependencies[RESOURCE_MAX_DEPENDENCIES];
+        size_t numDependencies = getResourceDependencies(self->_resources[i], dependencies);
+
+        for (size_t j = 0; j < numDependencies; ++j) {
+            size_t index = 0;
+            if (!findResourceIndex(self, dependencies[j], &index)) return false;
+            if (index >= firstIndex) continue;
+
+            struct ResourceCacheEntry *entry = self->_resourceEntries[index];
+            if (entry == NULL) {
+                trace_log(
+                    "[ResourceManager]: \"%s\" points at \"%s\" which only this scene owns",
+                    getChars(getResourceName(self->_resources[i])), getChars(getResourceName(dependencies[j]))
+                );
+                return false;
+            }
+
+            bool known = false;
+            for (size_t k = 0; k < (*numDependenciesPtr) && !known; ++k) {
+                known = (*dependenciesPtr)[k] == entry;
+            }
+            if (known) continue;
+
+            if ((*numDependenciesPtr) == capacity) {
+                size_t newCapacity = capacity > 0 ? capacity * 2 : 4;
+                struct ResourceCacheEntry **newDependencies = realloc((*dependenciesPtr), newCapacity * sizeof(struct ResourceCacheEntry *));
+                if (newDependencies == NULL) return false;
+
+                (*dependenciesPtr) = newDependencies;
+                capacity = newCapacity;
+            }
+
+            (*dependenciesPtr)[(*numDependenciesPtr)++] = entry;
         }
+    }
 
-        curNode = curNode->next;
+    return true;
+}
+
+bool Py3dResourceManager_ShareResources(struct Py3dResourceManager *self, size_t firstIndex, const char *key) {
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || key == NULL) return false;
+    if (firstIndex >= self->_numResources) return false;
+
+    for (size_t i = firstIndex; i < self->_numResources; ++i) {
+        if (self->_resourceEntries[i] != NULL) return false;
     }
 
-    return NULL;
+    struct ResourceCacheEntry **dependencies = NULL;
+    size_t numDependencies = 0;
+    if (!collectShareDependencies(self, firstIndex, &dependencies, &numDependencies)) {
+        trace_log("[ResourceManager]: \"%s\" can not be shared between scenes", key);
+        free(dependencies);
+        return false;
+    }
+
+    struct ResourceCacheEntry *entry = addResourceCacheEntry(
+        key, &self->_resources[firstIndex], self->_numResources - firstIndex, dependencies, numDependencies
+    );
+    free(dependencies);
+    if (entry == NULL) return false;
+
+    // the reference addResourceCacheEntry returned becomes the one this manager holds
+    if (!holdEntry(self, entry)) {
+        critical_log("[ResourceManager]: Could not hold \"%s\", its resources will be leaked", key);
+        return false;
+    }
+    releaseResourceCacheEntry(&entry);
+
+    for (size_t i = firstIndex; i < self->_numResources; ++i) {
+        self->_resourceEntries[i] = self->_heldEntries[self->_numHeldEntries - 1];
+    }
+
+    return true;
+}
+
+bool Py3dResourceManager_AliasResource(struct Py3dResourceManager *self, const char *alias, struct BaseResource *resource) {
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || alias == NULL || alias[0] == 0 || resource == NULL) return false;
+
+    size_t index = 0;
+    if (!findResourceIndex(self, resource, &index)) {
+        error_log("[ResourceManager]: Can not alias \"%s\" to a resource this manager does not hold", alias);
+        return false;
+    }
+
+    if (!reserveSlots(self, self->_numSlotsUsed + 1)) return false;
+
+    unsigned int hash = hashChars(alias);
+    struct ResourceNameSlot *slot = findSlot(self->_slots, self->_slotsCapacity, alias, hash);
+    if (slot->name != NULL) return self->_resources[slot->index] == resource;
+
+    const char *interned = internName(self, alias);
+    if (interned == NULL) {
+        critical_log("[ResourceManager]: Memory allocation failure while aliasing resource as \"%s\"", alias);
+        return false;
+    }
+
+    slot->name = interned;
+    slot->hash = hash;
+    slot->index = index;
+    self->_numSlotsUsed++;
+
+    return true;
+}
+
+struct BaseResource *Py3dResourceManager_GetResource(struct Py3dResourceManager *self, const char *name) {
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || name == NULL || name[0] == 0) return NULL;
+    if (self->_slots == NULL) return NULL;
+
+    struct ResourceNameSlot *slot = findSlot(self->_slots, self->_slotsCapacity, name, hashChars(name));
+    if (slot->name == NULL) return NULL;
+
+    return self->_resources[slot->index];
+}
+
+bool Py3dResourceManager_GetResourceEntry(struct Py3dResourceManager *self, const char *name, struct ResourceCacheEntry **entryOut) {
+    if (entryOut != NULL) (*entryOut) = NULL;
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || name == NULL || name[0] == 0 || entryOut == NULL) return false;
+    if (self->_slots == NULL) return false;
+
+    struct ResourceNameSlot *slot = findSlot(self->_slots, self->_slotsCapacity, name, hashChars(name));
+    if (slot->name == NULL) return false;
+
+    (*entryOut) = self->_resourceEntries[slot->index];
+
+    return true;
+}
+
+struct BaseResource *Py3dResourceManager_GetResourceOfType(struct Py3dResourceManager *self, const char *name, const char *typeName) {
+    if (typeName == NULL) return NULL;
+
+    struct BaseResource *resource = Py3dResourceManager_GetResource(self, name);
+    if (resource == NULL || !stringEqualsCStr(getResourceTypeName(resource), typeName)) return NULL;
+
+    return resource;
+}
+
+size_t Py3dResourceManager_GetResourcesOfType(struct Py3dResourceManager *self, const char *typeName, struct BaseResource *const **resourcesOut) {
+    if (resourcesOut != NULL) (*resourcesOut) = NULL;
+    if (Py3dResourceManager_Check((PyObject *) self) != 1 || typeName == NULL || resourcesOut == NULL) return 0;
+
+    struct ResourceTypeIndex *typeIndex = findTypeIndex(self, typeName);
+    if (typeIndex == NULL) return 0;
+
+    (*resourcesOut) = typeIndex->resources;
+
+    return typeIndex->numResources;
 }
@@ -1,3 +1,5 @@
+#include <glad/gl.h>
+
 #include "python/py3dscene.h"
 #include <structmember.h>
 
@@ -14,93 +16,106 @@
 #include "python/py3drenderingcontext.h"
 #include "lights.h"
 #include "python/py3dlight.h"
+#include "rendering/render_queue.h"
+#include "rendering/gl_state.h"
+#include "rendering/uniform_buffer.h"
+#include "rendering/light_clusters.h"
+#include "rendering/deferred_renderer.h"
+#include "resources/shader.h"
 
 static PyObject *py3dSceneCtor = NULL;
 
-struct LightListNode {
+// Registered lights live in a dense array, a light knows its own slot so removal is a swap with the last slot.
+// The first max_dynamic_lights slots map one to one onto the marshalled LightData array.
+struct LightSlot {
     struct Py3dLight *component;
-    struct LightListNode *next;
+    struct Py3dGameObject *owner;
+    unsigned int paramVersion;
+    unsigned int transformVersion;
+    unsigned int stateVersion;
+    bool dirty;
 };
 
-static void allocLightListNode(struct LightListNode **node) {
-    if (node == NULL || (*node) != NULL) return;
-
-    struct LightListNode *newNode = calloc(1, sizeof(struct LightListNode));
-    newNode->component = NULL;
-    newNode->next = NULL;
-
-    *node = newNode;
-}
+static bool growLightSlots(struct Py3dScene *self) {
+    Py_ssize_t newCapacity = self->lightSlotCapacity == 0 ? 8 : self->lightSlotCapacity * 2;
 
-static void deallocLightListNode(struct LightListNode **node) {
-    if (node == NULL || (*node) == NULL) return;
+    struct LightSlot *newSlots = realloc(self->lightSlots, newCapacity * sizeof(struct LightSlot));
+    if (newSlots == NULL) {
+        critical_log("%s", "[Scene]: Could not grow light slot array");
+        return false;
+    }
 
-    deallocLightListNode(&(*node)->next);
+    self->lightSlots = newSlots;
+    self->lightSlotCapacity = newCapacity;
 
-    free(*node);
-    *node = NULL;
+    return true;
 }
 
-static void appendLightToList(struct LightListNode **list, struct Py3dLight *newLightComponent) {
-    if (list == NULL) return;
-
-    struct LightListNode *prev = NULL, *next = NULL;
+static void clearLightSlots(struct Py3dScene *self) {
+    for (Py_ssize_t i = 0; i < self->numLightSlots; ++i) {
+        Py3dLight_SetSceneSlot(self->lightSlots[i].component, -1);
+        Py_CLEAR(self->lightSlots[i].component);
+        Py_CLEAR(self->lightSlots[i].owner);
+    }
 
-    int lightCount = 0;
-    next = *list;
-    while (next != NULL) {
-        if (next->component == newLightComponent) {
-            warning_log("%s", "[Scene]: Attempted to add non unique light to light list");
-            return;
-        }
+    self->numLightSlots = 0;
+}
 
-        prev = next;
-        next = next->next;
-        lightCount++;
+static void addLightSlot(struct Py3dScene *self, struct Py3dLight *newLightComponent) {
+    if (Py3dLight_GetSceneSlot(newLightComponent) >= 0) {
+        warning_log("%s", "[Scene]: Attempted to add non unique light to light list");
+        return;
     }
 
-    struct LightListNode *newNode = NULL;
-    allocLightListNode(&newNode);
-    newNode->next = NULL;
-    newNode->component = newLightComponent;
+    // the owner is looked up once here instead of every frame while marshalling
+    struct Py3dGameObject *owner = Py3d_GetComponentOwner((PyObject *) newLightComponent);
+    if (owner == NULL) {
+        warning_log("%s", "[Scene]: Could not determine light owner while registering light");
+        return;
+    }
 
-    trace_log("[Scene]: Light count for scene increased from %d to %d", lightCount, lightCount + 1);
-    if (lightCount >= getConfigMaxDynamicLights()) {
-        warning_log("[Scene]: Light count for scene has reached max dynamic light config value. Further lights will be ignored.");
+    if (self->numLightSlots == self->lightSlotCapacity && !growLightSlots(self)) {
+        Py_CLEAR(owner);
+        return;
     }
 
-    if (prev == NULL) {
-        *list = newNode;
-    } else {
-        prev->next = newNode;
+    Py_ssize_t slot = self->numLightSlots;
+    self->lightSlots[slot].component = (struct Py3dLight *) Py_NewRef((PyObject *) newLightComponent);
+    self->lightSlots[slot].owner = owner;
+    self->lightSlots[slot].dirty = true;
+    Py3dLight_SetSceneSlot(newLightComponent, slot);
+    self->numLightSlots++;
+
+    trace_log("[Scene]: Light count for scene increased from %d to %d", slot, slot + 1);
+    if (slot >= getConfigMaxDynamicLights()) {
+        warning_log("[Scene]: Light count for scene has reached max dynamic light config value. Further lights will only reach clustered shaders.");
     }
 }
 
-static void removeLightFromList(struct LightListNode **list, const struct Py3dLight *target) {
-    if (list == NULL || *list == NULL) {
-        warning_log("%s", "[Scene]: Tried to remove light from empty light list");
+static void removeLightSlot(struct Py3dScene *self, const struct Py3dLight *target) {
+    Py_ssize_t slot = Py3dLight_GetSceneSlot(target);
+    if (slot < 0 || slot >= self->numLightSlots || self->lightSlots[slot].component != target) {
+        warning_log("%s", "[Scene]: Attempted to remove a non existent light from light list");
         return;
     }
 
-    struct LightListNode *prev = NULL, *next = *list;
-    while (next != NULL) {
-        if (next->component == target) {
-            if (prev != NULL) {
-                prev->next = next->next;
-            } else {
-                *list = next->next;
-            }
+    Py3dLight_SetSceneSlot(self->lightSlots[slot].component, -1);
+    Py_CLEAR(self->lightSlots[slot].component);
+    Py_CLEAR(self->lightSlots[slot].owner);
 
-            free(next);
-            next = NULL;
-            return;
-        }
-
-        prev = next;
-        next = next->next;
+    Py_ssize_t last = self->numLightSlots - 1;
+    if (slot != last) {
+        self->lightSlots[slot] = self->lightSlots[last];
+        self->lightSlots[slot].dirty = true;
+        Py3dLight_SetSceneSlot(self->lightSlots[slot].component, slot);
     }
+    self->numLightSlots--;
 
-    warning_log("%s", "[Scene]: Attempted to remove a non existent light from light list");
+    // the vacated slot has to be cleared in the marshalled data as well
+    if (last < self->lightDataCapacity && self->lightData != NULL) {
+        memset(&self->lightData[last], 0, sizeof(struct LightData));
+        self->lightDataVersion++;
+    }
 }
 
 static int traverseCallbackTable(struct Py3dScene *self, visitproc visit, void *arg) {
@@ -119,6 +134,11 @@ static int Py3dScene_Traverse(struct Py3dScene *self, visitproc visit, void *arg
     Py_VISIT(self->sceneGraph);
     Py_VISIT(self->activeCamera);
     Py_VISIT(self->resourceManager);
+    Py_VISIT(self->renderingContext);
+    for (Py_ssize_t i = 0; i < self->numLightSlots; ++i) {
+        Py_VISIT(self->lightSlots[i].component);
+        Py_VISIT(self->lightSlots[i].owner);
+    }
 
     return traverseCallbackTable(self, visit, arg);
 }
@@ -148,6 +168,8 @@ static int Py3dScene_Clear(struct Py3dScene *self) {
     Py_CLEAR(self->sceneGraph);
     Py_CLEAR(self->activeCamera);
     Py_CLEAR(self->resourceManager);
+    Py_CLEAR(self->renderingContext);
+    clearLightSlots(self);
 
     return 0;
 }
@@ -159,7 +181,13 @@ static void Py3dScene_Dealloc(struct Py3dScene *self) {
     deallocPhysicsSpace(&self->space);
     finalizeCallbackTable(self);
     LightData_Dealloc(&self->lightData);
-    deallocLightListNode(&self->lightList);
+    free(self->lightSlots);
+    self->lightSlots = NULL;
+    deleteRenderQueue(&self->renderQueue);
+    deleteUniformBuffer(&self->lightBlock);
+    deleteUniformBuffer(&self->frameBlock);
+    deleteLightClusters(&self->lightClusters);
+    deleteDeferredRenderer(&self->deferred);
     Py_TYPE(self)->tp_free((PyObject *) self);
 }
 
@@ -178,7 +206,24 @@ static int Py3dScene_Init(struct Py3dScene *self, PyObject *args, PyObject *kwds
     self->cursorMode = GLFW_CURSOR_NORMAL;
     self->lightData = NULL;
     self->numLights = 0;
-    self->lightList = NULL;
+    self->lightDataCapacity = 0;
+    self->lightDataVersion = 0;
+    self->lightBlockVersion = 0;
+    self->lightSlots = NULL;
+    self->numLightSlots = 0;
+    self->lightSlotCapacity = 0;
+    self->renderQueue = NULL;
+    allocRenderQueue(&self->renderQueue);
+    self->lightBlock = NULL;
+    allocUniformBuffer(&self->lightBlock, SHADER_LIGHT_BLOCK_BINDING);
+    self->frameBlock = NULL;
+    allocUniformBuffer(&self->frameBlock, SHADER_FRAME_BLOCK_BINDING);
+    self->lightClusters = NULL;
+    self->clusterLightVersion = 0;
+    self->lightClustersBuilt = false;
+    self->renderPath = RENDER_PATH_FORWARD;
+    self->deferred = NULL;
+    self->renderingContext = NULL;
 
     return 0;
 }
@@ -413,6 +458,39 @@ void Py3dScene_Update(struct Py3dScene *self, float dt) {
     handleCollisions(self->space);
 }
 
+// The G-buffer has to exist before the queue is filled, packets queued for it carry the geometry shader
+static bool prepareDeferred(struct Py3dScene *self, struct Py3dRenderingContext *rc) {
+    if (self->renderPath != RENDER_PATH_DEFERRED || self->deferred == NULL) return false;
+
+    struct FrameData frameData;
+    Py3dRenderingContext_GetFrameData(rc, &frameData);
+
+    if (!prepareDeferredGeometryPass(self->deferred, (int) frameData.viewportSize[0], (int) frameData.viewportSize[1])) {
+        warning_log("%s", "[Scene]: G-buffer is unavailable, falling back to forward rendering for this frame");
+        return false;
+    }
+
+    return true;
+}
+
+// Models fill the G-buffer and get lit per light, sprites and text are drawn forward on top afterwards
+static void renderDeferred(struct Py3dScene *self, struct Py3dRenderingContext *rc) {
+    struct FrameData frameData;
+    Py3dRenderingContext_GetFrameData(rc, &frameData);
+
+    beginDeferredGeometryPass(self->deferred);
+    submitRenderQueueLayers(self->renderQueue, self, rc, DRAW_PACKET_LAYER_MODEL, DRAW_PACKET_LAYER_MODEL);
+    endDeferredGeometryPass(self->deferred);
+
+    float nearZ = 0.0f, farZ = 0.0f;
+    Py3dRenderingContext_GetCameraDepthRange(rc, &nearZ, &farZ);
+
+    size_t numLights = self->lightData == NULL ? 0 : (size_t) self->numLightSlots;
+    drawDeferredLighting(self->deferred, self->lightData, numLights, &frameData, nearZ, farZ);
+
+    submitRenderQueueLayers(self->renderQueue, self, rc, DRAW_PACKET_LAYER_SPRITE, DRAW_PACKET_LAYER_TEXT);
+}
+
 void Py3dScene_Render(struct Py3dScene *self) {
     if (self == NULL) return;
 
@@ -429,22 +507,44 @@ void Py3dScene_Render(struct Py3dScene *self) {
     }
 
     Py3dScene_MarshalLightData(self);
+    Py3dScene_UploadLightData(self);
+    self->lightClustersBuilt = false;
 
-    struct Py3dRenderingContext *rc = Py3dRenderingContext_New(self);
-    if (rc == NULL) {
+    // the context lives as long as the scene so camera matrices are only rebuilt when the camera changes
+    if (self->renderingContext == NULL) {
+        self->renderingContext = Py3dRenderingContext_New(self);
+        if (self->renderingContext == NULL) {
+            handleException();
+            return;
+        }
+    }
+
+    struct Py3dRenderingContext *rc = self->renderingContext;
+    if (!Py3dRenderingContext_BeginFrame(rc)) {
         handleException();
         return;
     }
+    Py3dScene_UploadFrameData(self, rc);
     PyObject *args = Py_BuildValue("(O)", rc);
 
-    PyObject *ret = Py3dGameObject_Render((struct Py3dGameObject *) self->sceneGraph, args, NULL);
-    if (ret == NULL) {
-        handleException();
+    // builtin renderers and python render calls are queued and drawn afterwards in sort key order,
+    // python render calls run in the sprite layer after opaque models
+    bool deferred = prepareDeferred(self, rc);
+    self->renderQueue->geometryShader = deferred ? getDeferredGeometryShader(self->deferred) : NULL;
+    self->renderQueue->rc = rc;
+    Py3dGameObject_FillRenderQueue((struct Py3dGameObject *) self->sceneGraph, args, self->renderQueue);
+    // python code bound GL objects without going through the state cache since the last frame
+    invalidateGLStateCache();
+    sortRenderQueue(self->renderQueue);
+    if (deferred) {
+        renderDeferred(self, rc);
+    } else {
+        submitRenderQueue(self->renderQueue, self, rc);
     }
+    clearRenderQueue(self->renderQueue);
+    self->renderQueue->rc = NULL;
 
-    Py_CLEAR(ret);
     Py_CLEAR(args);
-    Py_CLEAR(rc); // TODO: this might not be correct ... Py3dGameObject_Render should be taking ownership of this???
 }
 
 void Py3dScene_End(struct Py3dScene *self) {
@@ -616,50 +716,163 @@ void Py3dScene_GetDynamicLightData(struct Py3dScene *self, struct LightData **li
     (*numLightsPtr) = self->numLights;
 }
 
+static void marshalLightSlot(struct LightData *dst, struct LightSlot *slot, GLint enabled) {
+    dst->used = 1;
+    dst->enabled = enabled;
+    Py3dLight_GetType(slot->component, &dst->type);
+    Vec3Copy(dst->position, Py3dGameObject_GetPositionFA(slot->owner));
+    Py3dLight_GetDiffuse(slot->component, dst->diffuse);
+    Py3dLight_GetSpecular(slot->component, dst->specular);
+    Py3dLight_GetAmbient(slot->component, dst->ambient);
+    Py3dLight_GetIntensity(slot->component, &dst->intensity);
+    Py3dLight_GetAttenuation(slot->component, dst->attenuation);
+
+    slot->paramVersion = Py3dLight_GetVersion(slot->component);
+    slot->transformVersion = Py3dGameObject_GetTransformVersion(slot->owner);
+    slot->stateVersion = Py3dGameObject_GetStateVersion(slot->owner);
+    slot->dirty = false;
+}
+
+// Every registered light is marshalled, the LightBlock only sees the first max_dynamic_lights of them
+static bool reserveLightData(struct Py3dScene *self) {
+    if (self->lightData == NULL) {
+        self->numLights = getConfigMaxDynamicLights();
+    }
+
+    size_t required = self->numLightSlots > self->numLights ? (size_t) self->numLightSlots : (size_t) self->numLights;
+    if (required <= self->lightDataCapacity) return true;
+
+    size_t newCapacity = self->lightDataCapacity == 0 ? required : self->lightDataCapacity * 2;
+    if (newCapacity < required) newCapacity = required;
+
+    struct LightData *newLightData = realloc(self->lightData, newCapacity * sizeof(struct LightData));
+    if (newLightData == NULL) {
+        critical_log("%s", "[Scene]: Could not grow marshalled light data");
+        return false;
+    }
+
+    memset(&newLightData[self->lightDataCapacity], 0, (newCapacity - self->lightDataCapacity) * sizeof(struct LightData));
+    self->lightData = newLightData;
+    self->lightDataCapacity = newCapacity;
+    self->lightDataVersion++;
+
+    return true;
+}
+
 void Py3dScene_MarshalLightData(struct Py3dScene *self) {
     if (self == NULL) return;
 
-    LightData_Dealloc(&self->lightData);
-    self->numLights = getConfigMaxDynamicLights();
-    LightData_Alloc(&self->lightData, self->numLights);
-
-    memset(self->lightData, 0, sizeof(struct LightData) * self->numLights);
-
-    const struct LightListNode *curNode = self->lightList;
-    ssize_t curLight = 0;
-    while (curNode != NULL && curLight < self->numLights) {
-        struct Py3dLight *component = curNode->component;
-        struct Py3dGameObject *owner = Py3d_GetComponentOwner((PyObject *) component);
-        if (owner == NULL) {
-            warning_log("%s", "[Scene]: Could not determine light owner while refreshing lighting data");
-            handleException();
+    if (!reserveLightData(self)) return;
+
+    for (Py_ssize_t i = 0; i < self->numLightSlots; ++i) {
+        struct LightSlot *slot = &self->lightSlots[i];
+
+        // component enable state lives on the python side and has no change counter, so it is polled
+        GLint enabled =
+            Py3d_IsComponentEnabled((PyObject *) slot->component) &&
+            Py3d_IsComponentVisible((PyObject *) slot->component) &&
+            Py3dGameObject_IsEnabledBool(slot->owner) &&
+            Py3dGameObject_IsVisibleBool(slot->owner);
+
+        if (
+            !slot->dirty &&
+            enabled == self->lightData[i].enabled &&
+            slot->paramVersion == Py3dLight_GetVersion(slot->component) &&
+            slot->transformVersion == Py3dGameObject_GetTransformVersion(slot->owner) &&
+            slot->stateVersion == Py3dGameObject_GetStateVersion(slot->owner)
+        ) {
             continue;
         }
 
-        self->lightData[curLight].used = 1;
-        self->lightData[curLight].enabled =
-            Py3d_IsComponentEnabled((PyObject *) component) &&
-            Py3d_IsComponentVisible((PyObject *) component) &&
-            Py3dGameObject_IsEnabledBool(owner) &&
-            Py3dGameObject_IsVisibleBool(owner);
-        Py3dLight_GetType(component, &self->lightData[curLight].type);
-        Vec3Copy(self->lightData[curLight].position, Py3dGameObject_GetPositionFA(owner));
-        Py3dLight_GetDiffuse(component, self->lightData[curLight].diffuse);
-        Py3dLight_GetSpecular(component, self->lightData[curLight].specular);
-        Py3dLight_GetAmbient(component, self->lightData[curLight].ambient);
-        Py3dLight_GetIntensity(component, &self->lightData[curLight].intensity);
-        Py3dLight_GetAttenuation(component, self->lightData[curLight].attenuation);
+        marshalLightSlot(&self->lightData[i], slot, enabled);
+        self->lightDataVersion++;
+    }
+}
 
-        Py_CLEAR(owner);
-        curNode = curNode->next;
-        ++curLight;
+void Py3dScene_UploadLightData(struct Py3dScene *self) {
+    if (self == NULL || self->lightData == NULL || self->numLights <= 0) return;
+
+    if (self->lightBlockVersion != self->lightDataVersion) {
+        updateUniformBuffer(self->lightBlock, self->lightData, sizeof(struct LightData) * self->numLights);
+        self->lightBlockVersion = self->lightDataVersion;
     }
+
+    // the binding point is shared by every scene, so rebind even if the contents did not change
+    bindUniformBuffer(self->lightBlock);
+}
+
+void Py3dScene_PrepareLightClusters(struct Py3dScene *self, struct Py3dRenderingContext *rc) {
+    if (self == NULL || rc == NULL) return;
+
+    // the grid depends on the camera, it is built at most once per frame by the first shader that needs it
+    if (self->lightClustersBuilt) return;
+    self->lightClustersBuilt = true;
+
+    if (self->lightClusters == NULL) {
+        allocLightClusters(&self->lightClusters);
+        if (self->lightClusters == NULL) return;
+        self->clusterLightVersion = self->lightDataVersion - 1;
+    }
+
+    struct FrameData frameData;
+    Py3dRenderingContext_GetFrameData(rc, &frameData);
+
+    float nearZ = 0.0f, farZ = 0.0f;
+    Py3dRenderingContext_GetCameraDepthRange(rc, &nearZ, &farZ);
+
+    size_t numLights = self->lightData == NULL ? 0 : (size_t) self->numLightSlots;
+    if (!buildLightClusters(self->lightClusters, self->lightData, numLights, frameData.viewMtx, frameData.projMtx, nearZ, farZ)) {
+        warning_log("%s", "[Scene]: Could not build light clusters for the active camera");
+    }
+
+    if (self->clusterLightVersion != self->lightDataVersion) {
+        uploadLightClusterLights(self->lightClusters, self->lightData, numLights);
+        self->clusterLightVersion = self->lightDataVersion;
+    }
+    uploadLightClusters(self->lightClusters);
+    bindLightClusters(self->lightClusters);
+}
+
+void Py3dScene_UploadFrameData(struct Py3dScene *self, struct Py3dRenderingContext *rc) {
+    if (self == NULL || rc == NULL) return;
+
+    struct FrameData frameData;
+    Py3dRenderingContext_GetFrameData(rc, &frameData);
+
+    updateUniformBuffer(self->frameBlock, &frameData, sizeof(struct FrameData));
+    bindUniformBuffer(self->frameBlock);
+}
+
+void Py3dScene_SetRenderPath(struct Py3dScene *self, int renderPath) {
+    if (self == NULL) return;
+
+    if (renderPath == RENDER_PATH_DEFERRED && self->deferred == NULL) {
+        allocDeferredRenderer(&self->deferred);
+        if (self->deferred == NULL) {
+            warning_log("%s", "[Scene]: Could not create the deferred renderer, scene stays on the forward path");
+            renderPath = RENDER_PATH_FORWARD;
+        }
+    }
+
+    self->renderPath = renderPath;
+}
+
+int Py3dScene_GetRenderPath(struct Py3dScene *self) {
+    if (self == NULL) return RENDER_PATH_FORWARD;
+
+    return self->renderPath;
+}
+
+struct DeferredRenderer *Py3dScene_GetDeferredRenderer(struct Py3dScene *self) {
+    if (self == NULL || self->renderPath != RENDER_PATH_DEFERRED) return NULL;
+
+    return self->deferred;
 }
 
 int Py3dScene_RegisterLight(struct Py3dScene *self, struct Py3dLight *newLightComponent) {
     if (self == NULL || newLightComponent == NULL) return 0;
 
-    appendLightToList(&self->lightList, newLightComponent);
+    addLightSlot(self, newLightComponent);
 
     return 1;
 }
@@ -667,7 +880,7 @@ int Py3dScene_RegisterLight(struct Py3dScene *self, struct Py3dLight *newLightCo
 int Py3dScene_UnRegisterLight(struct Py3dScene *self, const struct Py3dLight *lightComponent) {
     if (self == NULL || lightComponent == NULL) return 0;
 
-    removeLightFromList(&self->lightList, lightComponent);
+    removeLightSlot(self, lightComponent);
 
     return 1;
 }
\ No newline at end of file
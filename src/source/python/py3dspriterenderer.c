@@ -9,6 +9,8 @@
 #include "resources/sprite.h"
 #include "resources/model.h"
 #include "resources/shader.h"
+#include "rendering/render_queue.h"
+#include "rendering/sprite_batch.h"
 
 static PyObject *Py3dSpriteRenderer_Ctor = NULL;
 
@@ -103,6 +105,129 @@ struct Py3dSpriteRenderer *Py3dSpriteRenderer_New() {
     return (struct Py3dSpriteRenderer *) newObj;
 }
 
+// per sprite uniforms are set for every packet, so their handles are resolved once per run
+struct SpriteUniformHandles {
+    int wMtx;
+    int wvpMtx;
+    int texMtx;
+};
+
+static void resolveSpriteUniformHandles(struct Shader *shader, struct SpriteUniformHandles *handles) {
+    handles->texMtx = getShaderUniformHandle(shader, "gTexMtx");
+
+    if (getShaderUniformBlockSize(shader, SHADER_FRAME_BLOCK_BINDING) > 0) {
+        handles->wMtx = getShaderUniformHandle(shader, "gWMtx");
+        handles->wvpMtx = SHADER_INVALID_UNIFORM_HANDLE;
+    } else {
+        handles->wMtx = SHADER_INVALID_UNIFORM_HANDLE;
+        handles->wvpMtx = getShaderUniformHandle(shader, "gWVPMtx");
+    }
+}
+
+static void setSpriteUniforms(
+    struct Py3dSpriteRenderer *self,
+    const struct SpriteUniformHandles *handles,
+    struct Py3dGameObject *owner,
+    struct Py3dRenderingContext *rc
+) {
+    if (handles->wvpMtx != SHADER_INVALID_UNIFORM_HANDLE) {
+        float wvpMtx[16] = {0.0f};
+        Mat4Identity(wvpMtx);
+        Mat4Mult(wvpMtx, Py3dGameObject_GetWorldMatrix(owner), Py3dRenderingContext_GetCameraVPMtx(rc));
+        setShaderMatrixUniformByHandle(self->shader, handles->wvpMtx, wvpMtx, 4);
+    } else {
+        setShaderMatrixUniformByHandle(self->shader, handles->wMtx, Py3dGameObject_GetWorldMatrix(owner), 4);
+    }
+
+    float texMtx[9] = {0.0f};
+    calcSpriteTextureMtx(self->sprite, texMtx);
+    setShaderMatrixUniformByHandle(self->shader, handles->texMtx, texMtx, 3);
+}
+
+// Collapses a run of sprites sharing a sheet into one draw. Quads are transformed on the CPU, so
+// the per object uniforms are reset to identity (or the bare view projection for shaders without
+// the frame block) for the batch. Packets keep their submission order inside the batch
+static bool drawSpriteRunBatched(
+    struct DrawPacket *packets,
+    size_t numPackets,
+    struct RenderQueueState *state,
+    const struct SpriteUniformHandles *handles
+) {
+    struct SpriteBatch *batch = state->sprites;
+    if (batch == NULL) return false;
+
+    beginSpriteBatch(batch, numPackets);
+    for (size_t i = 0; i < numPackets; ++i) {
+        struct Py3dSpriteRenderer *self = (struct Py3dSpriteRenderer *) packets[i].renderer;
+
+        float texMtx[9] = {0.0f};
+        calcSpriteTextureMtx(self->sprite, texMtx);
+        if (!appendSprite(batch, Py3dGameObject_GetWorldMatrix(packets[i].owner), texMtx)) return false;
+    }
+
+    float identity4[16] = {0.0f};
+    float identity3[9] = {0.0f};
+    Mat4Identity(identity4);
+    Mat3Identity(identity3);
+
+    if (handles->wvpMtx != SHADER_INVALID_UNIFORM_HANDLE) {
+        setShaderMatrixUniformByHandle(state->shader, handles->wvpMtx, Py3dRenderingContext_GetCameraVPMtx(state->rc), 4);
+    } else {
+        setShaderMatrixUniformByHandle(state->shader, handles->wMtx, identity4, 4);
+    }
+    setShaderMatrixUniformByHandle(state->shader, handles->texMtx, identity3, 3);
+
+    flushSpriteBatch(batch);
+
+    // the batch drew from its own vertex array, put back the one the queue believes is bound
+    bindModel(state->model);
+
+    return true;
+}
+
+static void drawSpritePacket(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    if (state->shaderChanged) {
+        float mixColor[3] = {1.0f, 1.0f, 1.0f};
+        const GLint spriteUnit = 0;
+        setShaderFloatArrayUniform(state->shader, "gMixColor", mixColor, 3);
+        setShaderIntUniform(state->shader, "gSprite", &spriteUnit, 1);
+    }
+
+    struct SpriteUniformHandles handles;
+    resolveSpriteUniformHandles(state->shader, &handles);
+
+    // a lone sprite is cheaper to draw from the shared quad than to stream
+    if (numPackets > 1 && drawSpriteRunBatched(packets, numPackets, state, &handles)) return;
+
+    for (size_t i = 0; i < numPackets; ++i) {
+        struct Py3dSpriteRenderer *self = (struct Py3dSpriteRenderer *) packets[i].renderer;
+        setSpriteUniforms(self, &handles, packets[i].owner, state->rc);
+        renderModel(self->quad);
+    }
+}
+
+int Py3dSpriteRenderer_Enqueue(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue) {
+    // subclasses may override render, so only the exact builtin type skips python dispatch
+    if (component == NULL || !Py_IS_TYPE(component, &Py3dSpriteRenderer_Type)) return 0;
+
+    struct Py3dSpriteRenderer *self = (struct Py3dSpriteRenderer *) component;
+    if (self->sprite == NULL || self->quad == NULL || self->shader == NULL) return 0;
+
+    pushDrawPacket(
+        queue,
+        DRAW_PACKET_LAYER_SPRITE,
+        self->shader,
+        NULL,
+        getSpriteSheet(self->sprite),
+        self->quad,
+        component,
+        owner,
+        drawSpritePacket
+    );
+
+    return 1;
+}
+
 PyObject *Py3dSpriteRenderer_Render(struct Py3dSpriteRenderer *self, PyObject *args, PyObject *kwds) {
     if (self->sprite == NULL || self->quad == NULL || self->shader == NULL) {
         PyErr_SetString(PyExc_ValueError, "SpriteRendererComponent is not correctly configured");
@@ -121,15 +246,10 @@ PyObject *Py3dSpriteRenderer_Render(struct Py3dSpriteRenderer *self, PyObject *a
     setShaderFloatArrayUniform(self->shader, "gMixColor", mixColor, 3);
     setShaderTextureUniform(self->shader, "gSprite", getSpriteSheet(self->sprite));
 
-    float wvpMtx[16] = {0.0f};
-    Mat4Identity(wvpMtx);
-    Mat4Mult(wvpMtx, Py3dGameObject_GetWorldMatrix(owner), Py3dRenderingContext_GetCameraVPMtx(rc));
+    struct SpriteUniformHandles handles;
+    resolveSpriteUniformHandles(self->shader, &handles);
+    setSpriteUniforms(self, &handles, owner, rc);
     Py_CLEAR(owner);
-    setShaderMatrixUniform(self->shader, "gWVPMtx", wvpMtx, 4);
-
-    float texMtx[9] = {0.0f};
-    calcSpriteTextureMtx(self->sprite, texMtx);
-    setShaderMatrixUniform(self->shader, "gTexMtx", texMtx, 3);
 
     bindModel(self->quad);
     renderModel(self->quad);
@@ -10,15 +10,25 @@
 #include "resources/model.h"
 #include "resources/shader.h"
 #include "resources/texture.h"
+#include "rendering/render_queue.h"
 #include "util.h"
 #include "engine.h"
 
 #define TEXT_JUSTIFY_LEFT 0
 #define TEXT_JUSTIFY_RIGHT 1
 
+// glyphs are 8x16 pixel cells laid out left to right in a single strip of the char map
+#define GLYPH_WIDTH_IN_PIXELS 8
+#define GLYPH_HEIGHT_IN_PIXELS 16
+#define CHAR_MAP_WIDTH_IN_PIXELS 1024.0f
+#define VERTICES_PER_GLYPH 6
+
 struct Py3dTextRenderer {
     PyObject_HEAD
-    struct Model *quad;
+    struct Model *glyphs;
+    bool layoutDirty;
+    int layoutWidth;
+    int layoutHeight;
     struct Shader *shader;
     struct Texture *char_map;
     PyObject *text;
@@ -102,7 +112,10 @@ struct Py3dTextRenderer *Py3dTextRenderer_New() {
 static int Py3dTextRenderer_Init(struct Py3dTextRenderer *self, PyObject *args, PyObject *kwds) {
     if (Py3d_CallSuperInit((PyObject *) self, args, kwds) == -1) return -1;
 
-    self->quad = NULL;
+    self->glyphs = NULL;
+    self->layoutDirty = true;
+    self->layoutWidth = 0;
+    self->layoutHeight = 0;
     self->shader = NULL;
     self->char_map = NULL;
     self->text = Py_NewRef(Py_None);
@@ -124,7 +137,7 @@ static int Py3dTextRenderer_Init(struct Py3dTextRenderer *self, PyObject *args,
 }
 
 static void Py3dTextRenderer_Dealloc(struct Py3dTextRenderer *self) {
-    self->quad = NULL;
+    deleteModel(&self->glyphs);
     self->shader = NULL;
     self->char_map = NULL;
     Py_CLEAR(self->text);
@@ -132,61 +145,55 @@ static void Py3dTextRenderer_Dealloc(struct Py3dTextRenderer *self) {
     Py_TYPE(self)->tp_free((PyObject *) self);
 }
 
-static void calcCharWVPMtx(float out[16], int row, int col, int font_width, int font_height, int justify, int charsUntilLineEnd, float *margin) {
-    int screen_width = 0, screen_height = 0;
-    getRenderingTargetDimensions(&screen_width, &screen_height);
-
-    float quad_width_in_pixels = ((float) screen_width) / 2.0f;
-    float quad_height_in_pixels = ((float) screen_height) / 2.0f;
-    float glyph_width_in_units = ((float) font_width) / quad_width_in_pixels;
-    float glyph_height_in_units = ((float) font_height) / quad_height_in_pixels;
-
-    float margin_top_in_units = margin[0] / (((float) screen_height) / 2.0f);
-    float margin_left_in_units = margin[3] / (((float) screen_width) / 2.0f);
-    float margin_right_in_units = margin[1] / (((float) screen_width) / 2.0f);
-
-    float S[16];
-    Mat4ScalingF(S, glyph_width_in_units, glyph_height_in_units, 1.0f);
+// Screen space glyph size and margins in normalized device coordinates for one viewport size
+struct GlyphMetrics {
+    float glyphWidth;
+    float glyphHeight;
+    float marginTop;
+    float marginLeft;
+    float marginRight;
+};
 
-    float T[16];
-    float x;
-    if (justify == TEXT_JUSTIFY_LEFT) {
-        x = (((float) col) * glyph_width_in_units) + (glyph_width_in_units / 2.0f) - 1.0f + margin_left_in_units;
-    } else if (justify == TEXT_JUSTIFY_RIGHT) {
-        x = 1.0f - (((float) charsUntilLineEnd) * glyph_width_in_units) + (glyph_width_in_units / 2.0f) - margin_right_in_units;
-    }
-    float y = (((float) row * -1) * glyph_height_in_units) - (glyph_height_in_units / 2.0f) + 1.0f - margin_top_in_units;
-    Mat4TranslationF(T, x, y, 0.0f);
+static void calcGlyphMetrics(struct GlyphMetrics *metrics, int screen_width, int screen_height, const float *margin) {
+    const float half_width_in_pixels = ((float) screen_width) / 2.0f;
+    const float half_height_in_pixels = ((float) screen_height) / 2.0f;
 
-    Mat4Mult(out, S, T);
+    metrics->glyphWidth = ((float) GLYPH_WIDTH_IN_PIXELS) / half_width_in_pixels;
+    metrics->glyphHeight = ((float) GLYPH_HEIGHT_IN_PIXELS) / half_height_in_pixels;
+    metrics->marginTop = margin[0] / half_height_in_pixels;
+    metrics->marginRight = margin[1] / half_width_in_pixels;
+    metrics->marginLeft = margin[3] / half_width_in_pixels;
 }
 
-static void calcCharTexMtx(float out[9], char c, int font_width, int font_height) {
-    float glyph_width_in_units = ((float) font_width) / 1024.0f;
-    float glyph_height_in_units = ((float) font_height / 16.0f);
-    int spaces = c - ' ';
-    float offset = ((float) spaces) * glyph_width_in_units;
-
-    out[0] = glyph_width_in_units;
-    out[1] = 0.0f;
-    out[2] = 0.0f;
-
-    out[3] = 0.0f;
-    out[4] = glyph_height_in_units;
-    out[5] = 0.0f;
-
-    out[6] = offset;
-    out[7] = 0.0f;
-    out[8] = 1.0f;
+static void writeGlyphVertex(struct VertexPNT *dst, float x, float y, float u, float v) {
+    dst->position[0] = x;
+    dst->position[1] = y;
+    dst->position[2] = 0.0f;
+    dst->normal[0] = 0.0f;
+    dst->normal[1] = 0.0f;
+    dst->normal[2] = 1.0f;
+    dst->texCoord[0] = u;
+    dst->texCoord[1] = v;
 }
 
-static void advanceCursor(char c, int *col, int *row) {
-    if (c == '\n') {
-        (*col) = 0;
-        (*row)++;
-    } else {
-        (*col)++;
-    }
+// Writes the two triangles of one glyph, already in clip space and with char map coordinates,
+// wound the same way as the builtin quad
+static void writeGlyphQuad(struct VertexPNT *dst, float centerX, float centerY, const struct GlyphMetrics *metrics, char c) {
+    const float halfWidth = metrics->glyphWidth / 2.0f;
+    const float halfHeight = metrics->glyphHeight / 2.0f;
+    const float left = centerX - halfWidth, right = centerX + halfWidth;
+    const float top = centerY + halfHeight, bottom = centerY - halfHeight;
+
+    const float glyph_width_in_units = ((float) GLYPH_WIDTH_IN_PIXELS) / CHAR_MAP_WIDTH_IN_PIXELS;
+    const float u0 = ((float) (c - ' ')) * glyph_width_in_units;
+    const float u1 = u0 + glyph_width_in_units;
+
+    writeGlyphVertex(&dst[0], left, top, u0, 0.0f);
+    writeGlyphVertex(&dst[1], left, bottom, u0, 1.0f);
+    writeGlyphVertex(&dst[2], right, bottom, u1, 1.0f);
+    writeGlyphVertex(&dst[3], right, bottom, u1, 1.0f);
+    writeGlyphVertex(&dst[4], right, top, u1, 0.0f);
+    writeGlyphVertex(&dst[5], left, top, u0, 0.0f);
 }
 
 static int countCharsUntilLineEnd(const char *curChar) {
@@ -200,51 +207,158 @@ static int countCharsUntilLineEnd(const char *curChar) {
     return charCount;
 }
 
-PyObject *Py3dTextRenderer_Render(struct Py3dTextRenderer *self, PyObject *args, PyObject *kwds) {
-    if (self->quad == NULL || self->shader == NULL || self->char_map == NULL) {
-        PyErr_SetString(PyExc_ValueError, "TextRendererComponent is not correctly configured");
-        return NULL;
+// Rebuilds the glyph vertex buffer. Line lengths are measured once at the start of each line,
+// so laying out right justified text stays linear in its length
+static void layoutText(struct Py3dTextRenderer *self, int screen_width, int screen_height) {
+    Py_ssize_t textLen = 0;
+    const char *text = PyUnicode_AsUTF8AndSize(self->text, &textLen);
+    if (text == NULL) {
+        handleException();
+        return;
     }
 
-    if (Py_IsNone(self->text)) {
-        Py_RETURN_NONE;
+    size_t numGlyphs = 0;
+    for (Py_ssize_t i = 0; i < textLen; ++i) {
+        if (isprint(text[i])) ++numGlyphs;
     }
 
-    struct Py3dRenderingContext *rc = NULL;
-    if (PyArg_ParseTuple(args, "O!", &Py3dRenderingContext_Type, &rc) != 1) return NULL;
+    struct VertexPNT *vertices = NULL;
+    if (numGlyphs > 0) {
+        vertices = calloc(numGlyphs * VERTICES_PER_GLYPH, sizeof(struct VertexPNT));
+        if (vertices == NULL) {
+            critical_log("%s", "[TextRendererComponent]: Could not allocate glyph vertices");
+            return;
+        }
+    }
 
-    enableShader(self->shader);
+    struct GlyphMetrics metrics;
+    calcGlyphMetrics(&metrics, screen_width, screen_height, self->margin);
+
+    size_t curGlyph = 0;
+    int col = 0, row = 0, lineLength = 0;
+    for (Py_ssize_t i = 0; i < textLen; ++i) {
+        const char curChar = text[i];
+        if (col == 0) {
+            lineLength = countCharsUntilLineEnd(&text[i]);
+        }
+
+        if (isprint(curChar)) {
+            float x = 0.0f;
+            if (self->text_justify == TEXT_JUSTIFY_RIGHT) {
+                const int charsUntilLineEnd = lineLength - col;
+                x = 1.0f - (((float) charsUntilLineEnd) * metrics.glyphWidth) + (metrics.glyphWidth / 2.0f) - metrics.marginRight;
+            } else {
+                x = (((float) col) * metrics.glyphWidth) + (metrics.glyphWidth / 2.0f) - 1.0f + metrics.marginLeft;
+            }
+            const float y = (((float) row * -1) * metrics.glyphHeight) - (metrics.glyphHeight / 2.0f) + 1.0f - metrics.marginTop;
+
+            writeGlyphQuad(&vertices[curGlyph * VERTICES_PER_GLYPH], x, y, &metrics, curChar);
+            ++curGlyph;
+        }
+
+        if (curChar == '\n') {
+            col = 0;
+            row++;
+        } else {
+            col++;
+        }
+    }
+
+    updateModelPNTBuffer(self->glyphs, vertices, numGlyphs * VERTICES_PER_GLYPH);
+    free(vertices);
+    vertices = NULL;
+
+    self->layoutDirty = false;
+    self->layoutWidth = screen_width;
+    self->layoutHeight = screen_height;
+}
+
+// Lays the text out again only if it, its justification, its margin or the viewport changed.
+// Returns false when there is nothing to draw
+static bool ensureTextLayout(struct Py3dTextRenderer *self) {
+    if (Py_IsNone(self->text)) return false;
 
+    if (self->glyphs == NULL) {
+        allocModel(&self->glyphs);
+        if (self->glyphs == NULL) return false;
+    }
+
+    int screen_width = 0, screen_height = 0;
+    getRenderingTargetDimensions(&screen_width, &screen_height);
+    if (screen_width <= 0 || screen_height <= 0) return false;
+
+    if (self->layoutDirty || screen_width != self->layoutWidth || screen_height != self->layoutHeight) {
+        layoutText(self, screen_width, screen_height);
+    }
+
+    return self->glyphs->_sizeInVertices > 0;
+}
+
+static void setTextUniforms(struct Py3dTextRenderer *self) {
     setShaderFloatArrayUniform(self->shader, "gMixColor", self->color, 3);
     setShaderFloatArrayUniform(self->shader, "gBackgroundColor", self->background, 4);
-    setShaderTextureUniform(self->shader, "gSprite", self->char_map);
+}
 
-    bindModel(self->quad);
+static void drawTextPacket(struct DrawPacket *packets, size_t numPackets, struct RenderQueueState *state) {
+    if (state->shaderChanged) {
+        const GLint charMapUnit = 0;
+        setShaderIntUniform(state->shader, "gSprite", &charMapUnit, 1);
+    }
 
-    float wvpMtx[16];
-    float texMtx[9];
-    int col = 0, row = 0;
+    // every text component owns its glyph buffer, packets in a run only share it if they are the same component
+    for (size_t i = 0; i < numPackets; ++i) {
+        struct Py3dTextRenderer *self = (struct Py3dTextRenderer *) packets[i].renderer;
+        setTextUniforms(self);
+        renderModel(state->model);
+    }
+}
 
-    Py_ssize_t textLen = 0;
-    const char *text = PyUnicode_AsUTF8AndSize(self->text, &textLen);
+int Py3dTextRenderer_Enqueue(PyObject *component, struct Py3dGameObject *owner, struct RenderQueue *queue) {
+    // subclasses may override render, so only the exact builtin type skips python dispatch
+    if (component == NULL || !Py_IS_TYPE(component, &Py3dTextRenderer_Type)) return 0;
 
-    for (Py_ssize_t i = 0; i < textLen; ++i) {
-        const char curChar = text[i];
-        int charsUntilLineEnd = countCharsUntilLineEnd(&text[i]);
+    struct Py3dTextRenderer *self = (struct Py3dTextRenderer *) component;
+    if (self->shader == NULL || self->char_map == NULL) return 0;
 
-        if (isprint(curChar)) {
-            calcCharWVPMtx(wvpMtx, row, col, 8, 16, self->text_justify, charsUntilLineEnd, self->margin);
-            setShaderMatrixUniform(self->shader, "gWVPMtx", wvpMtx, 4);
+    // nothing to draw, but the component was still handled natively
+    if (!ensureTextLayout(self)) return 1;
 
-            calcCharTexMtx(texMtx, curChar, 8, 16);
-            setShaderMatrixUniform(self->shader, "gTexMtx", texMtx, 3);
+    pushDrawPacket(
+        queue,
+        DRAW_PACKET_LAYER_TEXT,
+        self->shader,
+        NULL,
+        self->char_map,
+        self->glyphs,
+        component,
+        owner,
+        drawTextPacket
+    );
 
-            renderModel(self->quad);
-        }
-        advanceCursor(curChar, &col, &row);
+    return 1;
+}
+
+PyObject *Py3dTextRenderer_Render(struct Py3dTextRenderer *self, PyObject *args, PyObject *kwds) {
+    if (self->shader == NULL || self->char_map == NULL) {
+        PyErr_SetString(PyExc_ValueError, "TextRendererComponent is not correctly configured");
+        return NULL;
+    }
+
+    struct Py3dRenderingContext *rc = NULL;
+    if (PyArg_ParseTuple(args, "O!", &Py3dRenderingContext_Type, &rc) != 1) return NULL;
+
+    if (!ensureTextLayout(self)) {
+        Py_RETURN_NONE;
     }
 
-    unbindModel(self->quad);
+    enableShader(self->shader);
+
+    setTextUniforms(self);
+    setShaderTextureUniform(self->shader, "gSprite", self->char_map);
+
+    bindModel(self->glyphs);
+    renderModel(self->glyphs);
+    unbindModel(self->glyphs);
 
     disableShader(self->shader);
 
@@ -261,17 +375,9 @@ PyObject *Py3dTextRenderer_Parse(struct Py3dTextRenderer *self, PyObject *args,
     if (PyArg_ParseTuple(args, "O!O!", &PyDict_Type, &parseDataDict, &Py3dResourceManager_Type, &py3dResourceManager) != 1) return NULL;
 
     struct BaseResource *curRes = NULL;
-    curRes = Py3dResourceManager_GetResource(py3dResourceManager, "QuadModelBuiltIn");
-    if (!isResourceTypeModel(curRes)) {
-        PyErr_SetString(PyExc_ValueError, "Could not find Quad Model Built In resource");
-        return NULL;
-    }
-    self->quad = (struct Model *) curRes;
-    curRes = NULL;
-
-    curRes = Py3dResourceManager_GetResource(py3dResourceManager, "SpriteShaderBuiltIn");
+    curRes = Py3dResourceManager_GetResource(py3dResourceManager, "TextShaderBuiltIn");
     if (!isResourceTypeShader(curRes)) {
-        PyErr_SetString(PyExc_ValueError, "Could not find Sprite Shader Built In resource");
+        PyErr_SetString(PyExc_ValueError, "Could not find Text Shader Built In resource");
         return NULL;
     }
     self->shader = (struct Shader *) curRes;
@@ -339,6 +445,7 @@ PyObject *Py3dTextRenderer_SetText(struct Py3dTextRenderer *self, PyObject *args
 
     Py_CLEAR(self->text);
     self->text = textArgAsStr;
+    self->layoutDirty = true;
 
     Py_RETURN_NONE;
 }
@@ -367,6 +474,7 @@ PyObject *Py3dTextRenderer_SetTextJustify(struct Py3dTextRenderer *self, PyObjec
         PyErr_Format(PyExc_ValueError, "Unknown text justification mode \"%s\"", newMode);
         return NULL;
     }
+    self->layoutDirty = true;
 
     Py_RETURN_NONE;
 }
@@ -391,6 +499,7 @@ PyObject *Py3dTextRenderer_SetMargin(struct Py3dTextRenderer *self, PyObject *ar
     self->margin[1] = r;
     self->margin[2] = b;
     self->margin[3] = l;
+    self->layoutDirty = true;
 
     Py_RETURN_NONE;
 }
@@ -9,6 +9,7 @@
 #include "math/vector3.h"
 #include "math/quaternion.h"
 #include "python/py3dlight.h"
+#include "python/py3dcamera.h"
 
 static PyObject *convertToPyString(PyObject *obj) {
     PyObject *ret = PyObject_Str(obj);
@@ -48,6 +49,7 @@ static PyObject *interesting_types[] = {
     (PyObject *) &Py3dQuaternion_Type,
     (PyObject *) &Py3dScene_Type,
     (PyObject *) &Py3dLight_Type,
+    (PyObject *) &Py3dCamera_Type,
 };
 
 static bool isObjectInteresting(PyObject *obj) {
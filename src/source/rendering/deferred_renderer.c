@@ -0,0 +1,528 @@
+#include <glad/gl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lights.h"
+#include "logger.h"
+#include "util.h"
+#include "python/py3drenderingcontext.h"
+#include "rendering/deferred_renderer.h"
+#include "rendering/gl_state.h"
+#include "rendering/light_clusters.h"
+#include "resources/shader.h"
+
+// Every deferred shader sticks to GL 4.5 core so Mesa's software rasteriser can run it
+#define DEFERRED_FRAME_BLOCK \
+"layout(std140, row_major) uniform FrameBlock {\n" \
+"   mat4 gViewMtx;\n" \
+"   mat4 gProjMtx;\n" \
+"   mat4 gVPMtx;\n" \
+"   vec3 gCamPosW;\n" \
+"   float gTime;\n" \
+"   vec2 gViewportSize;\n" \
+"};\n"
+
+static const char *geometryVertexShader =
+"#version 450 core\n"
+"\n"
+"layout(location = 0) in vec3 posL;\n"
+"layout(location = 1) in vec3 normalL;\n"
+"layout(location = 2) in vec2 inTexC;\n"
+"\n"
+DEFERRED_FRAME_BLOCK
+"\n"
+"uniform mat4 gWMtx;\n"
+"uniform mat4 gWITMtx;\n"
+"\n"
+"out vec3 posW;\n"
+"out vec3 normalW;\n"
+"out vec2 texCoord;\n"
+"\n"
+"void main() {\n"
+"   vec4 world = vec4(posL, 1.0) * gWMtx;\n"
+"   posW = world.xyz;\n"
+"   normalW = (vec4(normalL, 0.0) * gWITMtx).xyz;\n"
+"   texCoord = inTexC;\n"
+"   gl_Position = world * gVPMtx;\n"
+"}\n";
+
+static const char *instancedGeometryVertexShader =
+"#version 450 core\n"
+"\n"
+"layout(location = 0) in vec3 posL;\n"
+"layout(location = 1) in vec3 normalL;\n"
+"layout(location = 2) in vec2 inTexC;\n"
+"layout(location = 3) in mat4 instWMtx;\n"
+"layout(location = 7) in mat4 instWITMtx;\n"
+"\n"
+DEFERRED_FRAME_BLOCK
+"\n"
+"out vec3 posW;\n"
+"out vec3 normalW;\n"
+"out vec2 texCoord;\n"
+"\n"
+"void main() {\n"
+"   vec4 world = vec4(posL, 1.0) * instWMtx;\n"
+"   posW = world.xyz;\n"
+"   normalW = (vec4(normalL, 0.0) * instWITMtx).xyz;\n"
+"   texCoord = inTexC;\n"
+"   gl_Position = world * gVPMtx;\n"
+"}\n";
+
+static const char *geometryFragShader =
+"#version 450 core\n"
+"\n"
+"struct Material {\n"
+"   sampler2D diffuse;\n"
+"   vec3 ambient;\n"
+"   vec3 specular;\n"
+"   float specPower;\n"
+"};\n"
+"\n"
+"uniform Material gMaterial;\n"
+"\n"
+"in vec3 posW;\n"
+"in vec3 normalW;\n"
+"in vec2 texCoord;\n"
+"\n"
+"layout(location = 0) out vec4 outPosition;\n"
+"layout(location = 1) out vec4 outNormal;\n"
+"layout(location = 2) out vec4 outDiffuse;\n"
+"layout(location = 3) out vec4 outSpecular;\n"
+"layout(location = 4) out vec4 outAmbient;\n"
+"\n"
+"void main() {\n"
+"   outPosition = vec4(posW, 1.0);\n"
+"   outNormal = vec4(normalize(normalW), gMaterial.specPower);\n"
+"   outDiffuse = vec4(texture(gMaterial.diffuse, texCoord).rgb, 1.0);\n"
+"   outSpecular = vec4(gMaterial.specular, 1.0);\n"
+"   outAmbient = vec4(gMaterial.ambient, 1.0);\n"
+"}\n";
+
+// a single triangle covering the screen, lights narrow it down with the scissor rectangle
+static const char *screenVertexShader =
+"#version 450 core\n"
+"\n"
+"out vec2 screenUV;\n"
+"\n"
+"void main() {\n"
+"   screenUV = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));\n"
+"   gl_Position = vec4(screenUV * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+static const char *ambientFragShader =
+"#version 450 core\n"
+"\n"
+"uniform sampler2D gPositionMap;\n"
+"uniform sampler2D gDiffuseMap;\n"
+"uniform sampler2D gAmbientMap;\n"
+"uniform sampler2D gDepthMap;\n"
+"uniform vec3 gAmbientLight;\n"
+"\n"
+"in vec2 screenUV;\n"
+"\n"
+"layout(location = 0) out vec4 outputColor;\n"
+"\n"
+"void main() {\n"
+"   if (texture(gPositionMap, screenUV).a < 0.5) discard;\n"
+"\n"
+"   gl_FragDepth = texture(gDepthMap, screenUV).r;\n"
+"   outputColor = vec4(gAmbientLight * texture(gAmbientMap, screenUV).rgb * texture(gDiffuseMap, screenUV).rgb, 1.0);\n"
+"}\n";
+
+static const char *lightFragShader =
+"#version 450 core\n"
+"\n"
+DEFERRED_FRAME_BLOCK
+"\n"
+"struct Light {\n"
+"   vec3 position;\n"
+"   vec3 diffuse;\n"
+"   vec3 specular;\n"
+"   float intensity;\n"
+"   vec3 attenuation;\n"
+"};\n"
+"\n"
+"uniform Light gLight;\n"
+"uniform sampler2D gPositionMap;\n"
+"uniform sampler2D gNormalMap;\n"
+"uniform sampler2D gDiffuseMap;\n"
+"uniform sampler2D gSpecularMap;\n"
+"uniform sampler2D gDepthMap;\n"
+"\n"
+"in vec2 screenUV;\n"
+"\n"
+"layout(location = 0) out vec4 outputColor;\n"
+"\n"
+"void main() {\n"
+"   vec4 posW = texture(gPositionMap, screenUV);\n"
+"   if (posW.a < 0.5) discard;\n"
+"\n"
+"   gl_FragDepth = texture(gDepthMap, screenUV).r;\n"
+"\n"
+"   vec4 normalSpec = texture(gNormalMap, screenUV);\n"
+"   vec3 normal = normalize(normalSpec.xyz);\n"
+"   vec3 toLight = gLight.position - posW.xyz;\n"
+"   float dist = length(toLight);\n"
+"   vec3 lightDir = toLight / max(dist, 0.0001);\n"
+"   float falloff = gLight.attenuation.x + gLight.attenuation.y * dist + gLight.attenuation.z * dist * dist;\n"
+"   float attenuation = gLight.intensity / max(falloff, 0.0001);\n"
+"\n"
+"   vec3 diffuse = gLight.diffuse * texture(gDiffuseMap, screenUV).rgb * max(dot(normal, lightDir), 0.0);\n"
+"   vec3 reflected = reflect(-lightDir, normal);\n"
+"   vec3 toEye = normalize(gCamPosW - posW.xyz);\n"
+"   float specFactor = pow(max(dot(reflected, toEye), 0.0), max(normalSpec.a, 1.0));\n"
+"   vec3 specular = gLight.specular * texture(gSpecularMap, screenUV).rgb * specFactor;\n"
+"\n"
+"   outputColor = vec4((diffuse + specular) * attenuation, 1.0);\n"
+"}\n";
+
+#define LIGHT_UNIFORM_POSITION 0
+#define LIGHT_UNIFORM_DIFFUSE 1
+#define LIGHT_UNIFORM_SPECULAR 2
+#define LIGHT_UNIFORM_INTENSITY 3
+#define LIGHT_UNIFORM_ATTENUATION 4
+
+static const char *lightUniformNames[DEFERRED_NUM_LIGHT_UNIFORMS] = {
+    "gLight.position",
+    "gLight.diffuse",
+    "gLight.specular",
+    "gLight.intensity",
+    "gLight.attenuation",
+};
+
+static const GLenum colorTargetFormats[GBUFFER_NUM_COLOR_TARGETS] = {
+    GL_RGBA32F,
+    GL_RGBA16F,
+    GL_RGBA8,
+    GL_RGBA8,
+    GL_RGBA8,
+};
+
+static const char *samplerNames[GBUFFER_NUM_COLOR_TARGETS + 1] = {
+    "gPositionMap",
+    "gNormalMap",
+    "gDiffuseMap",
+    "gSpecularMap",
+    "gAmbientMap",
+    "gDepthMap",
+};
+
+static struct Shader *createDeferredShader(const char *vertexShaderSource, const char *fragShaderSource) {
+    struct Shader *shader = NULL;
+    allocShader(&shader);
+    if (shader == NULL) return NULL;
+
+    initShader(shader, vertexShaderSource, fragShaderSource);
+    if (shader->_program == 0) {
+        deleteShader(&shader);
+        return NULL;
+    }
+
+    return shader;
+}
+
+// samplers always read the same units, so they are assigned once when the program is created
+static void assignGBufferSamplers(struct Shader *shader) {
+    enableShader(shader);
+    for (GLint unit = 0; unit <= GBUFFER_DEPTH_UNIT; ++unit) {
+        int handle = getShaderUniformHandle(shader, samplerNames[unit]);
+        if (handle == SHADER_INVALID_UNIFORM_HANDLE) continue;
+
+        setShaderIntUniformByHandle(shader, handle, &unit, 1);
+    }
+}
+
+static void deleteGBufferTargets(struct DeferredRenderer *renderer) {
+    for (int i = 0; i < GBUFFER_NUM_COLOR_TARGETS; ++i) {
+        if (renderer->_colorTargets[i] == 0) continue;
+
+        forgetGLTexture2D(renderer->_colorTargets[i]);
+        glDeleteTextures(1, &renderer->_colorTargets[i]);
+        renderer->_colorTargets[i] = 0;
+    }
+
+    if (renderer->_depthTarget != 0) {
+        forgetGLTexture2D(renderer->_depthTarget);
+        glDeleteTextures(1, &renderer->_depthTarget);
+        renderer->_depthTarget = 0;
+    }
+
+    if (renderer->_fbo != 0) {
+        glDeleteFramebuffers(1, &renderer->_fbo);
+        renderer->_fbo = 0;
+    }
+
+    renderer->_width = 0;
+    renderer->_height = 0;
+}
+
+static GLuint createGBufferTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    if (texture == 0) return 0;
+
+    bindGLTexture2D(0, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, (GLint) internalFormat, width, height, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    bindGLTexture2D(0, 0);
+
+    return texture;
+}
+
+static bool resizeGBuffer(struct DeferredRenderer *renderer, int width, int height) {
+    if (renderer->_fbo != 0 && renderer->_width == width && renderer->_height == height) return true;
+
+    deleteGBufferTargets(renderer);
+
+    glGenFramebuffers(1, &renderer->_fbo);
+    if (renderer->_fbo == 0) {
+        error_log("%s", "[DeferredRenderer]: OpenGL could not allocate G-buffer framebuffer");
+        return false;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->_fbo);
+
+    GLenum drawBuffers[GBUFFER_NUM_COLOR_TARGETS];
+    for (int i = 0; i < GBUFFER_NUM_COLOR_TARGETS; ++i) {
+        renderer->_colorTargets[i] = createGBufferTarget(colorTargetFormats[i], GL_RGBA, GL_FLOAT, width, height);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, renderer->_colorTargets[i], 0);
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    glDrawBuffers(GBUFFER_NUM_COLOR_TARGETS, drawBuffers);
+
+    renderer->_depthTarget = createGBufferTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, renderer->_depthTarget, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        error_log("[DeferredRenderer]: G-buffer framebuffer is incomplete, status \"%d\"", status);
+        deleteGBufferTargets(renderer);
+        return false;
+    }
+
+    renderer->_width = width;
+    renderer->_height = height;
+    trace_log("[DeferredRenderer]: Resized G-buffer to %dx%d", width, height);
+
+    return true;
+}
+
+static void bindGBufferTextures(struct DeferredRenderer *renderer) {
+    for (unsigned int i = 0; i < GBUFFER_NUM_COLOR_TARGETS; ++i) {
+        bindGLTexture2D(i, renderer->_colorTargets[i]);
+    }
+    bindGLTexture2D(GBUFFER_DEPTH_UNIT, renderer->_depthTarget);
+}
+
+void allocDeferredRenderer(struct DeferredRenderer **rendererPtr) {
+    if (rendererPtr == NULL || (*rendererPtr) != NULL) return;
+
+    struct DeferredRenderer *newRenderer = calloc(1, sizeof(struct DeferredRenderer));
+    if (newRenderer == NULL) return;
+
+    newRenderer->_fbo = 0;
+    memset(newRenderer->_colorTargets, 0, sizeof(newRenderer->_colorTargets));
+    newRenderer->_depthTarget = 0;
+    newRenderer->_width = 0;
+    newRenderer->_height = 0;
+
+    glGenVertexArrays(1, &newRenderer->_screenVao);
+
+    newRenderer->_geometryShader = createDeferredShader(geometryVertexShader, geometryFragShader);
+    newRenderer->_ambientShader = createDeferredShader(screenVertexShader, ambientFragShader);
+    newRenderer->_lightShader = createDeferredShader(screenVertexShader, lightFragShader);
+    if (
+        newRenderer->_screenVao == 0 ||
+        newRenderer->_geometryShader == NULL ||
+        newRenderer->_ambientShader == NULL ||
+        newRenderer->_lightShader == NULL
+    ) {
+        error_log("%s", "[DeferredRenderer]: Could not create deferred shading resources");
+        deleteDeferredRenderer(&newRenderer);
+        return;
+    }
+
+    // the instanced variant is optional, without it runs of the same model are drawn one by one
+    setShaderInstancedVariant(
+        newRenderer->_geometryShader,
+        createDeferredShader(instancedGeometryVertexShader, geometryFragShader)
+    );
+
+    assignGBufferSamplers(newRenderer->_ambientShader);
+    assignGBufferSamplers(newRenderer->_lightShader);
+    for (int i = 0; i < DEFERRED_NUM_LIGHT_UNIFORMS; ++i) {
+        newRenderer->_lightUniforms[i] = getShaderUniformHandle(newRenderer->_lightShader, lightUniformNames[i]);
+    }
+
+    (*rendererPtr) = newRenderer;
+    newRenderer = NULL;
+}
+
+void deleteDeferredRenderer(struct DeferredRenderer **rendererPtr) {
+    if (rendererPtr == NULL || (*rendererPtr) == NULL) return;
+
+    struct DeferredRenderer *renderer = (*rendererPtr);
+    deleteGBufferTargets(renderer);
+
+    if (renderer->_screenVao != 0) {
+        forgetGLVertexArray(renderer->_screenVao);
+        glDeleteVertexArrays(1, &renderer->_screenVao);
+        renderer->_screenVao = 0;
+    }
+
+    deleteShader(&renderer->_geometryShader);
+    deleteShader(&renderer->_ambientShader);
+    deleteShader(&renderer->_lightShader);
+
+    free(renderer);
+    renderer = NULL;
+    (*rendererPtr) = NULL;
+}
+
+struct Shader *getDeferredGeometryShader(struct DeferredRenderer *renderer) {
+    if (renderer == NULL) return NULL;
+
+    return renderer->_geometryShader;
+}
+
+bool prepareDeferredGeometryPass(struct DeferredRenderer *renderer, int width, int height) {
+    if (renderer == NULL || width <= 0 || height <= 0) return false;
+
+    return resizeGBuffer(renderer, width, height);
+}
+
+void beginDeferredGeometryPass(struct DeferredRenderer *renderer) {
+    if (renderer == NULL || renderer->_fbo == 0) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->_fbo);
+
+    // a cleared position alpha marks pixels without geometry for the lighting passes
+    const GLfloat noGeometry[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (GLint i = 0; i < GBUFFER_NUM_COLOR_TARGETS; ++i) {
+        glClearBufferfv(GL_COLOR, i, noGeometry);
+    }
+    const GLfloat farDepth = 1.0f;
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+}
+
+void endDeferredGeometryPass(struct DeferredRenderer *renderer) {
+    if (renderer == NULL) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void setLightScissor(
+    struct DeferredRenderer *renderer,
+    const struct LightData *light,
+    const struct FrameData *frameData,
+    float nearZ,
+    float farZ,
+    bool *visible
+) {
+    (*visible) = true;
+
+    float range = calcLightInfluenceRange(light);
+    if (range == 0.0f) {
+        (*visible) = false;
+        return;
+    }
+
+    // lights that never fade out cover the whole screen
+    if (range < 0.0f) {
+        glScissor(0, 0, renderer->_width, renderer->_height);
+        return;
+    }
+
+    float worldPos[4] = {light->position[0], light->position[1], light->position[2], 1.0f};
+    float viewPos[4] = {0.0f};
+    Mat4Vec4Mult((float *) frameData->viewMtx, worldPos, viewPos);
+
+    float ndcMin[2], ndcMax[2], depthRange[2];
+    if (!calcLightScreenBounds(viewPos, range, frameData->projMtx, nearZ, farZ, ndcMin, ndcMax, depthRange)) {
+        (*visible) = false;
+        return;
+    }
+
+    int x0 = (int) ((ndcMin[0] * 0.5f + 0.5f) * renderer->_width);
+    int y0 = (int) ((ndcMin[1] * 0.5f + 0.5f) * renderer->_height);
+    int x1 = (int) ((ndcMax[0] * 0.5f + 0.5f) * renderer->_width) + 1;
+    int y1 = (int) ((ndcMax[1] * 0.5f + 0.5f) * renderer->_height) + 1;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > renderer->_width) x1 = renderer->_width;
+    if (y1 > renderer->_height) y1 = renderer->_height;
+
+    if (x1 <= x0 || y1 <= y0) {
+        (*visible) = false;
+        return;
+    }
+
+    glScissor(x0, y0, x1 - x0, y1 - y0);
+}
+
+static void drawLightVolume(struct DeferredRenderer *renderer, const struct LightData *light) {
+    struct Shader *shader = renderer->_lightShader;
+    const int *handles = renderer->_lightUniforms;
+
+    setShaderFloatArrayUniformByHandle(shader, handles[LIGHT_UNIFORM_POSITION], light->position, 3);
+    setShaderFloatArrayUniformByHandle(shader, handles[LIGHT_UNIFORM_DIFFUSE], light->diffuse, 3);
+    setShaderFloatArrayUniformByHandle(shader, handles[LIGHT_UNIFORM_SPECULAR], light->specular, 3);
+    setShaderFloatArrayUniformByHandle(shader, handles[LIGHT_UNIFORM_INTENSITY], &light->intensity, 1);
+    setShaderFloatArrayUniformByHandle(shader, handles[LIGHT_UNIFORM_ATTENUATION], light->attenuation, 3);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void drawDeferredLighting(
+    struct DeferredRenderer *renderer,
+    const struct LightData *lights,
+    size_t numLights,
+    const struct FrameData *frameData,
+    float nearZ,
+    float farZ
+) {
+    if (renderer == NULL || renderer->_fbo == 0 || frameData == NULL) return;
+
+    bindGBufferTextures(renderer);
+    bindGLVertexArray(renderer->_screenVao);
+
+    // the ambient pass also copies the G-buffer depth into the window, so python components that drew
+    // straight to the screen while the queue was filled keep occluding, and later layers depth test as usual
+    float ambientLight[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < numLights; ++i) {
+        if (!lights[i].used || !lights[i].enabled) continue;
+
+        Vec3Add(ambientLight, ambientLight, lights[i].ambient);
+    }
+
+    enableShader(renderer->_ambientShader);
+    setShaderFloatArrayUniform(renderer->_ambientShader, "gAmbientLight", ambientLight, 3);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // lights add on top of the ambient term without touching depth
+    enableShader(renderer->_lightShader);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_SCISSOR_TEST);
+
+    for (size_t i = 0; i < numLights; ++i) {
+        if (!lights[i].used || !lights[i].enabled) continue;
+
+        bool visible = false;
+        setLightScissor(renderer, &lights[i], frameData, nearZ, farZ, &visible);
+        if (!visible) continue;
+
+        drawLightVolume(renderer, &lights[i]);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+}
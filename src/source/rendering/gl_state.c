@@ -0,0 +1,124 @@
+#include <glad/gl.h>
+#include <string.h>
+
+#include "logger.h"
+#include "rendering/gl_state.h"
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu
+
+static unsigned int curProgram = GL_STATE_UNKNOWN;
+static unsigned int curVertexArray = GL_STATE_UNKNOWN;
+static unsigned int curActiveUnit = GL_STATE_UNKNOWN;
+static unsigned int curTextures[GL_STATE_MAX_TEXTURE_UNITS] = {
+    GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN,
+    GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN,
+    GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN,
+    GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN,
+};
+
+static struct GLStateCounters frameCounters = {0};
+static struct GLStateCounters lastFrameCounters = {0};
+
+static void setActiveTextureUnit(unsigned int unit) {
+    if (curActiveUnit == unit) {
+        frameCounters.activeTextureChangesAvoided++;
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    curActiveUnit = unit;
+    frameCounters.activeTextureChanges++;
+}
+
+void useGLProgram(unsigned int program) {
+    if (curProgram == program) {
+        frameCounters.programBindsAvoided++;
+        return;
+    }
+
+    glUseProgram(program);
+    curProgram = program;
+    frameCounters.programBinds++;
+}
+
+void bindGLVertexArray(unsigned int vao) {
+    if (curVertexArray == vao) {
+        frameCounters.vertexArrayBindsAvoided++;
+        return;
+    }
+
+    glBindVertexArray(vao);
+    curVertexArray = vao;
+    frameCounters.vertexArrayBinds++;
+}
+
+void bindGLTexture2D(unsigned int unit, unsigned int texture) {
+    // units past the tracked range are always bound, they are rare enough not to matter
+    if (unit >= GL_STATE_MAX_TEXTURE_UNITS) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        curActiveUnit = unit;
+        frameCounters.textureBinds++;
+        return;
+    }
+
+    if (curTextures[unit] == texture) {
+        frameCounters.textureBindsAvoided++;
+        return;
+    }
+
+    setActiveTextureUnit(unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    curTextures[unit] = texture;
+    frameCounters.textureBinds++;
+}
+
+void forgetGLProgram(unsigned int program) {
+    if (curProgram == program) {
+        curProgram = GL_STATE_UNKNOWN;
+    }
+}
+
+void forgetGLVertexArray(unsigned int vao) {
+    if (curVertexArray == vao) {
+        curVertexArray = GL_STATE_UNKNOWN;
+    }
+}
+
+void forgetGLTexture2D(unsigned int texture) {
+    for (unsigned int unit = 0; unit < GL_STATE_MAX_TEXTURE_UNITS; ++unit) {
+        if (curTextures[unit] == texture) {
+            curTextures[unit] = GL_STATE_UNKNOWN;
+        }
+    }
+}
+
+void invalidateGLStateCache() {
+    curProgram = GL_STATE_UNKNOWN;
+    curVertexArray = GL_STATE_UNKNOWN;
+    curActiveUnit = GL_STATE_UNKNOWN;
+    for (unsigned int unit = 0; unit < GL_STATE_MAX_TEXTURE_UNITS; ++unit) {
+        curTextures[unit] = GL_STATE_UNKNOWN;
+    }
+}
+
+void endGLStateFrame() {
+    lastFrameCounters = frameCounters;
+    memset(&frameCounters, 0, sizeof(struct GLStateCounters));
+}
+
+void getGLStateLastFrameCounters(struct GLStateCounters *dst) {
+    if (dst == NULL) return;
+
+    (*dst) = lastFrameCounters;
+}
+
+#ifdef PY3D_GL_DEBUG
+void checkGLError(const char *what) {
+    GLenum error = glGetError();
+    while (error != GL_NO_ERROR) {
+        warning_log("[GLState]: OpenGL raised error 0x%x while %s", error, what);
+        error = glGetError();
+    }
+}
+#endif
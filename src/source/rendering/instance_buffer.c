@@ -0,0 +1,106 @@
+#include <glad/gl.h>
+#include <stdlib.h>
+
+#include "logger.h"
+#include "util.h"
+#include "rendering/instance_buffer.h"
+
+static bool reserveInstances(struct InstanceBuffer *buffer, size_t maxInstances) {
+    if (maxInstances <= buffer->_capacity) return true;
+
+    struct InstanceData *newInstances = realloc(buffer->_instances, maxInstances * sizeof(struct InstanceData));
+    if (newInstances == NULL) {
+        critical_log("%s", "[InstanceBuffer]: Could not grow instance buffer");
+        return false;
+    }
+
+    buffer->_instances = newInstances;
+    buffer->_capacity = maxInstances;
+
+    return true;
+}
+
+void allocInstanceBuffer(struct InstanceBuffer **bufferPtr) {
+    if (bufferPtr == NULL || (*bufferPtr) != NULL) return;
+
+    struct InstanceBuffer *newBuffer = calloc(1, sizeof(struct InstanceBuffer));
+    if (newBuffer == NULL) return;
+
+    newBuffer->_vbo = 0;
+    newBuffer->_gpuCapacity = 0;
+    newBuffer->_instances = NULL;
+    newBuffer->_numInstances = 0;
+    newBuffer->_capacity = 0;
+
+    (*bufferPtr) = newBuffer;
+    newBuffer = NULL;
+}
+
+void deleteInstanceBuffer(struct InstanceBuffer **bufferPtr) {
+    if (bufferPtr == NULL || (*bufferPtr) == NULL) return;
+
+    struct InstanceBuffer *buffer = (*bufferPtr);
+    if (buffer->_vbo != 0) {
+        glDeleteBuffers(1, &buffer->_vbo);
+        buffer->_vbo = 0;
+    }
+
+    free(buffer->_instances);
+    buffer->_instances = NULL;
+
+    free(buffer);
+    buffer = NULL;
+    (*bufferPtr) = NULL;
+}
+
+void beginInstanceBufferFrame(struct InstanceBuffer *buffer, size_t maxInstances) {
+    if (buffer == NULL) return;
+
+    buffer->_numInstances = 0;
+    if (maxInstances == 0 || !reserveInstances(buffer, maxInstances)) return;
+
+    if (buffer->_vbo == 0) {
+        glGenBuffers(1, &buffer->_vbo);
+        if (buffer->_vbo == 0) {
+            error_log("%s", "[InstanceBuffer]: OpenGL could not allocate instance buffer object");
+            return;
+        }
+    }
+
+    if (maxInstances > buffer->_gpuCapacity) {
+        buffer->_gpuCapacity = maxInstances;
+    }
+
+    // orphan last frame's storage so the driver never has to wait on draws that are still reading it
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->_vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (buffer->_gpuCapacity * sizeof(struct InstanceData)), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool appendInstance(struct InstanceBuffer *buffer, const float wMtx[16], const float witMtx[16]) {
+    if (buffer == NULL || wMtx == NULL || witMtx == NULL) return false;
+
+    if (buffer->_numInstances >= buffer->_capacity) return false;
+
+    struct InstanceData *instance = &buffer->_instances[buffer->_numInstances];
+    Mat4Transpose(instance->wMtx, (float *) wMtx);
+    Mat4Transpose(instance->witMtx, (float *) witMtx);
+    buffer->_numInstances++;
+
+    return true;
+}
+
+void uploadInstances(struct InstanceBuffer *buffer, size_t firstInstance, size_t numInstances) {
+    if (buffer == NULL || buffer->_vbo == 0 || numInstances == 0) return;
+
+    if (firstInstance + numInstances > buffer->_gpuCapacity) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->_vbo);
+    glBufferSubData(
+        GL_ARRAY_BUFFER,
+        (GLintptr) (firstInstance * sizeof(struct InstanceData)),
+        (GLsizeiptr) (numInstances * sizeof(struct InstanceData)),
+        &buffer->_instances[firstInstance]
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
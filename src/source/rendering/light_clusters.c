@@ -0,0 +1,371 @@
+#include <glad/gl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lights.h"
+#include "logger.h"
+#include "util.h"
+#include "resources/shader.h"
+#include "rendering/light_clusters.h"
+
+// inclusive cluster ranges a light overlaps, min[0] is -1 when the light touches no cluster
+struct LightClusterBounds {
+    int min[3];
+    int max[3];
+};
+
+static int clampInt(int value, int lo, int hi) {
+    if (value < lo) return lo;
+    if (value > hi) return hi;
+
+    return value;
+}
+
+// Distance at which intensity / (c + l*d + q*d^2) falls under the cutoff, negative when the light never fades out
+float calcLightInfluenceRange(const struct LightData *light) {
+    if (light == NULL) return 0.0f;
+
+    float brightest = light->diffuse[0];
+    if (light->diffuse[1] > brightest) brightest = light->diffuse[1];
+    if (light->diffuse[2] > brightest) brightest = light->diffuse[2];
+    if (light->specular[0] > brightest) brightest = light->specular[0];
+    if (light->specular[1] > brightest) brightest = light->specular[1];
+    if (light->specular[2] > brightest) brightest = light->specular[2];
+
+    const float target = (light->intensity * brightest) / LIGHT_CLUSTER_INFLUENCE_CUTOFF;
+    const float c = light->attenuation[0] - target;
+    const float l = light->attenuation[1];
+    const float q = light->attenuation[2];
+
+    if (c >= 0.0f) return 0.0f;
+
+    if (q > 0.0f) {
+        return (-l + sqrtf(l * l - 4.0f * q * c)) / (2.0f * q);
+    }
+
+    if (l > 0.0f) {
+        return -c / l;
+    }
+
+    return -1.0f;
+}
+
+// Conservative screen rectangle and view depth range of a sphere, found by projecting its bounding box
+bool calcLightScreenBounds(
+    const float viewPos[3],
+    float range,
+    const float projMtx[16],
+    float nearZ,
+    float farZ,
+    float ndcMin[2],
+    float ndcMax[2],
+    float depthRange[2]
+) {
+    if (viewPos == NULL || projMtx == NULL || ndcMin == NULL || ndcMax == NULL || depthRange == NULL) return false;
+
+    float minZ = viewPos[2] - range;
+    float maxZ = viewPos[2] + range;
+    if (maxZ < nearZ || minZ > farZ) return false;
+    if (minZ < nearZ) minZ = nearZ;
+    if (maxZ > farZ) maxZ = farZ;
+
+    ndcMin[0] = ndcMin[1] = 1.0f;
+    ndcMax[0] = ndcMax[1] = -1.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+        float viewCorner[4] = {
+            viewPos[0] + ((corner & 1) ? range : -range),
+            viewPos[1] + ((corner & 2) ? range : -range),
+            (corner & 4) ? maxZ : minZ,
+            1.0f,
+        };
+
+        float clip[4] = {0.0f};
+        Mat4Vec4Mult((float *) projMtx, viewCorner, clip);
+        if (clip[3] <= 0.0f) continue;
+
+        for (int axis = 0; axis < 2; ++axis) {
+            float ndc = clip[axis] / clip[3];
+            if (ndc < ndcMin[axis]) ndcMin[axis] = ndc;
+            if (ndc > ndcMax[axis]) ndcMax[axis] = ndc;
+        }
+    }
+
+    if (ndcMin[0] > 1.0f || ndcMax[0] < -1.0f || ndcMin[1] > 1.0f || ndcMax[1] < -1.0f) return false;
+
+    depthRange[0] = minZ;
+    depthRange[1] = maxZ;
+
+    return true;
+}
+
+static int calcDepthSlice(const struct LightClusterHeader *header, float viewZ) {
+    if (viewZ <= header->depthParams[2]) return 0;
+
+    return (int) floorf(logf(viewZ) * header->depthParams[0] + header->depthParams[1]);
+}
+
+static void calcLightClusterBounds(
+    const struct LightClusterHeader *header,
+    const float viewPos[3],
+    float range,
+    const float projMtx[16],
+    struct LightClusterBounds *bounds
+) {
+    bounds->min[0] = -1;
+
+    float ndcMin[2], ndcMax[2], depthRange[2];
+    if (!calcLightScreenBounds(viewPos, range, projMtx, header->depthParams[2], header->depthParams[3], ndcMin, ndcMax, depthRange)) {
+        return;
+    }
+
+    const int gridSize[2] = {LIGHT_CLUSTER_GRID_X, LIGHT_CLUSTER_GRID_Y};
+    for (int axis = 0; axis < 2; ++axis) {
+        bounds->min[axis] = clampInt((int) floorf((ndcMin[axis] * 0.5f + 0.5f) * gridSize[axis]), 0, gridSize[axis] - 1);
+        bounds->max[axis] = clampInt((int) floorf((ndcMax[axis] * 0.5f + 0.5f) * gridSize[axis]), 0, gridSize[axis] - 1);
+    }
+
+    bounds->min[2] = clampInt(calcDepthSlice(header, depthRange[0]), 0, LIGHT_CLUSTER_GRID_Z - 1);
+    bounds->max[2] = clampInt(calcDepthSlice(header, depthRange[1]), 0, LIGHT_CLUSTER_GRID_Z - 1);
+}
+
+static size_t clusterIndex(int x, int y, int z) {
+    return (size_t) x + LIGHT_CLUSTER_GRID_X * ((size_t) y + LIGHT_CLUSTER_GRID_Y * (size_t) z);
+}
+
+static bool reserveClusterArrays(struct LightClusters *clusters, size_t numLights, size_t numIndices) {
+    if (numLights > clusters->_boundsCapacity) {
+        struct LightClusterBounds *newBounds = realloc(clusters->_bounds, numLights * sizeof(struct LightClusterBounds));
+        if (newBounds == NULL) return false;
+
+        clusters->_bounds = newBounds;
+        clusters->_boundsCapacity = numLights;
+    }
+
+    if (numIndices > clusters->_indexCapacity) {
+        size_t newCapacity = clusters->_indexCapacity == 0 ? 1024 : clusters->_indexCapacity;
+        while (newCapacity < numIndices) newCapacity *= 2;
+
+        uint32_t *newIndices = realloc(clusters->_indices, newCapacity * sizeof(uint32_t));
+        if (newIndices == NULL) return false;
+
+        clusters->_indices = newIndices;
+        clusters->_indexCapacity = newCapacity;
+    }
+
+    return true;
+}
+
+static void fillStorageBuffer(unsigned int *ssbo, size_t *currentSize, const void *data, size_t size) {
+    if ((*ssbo) == 0) {
+        glGenBuffers(1, ssbo);
+        if ((*ssbo) == 0) {
+            error_log("%s", "[LightClusters]: OpenGL could not allocate shader storage buffer");
+            return;
+        }
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, (*ssbo));
+    if (currentSize == NULL || size > (*currentSize)) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr) size, data, GL_DYNAMIC_DRAW);
+        if (currentSize != NULL) (*currentSize) = size;
+    } else {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr) size, data);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void allocLightClusters(struct LightClusters **clustersPtr) {
+    if (clustersPtr == NULL || (*clustersPtr) != NULL) return;
+
+    struct LightClusters *newClusters = calloc(1, sizeof(struct LightClusters));
+    if (newClusters == NULL) return;
+
+    // header followed by an (offset, count) pair per cluster, uploaded as one buffer
+    newClusters->_grid = calloc(LIGHT_CLUSTER_COUNT * 2, sizeof(uint32_t));
+    if (newClusters->_grid == NULL) {
+        free(newClusters);
+        return;
+    }
+
+    newClusters->_lightSsbo = 0;
+    newClusters->_lightSsboSize = 0;
+    newClusters->_gridSsbo = 0;
+    newClusters->_indexSsbo = 0;
+    newClusters->_indexSsboSize = 0;
+    newClusters->_indices = NULL;
+    newClusters->_numIndices = 0;
+    newClusters->_indexCapacity = 0;
+    newClusters->_bounds = NULL;
+    newClusters->_boundsCapacity = 0;
+
+    (*clustersPtr) = newClusters;
+    newClusters = NULL;
+}
+
+void deleteLightClusters(struct LightClusters **clustersPtr) {
+    if (clustersPtr == NULL || (*clustersPtr) == NULL) return;
+
+    struct LightClusters *clusters = (*clustersPtr);
+    GLuint buffers[3] = {clusters->_lightSsbo, clusters->_gridSsbo, clusters->_indexSsbo};
+    for (int i = 0; i < 3; ++i) {
+        if (buffers[i] != 0) glDeleteBuffers(1, &buffers[i]);
+    }
+
+    free(clusters->_grid);
+    clusters->_grid = NULL;
+    free(clusters->_indices);
+    clusters->_indices = NULL;
+    free(clusters->_bounds);
+    clusters->_bounds = NULL;
+
+    free(clusters);
+    clusters = NULL;
+    (*clustersPtr) = NULL;
+}
+
+bool buildLightClusters(
+    struct LightClusters *clusters,
+    const struct LightData *lights,
+    size_t numLights,
+    const float viewMtx[16],
+    const float projMtx[16],
+    float nearZ,
+    float farZ
+) {
+    if (clusters == NULL || viewMtx == NULL || projMtx == NULL) return false;
+    if (nearZ <= 0.0f || farZ <= nearZ) return false;
+
+    struct LightClusterHeader *header = &clusters->_header;
+    const float logDepthRange = logf(farZ / nearZ);
+    header->dims[0] = LIGHT_CLUSTER_GRID_X;
+    header->dims[1] = LIGHT_CLUSTER_GRID_Y;
+    header->dims[2] = LIGHT_CLUSTER_GRID_Z;
+    header->dims[3] = (uint32_t) numLights;
+    header->depthParams[0] = LIGHT_CLUSTER_GRID_Z / logDepthRange;
+    header->depthParams[1] = -LIGHT_CLUSTER_GRID_Z * logf(nearZ) / logDepthRange;
+    header->depthParams[2] = nearZ;
+    header->depthParams[3] = farZ;
+
+    memset(clusters->_grid, 0, LIGHT_CLUSTER_COUNT * 2 * sizeof(uint32_t));
+    clusters->_numIndices = 0;
+
+    if (lights == NULL || numLights == 0) return true;
+
+    if (!reserveClusterArrays(clusters, numLights, 0)) {
+        critical_log("%s", "[LightClusters]: Could not allocate light bounds");
+        return false;
+    }
+
+    // first pass counts how many lights land in every cluster
+    size_t totalIndices = 0;
+    for (size_t i = 0; i < numLights; ++i) {
+        struct LightClusterBounds *bounds = &clusters->_bounds[i];
+        bounds->min[0] = -1;
+
+        if (!lights[i].used || !lights[i].enabled) continue;
+
+        float range = calcLightInfluenceRange(&lights[i]);
+        if (range == 0.0f) continue;
+        if (range < 0.0f) range = farZ;
+
+        float worldPos[4] = {lights[i].position[0], lights[i].position[1], lights[i].position[2], 1.0f};
+        float viewPos[4] = {0.0f};
+        Mat4Vec4Mult((float *) viewMtx, worldPos, viewPos);
+
+        calcLightClusterBounds(header, viewPos, range, projMtx, bounds);
+        if (bounds->min[0] < 0) continue;
+
+        for (int z = bounds->min[2]; z <= bounds->max[2]; ++z) {
+            for (int y = bounds->min[1]; y <= bounds->max[1]; ++y) {
+                for (int x = bounds->min[0]; x <= bounds->max[0]; ++x) {
+                    clusters->_grid[clusterIndex(x, y, z) * 2 + 1]++;
+                    totalIndices++;
+                }
+            }
+        }
+    }
+
+    if (!reserveClusterArrays(clusters, numLights, totalIndices)) {
+        critical_log("%s", "[LightClusters]: Could not allocate cluster light indices");
+        memset(clusters->_grid, 0, LIGHT_CLUSTER_COUNT * 2 * sizeof(uint32_t));
+        return false;
+    }
+
+    // prefix sum turns the counts into offsets, counts are rebuilt while scattering
+    uint32_t offset = 0;
+    for (size_t cluster = 0; cluster < LIGHT_CLUSTER_COUNT; ++cluster) {
+        uint32_t count = clusters->_grid[cluster * 2 + 1];
+        clusters->_grid[cluster * 2] = offset;
+        clusters->_grid[cluster * 2 + 1] = 0;
+        offset += count;
+    }
+
+    for (size_t i = 0; i < numLights; ++i) {
+        const struct LightClusterBounds *bounds = &clusters->_bounds[i];
+        if (bounds->min[0] < 0) continue;
+
+        for (int z = bounds->min[2]; z <= bounds->max[2]; ++z) {
+            for (int y = bounds->min[1]; y <= bounds->max[1]; ++y) {
+                for (int x = bounds->min[0]; x <= bounds->max[0]; ++x) {
+                    uint32_t *cell = &clusters->_grid[clusterIndex(x, y, z) * 2];
+                    clusters->_indices[cell[0] + cell[1]] = (uint32_t) i;
+                    cell[1]++;
+                }
+            }
+        }
+    }
+    clusters->_numIndices = totalIndices;
+
+    return true;
+}
+
+void uploadLightClusterLights(struct LightClusters *clusters, const struct LightData *lights, size_t numLights) {
+    if (clusters == NULL) return;
+
+    if (lights == NULL || numLights == 0) {
+        // shaders still expect a buffer at the binding, even when the grid references no lights
+        const struct LightData noLight = {0};
+        fillStorageBuffer(&clusters->_lightSsbo, &clusters->_lightSsboSize, &noLight, sizeof(struct LightData));
+        return;
+    }
+
+    fillStorageBuffer(&clusters->_lightSsbo, &clusters->_lightSsboSize, lights, numLights * sizeof(struct LightData));
+}
+
+void uploadLightClusters(struct LightClusters *clusters) {
+    if (clusters == NULL) return;
+
+    // the grid has a fixed size, so it is allocated with the header once and refilled in two parts
+    const size_t gridSize = LIGHT_CLUSTER_COUNT * 2 * sizeof(uint32_t);
+    if (clusters->_gridSsbo == 0) {
+        fillStorageBuffer(&clusters->_gridSsbo, NULL, NULL, sizeof(struct LightClusterHeader) + gridSize);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusters->_gridSsbo);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(struct LightClusterHeader), &clusters->_header);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(struct LightClusterHeader), (GLsizeiptr) gridSize, clusters->_grid);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // an empty index buffer can not be bound, keep at least one entry around
+    const uint32_t noIndex = 0;
+    if (clusters->_numIndices == 0) {
+        fillStorageBuffer(&clusters->_indexSsbo, &clusters->_indexSsboSize, &noIndex, sizeof(uint32_t));
+    } else {
+        fillStorageBuffer(&clusters->_indexSsbo, &clusters->_indexSsboSize, clusters->_indices, clusters->_numIndices * sizeof(uint32_t));
+    }
+}
+
+void bindLightClusters(struct LightClusters *clusters) {
+    if (clusters == NULL) return;
+
+    if (clusters->_lightSsbo != 0) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_CLUSTER_LIGHT_BUFFER_BINDING, clusters->_lightSsbo);
+    }
+    if (clusters->_gridSsbo != 0) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_CLUSTER_GRID_BUFFER_BINDING, clusters->_gridSsbo);
+    }
+    if (clusters->_indexSsbo != 0) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADER_CLUSTER_INDEX_BUFFER_BINDING, clusters->_indexSsbo);
+    }
+}
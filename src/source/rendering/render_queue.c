@@ -0,0 +1,290 @@
+#include <glad/gl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "rendering/render_queue.h"
+#include "rendering/instance_buffer.h"
+#include "rendering/sprite_batch.h"
+#include "rendering/gl_state.h"
+#include "resources/base_resource.h"
+#include "resources/shader.h"
+#include "resources/texture.h"
+#include "resources/model.h"
+
+#define RENDER_QUEUE_INITIAL_CAPACITY 64
+
+// Sort key layout, most significant bits first:
+// [63..60] layer, [59..44] shader, [43..28] material, [27..16] texture, [15..4] model, [3..0] lod
+// Ids are resource serial numbers masked to their field width. A collision only costs a
+// redundant bind, the queue compares pointers when it decides what actually needs binding.
+// Blended layers only fill in the layer, so they draw in submission order and overlapping
+// sprites keep painter's order. Neighbouring packets that share state are still drawn as one run
+#define SORT_KEY_LAYER_SHIFT 60
+#define SORT_KEY_SHADER_SHIFT 44
+#define SORT_KEY_MATERIAL_SHIFT 28
+#define SORT_KEY_TEXTURE_SHIFT 16
+#define SORT_KEY_MODEL_SHIFT 4
+#define SORT_KEY_LOD_SHIFT 0
+
+#define SORT_KEY_LAYER_MASK 0xFull
+#define SORT_KEY_SHADER_MASK 0xFFFFull
+#define SORT_KEY_MATERIAL_MASK 0xFFFFull
+#define SORT_KEY_TEXTURE_MASK 0xFFFull
+#define SORT_KEY_MODEL_MASK 0xFFFull
+#define SORT_KEY_LOD_MASK 0xFull
+
+static bool isBlendedLayer(unsigned int layer) {
+    return layer == DRAW_PACKET_LAYER_SPRITE || layer == DRAW_PACKET_LAYER_TEXT;
+}
+
+static uint64_t keyField(struct BaseResource *resource, uint64_t mask, int shift) {
+    return (((uint64_t) getResourceId(resource)) & mask) << shift;
+}
+
+static int compareDrawPackets(const void *a, const void *b) {
+    const struct DrawPacket *lhs = a;
+    const struct DrawPacket *rhs = b;
+
+    if (lhs->sortKey < rhs->sortKey) return -1;
+    if (lhs->sortKey > rhs->sortKey) return 1;
+
+    // qsort is not stable, fall back to submission order so equal keys draw in scene graph order
+    if (lhs->sequence < rhs->sequence) return -1;
+    if (lhs->sequence > rhs->sequence) return 1;
+
+    return 0;
+}
+
+static bool packetsShareState(const struct DrawPacket *lhs, const struct DrawPacket *rhs) {
+    return lhs->shader == rhs->shader &&
+        lhs->material == rhs->material &&
+        lhs->texture == rhs->texture &&
+        lhs->model == rhs->model &&
+        lhs->lod == rhs->lod &&
+        lhs->draw == rhs->draw;
+}
+
+static size_t countPacketRun(struct RenderQueue *queue, size_t first, size_t end) {
+    size_t last = first + 1;
+    while (last < end && packetsShareState(&queue->packets[first], &queue->packets[last])) {
+        ++last;
+    }
+
+    return last - first;
+}
+
+static bool growRenderQueue(struct RenderQueue *queue) {
+    size_t newCapacity = queue->capacity == 0 ? RENDER_QUEUE_INITIAL_CAPACITY : queue->capacity * 2;
+
+    struct DrawPacket *newPackets = realloc(queue->packets, newCapacity * sizeof(struct DrawPacket));
+    if (newPackets == NULL) {
+        critical_log("%s", "[RenderQueue]: Could not grow render queue. Draw packet will be dropped.");
+        return false;
+    }
+
+    queue->packets = newPackets;
+    queue->capacity = newCapacity;
+
+    return true;
+}
+
+void allocRenderQueue(struct RenderQueue **queuePtr) {
+    if (queuePtr == NULL || (*queuePtr) != NULL) return;
+
+    struct RenderQueue *newQueue = calloc(1, sizeof(struct RenderQueue));
+    if (newQueue == NULL) return;
+
+    newQueue->packets = NULL;
+    newQueue->numPackets = 0;
+    newQueue->capacity = 0;
+    newQueue->instances = NULL;
+    newQueue->sprites = NULL;
+    newQueue->geometryShader = NULL;
+    newQueue->rc = NULL;
+
+    (*queuePtr) = newQueue;
+    newQueue = NULL;
+}
+
+void deleteRenderQueue(struct RenderQueue **queuePtr) {
+    if (queuePtr == NULL || (*queuePtr) == NULL) return;
+
+    struct RenderQueue *queue = (*queuePtr);
+    clearRenderQueue(queue);
+
+    free(queue->packets);
+    queue->packets = NULL;
+    queue->capacity = 0;
+
+    deleteInstanceBuffer(&queue->instances);
+    deleteSpriteBatch(&queue->sprites);
+
+    free(queue);
+    queue = NULL;
+    (*queuePtr) = NULL;
+}
+
+void clearRenderQueue(struct RenderQueue *queue) {
+    if (queue == NULL) return;
+
+    for (size_t i = 0; i < queue->numPackets; ++i) {
+        Py_CLEAR(queue->packets[i].renderer);
+        Py_CLEAR(queue->packets[i].owner);
+    }
+
+    queue->numPackets = 0;
+}
+
+uint64_t calcDrawPacketSortKey(
+    unsigned int layer,
+    struct Shader *shader,
+    struct Material *material,
+    struct Texture *texture,
+    struct Model *model
+) {
+    uint64_t layerKey = (((uint64_t) layer) & SORT_KEY_LAYER_MASK) << SORT_KEY_LAYER_SHIFT;
+    if (isBlendedLayer(layer)) return layerKey;
+
+    return layerKey |
+        keyField((struct BaseResource *) shader, SORT_KEY_SHADER_MASK, SORT_KEY_SHADER_SHIFT) |
+        keyField((struct BaseResource *) material, SORT_KEY_MATERIAL_MASK, SORT_KEY_MATERIAL_SHIFT) |
+        keyField((struct BaseResource *) texture, SORT_KEY_TEXTURE_MASK, SORT_KEY_TEXTURE_SHIFT) |
+        keyField((struct BaseResource *) model, SORT_KEY_MODEL_MASK, SORT_KEY_MODEL_SHIFT);
+}
+
+struct DrawPacket *pushDrawPacket(
+    struct RenderQueue *queue,
+    unsigned int layer,
+    struct Shader *shader,
+    struct Material *material,
+    struct Texture *texture,
+    struct Model *model,
+    PyObject *renderer,
+    struct Py3dGameObject *owner,
+    DrawPacketFunc draw
+) {
+    if (queue == NULL || renderer == NULL || owner == NULL || draw == NULL) return NULL;
+
+    if (queue->numPackets == queue->capacity && !growRenderQueue(queue)) return NULL;
+
+    struct DrawPacket *packet = &queue->packets[queue->numPackets];
+    packet->sortKey = calcDrawPacketSortKey(layer, shader, material, texture, model);
+    packet->sequence = queue->numPackets;
+    packet->shader = shader;
+    packet->material = material;
+    packet->texture = texture;
+    packet->model = model;
+    packet->lod = 0;
+    packet->renderer = Py_NewRef(renderer);
+    packet->owner = (struct Py3dGameObject *) Py_NewRef((PyObject *) owner);
+    packet->draw = draw;
+
+    queue->numPackets++;
+
+    return packet;
+}
+
+// Packets of the same model sort by level of detail, so every level still draws as one instanced run
+void setDrawPacketLod(struct DrawPacket *packet, size_t lod) {
+    if (packet == NULL) return;
+
+    packet->lod = lod;
+    packet->sortKey = (packet->sortKey & ~(SORT_KEY_LOD_MASK << SORT_KEY_LOD_SHIFT)) |
+        ((((uint64_t) lod) & SORT_KEY_LOD_MASK) << SORT_KEY_LOD_SHIFT);
+}
+
+void sortRenderQueue(struct RenderQueue *queue) {
+    if (queue == NULL || queue->numPackets < 2) return;
+
+    qsort(queue->packets, queue->numPackets, sizeof(struct DrawPacket), compareDrawPackets);
+}
+
+static unsigned int packetLayer(const struct DrawPacket *packet) {
+    return (unsigned int) ((packet->sortKey >> SORT_KEY_LAYER_SHIFT) & SORT_KEY_LAYER_MASK);
+}
+
+void submitRenderQueue(struct RenderQueue *queue, struct Py3dScene *scene, struct Py3dRenderingContext *rc) {
+    submitRenderQueueLayers(queue, scene, rc, 0, (unsigned int) SORT_KEY_LAYER_MASK);
+}
+
+void submitRenderQueueLayers(
+    struct RenderQueue *queue,
+    struct Py3dScene *scene,
+    struct Py3dRenderingContext *rc,
+    unsigned int firstLayer,
+    unsigned int lastLayer
+) {
+    if (queue == NULL || queue->numPackets == 0) return;
+
+    // the queue is sorted, so the requested layers form one contiguous range of packets
+    size_t first = 0;
+    while (first < queue->numPackets && packetLayer(&queue->packets[first]) < firstLayer) ++first;
+    size_t end = first;
+    while (end < queue->numPackets && packetLayer(&queue->packets[end]) <= lastLayer) ++end;
+    if (first == end) return;
+
+    if (queue->instances == NULL) {
+        allocInstanceBuffer(&queue->instances);
+    }
+    // instance data is appended across submissions of the same frame, only the first one orphans
+    if (first == 0) {
+        beginInstanceBufferFrame(queue->instances, queue->numPackets);
+    }
+
+    if (queue->sprites == NULL) {
+        allocSpriteBatch(&queue->sprites);
+    }
+
+    struct RenderQueueState state;
+    memset(&state, 0, sizeof(struct RenderQueueState));
+    state.scene = scene;
+    state.rc = rc;
+    state.instances = queue->instances;
+    state.sprites = queue->sprites;
+
+    size_t runLength = 0;
+    for (size_t i = first; i < end; i += runLength) {
+        struct DrawPacket *packet = &queue->packets[i];
+        runLength = countPacketRun(queue, i, end);
+
+        // the first run always binds everything because python code may have touched GL state since
+        // the last submission, the scene invalidates the GL state cache for it
+        bool bindAll = i == first || state.stateLost;
+        state.stateLost = false;
+        state.shaderChanged = bindAll || packet->shader != state.shader;
+        state.materialChanged = state.shaderChanged || packet->material != state.material;
+        state.textureChanged = bindAll || packet->texture != state.texture;
+        state.modelChanged = bindAll || packet->model != state.model;
+
+        if (state.shaderChanged) {
+            enableShader(packet->shader);
+            state.shader = packet->shader;
+        }
+
+        // packets without a texture unbind the unit, otherwise they would sample the previous packet's
+        if (state.textureChanged) {
+            if (packet->texture != NULL) {
+                bindTexture(packet->texture, 0);
+            } else {
+                bindGLTexture2D(0, 0);
+            }
+            state.texture = packet->texture;
+        }
+
+        if (state.modelChanged) {
+            bindModel(packet->model);
+            state.model = packet->model;
+        }
+
+        state.material = packet->material;
+
+        packet->draw(packet, runLength, &state);
+        if (state.stateLost) {
+            invalidateGLStateCache();
+        }
+    }
+
+    unbindModel(state.model);
+    disableShader(state.shader);
+}
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+
+#include "logger.h"
+#include "util.h"
+#include "resources/model.h"
+#include "rendering/sprite_batch.h"
+
+#define VERTICES_PER_SPRITE 6
+
+// matches the builtin quad, corners are x, y, u, v
+static const float quadCorners[VERTICES_PER_SPRITE][4] = {
+    {-0.5f,  0.5f, 0.0f, 0.0f},
+    {-0.5f, -0.5f, 0.0f, 1.0f},
+    { 0.5f, -0.5f, 1.0f, 1.0f},
+
+    { 0.5f, -0.5f, 1.0f, 1.0f},
+    { 0.5f,  0.5f, 1.0f, 0.0f},
+    {-0.5f,  0.5f, 0.0f, 0.0f}
+};
+
+static bool reserveSprites(struct SpriteBatch *batch, size_t maxSprites) {
+    if (maxSprites <= batch->_capacity) return true;
+
+    struct VertexPNT *newVertices = realloc(batch->_vertices, maxSprites * VERTICES_PER_SPRITE * sizeof(struct VertexPNT));
+    if (newVertices == NULL) {
+        critical_log("%s", "[SpriteBatch]: Could not grow sprite batch");
+        return false;
+    }
+
+    batch->_vertices = newVertices;
+    batch->_capacity = maxSprites;
+
+    return true;
+}
+
+void allocSpriteBatch(struct SpriteBatch **batchPtr) {
+    if (batchPtr == NULL || (*batchPtr) != NULL) return;
+
+    struct SpriteBatch *newBatch = calloc(1, sizeof(struct SpriteBatch));
+    if (newBatch == NULL) return;
+
+    newBatch->_model = NULL;
+    allocModel(&newBatch->_model);
+    if (newBatch->_model == NULL) {
+        free(newBatch);
+        return;
+    }
+    newBatch->_vertices = NULL;
+    newBatch->_numSprites = 0;
+    newBatch->_capacity = 0;
+
+    (*batchPtr) = newBatch;
+    newBatch = NULL;
+}
+
+void deleteSpriteBatch(struct SpriteBatch **batchPtr) {
+    if (batchPtr == NULL || (*batchPtr) == NULL) return;
+
+    struct SpriteBatch *batch = (*batchPtr);
+    deleteModel(&batch->_model);
+
+    free(batch->_vertices);
+    batch->_vertices = NULL;
+
+    free(batch);
+    batch = NULL;
+    (*batchPtr) = NULL;
+}
+
+void beginSpriteBatch(struct SpriteBatch *batch, size_t maxSprites) {
+    if (batch == NULL) return;
+
+    batch->_numSprites = 0;
+    reserveSprites(batch, maxSprites);
+}
+
+bool appendSprite(struct SpriteBatch *batch, const float wMtx[16], const float texMtx[9]) {
+    if (batch == NULL || wMtx == NULL || texMtx == NULL) return false;
+
+    if (batch->_numSprites >= batch->_capacity && !reserveSprites(batch, batch->_capacity == 0 ? 64 : batch->_capacity * 2)) {
+        return false;
+    }
+
+    struct VertexPNT *dst = &batch->_vertices[batch->_numSprites * VERTICES_PER_SPRITE];
+    for (int i = 0; i < VERTICES_PER_SPRITE; ++i) {
+        float posL[4] = {quadCorners[i][0], quadCorners[i][1], 0.0f, 1.0f};
+        float posW[4] = {0.0f};
+        Mat4Vec4Mult((float *) wMtx, posL, posW);
+
+        const float u = quadCorners[i][2], v = quadCorners[i][3];
+
+        dst[i].position[0] = posW[0];
+        dst[i].position[1] = posW[1];
+        dst[i].position[2] = posW[2];
+        dst[i].normal[0] = 0.0f;
+        dst[i].normal[1] = 0.0f;
+        dst[i].normal[2] = 1.0f;
+        dst[i].texCoord[0] = (u * texMtx[0]) + (v * texMtx[3]) + texMtx[6];
+        dst[i].texCoord[1] = (u * texMtx[1]) + (v * texMtx[4]) + texMtx[7];
+    }
+    batch->_numSprites++;
+
+    return true;
+}
+
+// Streams the collected quads into the batch's buffer and draws them. The batch's VAO is left bound
+void flushSpriteBatch(struct SpriteBatch *batch) {
+    if (batch == NULL || batch->_numSprites == 0) return;
+
+    updateModelPNTBuffer(batch->_model, batch->_vertices, batch->_numSprites * VERTICES_PER_SPRITE);
+    bindModel(batch->_model);
+    renderModel(batch->_model);
+
+    batch->_numSprites = 0;
+}
@@ -0,0 +1,204 @@
+#include <glad/gl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "logger.h"
+#include "resources/texture.h"
+#include "resources/texture_image.h"
+#include "rendering/texture_streamer.h"
+
+#define BYTES_PER_KILOBYTE 1024
+
+struct StreamingTexture {
+    struct Texture *texture;
+    int nextLevel;
+};
+
+struct StreamingUpload {
+    struct Texture *texture;
+    int level;
+    size_t offset;
+};
+
+static struct StreamingTexture *streaming = NULL;
+static size_t numStreaming = 0;
+static size_t streamingCapacity = 0;
+
+static struct StreamingUpload *uploads = NULL;
+static size_t uploadsCapacity = 0;
+
+static unsigned int pbo = 0;
+
+static bool reserveUploads(size_t numUploads) {
+    if (numUploads <= uploadsCapacity) return true;
+
+    size_t newCapacity = uploadsCapacity > 0 ? uploadsCapacity * 2 : 16;
+    while (newCapacity < numUploads) newCapacity *= 2;
+
+    struct StreamingUpload *newUploads = realloc(uploads, newCapacity * sizeof(struct StreamingUpload));
+    if (newUploads == NULL) {
+        critical_log("%s", "[TextureStreamer]: Could not grow upload list");
+        return false;
+    }
+
+    uploads = newUploads;
+    uploadsCapacity = newCapacity;
+
+    return true;
+}
+
+void queueTextureStreaming(struct Texture *texture) {
+    if (texture == NULL) return;
+
+    for (size_t i = 0; i < numStreaming; ++i) {
+        if (streaming[i].texture == texture) return;
+    }
+
+    if (numStreaming == streamingCapacity) {
+        size_t newCapacity = streamingCapacity > 0 ? streamingCapacity * 2 : 16;
+        struct StreamingTexture *newStreaming = realloc(streaming, newCapacity * sizeof(struct StreamingTexture));
+        if (newStreaming == NULL) {
+            critical_log("%s", "[TextureStreamer]: Could not grow streaming list");
+            return;
+        }
+
+        streaming = newStreaming;
+        streamingCapacity = newCapacity;
+    }
+
+    streaming[numStreaming].texture = texture;
+    streaming[numStreaming].nextLevel = -1;
+    numStreaming++;
+}
+
+void cancelTextureStreaming(struct Texture *texture) {
+    if (texture == NULL) return;
+
+    for (size_t i = 0; i < numStreaming; ++i) {
+        if (streaming[i].texture != texture) continue;
+
+        streaming[i] = streaming[numStreaming - 1];
+        numStreaming--;
+        return;
+    }
+}
+
+// Picks the smallest pending level over all textures until the budget is spent, so every texture
+// gets a usable mip before any of them gets its largest one. At least one level is always picked
+static size_t selectUploads(size_t budget, size_t *numUploadsOut) {
+    for (size_t i = 0; i < numStreaming; ++i) {
+        streaming[i].nextLevel = getTextureBaseLevel(streaming[i].texture) - 1;
+    }
+
+    size_t numUploads = 0;
+    size_t totalBytes = 0;
+    while (true) {
+        struct StreamingTexture *best = NULL;
+        size_t bestSize = 0;
+        for (size_t i = 0; i < numStreaming; ++i) {
+            struct StreamingTexture *cur = &streaming[i];
+            const struct TextureImage *image = getTextureStreamImage(cur->texture);
+            if (cur->nextLevel < 0 || image == NULL) continue;
+
+            size_t size = image->levels[cur->nextLevel].size;
+            if (best == NULL || size < bestSize) {
+                best = cur;
+                bestSize = size;
+            }
+        }
+
+        if (best == NULL || (numUploads > 0 && totalBytes + bestSize > budget)) break;
+        if (!reserveUploads(numUploads + 1)) break;
+
+        uploads[numUploads].texture = best->texture;
+        uploads[numUploads].level = best->nextLevel;
+        uploads[numUploads].offset = totalBytes;
+        numUploads++;
+        totalBytes += bestSize;
+        best->nextLevel--;
+    }
+
+    (*numUploadsOut) = numUploads;
+    return totalBytes;
+}
+
+static void removeFinishedTextures() {
+    size_t i = 0;
+    while (i < numStreaming) {
+        if (getTextureStreamImage(streaming[i].texture) == NULL) {
+            streaming[i] = streaming[numStreaming - 1];
+            numStreaming--;
+        } else {
+            ++i;
+        }
+    }
+}
+
+void updateTextureStreaming() {
+    if (numStreaming == 0) return;
+
+    int budgetInKilobytes = getConfigTextureUploadKbPerFrame();
+    size_t budget = budgetInKilobytes > 0 ? ((size_t) budgetInKilobytes) * BYTES_PER_KILOBYTE : 0;
+
+    size_t numUploads = 0;
+    size_t totalBytes = selectUploads(budget, &numUploads);
+    if (numUploads == 0) {
+        removeFinishedTextures();
+        return;
+    }
+
+    if (pbo == 0) {
+        glCreateBuffers(1, &pbo);
+        if (pbo == 0) {
+            error_log("%s", "[TextureStreamer]: OpenGL could not allocate pixel buffer");
+            return;
+        }
+    }
+
+    // orphaning hands last frame's storage back to the driver, so the copy never waits on a transfer still in flight
+    glNamedBufferData(pbo, (GLsizeiptr) totalBytes, NULL, GL_STREAM_DRAW);
+    unsigned char *mapped = glMapNamedBufferRange(
+        pbo, 0, (GLsizeiptr) totalBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+    );
+    if (mapped == NULL) {
+        error_log("%s", "[TextureStreamer]: Could not map pixel buffer");
+        return;
+    }
+
+    for (size_t i = 0; i < numUploads; ++i) {
+        const struct TextureImage *image = getTextureStreamImage(uploads[i].texture);
+        const struct TextureImageLevel *level = &image->levels[uploads[i].level];
+        memcpy(mapped + uploads[i].offset, image->pixels + level->offset, level->size);
+    }
+
+    // the buffer contents are undefined when unmapping fails, the same levels are picked again next frame
+    if (glUnmapNamedBuffer(pbo) == GL_FALSE) {
+        warning_log("%s", "[TextureStreamer]: Pixel buffer was corrupted, retrying next frame");
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    for (size_t i = 0; i < numUploads; ++i) {
+        streamTextureLevel(uploads[i].texture, uploads[i].level, uploads[i].offset);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    removeFinishedTextures();
+}
+
+void finalizeTextureStreaming() {
+    if (pbo != 0) {
+        glDeleteBuffers(1, &pbo);
+        pbo = 0;
+    }
+
+    free(streaming);
+    streaming = NULL;
+    numStreaming = 0;
+    streamingCapacity = 0;
+
+    free(uploads);
+    uploads = NULL;
+    uploadsCapacity = 0;
+}
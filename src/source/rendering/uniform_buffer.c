@@ -0,0 +1,66 @@
+#include <glad/gl.h>
+#include <stdlib.h>
+
+#include "logger.h"
+#include "rendering/uniform_buffer.h"
+
+void allocUniformBuffer(struct UniformBuffer **bufferPtr, unsigned int binding) {
+    if (bufferPtr == NULL || (*bufferPtr) != NULL) return;
+
+    struct UniformBuffer *newBuffer = calloc(1, sizeof(struct UniformBuffer));
+    if (newBuffer == NULL) return;
+
+    newBuffer->_ubo = 0;
+    newBuffer->_binding = binding;
+    newBuffer->_size = 0;
+
+    (*bufferPtr) = newBuffer;
+    newBuffer = NULL;
+}
+
+void deleteUniformBuffer(struct UniformBuffer **bufferPtr) {
+    if (bufferPtr == NULL || (*bufferPtr) == NULL) return;
+
+    struct UniformBuffer *buffer = (*bufferPtr);
+    if (buffer->_ubo != 0) {
+        glDeleteBuffers(1, &buffer->_ubo);
+        buffer->_ubo = 0;
+    }
+
+    free(buffer);
+    buffer = NULL;
+    (*bufferPtr) = NULL;
+}
+
+void updateUniformBuffer(struct UniformBuffer *buffer, const void *data, size_t size) {
+    if (buffer == NULL || data == NULL || size == 0) return;
+
+    if (buffer->_ubo == 0) {
+        glGenBuffers(1, &buffer->_ubo);
+        if (buffer->_ubo == 0) {
+            error_log("%s", "[UniformBuffer]: OpenGL could not allocate uniform buffer object");
+            return;
+        }
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer->_ubo);
+    if (size != buffer->_size) {
+        glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) size, data, GL_DYNAMIC_DRAW);
+        buffer->_size = size;
+    } else {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr) size, data);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void bindUniformBuffer(struct UniformBuffer *buffer) {
+    if (buffer == NULL || buffer->_ubo == 0) return;
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, buffer->_binding, buffer->_ubo);
+}
+
+size_t getUniformBufferSize(struct UniformBuffer *buffer) {
+    if (buffer == NULL) return 0;
+
+    return buffer->_size;
+}
@@ -2,22 +2,36 @@
 
 #include "logger.h"
 #include "resources/base_resource.h"
+#include "resources/residency.h"
 #include "custom_string.h"
 
 #define RESOURCE_TYPE_INVALID 0
 
+// Serial numbers start at 1 so that 0 can mean "no resource" in render sort keys
+static unsigned int nextResourceId = 1;
+
 void initializeBaseResource(struct BaseResource *resource) {
     if (resource == NULL) return;
 
+    resource->_id = nextResourceId++;
     resource->_type = RESOURCE_TYPE_INVALID;
     resource->_typeName = NULL;
     resource->_name = NULL;
     resource->delete = NULL;
+    resource->getDependencies = NULL;
+    resource->_gpuBytes = 0;
+    resource->_lastUsedFrame = getResidencyFrame();
+    resource->_evicted = false;
+    resource->evict = NULL;
+    resource->restore = NULL;
+    resource->_lruPrev = NULL;
+    resource->_lruNext = NULL;
 }
 
 void finalizeBaseResource(struct BaseResource *resource) {
     if (resource == NULL) return;
 
+    forgetResourceResidency(resource);
     deleteString(&resource->_typeName);
     deleteString(&resource->_name);
 }
@@ -35,6 +49,12 @@ void deleteResource(struct BaseResource **resourcePtr) {
     resource = NULL;
 }
 
+size_t getResourceDependencies(struct BaseResource *resource, struct BaseResource *dependencies[RESOURCE_MAX_DEPENDENCIES]) {
+    if (resource == NULL || dependencies == NULL || resource->getDependencies == NULL) return 0;
+
+    return resource->getDependencies(resource, dependencies);
+}
+
 bool resourceTypesEqual(struct BaseResource *r1, struct BaseResource *r2) {
     if (r1 == NULL || r2 == NULL) return false;
 
@@ -74,4 +94,10 @@ struct String *getResourceTypeName(struct BaseResource *resource) {
     if (resource == NULL) return NULL;
 
     return resource->_typeName;
+}
+
+unsigned int getResourceId(struct BaseResource *resource) {
+    if (resource == NULL) return 0;
+
+    return resource->_id;
 }
\ No newline at end of file
@@ -16,6 +16,16 @@ static void delete(struct BaseResource **resourcePtr) {
     deleteMaterial((struct Material **) resourcePtr);
 }
 
+static size_t getDependencies(struct BaseResource *resource, struct BaseResource *dependencies[RESOURCE_MAX_DEPENDENCIES]) {
+    struct Material *material = (struct Material *) resource;
+
+    size_t numDependencies = 0;
+    if (material->_shader != NULL) dependencies[numDependencies++] = (struct BaseResource *) material->_shader;
+    if (material->_diffuseMap != NULL) dependencies[numDependencies++] = (struct BaseResource *) material->_diffuseMap;
+
+    return numDependencies;
+}
+
 bool isResourceTypeMaterial(struct BaseResource *resource) {
     if (resource == NULL) return false;
 
@@ -33,6 +43,7 @@ void allocMaterial(struct Material **materialPtr) {
     base->_type = RESOURCE_TYPE_MATERIAL;
     allocString(&base->_typeName, RESOURCE_TYPE_NAME_MATERIAL);
     base->delete = delete;
+    base->getDependencies = getDependencies;
     base = NULL;
 
     newMaterial->_shader = NULL;
@@ -1,10 +1,31 @@
 #include <glad/gl.h>
+#include <string.h>
+
 #include "custom_string.h"
+#include "logger.h"
 #include "resources/model.h"
+#include "resources/residency.h"
+#include "rendering/instance_buffer.h"
+#include "rendering/gl_state.h"
+#include "util.h"
 
 #define RESOURCE_TYPE_MODEL 2
-
-// TODO: these should be in a vertex format file / struct
+// A coarser level is only picked once its error is this far below the limit, so models that sit
+// right at a switching distance do not flicker between two levels
+#define MODEL_LOD_HYSTERESIS 0.25f
+
+struct ModelEvictedData {
+    void *vertices;
+    size_t numVertices;
+    struct VertexFormat format;
+    void *indices;
+    size_t numIndices;
+    size_t indexSize;
+    struct ModelLod lods[MODEL_MAX_LODS];
+    size_t numLods;
+};
+
+// attribute locations shared by every vertex format
 const GLuint positionShaderIndex = 0;
 const GLuint normalShaderIndex = 1;
 const GLuint texCoordShaderIndex = 2;
@@ -13,6 +34,7 @@ static void deleteVAO(struct Model *model) {
     if (model == NULL) return;
 
     if (model->_vao != -1) {
+        forgetGLVertexArray(model->_vao);
         glDeleteVertexArrays(1, &model->_vao);
         model->_vao = -1;
     }
@@ -28,6 +50,109 @@ static void deleteVBO(struct Model *model) {
     model->_sizeInVertices = 0;
 }
 
+static void deleteIBO(struct Model *model) {
+    if (model == NULL) return;
+
+    if (model->_ibo != 0) {
+        glDeleteBuffers(1, &model->_ibo);
+        model->_ibo = 0;
+    }
+    model->_sizeInIndices = 0;
+    model->_indexType = GL_UNSIGNED_INT;
+    model->_numLods = 0;
+}
+
+static size_t getIndexSize(const struct Model *model) {
+    return model->_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+static void updateGpuBytes(struct Model *model) {
+    size_t numBytes = 0;
+    if (model->_vbo != -1) {
+        numBytes += ((size_t) model->_format.stride) * model->_sizeInVertices;
+    }
+    if (model->_ibo != 0) {
+        numBytes += getIndexSize(model) * model->_sizeInIndices;
+    }
+
+    setResourceGpuBytes((struct BaseResource *) model, numBytes);
+}
+
+static void deleteEvictedData(struct Model *model) {
+    if (model->_evicted == NULL) return;
+
+    free(model->_evicted->vertices);
+    free(model->_evicted->indices);
+    free(model->_evicted);
+    model->_evicted = NULL;
+}
+
+// Reads the buffers back before the GL objects are deleted, the format, levels of detail and bounds
+// stay on the model
+static bool evict(struct BaseResource *resource) {
+    struct Model *model = (struct Model *) resource;
+    if (model->_vao == -1 || model->_vbo == -1 || model->_sizeInVertices == 0) return false;
+
+    struct ModelEvictedData *evicted = calloc(1, sizeof(struct ModelEvictedData));
+    if (evicted == NULL) return false;
+
+    size_t vertexBytes = ((size_t) model->_format.stride) * model->_sizeInVertices;
+    size_t indexBytes = model->_ibo != 0 ? getIndexSize(model) * model->_sizeInIndices : 0;
+    evicted->vertices = malloc(vertexBytes);
+    evicted->indices = indexBytes > 0 ? malloc(indexBytes) : NULL;
+    if (evicted->vertices == NULL || (indexBytes > 0 && evicted->indices == NULL)) {
+        free(evicted->vertices);
+        free(evicted->indices);
+        free(evicted);
+        return false;
+    }
+
+    glGetNamedBufferSubData(model->_vbo, 0, (GLsizeiptr) vertexBytes, evicted->vertices);
+    evicted->numVertices = model->_sizeInVertices;
+    evicted->format = model->_format;
+    if (indexBytes > 0) {
+        glGetNamedBufferSubData(model->_ibo, 0, (GLsizeiptr) indexBytes, evicted->indices);
+        evicted->numIndices = model->_sizeInIndices;
+        evicted->indexSize = getIndexSize(model);
+        memcpy(evicted->lods, model->_lods, sizeof(model->_lods));
+        evicted->numLods = model->_numLods;
+    }
+
+    deleteEvictedData(model);
+    deleteIBO(model);
+    deleteVBO(model);
+    deleteVAO(model);
+    model->_evicted = evicted;
+
+    return true;
+}
+
+static bool restore(struct BaseResource *resource) {
+    struct Model *model = (struct Model *) resource;
+    struct ModelEvictedData *evicted = model->_evicted;
+    // the geometry was cleared while the model was evicted, there is nothing to bring back
+    if (evicted == NULL) return true;
+
+    // uploading replaces the evicted data, so it is detached first
+    model->_evicted = NULL;
+    setModelVertexBuffer(model, evicted->vertices, evicted->numVertices, &evicted->format);
+    if (evicted->indices != NULL) {
+        setModelPackedIndexBuffer(model, evicted->indices, evicted->numIndices, evicted->indexSize);
+        setModelLods(model, evicted->lods, evicted->numLods);
+    }
+
+    bool restored = model->_vao != -1;
+    if (restored) {
+        free(evicted->vertices);
+        free(evicted->indices);
+        free(evicted);
+    } else {
+        model->_evicted = evicted;
+    }
+
+    return restored;
+}
+
 static void delete(struct BaseResource **resourcePtr) {
     if (resourcePtr == NULL) return;
 
@@ -54,11 +179,22 @@ void allocModel(struct Model **modelPtr) {
     base->_type = RESOURCE_TYPE_MODEL;
     allocString(&base->_typeName, RESOURCE_TYPE_NAME_MODEL);
     base->delete = delete;
+    base->evict = evict;
+    base->restore = restore;
     base = NULL;
 
     newModel->_vao = -1;
     newModel->_vbo = -1;
     newModel->_sizeInVertices = 0;
+    newModel->_hasInstanceAttribs = false;
+    newModel->_ibo = 0;
+    newModel->_sizeInIndices = 0;
+    newModel->_indexType = GL_UNSIGNED_INT;
+    newModel->_numLods = 0;
+    newModel->_boundsRadius = 0.0f;
+    newModel->_evicted = NULL;
+    initVertexFormatPNT(&newModel->_format);
+    Mat4Identity(newModel->_dequantizationMtx);
 
     (*modelPtr) = newModel;
     newModel = NULL;
@@ -69,6 +205,8 @@ void deleteModel(struct Model **modelPtr) {
 
     struct Model *model = (*modelPtr);
 
+    deleteEvictedData(model);
+    deleteIBO(model);
     deleteVBO(model);
     deleteVAO(model);
 
@@ -79,61 +217,324 @@ void deleteModel(struct Model **modelPtr) {
     (*modelPtr) = NULL;
 }
 
-// TODO: custom vertex formats?
+static void setVertexAttributes(const struct VertexFormat *format) {
+    const GLsizei stride = (GLsizei) format->stride;
+
+    glEnableVertexAttribArray(positionShaderIndex);
+    glEnableVertexAttribArray(normalShaderIndex);
+    glEnableVertexAttribArray(texCoordShaderIndex);
+
+    const void *positionOffset = (const void *) (size_t) format->positionOffset;
+    if (format->position == VERTEX_POSITION_SNORM16) {
+        glVertexAttribPointer(positionShaderIndex, 3, GL_SHORT, GL_TRUE, stride, positionOffset);
+    } else {
+        glVertexAttribPointer(positionShaderIndex, 3, GL_FLOAT, GL_FALSE, stride, positionOffset);
+    }
+
+    const void *normalOffset = (const void *) (size_t) format->normalOffset;
+    if (format->normal == VERTEX_NORMAL_SNORM_10_10_10_2) {
+        // packed types must be fetched with size 4, the w component is ignored by vec3 inputs
+        glVertexAttribPointer(normalShaderIndex, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, normalOffset);
+    } else {
+        glVertexAttribPointer(normalShaderIndex, 3, GL_FLOAT, GL_FALSE, stride, normalOffset);
+    }
+
+    const void *texCoordOffset = (const void *) (size_t) format->texCoordOffset;
+    if (format->texCoord == VERTEX_TEXCOORD_HALF2) {
+        glVertexAttribPointer(texCoordShaderIndex, 2, GL_HALF_FLOAT, GL_FALSE, stride, texCoordOffset);
+    } else {
+        glVertexAttribPointer(texCoordShaderIndex, 2, GL_FLOAT, GL_FALSE, stride, texCoordOffset);
+    }
+}
+
 void setModelPNTBuffer(struct Model *model, struct VertexPNT *buffer, size_t bufferSizeInVertices) {
-    if (model == NULL || buffer == NULL || bufferSizeInVertices == 0) return;
+    struct VertexFormat format;
+    initVertexFormatPNT(&format);
+
+    setModelVertexBuffer(model, buffer, bufferSizeInVertices, &format);
+}
+
+// Uploads vertices already encoded in the given format, see encodeVertices
+void setModelVertexBuffer(struct Model *model, const void *vertices, size_t numVertices, const struct VertexFormat *format) {
+    if (model == NULL || vertices == NULL || numVertices == 0 || format == NULL) return;
 
     GLuint newVao = -1;
     glGenVertexArrays(1, &newVao);
     if (newVao == -1) return;
 
-    glBindVertexArray(newVao);
+    bindGLVertexArray(newVao);
 
     GLuint newVbo = -1;
     glGenBuffers(1, &newVbo);
     if (newVbo == -1) {
-        glBindVertexArray(0);
+        bindGLVertexArray(0);
         glDeleteVertexArrays(1, &newVao);
         return;
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, newVbo);
-    size_t bufferSizeInBytes = (sizeof(struct VertexPNT)) * bufferSizeInVertices;
-    glBufferData(GL_ARRAY_BUFFER, bufferSizeInBytes, buffer, GL_STATIC_DRAW);
+    size_t bufferSizeInBytes = ((size_t) format->stride) * numVertices;
+    glBufferData(GL_ARRAY_BUFFER, bufferSizeInBytes, vertices, GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(positionShaderIndex);
-    glEnableVertexAttribArray(normalShaderIndex);
-    glEnableVertexAttribArray(texCoordShaderIndex);
-
-    glVertexAttribPointer(positionShaderIndex, 3, GL_FLOAT, GL_FALSE, 32, (const void *) 0);
-    glVertexAttribPointer(normalShaderIndex, 3, GL_FLOAT, GL_FALSE, 32, (const void *) 12);
-    glVertexAttribPointer(texCoordShaderIndex, 2, GL_FLOAT, GL_FALSE, 32, (const void *) 24);
+    setVertexAttributes(format);
 
-    glBindVertexArray(0);
+    bindGLVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     deleteVAO(model);
     deleteVBO(model);
+    deleteIBO(model);
 
     model->_vao = newVao;
     model->_vbo = newVbo;
+    model->_sizeInVertices = numVertices;
+    model->_hasInstanceAttribs = false;
+    model->_format = (*format);
+    calcVertexFormatDequantizationMatrix(format, model->_dequantizationMtx);
+    deleteEvictedData(model);
+    updateGpuBytes(model);
+}
+
+// Narrows indices to 16 bits in place when every vertex is addressable with them and returns the
+// resulting size of one index in bytes, the same choice setModelIndexBuffer makes
+size_t packModelIndices(uint32_t *indices, size_t numIndices, size_t numVertices) {
+    if (indices == NULL || numVertices > UINT16_MAX + 1) return sizeof(uint32_t);
+
+    // each 16 bit index lands at or before the 32 bit one it came from, so a forward pass is safe
+    uint16_t *shortIndices = (uint16_t *) indices;
+    for (size_t i = 0; i < numIndices; ++i) {
+        shortIndices[i] = (uint16_t) indices[i];
+    }
+
+    return sizeof(uint16_t);
+}
+
+// Describes the model's triangles with an index buffer, which is stored as 16 bit indices
+// when the model has few enough vertices
+void setModelIndexBuffer(struct Model *model, const uint32_t *indices, size_t numIndices) {
+    if (model == NULL || model->_vao == -1 || indices == NULL || numIndices == 0) return;
+
+    if (model->_sizeInVertices <= UINT16_MAX + 1) {
+        uint16_t *shortIndices = malloc(numIndices * sizeof(uint16_t));
+        if (shortIndices != NULL) {
+            for (size_t i = 0; i < numIndices; ++i) {
+                shortIndices[i] = (uint16_t) indices[i];
+            }
+
+            setModelPackedIndexBuffer(model, shortIndices, numIndices, sizeof(uint16_t));
+            free(shortIndices);
+            return;
+        }
+    }
+
+    setModelPackedIndexBuffer(model, indices, numIndices, sizeof(uint32_t));
+}
+
+// Uploads indices that are already 16 or 32 bits wide as given, without any conversion
+void setModelPackedIndexBuffer(struct Model *model, const void *indices, size_t numIndices, size_t indexSize) {
+    if (model == NULL || model->_vao == -1 || indices == NULL || numIndices == 0) return;
+
+    if (indexSize != sizeof(uint16_t) && indexSize != sizeof(uint32_t)) {
+        error_log("[Model]: Unsupported index size of %zu bytes", indexSize);
+        return;
+    }
+
+    GLuint newIbo = 0;
+    glGenBuffers(1, &newIbo);
+    if (newIbo == 0) return;
+
+    // the element array binding is part of the VAO, so it is bound while the model's VAO is current
+    bindGLVertexArray(model->_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, newIbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * numIndices, indices, GL_STATIC_DRAW);
+    bindGLVertexArray(0);
+
+    deleteIBO(model);
+    model->_ibo = newIbo;
+    model->_sizeInIndices = numIndices;
+    model->_indexType = indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    updateGpuBytes(model);
+
+    struct ModelLod fullDetail = {0, numIndices, 0.0f};
+    setModelLods(model, &fullDetail, 1);
+}
+
+// Describes the levels of detail packed into the index buffer, ordered from the full detail mesh
+// to the coarsest one. Replaces whatever levels the model had
+void setModelLods(struct Model *model, const struct ModelLod *lods, size_t numLods) {
+    if (model == NULL || lods == NULL || numLods == 0) return;
+
+    if (numLods > MODEL_MAX_LODS) {
+        warning_log("[Model]: Only the first %d of %zu levels of detail are kept", MODEL_MAX_LODS, numLods);
+        numLods = MODEL_MAX_LODS;
+    }
+
+    for (size_t i = 0; i < numLods; ++i) {
+        if (lods[i].numIndices == 0 || lods[i].firstIndex > model->_sizeInIndices ||
+            lods[i].numIndices > model->_sizeInIndices - lods[i].firstIndex) {
+            error_log("[Model]: Level of detail %zu lies outside of the index buffer", i);
+            return;
+        }
+    }
+
+    memcpy(model->_lods, lods, numLods * sizeof(struct ModelLod));
+    model->_numLods = numLods;
+}
+
+// Sphere around the vertices in model space, used to estimate how large the model appears on screen
+void setModelBounds(struct Model *model, const float center[3], float radius) {
+    if (model == NULL || center == NULL) return;
+
+    Vec3Copy(model->_boundsCenter, center);
+    model->_boundsRadius = radius;
+}
+
+// pixelsPerUnit is the on screen size of one model unit at the model's distance. Starts from the
+// level used last frame and moves one way only, so the result is stable while nothing moves
+size_t selectModelLod(const struct Model *model, float pixelsPerUnit, size_t currentLod, float maxPixelError) {
+    if (model == NULL || model->_numLods <= 1) return 0;
+
+    size_t lod = currentLod < model->_numLods ? currentLod : model->_numLods - 1;
+
+    while (lod > 0 && model->_lods[lod].error * pixelsPerUnit > maxPixelError) {
+        lod--;
+    }
+
+    float coarsenError = maxPixelError * (1.0f - MODEL_LOD_HYSTERESIS);
+    while (lod + 1 < model->_numLods && model->_lods[lod + 1].error * pixelsPerUnit <= coarsenError) {
+        lod++;
+    }
+
+    return lod;
+}
+
+static const void *getLodIndexOffset(const struct Model *model, const struct ModelLod *lod) {
+    size_t indexSize = model->_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    return (const void *) (lod->firstIndex * indexSize);
+}
+
+static const struct ModelLod *getModelLod(const struct Model *model, size_t lod) {
+    if (model->_numLods == 0) return NULL;
+
+    return &model->_lods[lod < model->_numLods ? lod : model->_numLods - 1];
+}
+
+// Refills the vertex buffer of an existing model in place, for geometry that is rebuilt at runtime.
+// The VAO keeps pointing at the same buffer so nothing has to be re-specified
+void updateModelPNTBuffer(struct Model *model, struct VertexPNT *buffer, size_t bufferSizeInVertices) {
+    if (model == NULL) return;
+
+    if (bufferSizeInVertices == 0 || buffer == NULL) {
+        model->_sizeInVertices = 0;
+        deleteEvictedData(model);
+        updateGpuBytes(model);
+        return;
+    }
+
+    if (model->_vao == -1 || model->_vbo == -1 || model->_format.stride != sizeof(struct VertexPNT)) {
+        setModelPNTBuffer(model, buffer, bufferSizeInVertices);
+        return;
+    }
+
+    // runtime geometry is never indexed, the VAO keeps the old index buffer alive until it is rebuilt
+    deleteIBO(model);
+
+    glBindBuffer(GL_ARRAY_BUFFER, model->_vbo);
+    glBufferData(GL_ARRAY_BUFFER, (sizeof(struct VertexPNT)) * bufferSizeInVertices, buffer, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
     model->_sizeInVertices = bufferSizeInVertices;
+    updateGpuBytes(model);
+}
+
+// Quantised models fold their dequantisation into the world matrix, so shaders never know about it.
+// Returns wMtx untouched for everything else
+const float *calcModelWorldMatrix(const struct Model *model, const float wMtx[16], float scratch[16]) {
+    if (model == NULL || wMtx == NULL || scratch == NULL || !isVertexFormatQuantized(&model->_format)) return wMtx;
+
+    Mat4Mult(scratch, model->_dequantizationMtx, wMtx);
+
+    return scratch;
 }
 
 void bindModel(struct Model *model) {
-    if (model == NULL || model->_vao == -1) return;
+    if (model == NULL || !useResource((struct BaseResource *) model) || model->_vao == -1) return;
 
-    glBindVertexArray(model->_vao);
+    bindGLVertexArray(model->_vao);
 }
 
+// The vertex array is left bound, binding the same model again costs nothing
 void unbindModel(struct Model *model) {
     if (model == NULL) return;
-
-    glBindVertexArray(0);
 }
 
 void renderModel(struct Model *model) {
+    renderModelLod(model, 0);
+}
+
+// Levels past the coarsest one draw the coarsest one, models without levels always draw in full
+void renderModelLod(struct Model *model, size_t lod) {
     if (model == NULL || model->_vao == -1 || model->_sizeInVertices == 0) return;
 
+    const struct ModelLod *modelLod = getModelLod(model, lod);
+    if (model->_sizeInIndices > 0 && modelLod != NULL) {
+        glDrawElements(GL_TRIANGLES, (GLsizei) modelLod->numIndices, model->_indexType, getLodIndexOffset(model, modelLod));
+        return;
+    }
+
     glDrawArrays(GL_TRIANGLES, 0, (int) model->_sizeInVertices);
 }
+
+static void setInstanceMatrixAttribute(GLuint vao, GLuint firstIndex, GLuint offset) {
+    for (GLuint row = 0; row < 4; ++row) {
+        glEnableVertexArrayAttrib(vao, firstIndex + row);
+        glVertexArrayAttribFormat(vao, firstIndex + row, 4, GL_FLOAT, GL_FALSE, offset + (GLuint) (sizeof(float) * 4 * row));
+        glVertexArrayAttribBinding(vao, firstIndex + row, INSTANCE_BUFFER_BINDING);
+    }
+}
+
+// Attaches the per instance attributes to this model's VAO. The attribute layout is set up once,
+// the buffer itself is rebound on every call: models are shared between scenes that each own an
+// instance buffer, and a deleted buffer's name can come back for a different one
+void setModelInstanceBuffer(struct Model *model, unsigned int instanceVbo) {
+    if (model == NULL || model->_vao == -1 || instanceVbo == 0) return;
+
+    if (!model->_hasInstanceAttribs) {
+        setInstanceMatrixAttribute(model->_vao, INSTANCE_W_MTX_ATTRIB_INDEX, offsetof(struct InstanceData, wMtx));
+        setInstanceMatrixAttribute(model->_vao, INSTANCE_WIT_MTX_ATTRIB_INDEX, offsetof(struct InstanceData, witMtx));
+        glVertexArrayBindingDivisor(model->_vao, INSTANCE_BUFFER_BINDING, 1);
+        model->_hasInstanceAttribs = true;
+    }
+
+    glVertexArrayVertexBuffer(model->_vao, INSTANCE_BUFFER_BINDING, instanceVbo, 0, sizeof(struct InstanceData));
+}
+
+void renderModelInstanced(struct Model *model, size_t numInstances, size_t firstInstance) {
+    renderModelInstancedLod(model, 0, numInstances, firstInstance);
+}
+
+void renderModelInstancedLod(struct Model *model, size_t lod, size_t numInstances, size_t firstInstance) {
+    if (model == NULL || model->_vao == -1 || model->_sizeInVertices == 0 || numInstances == 0) return;
+
+    const struct ModelLod *modelLod = getModelLod(model, lod);
+    if (model->_sizeInIndices > 0 && modelLod != NULL) {
+        glDrawElementsInstancedBaseInstance(
+            GL_TRIANGLES,
+            (GLsizei) modelLod->numIndices,
+            model->_indexType,
+            getLodIndexOffset(model, modelLod),
+            (GLsizei) numInstances,
+            (GLuint) firstInstance
+        );
+        return;
+    }
+
+    glDrawArraysInstancedBaseInstance(
+        GL_TRIANGLES,
+        0,
+        (int) model->_sizeInVertices,
+        (GLsizei) numInstances,
+        (GLuint) firstInstance
+    );
+}
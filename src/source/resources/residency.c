@@ -0,0 +1,168 @@
+#include "config.h"
+#include "logger.h"
+#include "custom_string.h"
+#include "resources/base_resource.h"
+#include "resources/residency.h"
+
+#define BYTES_PER_MEGABYTE (1024 * 1024)
+
+// Evictable resources holding GPU memory, most recently used first
+static struct BaseResource *lruHead = NULL;
+static struct BaseResource *lruTail = NULL;
+static size_t residentBytes = 0;
+static uint64_t currentFrame = 0;
+
+static const char *describeResource(struct BaseResource *resource) {
+    const char *name = getChars(getResourceName(resource));
+
+    return name != NULL ? name : "unnamed resource";
+}
+
+static bool isLinked(const struct BaseResource *resource) {
+    return resource->_lruPrev != NULL || lruHead == resource;
+}
+
+static void unlinkResource(struct BaseResource *resource) {
+    if (!isLinked(resource)) return;
+
+    if (resource->_lruPrev != NULL) {
+        resource->_lruPrev->_lruNext = resource->_lruNext;
+    } else {
+        lruHead = resource->_lruNext;
+    }
+
+    if (resource->_lruNext != NULL) {
+        resource->_lruNext->_lruPrev = resource->_lruPrev;
+    } else {
+        lruTail = resource->_lruPrev;
+    }
+
+    resource->_lruPrev = NULL;
+    resource->_lruNext = NULL;
+}
+
+static void linkResourceAtHead(struct BaseResource *resource) {
+    resource->_lruPrev = NULL;
+    resource->_lruNext = lruHead;
+    if (lruHead != NULL) {
+        lruHead->_lruPrev = resource;
+    } else {
+        lruTail = resource;
+    }
+    lruHead = resource;
+}
+
+void setResourceGpuBytes(struct BaseResource *resource, size_t numBytes) {
+    if (resource == NULL) return;
+
+    residentBytes -= resource->_gpuBytes;
+    residentBytes += numBytes;
+    resource->_gpuBytes = numBytes;
+
+    // new GL objects replace whatever the resource would have restored
+    if (numBytes > 0) {
+        resource->_evicted = false;
+    }
+
+    if (numBytes == 0 || resource->evict == NULL) {
+        unlinkResource(resource);
+    } else if (!isLinked(resource)) {
+        linkResourceAtHead(resource);
+    }
+}
+
+size_t getResourceGpuBytes(struct BaseResource *resource) {
+    if (resource == NULL) return 0;
+
+    return resource->_gpuBytes;
+}
+
+bool useResource(struct BaseResource *resource) {
+    if (resource == NULL) return false;
+
+    if (resource->_evicted) {
+        if (resource->restore == NULL || !resource->restore(resource)) {
+            error_log("[Residency]: Could not restore \"%s\"", describeResource(resource));
+            return false;
+        }
+
+        resource->_evicted = false;
+        trace_log("[Residency]: Restored \"%s\"", describeResource(resource));
+    }
+
+    if (resource->_lastUsedFrame == currentFrame) return true;
+    resource->_lastUsedFrame = currentFrame;
+
+    if (isLinked(resource) && lruHead != resource) {
+        unlinkResource(resource);
+        linkResourceAtHead(resource);
+    }
+
+    return true;
+}
+
+bool isResourceEvicted(struct BaseResource *resource) {
+    if (resource == NULL) return false;
+
+    return resource->_evicted;
+}
+
+bool evictResource(struct BaseResource *resource) {
+    if (resource == NULL || resource->_evicted || resource->evict == NULL) return false;
+
+    size_t freedBytes = resource->_gpuBytes;
+    if (!resource->evict(resource)) return false;
+
+    // the evict function is expected to report 0 bytes, this keeps the total right when it does not
+    setResourceGpuBytes(resource, 0);
+    resource->_evicted = true;
+
+    trace_log(
+        "[Residency]: Evicted \"%s\", %zu bytes freed, %zu bytes remain resident",
+        describeResource(resource), freedBytes, residentBytes
+    );
+
+    return true;
+}
+
+void forgetResourceResidency(struct BaseResource *resource) {
+    if (resource == NULL) return;
+
+    residentBytes -= resource->_gpuBytes;
+    resource->_gpuBytes = 0;
+    resource->_evicted = false;
+    unlinkResource(resource);
+}
+
+void endResidencyFrame() {
+    int budgetInMegabytes = getConfigGpuMemoryBudget();
+    int evictAfterFrames = getConfigResourceEvictAfterFrames();
+    size_t budget = budgetInMegabytes > 0 ? ((size_t) budgetInMegabytes) * BYTES_PER_MEGABYTE : 0;
+    uint64_t minUnusedFrames = evictAfterFrames > 1 ? (uint64_t) evictAfterFrames : 1;
+
+    // the list is ordered by last use, so the first resource that is still too recent ends the walk
+    struct BaseResource *resource = lruTail;
+    while (budget > 0 && residentBytes > budget && resource != NULL) {
+        struct BaseResource *prev = resource->_lruPrev;
+        if (currentFrame - resource->_lastUsedFrame < minUnusedFrames) break;
+
+        if (!evictResource(resource)) {
+            // resources that refuse are treated as used so they are not retried every frame
+            resource->_lastUsedFrame = currentFrame;
+            unlinkResource(resource);
+            linkResourceAtHead(resource);
+        }
+
+        resource = prev;
+    }
+
+    currentFrame++;
+}
+
+uint64_t getResidencyFrame() {
+    return currentFrame;
+}
+
+size_t getResidentGpuBytes() {
+    return residentBytes;
+}
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "logger.h"
+#include "custom_string.h"
+#include "resources/base_resource.h"
+#include "resources/resource_cache.h"
+
+#define RESOURCE_CACHE_KEY_SEPARATOR "|"
+
+struct ResourceCacheEntry {
+    char *key;
+    unsigned int hash;
+    size_t refCount;
+
+    struct BaseResource **resources;
+    size_t numResources;
+
+    struct ResourceCacheEntry **dependencies;
+    size_t numDependencies;
+};
+
+// A scene imports tens of files, not thousands, so the entries are searched linearly by hash
+static struct ResourceCacheEntry **entries = NULL;
+static size_t numEntries = 0;
+static size_t entriesCapacity = 0;
+// Set at shutdown, entries that are still referenced then are leaked rather than freed under their holders
+static bool cacheFinalized = false;
+
+char *allocCanonicalPath(const char *path) {
+    if (path == NULL) return NULL;
+
+#ifndef _WIN32
+    return realpath(path, NULL);
+#else
+    return _fullpath(NULL, path, 0);
+#endif
+}
+
+void buildResourceCacheKey(struct String **keyPtr, const char *path, const char *params) {
+    if (keyPtr == NULL || path == NULL) return;
+
+    // files that can not be resolved still get a key, the import reports the missing file itself
+    char *canonicalPath = allocCanonicalPath(path);
+    const char *keyPath = canonicalPath != NULL ? canonicalPath : path;
+
+    size_t pathLength = strlen(keyPath);
+    size_t paramsLength = params != NULL ? strlen(params) : 0;
+    size_t separatorLength = strlen(RESOURCE_CACHE_KEY_SEPARATOR);
+
+    char *key = malloc(pathLength + separatorLength + paramsLength + 1);
+    if (key == NULL) {
+        critical_log("%s", "[ResourceCache]: Memory allocation failure while building cache key");
+        free(canonicalPath);
+        return;
+    }
+
+    memcpy(key, keyPath, pathLength);
+    memcpy(key + pathLength, RESOURCE_CACHE_KEY_SEPARATOR, separatorLength);
+    if (paramsLength > 0) {
+        memcpy(key + pathLength + separatorLength, params, paramsLength);
+    }
+    key[pathLength + separatorLength + paramsLength] = 0;
+
+    if ((*keyPtr) == NULL) {
+        allocString(keyPtr, key);
+    } else {
+        setChars((*keyPtr), key);
+    }
+
+    free(key);
+    free(canonicalPath);
+}
+
+static struct ResourceCacheEntry *findEntry(const char *key) {
+    unsigned int hash = hashChars(key);
+    for (size_t i = 0; i < numEntries; ++i) {
+        if (entries[i]->hash == hash && strcmp(entries[i]->key, key) == 0) return entries[i];
+    }
+
+    return NULL;
+}
+
+bool hasResourceCacheEntry(const char *key) {
+    if (key == NULL) return false;
+
+    return findEntry(key) != NULL;
+}
+
+struct ResourceCacheEntry *acquireResourceCacheEntry(const char *key) {
+    if (key == NULL) return NULL;
+
+    struct ResourceCacheEntry *entry = findEntry(key);
+    if (entry != NULL) {
+        entry->refCount++;
+    }
+
+    return entry;
+}
+
+static void deleteEntry(struct ResourceCacheEntry *entry) {
+    for (size_t i = 0; i < entry->numResources; ++i) {
+        deleteResource(&entry->resources[i]);
+    }
+
+    for (size_t i = 0; i < entry->numDependencies; ++i) {
+        releaseResourceCacheEntry(&entry->dependencies[i]);
+    }
+
+    free(entry->resources);
+    free(entry->dependencies);
+    free(entry->key);
+    free(entry);
+}
+
+struct ResourceCacheEntry *addResourceCacheEntry(
+    const char *key,
+    struct BaseResource **resources,
+    size_t numResources,
+    struct ResourceCacheEntry **dependencies,
+    size_t numDependencies
+) {
+    if (key == NULL || (numResources > 0 && resources == NULL) || (numDependencies > 0 && dependencies == NULL)) return NULL;
+
+    if (findEntry(key) != NULL) {
+        error_log("[ResourceCache]: \"%s\" is already cached", key);
+        return NULL;
+    }
+
+    if (numEntries == entriesCapacity) {
+        size_t newCapacity = entriesCapacity > 0 ? entriesCapacity * 2 : 16;
+        struct ResourceCacheEntry **newEntries = realloc(entries, newCapacity * sizeof(struct ResourceCacheEntry *));
+        if (newEntries == NULL) {
+            critical_log("%s", "[ResourceCache]: Could not grow entry list");
+            return NULL;
+        }
+
+        entries = newEntries;
+        entriesCapacity = newCapacity;
+    }
+
+    struct ResourceCacheEntry *newEntry = calloc(1, sizeof(struct ResourceCacheEntry));
+    if (newEntry == NULL) {
+        critical_log("%s", "[ResourceCache]: Memory allocation failure while adding entry");
+        return NULL;
+    }
+
+    size_t keyLength = strlen(key);
+    newEntry->key = malloc(keyLength + 1);
+    newEntry->resources = numResources > 0 ? malloc(numResources * sizeof(struct BaseResource *)) : NULL;
+    newEntry->dependencies = numDependencies > 0 ? malloc(numDependencies * sizeof(struct ResourceCacheEntry *)) : NULL;
+    if (newEntry->key == NULL || (numResources > 0 && newEntry->resources == NULL) || (numDependencies > 0 && newEntry->dependencies == NULL)) {
+        critical_log("%s", "[ResourceCache]: Memory allocation failure while adding entry");
+        free(newEntry->key);
+        free(newEntry->resources);
+        free(newEntry->dependencies);
+        free(newEntry);
+        return NULL;
+    }
+
+    memcpy(newEntry->key, key, keyLength + 1);
+    newEntry->hash = hashChars(key);
+    newEntry->refCount = 1;
+    if (numResources > 0) {
+        memcpy(newEntry->resources, resources, numResources * sizeof(struct BaseResource *));
+    }
+    newEntry->numResources = numResources;
+
+    for (size_t i = 0; i < numDependencies; ++i) {
+        retainResourceCacheEntry(dependencies[i]);
+        newEntry->dependencies[i] = dependencies[i];
+    }
+    newEntry->numDependencies = numDependencies;
+
+    entries[numEntries++] = newEntry;
+    trace_log("[ResourceCache]: Cached %zu resources as \"%s\"", numResources, key);
+
+    return newEntry;
+}
+
+void retainResourceCacheEntry(struct ResourceCacheEntry *entry) {
+    if (entry == NULL) return;
+
+    entry->refCount++;
+}
+
+void releaseResourceCacheEntry(struct ResourceCacheEntry **entryPtr) {
+    if (entryPtr == NULL || (*entryPtr) == NULL) return;
+
+    struct ResourceCacheEntry *entry = (*entryPtr);
+    (*entryPtr) = NULL;
+
+    if (cacheFinalized) return;
+
+    entry->refCount--;
+    if (entry->refCount > 0) return;
+
+    // the list stays in the order entries were added, finalizeResourceCache relies on it
+    for (size_t i = 0; i < numEntries; ++i) {
+        if (entries[i] != entry) continue;
+
+        memmove(&entries[i], &entries[i + 1], (numEntries - i - 1) * sizeof(struct ResourceCacheEntry *));
+        numEntries--;
+        break;
+    }
+
+    trace_log("[ResourceCache]: Releasing \"%s\"", entry->key);
+    deleteEntry(entry);
+}
+
+size_t getResourceCacheEntryResources(struct ResourceCacheEntry *entry, struct BaseResource *const **resourcesOut) {
+    if (resourcesOut != NULL) (*resourcesOut) = NULL;
+    if (entry == NULL || resourcesOut == NULL) return 0;
+
+    (*resourcesOut) = entry->resources;
+
+    return entry->numResources;
+}
+
+const char *getResourceCacheEntryKey(struct ResourceCacheEntry *entry) {
+    if (entry == NULL) return NULL;
+
+    return entry->key;
+}
+
+void finalizeResourceCache() {
+    // released entries are deleted right away, so everything left here is still held by a manager that
+    // outlived garbage collection. Its resources may still be in use, so they are reported and leaked
+    for (size_t i = 0; i < numEntries; ++i) {
+        warning_log("[ResourceCache]: \"%s\" is still referenced %zu times at shutdown, it will be leaked", entries[i]->key, entries[i]->refCount);
+    }
+
+    free(entries);
+    entries = NULL;
+    numEntries = 0;
+    entriesCapacity = 0;
+    cacheFinalized = true;
+}
@@ -7,89 +7,73 @@
 #include "custom_string.h"
 #include "resources/shader.h"
 #include "resources/texture.h"
+#include "rendering/gl_state.h"
 
 #define RESOURCE_TYPE_SHADER 3
 
-struct UniformListNode {
-    struct String *name;
-    GLint location;
-    struct UniformListNode *next;
+static const char *uniformBlockNames[SHADER_NUM_UNIFORM_BLOCK_BINDINGS] = {
+    SHADER_LIGHT_BLOCK_NAME,
+    SHADER_FRAME_BLOCK_NAME,
 };
 
-static void allocUniformListNode(struct UniformListNode **listNodePtr) {
-    if (listNodePtr == NULL || (*listNodePtr) != NULL) return;
+static const char *storageBlockNames[SHADER_NUM_STORAGE_BLOCK_BINDINGS] = {
+    SHADER_CLUSTER_LIGHT_BUFFER_NAME,
+    SHADER_CLUSTER_GRID_BUFFER_NAME,
+    SHADER_CLUSTER_INDEX_BUFFER_NAME,
+};
 
-    struct UniformListNode *newNode = calloc(1, sizeof(struct UniformListNode));
-    if (newNode == NULL) return;
-    newNode->next = NULL;
-    newNode->name = NULL;
-    newNode->location = -1;
+#define UNIFORM_TABLE_EMPTY_SLOT -1
 
-    (*listNodePtr) = newNode;
-    newNode = NULL;
-}
+struct ShaderUniform {
+    struct String *name;
+    unsigned int hash;
+    GLint location;
+};
 
-static void initUniformListNode(
-    struct UniformListNode *listNode,
-    GLint location,
-    const char *name
-) {
-    if (listNode == NULL || name == NULL || location == -1) return;
+static void deleteShaderUniforms(struct Shader *shader) {
+    if (shader == NULL) return;
 
-    listNode->location = location;
-    if(listNode->name != NULL) {
-        setChars(listNode->name, name);
-    } else {
-        allocString(&listNode->name, name);
+    for (size_t i = 0; i < shader->_numUniforms; ++i) {
+        deleteString(&shader->_uniforms[i].name);
     }
-}
 
-static void deleteUniformListNode(struct UniformListNode **listNodePtr) {
-    if (listNodePtr == NULL || (*listNodePtr) == NULL) return;
+    free(shader->_uniforms);
+    shader->_uniforms = NULL;
+    shader->_numUniforms = 0;
 
-    struct UniformListNode *node = (*listNodePtr);
-    deleteUniformListNode(&node->next);
-    deleteString(&node->name);
-
-    free(node);
-    node = NULL;
-    (*listNodePtr) = NULL;
+    free(shader->_uniformTable);
+    shader->_uniformTable = NULL;
+    shader->_uniformTableSize = 0;
 }
 
-static void storeShaderUniformInfo(struct Shader *shader, GLint location, const char *name) {
-    if (shader == NULL || location == -1 || name == NULL) return;
+// Open addressing table of indexes into _uniforms. The table is sized to a power of two at least
+// twice the uniform count, so probe chains stay short and lookups never walk a full list
+static void buildUniformTable(struct Shader *shader) {
+    if (shader == NULL || shader->_numUniforms == 0) return;
 
-    struct UniformListNode *prevNode = NULL, *curNode = shader->uniformList;
-    while(curNode != NULL) {
-        prevNode = curNode;
-        curNode = curNode->next;
+    size_t tableSize = 8;
+    while (tableSize < shader->_numUniforms * 2) {
+        tableSize *= 2;
     }
 
-    struct UniformListNode *newNode = NULL;
-    allocUniformListNode(&newNode);
-    if (newNode == NULL) return;
-    initUniformListNode(newNode, location, name);
-
-    if (prevNode == NULL) {
-        shader->uniformList = newNode;
-    } else {
-        prevNode->next = newNode;
+    shader->_uniformTable = malloc(tableSize * sizeof(int));
+    if (shader->_uniformTable == NULL) {
+        critical_log("%s", "[Shader]: Could not allocate uniform lookup table");
+        return;
     }
-    newNode = NULL;
-}
+    shader->_uniformTableSize = tableSize;
 
-static GLint getUniformLocation(struct Shader *shader, const char *name) {
-    if (shader == NULL || name == NULL) return -1;
-
-    struct UniformListNode *curNode = shader->uniformList;
-    while (curNode != NULL) {
-        if (stringEqualsCStr(curNode->name, name)) break;
-        curNode = curNode->next;
+    for (size_t i = 0; i < tableSize; ++i) {
+        shader->_uniformTable[i] = UNIFORM_TABLE_EMPTY_SLOT;
     }
 
-    if (curNode == NULL) return -1;
-
-    return curNode->location;
+    for (size_t i = 0; i < shader->_numUniforms; ++i) {
+        size_t slot = shader->_uniforms[i].hash & (tableSize - 1);
+        while (shader->_uniformTable[slot] != UNIFORM_TABLE_EMPTY_SLOT) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        shader->_uniformTable[slot] = (int) i;
+    }
 }
 
 static void compileShader(GLuint shader) {
@@ -160,9 +144,17 @@ static void linkProgram(GLuint pgm) {
 static void queryShaderUniformLocations(struct Shader *shader) {
     if (shader == NULL || shader->_program == 0) return;
 
+    deleteShaderUniforms(shader);
+
     GLint numUniforms = 0;
     glGetProgramiv(shader->_program, GL_ACTIVE_UNIFORMS, &numUniforms);
-    if (numUniforms == 0) return;
+    if (numUniforms <= 0) return;
+
+    shader->_uniforms = calloc(numUniforms, sizeof(struct ShaderUniform));
+    if (shader->_uniforms == NULL) {
+        critical_log("%s", "[Shader]: Could not allocate uniform list");
+        return;
+    }
 
     for (GLuint i = 0; i < numUniforms; ++i) {
         char nameBuffer[64];
@@ -172,7 +164,45 @@ static void queryShaderUniformLocations(struct Shader *shader) {
         GLsizei nameLength = 0;
         glGetActiveUniform(shader->_program, i, 63, &nameLength, &uniformSize, &uniformType, nameBuffer);
 
-        storeShaderUniformInfo(shader, i, nameBuffer);
+        // members of uniform blocks are active uniforms too, but they have no location and are
+        // fed through the block's buffer instead
+        GLint location = glGetUniformLocation(shader->_program, nameBuffer);
+        if (location == -1) continue;
+
+        struct ShaderUniform *uniform = &shader->_uniforms[shader->_numUniforms];
+        allocString(&uniform->name, nameBuffer);
+        uniform->hash = hashChars(nameBuffer);
+        uniform->location = location;
+        shader->_numUniforms++;
+    }
+
+    buildUniformTable(shader);
+}
+
+static void bindShaderUniformBlocks(struct Shader *shader) {
+    if (shader == NULL || shader->_program == 0) return;
+
+    for (GLuint binding = 0; binding < SHADER_NUM_UNIFORM_BLOCK_BINDINGS; ++binding) {
+        shader->_uniformBlockSizes[binding] = 0;
+
+        GLuint blockIndex = glGetUniformBlockIndex(shader->_program, uniformBlockNames[binding]);
+        if (blockIndex == GL_INVALID_INDEX) continue;
+
+        GLint blockSize = 0;
+        glGetActiveUniformBlockiv(shader->_program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+        glUniformBlockBinding(shader->_program, blockIndex, binding);
+
+        shader->_uniformBlockSizes[binding] = (size_t) blockSize;
+    }
+
+    for (GLuint binding = 0; binding < SHADER_NUM_STORAGE_BLOCK_BINDINGS; ++binding) {
+        shader->_storageBlocksDeclared[binding] = false;
+
+        GLuint blockIndex = glGetProgramResourceIndex(shader->_program, GL_SHADER_STORAGE_BLOCK, storageBlockNames[binding]);
+        if (blockIndex == GL_INVALID_INDEX) continue;
+
+        glShaderStorageBlockBinding(shader->_program, blockIndex, binding);
+        shader->_storageBlocksDeclared[binding] = true;
     }
 }
 
@@ -251,7 +281,15 @@ void allocShader(struct Shader **shaderPtr) {
     newShader->_fragShader = 0;
     newShader->_program = 0;
 
-    newShader->uniformList = NULL;
+    newShader->_uniforms = NULL;
+    newShader->_numUniforms = 0;
+    newShader->_uniformTable = NULL;
+    newShader->_uniformTableSize = 0;
+    memset(newShader->_uniformBlockSizes, 0, sizeof(newShader->_uniformBlockSizes));
+    memset(newShader->_storageBlocksDeclared, 0, sizeof(newShader->_storageBlocksDeclared));
+
+    newShader->_instancedVariant = NULL;
+    newShader->_isInstanced = false;
 
     (*shaderPtr) = newShader;
     newShader = NULL;
@@ -265,10 +303,13 @@ void deleteShader(struct Shader **shaderPtr) {
     deleteGLShader(shader, &shader->_vertexShader);
     deleteGLShader(shader, &shader->_fragShader);
 
+    forgetGLProgram(shader->_program);
     glDeleteProgram(shader->_program);
     shader->_program = 0;
 
-    deleteUniformListNode(&shader->uniformList);
+    deleteShaderUniforms(shader);
+
+    deleteShader(&shader->_instancedVariant);
 
     finalizeBaseResource((struct BaseResource *) shader);
 
@@ -277,12 +318,32 @@ void deleteShader(struct Shader **shaderPtr) {
     (*shaderPtr) = NULL;
 }
 
-bool setShaderFloatArrayUniform(struct Shader *shader, const char *name, const float *src, size_t numElements) {
-    if (shader == NULL || name == NULL || src == NULL || numElements == 0) return false;
+int getShaderUniformHandle(struct Shader *shader, const char *name) {
+    if (shader == NULL || name == NULL || shader->_uniformTable == NULL) return SHADER_INVALID_UNIFORM_HANDLE;
+
+    const unsigned int hash = hashChars(name);
+    const size_t mask = shader->_uniformTableSize - 1;
+    for (size_t slot = hash & mask; shader->_uniformTable[slot] != UNIFORM_TABLE_EMPTY_SLOT; slot = (slot + 1) & mask) {
+        const int index = shader->_uniformTable[slot];
+        const struct ShaderUniform *uniform = &shader->_uniforms[index];
+        if (uniform->hash == hash && strcmp(getChars(uniform->name), name) == 0) return index;
+    }
+
+    return SHADER_INVALID_UNIFORM_HANDLE;
+}
+
+static GLint getHandleLocation(struct Shader *shader, int handle) {
+    if (shader == NULL || handle < 0 || ((size_t) handle) >= shader->_numUniforms) return -1;
+
+    return shader->_uniforms[handle].location;
+}
+
+bool setShaderFloatArrayUniformByHandle(struct Shader *shader, int handle, const float *src, size_t numElements) {
+    if (shader == NULL || src == NULL || numElements == 0) return false;
 
     if (numElements > 4) return false;
 
-    GLint loc = getUniformLocation(shader, name);
+    GLint loc = getHandleLocation(shader, handle);
     if (loc == -1) return false;
 
     switch (numElements) {
@@ -305,10 +366,10 @@ bool setShaderFloatArrayUniform(struct Shader *shader, const char *name, const f
     return true;
 }
 
-bool setShaderMatrixUniform(struct Shader *shader, const char *name, const float *src, size_t dimensions) {
-    if (shader == NULL || name == NULL || src == NULL) return false;
+bool setShaderMatrixUniformByHandle(struct Shader *shader, int handle, const float *src, size_t dimensions) {
+    if (shader == NULL || src == NULL) return false;
 
-    GLint loc = getUniformLocation(shader, name);
+    GLint loc = getHandleLocation(shader, handle);
     if (loc == -1) return false;
 
     if (dimensions == 3) {
@@ -322,10 +383,10 @@ bool setShaderMatrixUniform(struct Shader *shader, const char *name, const float
     return true;
 }
 
-bool setShaderIntUniform(struct Shader *shader, const char *name, const GLint *src, size_t dimensions) {
-    if (shader == NULL || name == NULL || src == NULL) return false;
+bool setShaderIntUniformByHandle(struct Shader *shader, int handle, const GLint *src, size_t dimensions) {
+    if (shader == NULL || src == NULL) return false;
 
-    GLint loc = getUniformLocation(shader, name);
+    GLint loc = getHandleLocation(shader, handle);
     if (loc == -1) return false;
 
     if (dimensions == 1) {
@@ -343,21 +404,38 @@ bool setShaderIntUniform(struct Shader *shader, const char *name, const GLint *s
     return true;
 }
 
+bool setShaderFloatArrayUniform(struct Shader *shader, const char *name, const float *src, size_t numElements) {
+    if (shader == NULL || name == NULL) return false;
+
+    return setShaderFloatArrayUniformByHandle(shader, getShaderUniformHandle(shader, name), src, numElements);
+}
+
+bool setShaderMatrixUniform(struct Shader *shader, const char *name, const float *src, size_t dimensions) {
+    if (shader == NULL || name == NULL) return false;
+
+    return setShaderMatrixUniformByHandle(shader, getShaderUniformHandle(shader, name), src, dimensions);
+}
+
+bool setShaderIntUniform(struct Shader *shader, const char *name, const GLint *src, size_t dimensions) {
+    if (shader == NULL || name == NULL) return false;
+
+    return setShaderIntUniformByHandle(shader, getShaderUniformHandle(shader, name), src, dimensions);
+}
+
 bool setShaderTextureUniform(struct Shader *shader, const char *name, struct Texture *texture) {
     if (shader == NULL || name == NULL || texture == NULL) return false;
 
-    if (!glIsTexture(texture->_id)) return false;
+    // going through the getter restores evicted textures
+    unsigned int textureId = getTextureId(texture);
+    if (textureId == 0) return false;
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture->_id);
+    bindGLTexture2D(0, textureId);
 
-    GLint loc = getUniformLocation(shader, name);
+    GLint loc = getHandleLocation(shader, getShaderUniformHandle(shader, name));
     if (loc == -1) return false;
 
     glUniform1i(loc, 0);
-    if (glGetError() != GL_NO_ERROR) {
-        warning_log("[Shader]: OpenGL raised error when setting \"%s\" shader param", name);
-    }
+    checkGLError("setting a texture shader param");
 
     return true;
 }
@@ -413,16 +491,52 @@ void initShader(struct Shader *shader, const char *vertexShaderSource, const cha
     pgm = 0;
 
     queryShaderUniformLocations(shader);
+    bindShaderUniformBlocks(shader);
+}
+
+void setShaderInstancedVariant(struct Shader *shader, struct Shader *instancedVariant) {
+    if (shader == NULL || instancedVariant == shader) return;
+
+    deleteShader(&shader->_instancedVariant);
+
+    shader->_instancedVariant = instancedVariant;
+    if (instancedVariant != NULL) {
+        instancedVariant->_isInstanced = true;
+    }
+}
+
+struct Shader *getShaderInstancedVariant(struct Shader *shader) {
+    if (shader == NULL) return NULL;
+
+    return shader->_instancedVariant;
+}
+
+bool isShaderInstanced(struct Shader *shader) {
+    if (shader == NULL) return false;
+
+    return shader->_isInstanced;
+}
+
+size_t getShaderUniformBlockSize(struct Shader *shader, unsigned int binding) {
+    if (shader == NULL || binding >= SHADER_NUM_UNIFORM_BLOCK_BINDINGS) return 0;
+
+    return shader->_uniformBlockSizes[binding];
+}
+
+bool isShaderStorageBlockDeclared(struct Shader *shader, unsigned int binding) {
+    if (shader == NULL || binding >= SHADER_NUM_STORAGE_BLOCK_BINDINGS) return false;
+
+    return shader->_storageBlocksDeclared[binding];
 }
 
 void enableShader(struct Shader *shader) {
     if (shader == NULL) return;
 
-    glUseProgram(shader->_program);
+    useGLProgram(shader->_program);
 }
 
+// The program is left bound, the next enableShader replaces it and skips the bind entirely
+// when it is the same program
 void disableShader(struct Shader *shader) {
     if (shader == NULL) return;
-
-    glUseProgram(0);
 }
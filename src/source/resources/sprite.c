@@ -21,6 +21,15 @@ bool isResourceTypeSprite(struct BaseResource *resource) {
     return resource->_type == RESOURCE_TYPE_SPRITE && stringEqualsCStr(resource->_typeName, RESOURCE_TYPE_NAME_SPRITE);
 }
 
+static size_t getDependencies(struct BaseResource *resource, struct BaseResource *dependencies[RESOURCE_MAX_DEPENDENCIES]) {
+    struct Sprite *sprite = (struct Sprite *) resource;
+    if (sprite->_spriteSheet == NULL) return 0;
+
+    dependencies[0] = (struct BaseResource *) sprite->_spriteSheet;
+
+    return 1;
+}
+
 void allocSprite(struct Sprite **spritePtr) {
     if (spritePtr == NULL || (*spritePtr) != NULL) return;
 
@@ -32,6 +41,7 @@ void allocSprite(struct Sprite **spritePtr) {
     base->_type = RESOURCE_TYPE_SPRITE;
     allocString(&base->_typeName, RESOURCE_TYPE_NAME_SPRITE);
     base->delete = delete;
+    base->getDependencies = getDependencies;
     base = NULL;
 
     newSprite->_spriteSheet = NULL;
@@ -1,22 +1,180 @@
-#include <SOIL/SOIL.h>
 #include <glad/gl.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "custom_string.h"
 #include "resources/base_resource.h"
 #include "resources/texture.h"
+#include "resources/texture_image.h"
+#include "resources/residency.h"
+#include "rendering/gl_state.h"
+#include "rendering/texture_streamer.h"
 #include "logger.h"
 
 #define RESOURCE_TYPE_TEXTURE 4
+#define TEXTURE_BYTES_PER_PIXEL 4
+// Levels up to 64x64 are cheap enough to upload while the texture is created
+#define TEXTURE_IMMEDIATE_UPLOAD_BYTES (16 * 1024)
+
+// Sampling parameters are part of the texture object, so they are carried across an eviction
+static const GLenum evictedParamNames[] = {
+    GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T
+};
+#define NUM_EVICTED_PARAMS (sizeof(evictedParamNames) / sizeof(evictedParamNames[0]))
+
+struct TextureEvictedData {
+    unsigned char *pixels;
+    GLint params[NUM_EVICTED_PARAMS];
+};
+
+static void deleteStream(struct Texture *texture) {
+    if (texture->_stream == NULL) return;
+
+    cancelTextureStreaming(texture);
+    freeTextureImage(texture->_stream);
+    free(texture->_stream);
+    texture->_stream = NULL;
+}
 
-static void deleteTextureId(struct Texture *texture) {
+static void releaseTextureId(struct Texture *texture) {
+    deleteStream(texture);
+    texture->_baseLevel = 0;
     if (texture->_id == 0) return;
 
+    forgetGLTexture2D(texture->_id);
     glDeleteTextures(1, &texture->_id);
     texture->_id = 0;
+    setResourceGpuBytes((struct BaseResource *) texture, 0);
+}
+
+static void deleteTextureId(struct Texture *texture) {
+    releaseTextureId(texture);
     texture->_width = 0;
     texture->_height = 0;
+    texture->_numLevels = 0;
+}
+
+static void deleteEvictedData(struct Texture *texture) {
+    if (texture->_evicted == NULL) return;
+
+    free(texture->_evicted->pixels);
+    free(texture->_evicted);
+    texture->_evicted = NULL;
+}
+
+static void setSourcePath(struct Texture *texture, const char *fileName) {
+    if (fileName == NULL) {
+        deleteString(&texture->_sourcePath);
+    } else if (texture->_sourcePath == NULL) {
+        allocString(&texture->_sourcePath, fileName);
+    } else if (getChars(texture->_sourcePath) != fileName) {
+        setChars(texture->_sourcePath, fileName);
+    }
+}
+
+static size_t calcLevelBytes(const struct Texture *texture, int level) {
+    size_t width = texture->_width > 0 ? (size_t) texture->_width : 0;
+    size_t height = texture->_height > 0 ? (size_t) texture->_height : 0;
+    for (int i = 0; i < level; ++i) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    return width * height * TEXTURE_BYTES_PER_PIXEL;
+}
+
+static size_t calcTextureBytes(const struct Texture *texture) {
+    size_t numBytes = 0;
+    for (int level = 0; level < texture->_numLevels; ++level) {
+        numBytes += calcLevelBytes(texture, level);
+    }
+
+    return numBytes;
+}
+
+static void uploadImageLevel(GLuint id, const struct TextureImage *image, int level) {
+    const struct TextureImageLevel *cur = &image->levels[level];
+    glTextureSubImage2D(
+        id, level, 0, 0, cur->width, cur->height, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels + cur->offset
+    );
+}
+
+// Uploads whatever the streamer has not got to yet, for callers that need level 0 right now
+static void finishStreaming(struct Texture *texture) {
+    if (texture->_stream == NULL) return;
+
+    for (int level = texture->_baseLevel - 1; level >= 0; --level) {
+        uploadImageLevel(texture->_id, texture->_stream, level);
+    }
+
+    texture->_baseLevel = 0;
+    glTextureParameteri(texture->_id, GL_TEXTURE_BASE_LEVEL, 0);
+    deleteStream(texture);
+}
+
+static bool evict(struct BaseResource *resource) {
+    struct Texture *texture = (struct Texture *) resource;
+    // half streamed textures are in active use by definition, their CPU copy is freed once they finish
+    if (texture->_id == 0 || texture->_stream != NULL) return false;
+
+    struct TextureEvictedData *evicted = calloc(1, sizeof(struct TextureEvictedData));
+    if (evicted == NULL) return false;
+
+    for (size_t i = 0; i < NUM_EVICTED_PARAMS; ++i) {
+        glGetTextureParameteriv(texture->_id, evictedParamNames[i], &evicted->params[i]);
+    }
+
+    // textures without a file behind them were filled at runtime and have to be read back
+    if (texture->_sourcePath == NULL) {
+        size_t numBytes = calcLevelBytes(texture, 0);
+        evicted->pixels = malloc(numBytes);
+        if (evicted->pixels == NULL) {
+            free(evicted);
+            return false;
+        }
+
+        glGetTextureImage(texture->_id, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei) numBytes, evicted->pixels);
+    }
+
+    deleteEvictedData(texture);
+    releaseTextureId(texture);
+    texture->_evicted = evicted;
+
+    return true;
+}
+
+static bool restore(struct BaseResource *resource) {
+    struct Texture *texture = (struct Texture *) resource;
+    struct TextureEvictedData *evicted = texture->_evicted;
+    if (evicted == NULL) return false;
+
+    texture->_evicted = NULL;
+    if (evicted->pixels != NULL) {
+        // only level 0 was read back, the rest of the chain is rebuilt from it
+        struct TextureImage image;
+        if (initTextureImage(&image, evicted->pixels, texture->_width, texture->_height, texture->_numLevels > 1)) {
+            if (!initTextureFromImage(texture, &image, NULL)) {
+                freeTextureImage(&image);
+            }
+        }
+    } else {
+        initTexture(texture, getChars(texture->_sourcePath));
+    }
+
+    if (texture->_id == 0) {
+        texture->_evicted = evicted;
+        return false;
+    }
+
+    for (size_t i = 0; i < NUM_EVICTED_PARAMS; ++i) {
+        glTextureParameteri(texture->_id, evictedParamNames[i], evicted->params[i]);
+    }
+
+    free(evicted->pixels);
+    free(evicted);
+
+    return true;
 }
 
 static void delete(struct BaseResource **resourcePtr) {
@@ -39,6 +197,10 @@ static GLenum convertParamName(const char *pName) {
 static GLint convertParamValue(const char *pVal) {
     if (strcmp(pVal, "GL_NEAREST") == 0) return GL_NEAREST;
     if (strcmp(pVal, "GL_LINEAR") == 0) return GL_LINEAR;
+    if (strcmp(pVal, "GL_NEAREST_MIPMAP_NEAREST") == 0) return GL_NEAREST_MIPMAP_NEAREST;
+    if (strcmp(pVal, "GL_LINEAR_MIPMAP_NEAREST") == 0) return GL_LINEAR_MIPMAP_NEAREST;
+    if (strcmp(pVal, "GL_NEAREST_MIPMAP_LINEAR") == 0) return GL_NEAREST_MIPMAP_LINEAR;
+    if (strcmp(pVal, "GL_LINEAR_MIPMAP_LINEAR") == 0) return GL_LINEAR_MIPMAP_LINEAR;
     if (strcmp(pVal, "GL_REPEAT") == 0) return GL_REPEAT;
     if (strcmp(pVal, "GL_MIRRORED_REPEAT") == 0) return GL_MIRRORED_REPEAT;
 
@@ -61,11 +223,18 @@ void allocTexture(struct Texture **texturePtr) {
     base->_type = RESOURCE_TYPE_TEXTURE;
     allocString(&base->_typeName, RESOURCE_TYPE_NAME_TEXTURE);
     base->delete = delete;
+    base->evict = evict;
+    base->restore = restore;
     base = NULL;
 
     newTexture->_id = 0;
     newTexture->_width = 0;
     newTexture->_height = 0;
+    newTexture->_numLevels = 0;
+    newTexture->_baseLevel = 0;
+    newTexture->_stream = NULL;
+    newTexture->_sourcePath = NULL;
+    newTexture->_evicted = NULL;
     (*texturePtr) = newTexture;
     newTexture = NULL;
 }
@@ -75,6 +244,8 @@ void deleteTexture(struct Texture **texturePtr) {
 
     struct Texture *texture = (*texturePtr);
     deleteTextureId(texture);
+    deleteEvictedData(texture);
+    deleteString(&texture->_sourcePath);
 
     finalizeBaseResource((struct BaseResource *) texture);
 
@@ -86,44 +257,114 @@ void deleteTexture(struct Texture **texturePtr) {
 void initTexture(struct Texture *texture, const char *fileName) {
     if (texture == NULL || fileName == NULL) return;
 
-    int newWidth = 0, newHeight = 0;
-    unsigned char *imageData = SOIL_load_image(fileName, &newWidth, &newHeight, NULL, SOIL_LOAD_RGBA);
-    if (imageData == NULL) {
-        error_log("[Texture]: SOIL failed to load image data from \"%s\"", fileName);
-        return;
+    struct TextureImage image;
+    if (!loadTextureImage(&image, fileName)) return;
+
+    if (!initTextureFromImage(texture, &image, fileName)) {
+        freeTextureImage(&image);
     }
+}
+
+bool initTextureFromImage(struct Texture *texture, struct TextureImage *image, const char *sourcePath) {
+    if (texture == NULL || image == NULL || image->pixels == NULL || image->numLevels <= 0) return false;
 
     GLuint newId = 0;
-    glGenTextures(1, &newId);
+    glCreateTextures(GL_TEXTURE_2D, 1, &newId);
     if (newId == 0) {
-        error_log("[Texture]: OpenGL could not allocate texture object", fileName);
-        free(imageData);
-        imageData = NULL;
-        return;
+        error_log("%s", "[Texture]: OpenGL could not allocate texture object");
+        return false;
+    }
+
+    glTextureStorage2D(newId, image->numLevels, GL_RGBA8, image->levels[0].width, image->levels[0].height);
+
+    // the coarsest level always goes up now so the texture can be sampled from the first frame
+    int baseLevel = image->numLevels - 1;
+    uploadImageLevel(newId, image, baseLevel);
+    while (baseLevel > 0 && image->levels[baseLevel - 1].size <= TEXTURE_IMMEDIATE_UPLOAD_BYTES) {
+        baseLevel--;
+        uploadImageLevel(newId, image, baseLevel);
+    }
+
+    glTextureParameteri(newId, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    glTextureParameteri(newId, GL_TEXTURE_MAX_LEVEL, image->numLevels - 1);
+    if (image->numLevels > 1) {
+        glTextureParameteri(newId, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     }
 
-    glBindTexture(GL_TEXTURE_2D, newId);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, newWidth, newHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
-    free(imageData);
-    imageData = NULL;
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        error_log("[Texture]: OpenGL generated an error with code \"%d\" while trying to load \"%s\"", error, fileName);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glDeleteTextures(1, &newId);
+    deleteTextureId(texture);
+    deleteEvictedData(texture);
+    texture->_id = newId;
+    texture->_width = image->levels[0].width;
+    texture->_height = image->levels[0].height;
+    texture->_numLevels = image->numLevels;
+    texture->_baseLevel = baseLevel;
+    setSourcePath(texture, sourcePath);
+    setResourceGpuBytes((struct BaseResource *) texture, calcTextureBytes(texture));
+
+    if (baseLevel == 0) {
+        freeTextureImage(image);
+        return true;
+    }
+
+    texture->_stream = malloc(sizeof(struct TextureImage));
+    if (texture->_stream == NULL) {
+        critical_log("%s", "[Texture]: Memory allocation failure, texture stays at low resolution");
+        freeTextureImage(image);
+        return true;
+    }
+
+    memcpy(texture->_stream, image, sizeof(struct TextureImage));
+    memset(image, 0, sizeof(struct TextureImage));
+    queueTextureStreaming(texture);
+
+    return true;
+}
+
+// Allocates uninitialised RGBA storage, used for textures that are filled region by region
+void initEmptyTexture(struct Texture *texture, int width, int height) {
+    if (texture == NULL || width <= 0 || height <= 0) return;
+
+    GLuint newId = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &newId);
+    if (newId == 0) {
+        error_log("%s", "[Texture]: OpenGL could not allocate texture object");
         return;
     }
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glTextureStorage2D(newId, 1, GL_RGBA8, width, height);
+    glTextureParameteri(newId, GL_TEXTURE_MAX_LEVEL, 0);
 
     deleteTextureId(texture);
+    deleteEvictedData(texture);
     texture->_id = newId;
-    texture->_width = newWidth;
-    texture->_height = newHeight;
+    texture->_width = width;
+    texture->_height = height;
+    texture->_numLevels = 1;
+    setSourcePath(texture, NULL);
+    setResourceGpuBytes((struct BaseResource *) texture, calcTextureBytes(texture));
+}
+
+void setTextureRegion(struct Texture *texture, int x, int y, int width, int height, const unsigned char *rgbaPixels) {
+    if (texture == NULL || rgbaPixels == NULL) return;
+    if (!useResource((struct BaseResource *) texture) || texture->_id == 0) return;
+
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > texture->_width || y + height > texture->_height) {
+        error_log("%s", "[Texture]: Texture region is out of bounds");
+        return;
+    }
+
+    finishStreaming(texture);
+    glTextureSubImage2D(texture->_id, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgbaPixels);
+    if (texture->_numLevels > 1) {
+        glGenerateTextureMipmap(texture->_id);
+    }
+    // the contents no longer match the file, so an eviction has to read them back
+    setSourcePath(texture, NULL);
 }
 
 void setTextureParam(struct Texture *texture, const char *paramName, const char *paramValue) {
-    if (texture == NULL || texture->_id == 0 || paramName == NULL || paramValue == NULL) return;
+    if (texture == NULL || paramName == NULL || paramValue == NULL) return;
+    if (!useResource((struct BaseResource *) texture) || texture->_id == 0) return;
 
     GLenum pName = convertParamName(paramName);
     if (pName == GL_INVALID_ENUM) {
@@ -140,8 +381,15 @@ void setTextureParam(struct Texture *texture, const char *paramName, const char
     glTextureParameteri(texture->_id, pName, pVal);
 }
 
+void bindTexture(struct Texture *texture, unsigned int unit) {
+    if (texture == NULL || !useResource((struct BaseResource *) texture) || texture->_id == 0) return;
+
+    bindGLTexture2D(unit, texture->_id);
+}
+
+// Callers bind the id themselves, so handing it out counts as a use
 unsigned int getTextureId(struct Texture *texture) {
-    if (texture == NULL) return 0;
+    if (texture == NULL || !useResource((struct BaseResource *) texture)) return 0;
 
     return texture->_id;
 }
@@ -157,3 +405,34 @@ int getTextureHeight(struct Texture *texture) {
 
     return texture->_height;
 }
+
+const struct TextureImage *getTextureStreamImage(struct Texture *texture) {
+    if (texture == NULL) return NULL;
+
+    return texture->_stream;
+}
+
+int getTextureBaseLevel(struct Texture *texture) {
+    if (texture == NULL) return 0;
+
+    return texture->_baseLevel;
+}
+
+void streamTextureLevel(struct Texture *texture, int level, size_t bufferOffset) {
+    if (texture == NULL || texture->_stream == NULL || texture->_id == 0) return;
+    // levels have to arrive in order, the base level can only move one step finer at a time
+    if (level != texture->_baseLevel - 1) return;
+
+    const struct TextureImageLevel *cur = &texture->_stream->levels[level];
+    glTextureSubImage2D(
+        texture->_id, level, 0, 0, cur->width, cur->height, GL_RGBA, GL_UNSIGNED_BYTE,
+        (const void *) (uintptr_t) bufferOffset
+    );
+
+    // the transfer is queued behind the copy, so sampling from the new level never sees partial data
+    texture->_baseLevel = level;
+    glTextureParameteri(texture->_id, GL_TEXTURE_BASE_LEVEL, level);
+    if (level == 0) {
+        deleteStream(texture);
+    }
+}
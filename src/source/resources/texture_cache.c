@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "mapped_file.h"
+#include "resources/texture_cache.h"
+#include "resources/texture_image.h"
+
+#define TEXTURE_CACHE_MAGIC "P3DTEX"
+// Texels are stored exactly as GL_RGBA8 expects them, other formats get their own id
+#define TEXTURE_CACHE_FORMAT_RGBA8 1
+
+struct TextureCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numLevels;
+    uint32_t padding;
+    uint64_t pixelsOffset;
+    uint64_t pixelsSize;
+};
+
+// Offsets are relative to the start of the texel data
+struct TextureCacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct TextureCacheContents {
+    struct TextureCacheHeader header;
+    struct TextureCacheLevel levels[TEXTURE_IMAGE_MAX_LEVELS];
+};
+
+bool readTextureCacheSourceKey(const char *sourcePath, struct TextureCacheSourceKey *key) {
+    if (sourcePath == NULL || key == NULL) return false;
+
+    struct MappedFile *source = NULL;
+    if (!allocMappedFile(&source, sourcePath)) return false;
+
+    key->size = (uint64_t) source->size;
+    key->hash = hashMappedFile(source);
+    deleteMappedFile(&source);
+
+    return true;
+}
+
+static bool isCacheValid(const struct MappedFile *file, const struct TextureCacheSourceKey *key, struct TextureImage *layout) {
+    if (file->size < sizeof(struct TextureCacheContents)) return false;
+
+    const struct TextureCacheContents *contents = (const struct TextureCacheContents *) file->data;
+    const struct TextureCacheHeader *header = &contents->header;
+    if (memcmp(header->magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC)) != 0) return false;
+    if (header->version != TEXTURE_CACHE_VERSION || header->format != TEXTURE_CACHE_FORMAT_RGBA8) return false;
+    if (header->fileSize != file->size) return false;
+    if (header->sourceSize != key->size || header->sourceHash != key->hash) return false;
+
+    if (header->width == 0 || header->height == 0 || header->width > INT32_MAX || header->height > INT32_MAX) return false;
+    if (header->numLevels == 0 || header->numLevels > TEXTURE_IMAGE_MAX_LEVELS) return false;
+    if (header->pixelsOffset % TEXTURE_CACHE_BLOB_ALIGNMENT != 0 || header->pixelsOffset > file->size) return false;
+    if (header->pixelsSize > file->size - header->pixelsOffset) return false;
+
+    // the stored table has to be exactly the layout this build would produce for the image
+    layoutTextureImage(layout, (int) header->width, (int) header->height, header->numLevels > 1);
+    if ((uint32_t) layout->numLevels != header->numLevels || layout->size != header->pixelsSize) return false;
+
+    for (int level = 0; level < layout->numLevels; ++level) {
+        const struct TextureCacheLevel *stored = &contents->levels[level];
+        const struct TextureImageLevel *expected = &layout->levels[level];
+        if (stored->width != (uint32_t) expected->width || stored->height != (uint32_t) expected->height) return false;
+        if (stored->offset != expected->offset || stored->size != expected->size) return false;
+    }
+
+    return true;
+}
+
+bool loadTextureCache(struct TextureImage *image, const char *sourcePath, const struct TextureCacheSourceKey *key) {
+    if (image == NULL || sourcePath == NULL || key == NULL) return false;
+
+    char *path = allocPathWithExtension(sourcePath, TEXTURE_CACHE_EXTENSION);
+    if (path == NULL) return false;
+
+    struct MappedFile *file = NULL;
+    if (!allocMappedFile(&file, path)) {
+        free(path);
+        return false;
+    }
+
+    memset(image, 0, sizeof(struct TextureImage));
+    if (!isCacheValid(file, key, image)) {
+        trace_log("[TextureCache]: \"%s\" is stale or damaged, it will be rebuilt", path);
+        memset(image, 0, sizeof(struct TextureImage));
+        deleteMappedFile(&file);
+        free(path);
+        return false;
+    }
+
+    const struct TextureCacheHeader *header = (const struct TextureCacheHeader *) file->data;
+    image->pixels = file->data + header->pixelsOffset;
+    image->_mapping = file;
+
+    free(path);
+
+    return true;
+}
+
+bool writeTextureCache(const struct TextureImage *image, const char *sourcePath, const struct TextureCacheSourceKey *key) {
+    if (image == NULL || image->pixels == NULL || sourcePath == NULL || key == NULL) return false;
+    if (image->numLevels <= 0 || image->numLevels > TEXTURE_IMAGE_MAX_LEVELS) return false;
+
+    char *path = allocPathWithExtension(sourcePath, TEXTURE_CACHE_EXTENSION);
+    if (path == NULL) {
+        critical_log("%s", "[TextureCache]: Memory allocation failure while writing texture cache");
+        return false;
+    }
+
+    struct TextureCacheContents contents;
+    memset(&contents, 0, sizeof(struct TextureCacheContents));
+
+    struct TextureCacheHeader *header = &contents.header;
+    memcpy(header->magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC));
+    header->version = TEXTURE_CACHE_VERSION;
+    header->format = TEXTURE_CACHE_FORMAT_RGBA8;
+    header->sourceSize = key->size;
+    header->sourceHash = key->hash;
+    header->width = (uint32_t) image->levels[0].width;
+    header->height = (uint32_t) image->levels[0].height;
+    header->numLevels = (uint32_t) image->numLevels;
+    header->pixelsOffset = ((sizeof(struct TextureCacheContents) + TEXTURE_CACHE_BLOB_ALIGNMENT - 1) / TEXTURE_CACHE_BLOB_ALIGNMENT) * TEXTURE_CACHE_BLOB_ALIGNMENT;
+    header->pixelsSize = image->size;
+    header->fileSize = header->pixelsOffset + header->pixelsSize;
+
+    for (int level = 0; level < image->numLevels; ++level) {
+        contents.levels[level].width = (uint32_t) image->levels[level].width;
+        contents.levels[level].height = (uint32_t) image->levels[level].height;
+        contents.levels[level].offset = image->levels[level].offset;
+        contents.levels[level].size = image->levels[level].size;
+    }
+
+    struct MappedFileWriter *writer = NULL;
+    if (!allocMappedFileWriter(&writer, path)) {
+        warning_log("[TextureCache]: Texture will not be cached in \"%s\"", path);
+        free(path);
+        return false;
+    }
+
+    static const unsigned char zeros[TEXTURE_CACHE_BLOB_ALIGNMENT] = {0};
+    size_t padding = (size_t) header->pixelsOffset - sizeof(struct TextureCacheContents);
+
+    bool written = fwrite(&contents, sizeof(struct TextureCacheContents), 1, writer->file) == 1 &&
+                   (padding == 0 || fwrite(zeros, 1, padding, writer->file) == padding) &&
+                   fwrite(image->pixels, 1, image->size, writer->file) == image->size;
+    if (!written) {
+        warning_log("[TextureCache]: Failed writing \"%s\", texture will not be cached", writer->tempPath);
+        deleteMappedFileWriter(&writer);
+        free(path);
+        return false;
+    }
+
+    bool committed = commitMappedFileWriter(writer);
+    deleteMappedFileWriter(&writer);
+    if (!committed) {
+        warning_log("[TextureCache]: Texture will not be cached in \"%s\"", path);
+        free(path);
+        return false;
+    }
+
+    trace_log("[TextureCache]: Wrote %d levels to \"%s\"", image->numLevels, path);
+
+    free(path);
+
+    return true;
+}
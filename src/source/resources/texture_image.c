@@ -0,0 +1,124 @@
+#include <SOIL/SOIL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "mapped_file.h"
+#include "resources/texture_cache.h"
+#include "resources/texture_image.h"
+
+static int calcNumLevels(int width, int height) {
+    int numLevels = 1;
+    while ((width > 1 || height > 1) && numLevels < TEXTURE_IMAGE_MAX_LEVELS) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        numLevels++;
+    }
+
+    return numLevels;
+}
+
+// Fills in the level table only, the texture cache uses it to check the layout it read back
+void layoutTextureImage(struct TextureImage *image, int width, int height, bool mipmapped) {
+    if (image == NULL || width <= 0 || height <= 0) return;
+
+    int numLevels = mipmapped ? calcNumLevels(width, height) : 1;
+    size_t offset = 0;
+    for (int level = 0; level < numLevels; ++level) {
+        struct TextureImageLevel *cur = &image->levels[level];
+        cur->width = width;
+        cur->height = height;
+        cur->offset = offset;
+        cur->size = ((size_t) width) * ((size_t) height) * TEXTURE_IMAGE_BYTES_PER_PIXEL;
+        offset += cur->size;
+
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    image->numLevels = numLevels;
+    image->size = offset;
+}
+
+// 2x2 box filter, the last row or column of an odd sized level is folded into its neighbour
+static void downsampleLevel(const unsigned char *src, const struct TextureImageLevel *srcLevel, unsigned char *dst, const struct TextureImageLevel *dstLevel) {
+    for (int y = 0; y < dstLevel->height; ++y) {
+        int y0 = y * 2 < srcLevel->height ? y * 2 : srcLevel->height - 1;
+        int y1 = y0 + 1 < srcLevel->height ? y0 + 1 : y0;
+
+        for (int x = 0; x < dstLevel->width; ++x) {
+            int x0 = x * 2 < srcLevel->width ? x * 2 : srcLevel->width - 1;
+            int x1 = x0 + 1 < srcLevel->width ? x0 + 1 : x0;
+
+            const unsigned char *p00 = src + (((size_t) y0) * srcLevel->width + x0) * TEXTURE_IMAGE_BYTES_PER_PIXEL;
+            const unsigned char *p01 = src + (((size_t) y0) * srcLevel->width + x1) * TEXTURE_IMAGE_BYTES_PER_PIXEL;
+            const unsigned char *p10 = src + (((size_t) y1) * srcLevel->width + x0) * TEXTURE_IMAGE_BYTES_PER_PIXEL;
+            const unsigned char *p11 = src + (((size_t) y1) * srcLevel->width + x1) * TEXTURE_IMAGE_BYTES_PER_PIXEL;
+            unsigned char *out = dst + (((size_t) y) * dstLevel->width + x) * TEXTURE_IMAGE_BYTES_PER_PIXEL;
+
+            for (int channel = 0; channel < TEXTURE_IMAGE_BYTES_PER_PIXEL; ++channel) {
+                out[channel] = (unsigned char) ((p00[channel] + p01[channel] + p10[channel] + p11[channel] + 2) / 4);
+            }
+        }
+    }
+}
+
+// Copies the pixels and, when mipmapped, builds every smaller level from the one above it
+bool initTextureImage(struct TextureImage *image, const unsigned char *rgbaPixels, int width, int height, bool mipmapped) {
+    if (image == NULL || rgbaPixels == NULL || width <= 0 || height <= 0) return false;
+
+    memset(image, 0, sizeof(struct TextureImage));
+    layoutTextureImage(image, width, height, mipmapped);
+
+    unsigned char *pixels = malloc(image->size);
+    if (pixels == NULL) {
+        critical_log("%s", "[TextureImage]: Memory allocation failure");
+        memset(image, 0, sizeof(struct TextureImage));
+        return false;
+    }
+
+    memcpy(pixels, rgbaPixels, image->levels[0].size);
+    for (int level = 1; level < image->numLevels; ++level) {
+        downsampleLevel(
+            pixels + image->levels[level - 1].offset, &image->levels[level - 1],
+            pixels + image->levels[level].offset, &image->levels[level]
+        );
+    }
+
+    image->pixels = pixels;
+    image->_storage = pixels;
+
+    return true;
+}
+
+bool loadTextureImage(struct TextureImage *image, const char *fileName) {
+    if (image == NULL || fileName == NULL) return false;
+
+    struct TextureCacheSourceKey key;
+    bool haveKey = readTextureCacheSourceKey(fileName, &key);
+    if (haveKey && loadTextureCache(image, fileName, &key)) return true;
+
+    int width = 0, height = 0;
+    unsigned char *imageData = SOIL_load_image(fileName, &width, &height, NULL, SOIL_LOAD_RGBA);
+    if (imageData == NULL) {
+        error_log("[TextureImage]: SOIL failed to load image data from \"%s\"", fileName);
+        return false;
+    }
+
+    bool initialized = initTextureImage(image, imageData, width, height, true);
+    SOIL_free_image_data(imageData);
+
+    if (initialized && haveKey) {
+        writeTextureCache(image, fileName, &key);
+    }
+
+    return initialized;
+}
+
+void freeTextureImage(struct TextureImage *image) {
+    if (image == NULL) return;
+
+    free(image->_storage);
+    deleteMappedFile(&image->_mapping);
+    memset(image, 0, sizeof(struct TextureImage));
+}
@@ -1,236 +1,99 @@
 #include <stdlib.h>
-#include <stdbool.h>
 #include <string.h>
 
 #include "logger.h"
-#include "config.h"
 #include "wfo_parser/object_list.h"
 
-#define INDEX_BUFFER_SIZE_IN_ELEMENTS 9
+#define MIN_CAPACITY_IN_FACES 64
 
-static const int name_buffer_size_in_elements = 64;
+static void allocObjectListNode(struct ObjectListNode **objectListNodePtr, const char *name) {
+    if (objectListNodePtr == NULL || (*objectListNodePtr) != NULL || name == NULL) return;
 
-struct FaceListNode {
-    struct FaceListNode *next;
-    int dataIndices[INDEX_BUFFER_SIZE_IN_ELEMENTS];
-};
+    struct ObjectListNode *newNode = calloc(1, sizeof(struct ObjectListNode));
+    if (newNode == NULL) return;
 
-static void clearNameBuffer(char *nameBuffer) {
-    memset(nameBuffer, 0, (name_buffer_size_in_elements+1) * sizeof(char) );
-}
-
-static void allocObjectListNode(struct ObjectListNode **objectListNodePtr) {
-    if (objectListNodePtr == NULL || (*objectListNodePtr) != NULL) return;
-
-    struct ObjectListNode *objectList = calloc(1, sizeof(struct ObjectListNode));
-    if (objectList == NULL) return;
-
-    objectList->next = NULL;
-    objectList->faceList = NULL;
-    objectList->name = calloc(name_buffer_size_in_elements + 1, sizeof(char));
-    objectList->indexBuffer = NULL;
-    objectList->indexBufferSize = 0;
-
-    (*objectListNodePtr) = objectList;
-    objectList = NULL;
-}
+    newNode->name = calloc(OBJECT_LIST_NAME_SIZE + 1, sizeof(char));
+    if (newNode->name == NULL) {
+        free(newNode);
+        return;
+    }
+    strncpy(newNode->name, name, OBJECT_LIST_NAME_SIZE);
 
-static void setObjectListNodeName(struct ObjectListNode *objectListNode, char *newName) {
-    if (objectListNode == NULL || newName == NULL) return;
+    newNode->next = NULL;
+    newNode->indexBuffer = NULL;
+    newNode->indexBufferSize = 0;
+    newNode->indexBufferCapacity = 0;
 
-    clearNameBuffer(objectListNode->name);
-    strncpy(objectListNode->name, newName, name_buffer_size_in_elements);
+    (*objectListNodePtr) = newNode;
 }
 
-static struct ObjectListNode * findObjectListNodeByName(struct ObjectListNode *objectListNode, const char *name) {
-    if (objectListNode == NULL || name == NULL) return NULL;
+struct ObjectListNode *findOrAppendObject(struct ObjectListNode **objectListPtr, const char *name) {
+    if (objectListPtr == NULL || name == NULL) return NULL;
 
-    struct ObjectListNode *curNode = objectListNode;
-    while (curNode != NULL) {
-        if (strncmp(curNode->name, name, name_buffer_size_in_elements) == 0) {
-            return curNode;
+    struct ObjectListNode **curNodePtr = objectListPtr;
+    while ((*curNodePtr) != NULL) {
+        if (strncmp((*curNodePtr)->name, name, OBJECT_LIST_NAME_SIZE) == 0) {
+            return (*curNodePtr);
         }
 
-        curNode = curNode->next;
-    }
-
-    return NULL;
-}
-
-static void appendNodeToObjectList(struct ObjectListNode **objectListPtr, struct ObjectListNode *newNode) {
-    if (objectListPtr == NULL || newNode == NULL) return;
-
-    if ((*objectListPtr) == NULL) {
-        (*objectListPtr) = newNode;
-
-        return;
+        curNodePtr = &(*curNodePtr)->next;
     }
 
-    struct ObjectListNode *curNode = (*objectListPtr);
-    while (curNode->next != NULL) {
-        curNode = curNode->next;
+    allocObjectListNode(curNodePtr, name);
+    if ((*curNodePtr) == NULL) {
+        critical_log("%s", "[ObjectList]: Memory allocation failure");
     }
 
-    curNode->next = newNode;
+    return (*curNodePtr);
 }
 
-static void allocFaceListNode(struct FaceListNode **faceListNodePtr, const int indexBuffer[INDEX_BUFFER_SIZE_IN_ELEMENTS]) {
-    if (faceListNodePtr == NULL || (*faceListNodePtr) != NULL || indexBuffer == NULL) return;
-
-    struct FaceListNode *newFaceListNode = calloc(1, sizeof(struct FaceListNode));
-    if (newFaceListNode == NULL) return;
-
-    newFaceListNode->next = NULL;
-    for (int i = 0; i < INDEX_BUFFER_SIZE_IN_ELEMENTS; ++i) {
-        newFaceListNode->dataIndices[i] = indexBuffer[i];
-    }
-
-    (*faceListNodePtr) = newFaceListNode;
+bool appendFaceToObject(struct ObjectListNode *objectListNode, const int indexBuffer[OBJECT_LIST_INDICES_PER_FACE]) {
+    return appendFacesToObject(objectListNode, indexBuffer, 1);
 }
 
-static void appendFaceListNode(struct FaceListNode **faceListNodePtr, struct FaceListNode *newNode) {
-    if (faceListNodePtr == NULL || newNode == NULL) return;
+bool appendFacesToObject(struct ObjectListNode *objectListNode, const int *indexBuffer, size_t numFaces) {
+    if (objectListNode == NULL || indexBuffer == NULL) return false;
 
-    if ( (*faceListNodePtr) == NULL ) {
-        (*faceListNodePtr) = newNode;
+    size_t numIndices = numFaces * OBJECT_LIST_INDICES_PER_FACE;
+    if (objectListNode->indexBufferSize + numIndices > objectListNode->indexBufferCapacity) {
+        size_t newCapacity = objectListNode->indexBufferCapacity * 2;
+        if (newCapacity < MIN_CAPACITY_IN_FACES * OBJECT_LIST_INDICES_PER_FACE) {
+            newCapacity = MIN_CAPACITY_IN_FACES * OBJECT_LIST_INDICES_PER_FACE;
+        }
+        if (newCapacity < objectListNode->indexBufferSize + numIndices) {
+            newCapacity = objectListNode->indexBufferSize + numIndices;
+        }
 
-        return;
-    }
+        int *newIndexBuffer = realloc(objectListNode->indexBuffer, newCapacity * sizeof(int));
+        if (newIndexBuffer == NULL) {
+            critical_log("[ObjectList]: Memory allocation failure while adding faces to \"%s\"", objectListNode->name);
+            return false;
+        }
 
-    struct FaceListNode *curNode = (*faceListNodePtr);
-    while (curNode->next != NULL) {
-        curNode = curNode->next;
+        objectListNode->indexBuffer = newIndexBuffer;
+        objectListNode->indexBufferCapacity = newCapacity;
     }
 
-    curNode->next = newNode;
-}
-
-static void deleteFaceList(struct FaceListNode **faceListNodePtr) {
-    if (faceListNodePtr == NULL || (*faceListNodePtr) == NULL) return;
-
-    struct FaceListNode *faceList = (*faceListNodePtr);
-    deleteFaceList(&faceList->next);
+    memcpy(objectListNode->indexBuffer + objectListNode->indexBufferSize, indexBuffer, numIndices * sizeof(int));
+    objectListNode->indexBufferSize += numIndices;
 
-    free(faceList);
-    faceList = NULL;
-    (*faceListNodePtr) = NULL;
+    return true;
 }
 
-static unsigned long getFaceCount(struct ObjectListNode *objectList) {
-    if (objectList == NULL) return 0;
-
-    struct FaceListNode *curNode = objectList->faceList;
-    int faceCount = 0;
+void deleteObjectListNode(struct ObjectListNode **objectListNodePtr) {
+    if (objectListNodePtr == NULL) return;
 
+    // iterative so files with many objects can not run out of stack
+    struct ObjectListNode *curNode = (*objectListNodePtr);
     while (curNode != NULL) {
-        faceCount++;
-        curNode = curNode->next;
-    }
+        struct ObjectListNode *next = curNode->next;
 
-    return faceCount;
-}
+        free(curNode->name);
+        free(curNode->indexBuffer);
+        free(curNode);
 
-void deleteObjectListNode(struct ObjectListNode **objectListNodePtr) {
-    if (objectListNodePtr == NULL || (*objectListNodePtr) == NULL) return;
-
-    struct ObjectListNode *objectList = (*objectListNodePtr);
-    deleteObjectListNode(&(objectList->next));
-    deleteFaceList(&objectList->faceList);
-    free(objectList->name);
-    objectList->name = NULL;
-    if (objectList->indexBuffer != NULL) {
-        free(objectList->indexBuffer);
-        objectList->indexBuffer = NULL;
+        curNode = next;
     }
-    objectList->indexBufferSize = 0;
 
-    free(objectList);
-    objectList = NULL;
     (*objectListNodePtr) = NULL;
 }
-
-void appendFaceToObjectList(struct ObjectListNode **objectListPtr, char *name, int indexBuffer[INDEX_BUFFER_SIZE_IN_ELEMENTS]) {
-    if (objectListPtr == NULL || name == NULL || indexBuffer == NULL) return;
-
-    struct FaceListNode *newFaceListNode = NULL;
-    allocFaceListNode(&newFaceListNode, indexBuffer);
-    if (newFaceListNode == NULL) return;
-
-    struct ObjectListNode *objectListNode = NULL;
-    objectListNode = findObjectListNodeByName((*objectListPtr), name);
-    if (objectListNode == NULL) {
-        allocObjectListNode(&objectListNode);
-        if (objectListNode == NULL) {
-            deleteFaceList(&newFaceListNode);
-
-            return;
-        }
-        setObjectListNodeName(objectListNode, name);
-        appendNodeToObjectList(objectListPtr, objectListNode);
-    }
-
-    appendFaceListNode(&objectListNode->faceList, newFaceListNode);
-}
-
-void flattenObjectList(struct ObjectListNode *objectList) {
-    if (objectList == NULL || objectList->indexBuffer != NULL || objectList->faceList == NULL) return;
-
-    size_t faceCount = getFaceCount(objectList);
-    if (faceCount == 0) return;
-
-    debug_log(
-        "Allocating %d * %d * %d = %d for index buffer with name %s",
-        faceCount, INDEX_BUFFER_SIZE_IN_ELEMENTS, sizeof(int),
-        faceCount * INDEX_BUFFER_SIZE_IN_ELEMENTS * sizeof(int),
-        objectList->name
-    );
-    int *newIndexBuffer = calloc(faceCount * INDEX_BUFFER_SIZE_IN_ELEMENTS, sizeof(int));
-    if (newIndexBuffer == NULL) return;
-
-    bool reverse_winding_order = getConfigWfoReversePolygons();
-    struct FaceListNode *curNode = objectList->faceList;
-    int count = 0;
-    while (curNode != NULL && count < faceCount) {
-        newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 0] = curNode->dataIndices[0];
-        newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 1] = curNode->dataIndices[1];
-        newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 2] = curNode->dataIndices[2];
-
-        if (!reverse_winding_order) {
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 3] = curNode->dataIndices[3];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 4] = curNode->dataIndices[4];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 5] = curNode->dataIndices[5];
-
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 6] = curNode->dataIndices[6];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 7] = curNode->dataIndices[7];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 8] = curNode->dataIndices[8];
-        } else {
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 6] = curNode->dataIndices[3];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 7] = curNode->dataIndices[4];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 8] = curNode->dataIndices[5];
-
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 3] = curNode->dataIndices[6];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 4] = curNode->dataIndices[7];
-            newIndexBuffer[(count * INDEX_BUFFER_SIZE_IN_ELEMENTS) + 5] = curNode->dataIndices[8];
-        }
-
-        curNode = curNode->next;
-        count++;
-    }
-
-    objectList->indexBuffer = newIndexBuffer;
-    newIndexBuffer = NULL;
-    objectList->indexBufferSize = faceCount * INDEX_BUFFER_SIZE_IN_ELEMENTS;
-    deleteFaceList(&objectList->faceList);
-
-    flattenObjectList(objectList->next);
-}
-
-extern void getIndexBuffer(struct ObjectListNode *objectListNode, const char *name, int **dst, size_t *dstSize) {
-    if (objectListNode == NULL || name == NULL || dst == NULL || (*dst) != NULL || dstSize == NULL) return;
-
-    struct ObjectListNode *node = findObjectListNodeByName(objectListNode, name);
-    if (node == NULL) return;
-
-    (*dst) = node->indexBuffer;
-    (*dstSize) = node->indexBufferSize;
-}
@@ -1,110 +1,61 @@
 #include <stdlib.h>
 
+#include "logger.h"
 #include "wfo_parser/vertex_data_list.h"
 
-static void allocVectorListNode(struct VectorListNode **listNodePtr) {
-    if (listNodePtr == NULL || (*listNodePtr) != NULL) return;
+#define MIN_CAPACITY_IN_ELEMENTS 64
 
-    struct VectorListNode *newNode = calloc(1, sizeof(struct VectorListNode));
-    if (newNode == NULL) return;
+bool reserveVertexDataList(struct VertexDataList *list, size_t capacity) {
+    if (list == NULL) return false;
+    if (capacity <= list->capacity) return true;
 
-    newNode->next = NULL;
-    newNode->size = 0;
-    newNode->elements[0] = 0.0f;
-    newNode->elements[1] = 0.0f;
-    newNode->elements[2] = 0.0f;
-
-    (*listNodePtr) = newNode;
-    newNode = NULL;
-};
-
-static struct VectorListNode *getVectorListEnd(struct VectorListNode *list) {
-    struct VectorListNode *prevNode = NULL, *curNode = list;
-    while (curNode != NULL) {
-        prevNode = curNode;
-        curNode = curNode->next;
+    float *newElements = realloc(list->elements, capacity * sizeof(float));
+    if (newElements == NULL) {
+        critical_log("%s", "[VertexDataList]: Memory allocation failure");
+        return false;
     }
 
-    if (prevNode == NULL) {
-        return list;
-    } else {
-        return prevNode;
-    }
-}
+    list->elements = newElements;
+    list->capacity = capacity;
 
-void appendVector2(struct VectorListNode **vecListNodePtr, float x, float y) {
-    if (vecListNodePtr == NULL) return;
-
-    struct VectorListNode *prevNode = getVectorListEnd((*vecListNodePtr));
-    struct VectorListNode *newNode = NULL;
-    allocVectorListNode(&newNode);
-    if (newNode == NULL) return;
+    return true;
+}
 
-    newNode->size = 2;
-    newNode->elements[0] = x;
-    newNode->elements[1] = y;
+static bool growVertexDataList(struct VertexDataList *list, size_t numElements) {
+    if (list->size + numElements <= list->capacity) return true;
 
-    if (prevNode == NULL && (*vecListNodePtr) == NULL) {
-        (*vecListNodePtr) = newNode;
-    } else {
-        prevNode->next = newNode;
+    size_t newCapacity = list->capacity < MIN_CAPACITY_IN_ELEMENTS ? MIN_CAPACITY_IN_ELEMENTS : list->capacity * 2;
+    while (newCapacity < list->size + numElements) {
+        newCapacity *= 2;
     }
-    newNode = NULL;
-}
 
-void appendVector3(struct VectorListNode **vecListNodePtr, float x, float y, float z) {
-    if (vecListNodePtr == NULL) return;
+    return reserveVertexDataList(list, newCapacity);
+}
 
-    struct VectorListNode *prevNode = getVectorListEnd((*vecListNodePtr));
-    struct VectorListNode *newNode = NULL;
-    allocVectorListNode(&newNode);
-    if (newNode == NULL) return;
+bool appendVector2(struct VertexDataList *list, float x, float y) {
+    if (list == NULL || !growVertexDataList(list, 2)) return false;
 
-    newNode->size = 3;
-    newNode->elements[0] = x;
-    newNode->elements[1] = y;
-    newNode->elements[2] = z;
+    list->elements[list->size++] = x;
+    list->elements[list->size++] = y;
 
-    if (prevNode == NULL && (*vecListNodePtr) == NULL) {
-        (*vecListNodePtr) = newNode;
-    } else {
-        prevNode->next = newNode;
-    }
-    newNode = NULL;
+    return true;
 }
 
-void deleteVectorList(struct VectorListNode **listNodePtr) {
-    if (listNodePtr == NULL || (*listNodePtr) == NULL) return;
+bool appendVector3(struct VertexDataList *list, float x, float y, float z) {
+    if (list == NULL || !growVertexDataList(list, 3)) return false;
 
-    struct VectorListNode *node = (*listNodePtr);
-    deleteVectorList(&node->next);
+    list->elements[list->size++] = x;
+    list->elements[list->size++] = y;
+    list->elements[list->size++] = z;
 
-    free(node);
-    node = NULL;
-    (*listNodePtr) = NULL;
+    return true;
 }
 
-void flattenVectorList(struct VectorListNode *vecList, float **dstPtr, size_t *dstSizePtr) {
-    if (vecList == NULL || dstPtr == NULL || (*dstPtr) != NULL || dstSizePtr == NULL) return;
-
-    size_t floatCount = 0;
-    struct VectorListNode *curNode = vecList;
-    while (curNode != NULL) {
-        floatCount += curNode->size;
-        curNode = curNode->next;
-    }
-
-    float *vecBuffer = calloc(floatCount, sizeof(float));
-    size_t curFloat = 0;
-    curNode = vecList;
-    while (curNode != NULL) {
-        for (size_t i = 0; i < curNode->size; ++i) {
-            vecBuffer[curFloat++] = curNode->elements[i];
-        }
-        curNode = curNode->next;
-    }
+void freeVertexDataList(struct VertexDataList *list) {
+    if (list == NULL) return;
 
-    (*dstPtr) = vecBuffer;
-    vecBuffer = NULL;
-    (*dstSizePtr) = floatCount;
+    free(list->elements);
+    list->elements = NULL;
+    list->size = 0;
+    list->capacity = 0;
 }
@@ -1,10 +1,15 @@
 #include <ctype.h>
+#include <float.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "util.h"
 #include "logger.h"
 #include "custom_string.h"
+#include "config.h"
+#include "mapped_file.h"
+#include "parallel_jobs.h"
 #include "wfo_parser/vertex_data_list.h"
 #include "wfo_parser/object_list.h"
 #include "wfo_parser/wfo_parser.h"
@@ -12,21 +17,34 @@
 #include "resources/material.h"
 #include "resources/texture.h"
 #include "resources/model.h"
+#include "mesh/mesh_cache.h"
+#include "mesh/mesh_optimizer.h"
+#include "mesh/mesh_simplifier.h"
+#include "mesh/vertex_format.h"
 
 #define LINE_BUFFER_SIZE_IN_ELEMENTS 256
 #define TYPE_BUFFER_SIZE_IN_ELEMENTS 16
 #define NAME_BUFFER_SIZE_IN_ELEMENTS 64
-#define INDEX_BUFFER_SIZE_IN_ELEMENTS 9
 #define FILE_NAME_BUFFER_SIZE_IN_ELEMENTS 256
+#define FLOAT_TOKEN_SIZE_IN_ELEMENTS 63
+// Mantissa bits a double has beyond a float's, and their pattern when it lies halfway between two floats
+#define DOUBLE_TO_FLOAT_DROPPED_BITS ((1ull << 29) - 1)
+#define DOUBLE_TO_FLOAT_HALFWAY (1ull << 28)
+// Smaller files parse faster than the threads start
+#define WFO_PARALLEL_MIN_SIZE_IN_BYTES (4 * 1024 * 1024)
+// More chunks than workers so threads that finish early pick up the remaining work
+#define WFO_CHUNKS_PER_WORKER 4
+// Meshes this small cost less to draw than the state changes a level of detail would save
+#define WFO_LOD_MIN_TRIANGLES 256
+// A level is only kept when it drops at least this share of the previous level's triangles
+#define WFO_LOD_MIN_REDUCTION 0.1f
+// Collapses that move the surface further than this share of the bounding radius are never made
+#define WFO_LOD_MAX_RELATIVE_ERROR 0.1f
 
 static void clearCharBuffer(char *lineBuffer, int sizeInElements) {
     memset(lineBuffer, 0, sizeInElements * sizeof(char));
 }
 
-static void clearIndexBuffer(int *indexBuffer) {
-    memset(indexBuffer, 0, INDEX_BUFFER_SIZE_IN_ELEMENTS * sizeof(int));
-}
-
 static char* readStringFromLine(char *curPos, char *dst, int limit) {
     if (curPos == NULL || (*curPos) == 0 || dst == NULL || limit < 0) return curPos;
 
@@ -71,85 +89,107 @@ static void readFloatsFromLine(char *curPos, float *dataBuffer, int numFloatsToR
     }
 }
 
-static char* readIntFromLine(char *curPos, int *dst) {
-    if (curPos == NULL || (*curPos) == 0 || dst == NULL) return curPos;
-
-    if ( (*curPos) == '/' ) {
-        (*dst) = -1;
+static float getVertexDataElement(float *vertexDataBuffer, int index, size_t bufferSize) {
+    if (vertexDataBuffer == NULL || bufferSize == 0) return 0.0f;
 
-        return curPos;
+    if (index < 0 || index >= bufferSize) {
+        critical_log("Bad vertex data read while generating vertex buffer. VB will be corrupt. Read was \"%d\" / \"%d\"", index, bufferSize);
+        return 0.0f;
     }
 
-    char charBuffer[33];
-    char *charBufferCursor = charBuffer;
-    memset(charBuffer, 0, 33 * sizeof(char));
-
-    for (int i = 0; i < 32; ++i) {
-        char curChar = (*curPos);
+    return vertexDataBuffer[index];
+}
 
-        if (!isdigit(curChar)) {
-            break;
-        }
+static int getIndexBufferElement (int *indexBuffer, int index, size_t bufferSize) {
+    if (indexBuffer == NULL || bufferSize == 0) return 1;
 
-        (*charBufferCursor) = curChar;
-        charBufferCursor++;
-        curPos++;
+    if (index < 0 || index >= bufferSize) {
+        critical_log("Bad index buffer read while generating vertex buffer. VB will be corrupt. Read was \"%d\" / \"%d\"", index, bufferSize);
+        return 1;
     }
 
-    (*dst) = (int) strtol(charBuffer, NULL, 10);
-
-    return curPos;
+    return indexBuffer[index];
 }
 
-static char* consumeIndexSeparator(char *curPos) {
-    if (curPos == NULL) return curPos;
+// Open addressing table from a face corner's (position, texcoord, normal) index triple to its vertex
+struct CornerTable {
+    uint32_t *slots;
+    size_t mask;
+};
 
-    if ( (*curPos) == '/') {
-        return curPos+1;
-    } else {
-        return curPos;
+static unsigned int hashCorner(const int *corner) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < 3; ++i) {
+        hash = (hash ^ (unsigned int) corner[i]) * 16777619u;
     }
-}
 
-static char* readIndicesFromLine(char *curPos, int *indexBuffer) {
-    if (curPos == NULL || (*curPos) == 0 || indexBuffer == NULL) return curPos;
+    return hash;
+}
 
-    for (int i = 0; i < 3; ++i) {
-        curPos = readIntFromLine(curPos, &(indexBuffer[i*3+0]));
-        curPos = consumeIndexSeparator(curPos);
-        curPos = readIntFromLine(curPos, &(indexBuffer[i*3+1]));
-        curPos = consumeIndexSeparator(curPos);
-        curPos = readIntFromLine(curPos, &(indexBuffer[i*3+2]));
-        curPos = advancePastSpaces(curPos);
+static bool allocCornerTable(struct CornerTable *table, size_t numCorners) {
+    size_t capacity = 16;
+    while (capacity < numCorners * 2) {
+        capacity *= 2;
     }
 
-    return curPos;
+    table->slots = malloc(capacity * sizeof(uint32_t));
+    if (table->slots == NULL) return false;
+
+    memset(table->slots, 0xFF, capacity * sizeof(uint32_t));
+    table->mask = capacity - 1;
+
+    return true;
 }
 
-static float getVertexDataElement(float *vertexDataBuffer, int index, size_t bufferSize) {
-    if (vertexDataBuffer == NULL || bufferSize == 0) return 0.0f;
+// Returns the vertex already created for an identical corner, or registers newVertex for it
+static uint32_t findOrAddCorner(struct CornerTable *table, int *indexBuffer, const uint32_t *vertexCorners, size_t corner, uint32_t newVertex) {
+    const int *key = &indexBuffer[corner * 3];
 
-    if (index < 0 || index >= bufferSize) {
-        critical_log("Bad vertex data read while generating vertex buffer. VB will be corrupt. Read was \"%d\" / \"%d\"", index, bufferSize);
-        return 0.0f;
-    }
+    for (size_t slot = hashCorner(key) & table->mask;; slot = (slot + 1) & table->mask) {
+        uint32_t vertex = table->slots[slot];
+        if (vertex == UINT32_MAX) {
+            table->slots[slot] = newVertex;
+            return newVertex;
+        }
 
-    return vertexDataBuffer[index];
+        if (memcmp(&indexBuffer[vertexCorners[vertex] * 3], key, 3 * sizeof(int)) == 0) return vertex;
+    }
 }
 
-static int getIndexBufferElement (int *indexBuffer, int index, size_t bufferSize) {
-    if (indexBuffer == NULL || bufferSize == 0) return 1;
-
-    if (index < 0 || index >= bufferSize) {
-        critical_log("Bad index buffer read while generating vertex buffer. VB will be corrupt. Read was \"%d\" / \"%d\"", index, bufferSize);
-        return 1;
+static void fillVertex(
+    struct VertexPNT *vertex,
+    float *posBuffer, size_t posSize,
+    float *normBuffer, size_t normSize,
+    float *tcBuffer, size_t tcSize,
+    int *indexBuffer, size_t indexBufferSize,
+    size_t corner
+) {
+    // wfo indices start at 1 not 0 so subtract 1, a 0 means the corner has no such attribute
+    int posIndex = getIndexBufferElement(indexBuffer, corner * 3 + 0, indexBufferSize) -1;
+    // yes, these offsets are correct, wfo stores vertices as PTN format, I want them in PNT format
+    int normIndex = getIndexBufferElement(indexBuffer, corner * 3 + 2, indexBufferSize) -1;
+    int texCoordIndex = getIndexBufferElement(indexBuffer, corner * 3 + 1, indexBufferSize) -1;
+
+    vertex->position[0] = getVertexDataElement(posBuffer, (posIndex) * 3 + 0, posSize);
+    vertex->position[1] = getVertexDataElement(posBuffer, (posIndex) * 3 + 1, posSize);
+    vertex->position[2] = getVertexDataElement(posBuffer, (posIndex) * 3 + 2, posSize);
+
+    if (normIndex != -1) {
+        vertex->normal[0] = getVertexDataElement(normBuffer, (normIndex) * 3 + 0, normSize);
+        vertex->normal[1] = getVertexDataElement(normBuffer, (normIndex) * 3 + 1, normSize);
+        vertex->normal[2] = getVertexDataElement(normBuffer, (normIndex) * 3 + 2, normSize);
     }
 
-    return indexBuffer[index];
+    if (texCoordIndex != -1) {
+        vertex->texCoord[0] = getVertexDataElement(tcBuffer, (texCoordIndex) * 2 + 0, tcSize);
+        vertex->texCoord[1] = getVertexDataElement(tcBuffer, (texCoordIndex) * 2 + 1, tcSize);
+    }
 }
 
+// Every distinct corner becomes one vertex, faces refer to them through the generated index buffer
 static void generateVertexBuffer(
     struct VertexPNT **dst, size_t *dstSize,
+    uint32_t **dstIndices, size_t *dstIndicesSize,
     float *posBuffer, size_t posSize,
     float *normBuffer, size_t normSize,
     float *tcBuffer, size_t tcSize,
@@ -157,9 +197,8 @@ static void generateVertexBuffer(
 ) {
     if (
         dst == NULL || (*dst) != NULL || dstSize == NULL ||
+        dstIndices == NULL || (*dstIndices) != NULL || dstIndicesSize == NULL ||
         posBuffer == NULL || posSize == 0 ||
-        normBuffer == NULL || normSize == 0 ||
-        tcBuffer == NULL || tcSize == 0 ||
         indexBuffer == NULL || indexBufferSize == 0
     ) return;
 
@@ -168,126 +207,723 @@ static void generateVertexBuffer(
         return;
     }
 
-    size_t vbSizeInVertices = indexBufferSize / 3;
-    struct VertexPNT *newVB = calloc(vbSizeInVertices, sizeof(struct VertexPNT));
-
-    for (size_t i = 0; i < vbSizeInVertices; ++i) {
-        // wfo indices start at 1 not 0 so subtract 1
-        int posIndex = getIndexBufferElement(indexBuffer, i * 3 + 0, indexBufferSize) -1;
-        // yes, these offsets are correct, wfo stores vertices as PTN format, I want them in PNT format
-        int normIndex = getIndexBufferElement(indexBuffer, i * 3 + 2, indexBufferSize) -1;
-        int texCoordIndex = getIndexBufferElement(indexBuffer, i * 3 + 1, indexBufferSize) -1;
+    size_t numCorners = indexBufferSize / 3;
+    struct VertexPNT *newVB = calloc(numCorners, sizeof(struct VertexPNT));
+    uint32_t *newIndices = malloc(numCorners * sizeof(uint32_t));
+    uint32_t *vertexCorners = malloc(numCorners * sizeof(uint32_t));
+    struct CornerTable table = {NULL, 0};
+    if (newVB == NULL || newIndices == NULL || vertexCorners == NULL || !allocCornerTable(&table, numCorners)) {
+        critical_log("%s", "[WfoParser]: Could not allocate memory for vertex buffer generation");
+        free(table.slots);
+        free(vertexCorners);
+        free(newIndices);
+        free(newVB);
+        return;
+    }
 
-        newVB[i].position[0] = getVertexDataElement(posBuffer, (posIndex) * 3 + 0, posSize);
-        newVB[i].position[1] = getVertexDataElement(posBuffer, (posIndex) * 3 + 1, posSize);
-        newVB[i].position[2] = getVertexDataElement(posBuffer, (posIndex) * 3 + 2, posSize);
+    uint32_t numVertices = 0;
+    for (size_t i = 0; i < numCorners; ++i) {
+        uint32_t vertex = findOrAddCorner(&table, indexBuffer, vertexCorners, i, numVertices);
+        if (vertex == numVertices) {
+            vertexCorners[numVertices] = (uint32_t) i;
+            fillVertex(
+                &newVB[numVertices],
+                posBuffer, posSize,
+                normBuffer, normSize,
+                tcBuffer, tcSize,
+                indexBuffer, indexBufferSize,
+                i
+            );
+            numVertices++;
+        }
 
-        newVB[i].normal[0] = getVertexDataElement(normBuffer, (normIndex) * 3 + 0, normSize);
-        newVB[i].normal[1] = getVertexDataElement(normBuffer, (normIndex) * 3 + 1, normSize);
-        newVB[i].normal[2] = getVertexDataElement(normBuffer, (normIndex) * 3 + 2, normSize);
+        newIndices[i] = vertex;
+    }
 
-        newVB[i].texCoord[0] = getVertexDataElement(tcBuffer, (texCoordIndex) * 2 + 0, tcSize);
-        newVB[i].texCoord[1] = getVertexDataElement(tcBuffer, (texCoordIndex) * 2 + 1, tcSize);
+    free(table.slots);
+    table.slots = NULL;
+    free(vertexCorners);
+    vertexCorners = NULL;
+
+    float acmrBefore = calcAverageCacheMissRatio(newIndices, numCorners, numVertices, MESH_VERTEX_CACHE_SIZE);
+    optimizeVertexCache(newIndices, numCorners, numVertices, MESH_VERTEX_CACHE_SIZE);
+    optimizeVertexFetch(newVB, numVertices, newIndices, numCorners);
+    float acmrAfter = calcAverageCacheMissRatio(newIndices, numCorners, numVertices, MESH_VERTEX_CACHE_SIZE);
+    trace_log(
+        "[WfoParser]: %zu corners share %u vertices, vertices per triangle went from %.3f to %.3f",
+        numCorners, numVertices, acmrBefore, acmrAfter
+    );
+
+    // the buffer was sized for the worst case of no shared corners
+    struct VertexPNT *shrunkVB = realloc(newVB, numVertices * sizeof(struct VertexPNT));
+    if (shrunkVB != NULL) {
+        newVB = shrunkVB;
     }
 
     (*dst) = newVB;
     newVB = NULL;
-    (*dstSize) = vbSizeInVertices;
+    (*dstSize) = numVertices;
+    (*dstIndices) = newIndices;
+    newIndices = NULL;
+    (*dstIndicesSize) = numCorners;
 }
 
-void importWaveFrontFile(struct Py3dResourceManager *manager, const char *filePath) {
-    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || filePath == NULL) return;
+static bool appendLodIndices(uint32_t **indices, size_t *numIndices, size_t *capacity, const uint32_t *src, size_t numSrc) {
+    if ((*numIndices) + numSrc > (*capacity)) {
+        size_t newCapacity = ((*numIndices) + numSrc) * 2;
+        uint32_t *newIndices = realloc(*indices, newCapacity * sizeof(uint32_t));
+        if (newIndices == NULL) return false;
 
-    FILE *wfoFile = fopen(filePath, "r");
-    if (wfoFile == NULL) {
-        error_log("[WfoParser]: Could not open \"%s\" for reading", filePath);
-        return;
+        (*indices) = newIndices;
+        (*capacity) = newCapacity;
     }
 
-    parseWaveFrontFile(manager, wfoFile);
-    fclose(wfoFile);
-    wfoFile = NULL;
+    memcpy((*indices) + (*numIndices), src, numSrc * sizeof(uint32_t));
+    (*numIndices) += numSrc;
+
+    return true;
 }
 
-void parseWaveFrontFile(struct Py3dResourceManager *manager, FILE *wfo) {
-    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || wfo == NULL) return;
+// Simplifies the mesh step by step and packs every level behind the full detail indices. Returns the
+// combined index buffer, or NULL when the mesh keeps its single level
+static uint32_t *generateLodChain(
+    const struct VertexPNT *vb, size_t vbSizeInVertices,
+    const uint32_t *ib, size_t ibSizeInIndices,
+    float boundsRadius,
+    struct ModelLod *lods, size_t *numLods, size_t *combinedSizeInIndices
+) {
+    int maxLods = getConfigModelLodCount();
+    if (maxLods > MODEL_MAX_LODS) maxLods = MODEL_MAX_LODS;
+
+    int trianglePercent = getConfigModelLodTrianglePercent();
+    if (trianglePercent < 1) trianglePercent = 1;
+    if (trianglePercent > 99) trianglePercent = 99;
+
+    if (maxLods <= 1 || ibSizeInIndices / 3 < WFO_LOD_MIN_TRIANGLES) return NULL;
+
+    struct MeshSimplifier *simplifier = NULL;
+    if (!allocMeshSimplifier(&simplifier, vb, vbSizeInVertices, ib, ibSizeInIndices)) return NULL;
+
+    size_t capacity = ibSizeInIndices * 2;
+    size_t combinedSize = 0;
+    uint32_t *combined = malloc(capacity * sizeof(uint32_t));
+    if (combined == NULL || !appendLodIndices(&combined, &combinedSize, &capacity, ib, ibSizeInIndices)) {
+        critical_log("%s", "[WfoParser]: Could not allocate memory for levels of detail");
+        free(combined);
+        deleteMeshSimplifier(&simplifier);
+        return NULL;
+    }
 
-    char lineBuffer[LINE_BUFFER_SIZE_IN_ELEMENTS+1];
-    char *curPos = NULL;
-    char typeBuffer[TYPE_BUFFER_SIZE_IN_ELEMENTS+1];
-    char nameBuffer[NAME_BUFFER_SIZE_IN_ELEMENTS+1];
-    float dataBuffer[3];
-    int indexBuffer[INDEX_BUFFER_SIZE_IN_ELEMENTS];
-    int lineNumber = 0;
-    size_t posCount = 0, normalCount = 0, texCoordCount = 0;
+    lods[0] = (struct ModelLod) {0, ibSizeInIndices, 0.0f};
+    size_t newNumLods = 1;
+    float maxError = boundsRadius * WFO_LOD_MAX_RELATIVE_ERROR;
+    while (newNumLods < (size_t) maxLods) {
+        size_t previousSize = lods[newNumLods - 1].numIndices;
+        size_t targetSize = (previousSize / 3) * (size_t) trianglePercent / 100 * 3;
+        size_t lodSize = simplifyMesh(simplifier, targetSize, maxError);
+        if (lodSize == 0 || (float) lodSize > (float) previousSize * (1.0f - WFO_LOD_MIN_REDUCTION)) break;
+
+        size_t firstIndex = combinedSize;
+        if (!appendLodIndices(&combined, &combinedSize, &capacity, getMeshSimplifierIndices(simplifier), lodSize)) {
+            critical_log("%s", "[WfoParser]: Could not allocate memory for levels of detail");
+            break;
+        }
+        optimizeVertexCache(combined + firstIndex, lodSize, vbSizeInVertices, MESH_VERTEX_CACHE_SIZE);
 
-    struct VectorListNode *posList = NULL, *normalList = NULL, *texCoordList = NULL;
-    struct ObjectListNode *objectList = NULL;
+        lods[newNumLods++] = (struct ModelLod) {firstIndex, lodSize, getMeshSimplifierError(simplifier)};
+    }
 
-    clearCharBuffer(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS+1);
-    curPos = lineBuffer;
-    clearCharBuffer(nameBuffer, NAME_BUFFER_SIZE_IN_ELEMENTS+1);
-    strncpy(nameBuffer, "None", NAME_BUFFER_SIZE_IN_ELEMENTS);
+    deleteMeshSimplifier(&simplifier);
 
-    while(fgets(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS, wfo) != NULL) {
-        lineNumber++;
-        clearCharBuffer(typeBuffer, TYPE_BUFFER_SIZE_IN_ELEMENTS+1);
-        curPos = readStringFromLine(curPos, typeBuffer, TYPE_BUFFER_SIZE_IN_ELEMENTS);
-        curPos = advancePastSpaces(curPos);
+    if (newNumLods == 1) {
+        free(combined);
+        return NULL;
+    }
 
-        if (strncmp(typeBuffer, "v", TYPE_BUFFER_SIZE_IN_ELEMENTS) == 0) {
+    trace_log(
+        "[WfoParser]: Generated %zu levels of detail, the coarsest keeps %zu of %zu triangles",
+        newNumLods, lods[newNumLods - 1].numIndices / 3, ibSizeInIndices / 3
+    );
+
+    (*numLods) = newNumLods;
+    (*combinedSizeInIndices) = combinedSize;
+
+    return combined;
+}
+
+// Creates the models straight from the mapped cache, the blobs are already in their upload format
+static bool importMeshCache(struct Py3dResourceManager *manager, const char *filePath) {
+    struct MeshCache *cache = NULL;
+    if (!allocMeshCache(&cache, filePath)) return false;
+
+    size_t numObjects = getMeshCacheObjectCount(cache);
+    for (size_t i = 0; i < numObjects; ++i) {
+        struct MeshCacheObject object;
+        if (!getMeshCacheObject(cache, i, &object)) continue;
+
+        struct Model *newModel = NULL;
+        allocModel(&newModel);
+        if (newModel == NULL) continue;
+
+        setResourceName((struct BaseResource *) newModel, object.name);
+        setModelVertexBuffer(newModel, object.vertices, object.numVertices, &object.format);
+        setModelPackedIndexBuffer(newModel, object.indices, object.numIndices, object.indexSize);
+        setModelLods(newModel, object.lods, object.numLods);
+        setModelBounds(newModel, object.boundsCenter, object.boundsRadius);
+
+        trace_log("[WfoParser]: Storing cached model named \"%s\"", object.name);
+        Py3dResourceManager_StoreResource(manager, (struct BaseResource *) newModel);
+        newModel = NULL;
+    }
+
+    deleteMeshCache(&cache);
+    trace_log("[WfoParser]: Loaded %zu objects of \"%s\" from its mesh cache", numObjects, filePath);
+
+    return true;
+}
+
+// Mapped files are not NUL terminated, so everything below parses between a cursor and an end pointer
+// instead of relying on the C string functions
+
+static const double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool isLineSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static bool isLineEnd(char c) {
+    return c == '\n' || c == '\r';
+}
+
+static bool isDigitChar(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char *skipLineSpaces(const char *curPos, const char *end) {
+    while (curPos < end && isLineSpace(*curPos)) {
+        curPos++;
+    }
+
+    return curPos;
+}
+
+static const char *skipToNextLine(const char *curPos, const char *end) {
+    const char *newLine = memchr(curPos, '\n', end - curPos);
+
+    return newLine != NULL ? newLine + 1 : end;
+}
+
+static const char *parseSlowFloat(const char *curPos, const char *end, float *dst) {
+    char token[FLOAT_TOKEN_SIZE_IN_ELEMENTS + 1];
+    size_t length = 0;
+    while (curPos + length < end && length < FLOAT_TOKEN_SIZE_IN_ELEMENTS && !isLineSpace(curPos[length]) && !isLineEnd(curPos[length])) {
+        length++;
+    }
+    memcpy(token, curPos, length);
+    token[length] = 0;
+
+    char *tokenEnd = NULL;
+    (*dst) = strtof(token, &tokenEnd);
+
+    return curPos + (tokenEnd - token);
+}
+
+// Rounding to double and then to float gives the same float as rounding once, unless the double
+// landed exactly halfway between two floats. Float subnormals round differently as well
+static bool isFloatRoundingSafe(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(uint64_t));
+    if ((bits & DOUBLE_TO_FLOAT_DROPPED_BITS) == DOUBLE_TO_FLOAT_HALFWAY) return false;
+
+    double magnitude = fabs(value);
+    return magnitude == 0.0 || magnitude >= FLT_MIN;
+}
+
+// Numbers with at most 19 significant digits and a small decimal exponent are exact as a double
+// mantissa and power of ten, so they are assembled directly. The result is bit identical to strtof,
+// the few values that double rounding could change and everything else go through strtof itself
+static const char *parseFloat(const char *curPos, const char *end, float *dst) {
+    const char *start = curPos;
+
+    bool negative = false;
+    if (curPos < end && ((*curPos) == '-' || (*curPos) == '+')) {
+        negative = (*curPos) == '-';
+        curPos++;
+    }
+
+    uint64_t mantissa = 0;
+    int numDigits = 0, numSignificantDigits = 0, exponent = 0;
+    while (curPos < end && isDigitChar(*curPos)) {
+        if (numSignificantDigits == 19) return parseSlowFloat(start, end, dst);
+
+        mantissa = mantissa * 10 + (uint64_t) ((*curPos) - '0');
+        if (mantissa != 0) numSignificantDigits++;
+        numDigits++;
+        curPos++;
+    }
+
+    if (curPos < end && (*curPos) == '.') {
+        curPos++;
+        while (curPos < end && isDigitChar(*curPos)) {
+            if (numSignificantDigits == 19) return parseSlowFloat(start, end, dst);
+
+            mantissa = mantissa * 10 + (uint64_t) ((*curPos) - '0');
+            if (mantissa != 0) numSignificantDigits++;
+            numDigits++;
+            exponent--;
+            curPos++;
+        }
+    }
+
+    // inf, nan and anything that is not a number at all
+    if (numDigits == 0) return parseSlowFloat(start, end, dst);
+
+    if (curPos < end && ((*curPos) == 'e' || (*curPos) == 'E')) {
+        const char *exponentPos = curPos + 1;
+        bool negativeExponent = false;
+        if (exponentPos < end && ((*exponentPos) == '-' || (*exponentPos) == '+')) {
+            negativeExponent = (*exponentPos) == '-';
+            exponentPos++;
+        }
+
+        // like strtof a dangling 'e' is not part of the number
+        if (exponentPos < end && isDigitChar(*exponentPos)) {
+            int explicitExponent = 0;
+            while (exponentPos < end && isDigitChar(*exponentPos)) {
+                if (explicitExponent < 10000) {
+                    explicitExponent = explicitExponent * 10 + ((*exponentPos) - '0');
+                }
+                exponentPos++;
+            }
+
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            curPos = exponentPos;
+        }
+    }
+
+    if (mantissa > (1ull << 53) || exponent < -22 || exponent > 22) return parseSlowFloat(start, end, dst);
+
+    double value = (double) mantissa;
+    value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+    if (!isFloatRoundingSafe(value)) return parseSlowFloat(start, end, dst);
+
+    (*dst) = (float) (negative ? -value : value);
+
+    return curPos;
+}
+
+// Reads up to numFloatsToRead floats, components the line does not have are left untouched
+static const char *parseFloats(const char *curPos, const char *end, float *dataBuffer, int numFloatsToRead) {
+    for (int i = 0; i < numFloatsToRead; ++i) {
+        curPos = skipLineSpaces(curPos, end);
+        if (curPos >= end || isLineEnd(*curPos)) break;
+
+        const char *next = parseFloat(curPos, end, &dataBuffer[i]);
+        if (next == curPos) break;
+        curPos = next;
+    }
+
+    return curPos;
+}
+
+static const char *parseIndex(const char *curPos, const char *end, long *dst) {
+    const char *start = curPos;
+
+    bool negative = false;
+    if (curPos < end && (*curPos) == '-') {
+        negative = true;
+        curPos++;
+    }
+
+    if (curPos >= end || !isDigitChar(*curPos)) return start;
+
+    long value = 0;
+    while (curPos < end && isDigitChar(*curPos)) {
+        if (value < INT_MAX) {
+            value = value * 10 + ((*curPos) - '0');
+        }
+        curPos++;
+    }
+
+    (*dst) = negative ? -value : value;
+
+    return curPos;
+}
+
+// Negative indices count back from the most recently defined element, out of range ones are kept
+// invalid so generating the vertex buffer reports them
+static int resolveIndex(long index, size_t numElements) {
+    if (index > 0) return index < INT_MAX ? (int) index : INT_MAX;
+
+    long resolved = (long) numElements + index + 1;
+
+    return resolved > 0 ? (int) resolved : -1;
+}
+
+// One "v", "v/vt", "v//vn" or "v/vt/vn" face corner, returns curPos unchanged when there is none
+static const char *parseFaceCorner(const char *curPos, const char *end, const size_t numElements[3], int corner[3]) {
+    corner[0] = corner[1] = corner[2] = 0;
+
+    for (int attribute = 0; attribute < 3; ++attribute) {
+        if (attribute > 0) {
+            if (curPos >= end || (*curPos) != '/') break;
+            curPos++;
+        }
+
+        long index = 0;
+        const char *next = parseIndex(curPos, end, &index);
+        if (next == curPos) {
+            if (attribute == 0) return curPos;
+            continue;
+        }
+
+        corner[attribute] = resolveIndex(index, numElements[attribute]);
+        curPos = next;
+    }
+
+    return curPos;
+}
+
+struct WfoParseState {
+    struct VertexDataList positions;
+    struct VertexDataList normals;
+    struct VertexDataList texCoords;
+    struct ObjectListNode *objectList;
+    struct ObjectListNode *curObject;
+    char objectName[OBJECT_LIST_NAME_SIZE + 1];
+    bool reverseWindingOrder;
+    size_t lineNumber;
+
+    // Chunks parsed in parallel do not know what came before them. Indices resolve against the
+    // position, texcoord and normal counts of the earlier chunks, and faces that come before the
+    // chunk's first "o" line collect in leadingObject until the chunks are merged
+    size_t elementOffsets[3];
+    bool objectNameKnown;
+    struct ObjectListNode *leadingObject;
+};
+
+static void initWfoParseState(struct WfoParseState *state) {
+    memset(state, 0, sizeof(struct WfoParseState));
+    strncpy(state->objectName, "None", OBJECT_LIST_NAME_SIZE);
+    state->reverseWindingOrder = getConfigWfoReversePolygons();
+    state->objectNameKnown = true;
+}
+
+static void clearWfoParseState(struct WfoParseState *state) {
+    freeVertexDataList(&state->positions);
+    freeVertexDataList(&state->normals);
+    freeVertexDataList(&state->texCoords);
+    deleteObjectListNode(&state->objectList);
+    deleteObjectListNode(&state->leadingObject);
+    state->curObject = NULL;
+}
+
+static void appendTriangle(struct WfoParseState *state, const int first[3], const int second[3], const int third[3]) {
+    // objects are only created once they have a face, like before
+    if (state->curObject == NULL) {
+        if (state->objectNameKnown) {
+            state->curObject = findOrAppendObject(&state->objectList, state->objectName);
+        } else {
+            state->curObject = findOrAppendObject(&state->leadingObject, "");
+        }
+        if (state->curObject == NULL) return;
+    }
+
+    if (state->reverseWindingOrder) {
+        const int *swap = second;
+        second = third;
+        third = swap;
+    }
+
+    int face[OBJECT_LIST_INDICES_PER_FACE];
+    memcpy(face + 0, first, 3 * sizeof(int));
+    memcpy(face + 3, second, 3 * sizeof(int));
+    memcpy(face + 6, third, 3 * sizeof(int));
+    appendFaceToObject(state->curObject, face);
+}
+
+// Polygons with more than three corners are split into a triangle fan around the first corner
+static void parseFaceLine(struct WfoParseState *state, const char *curPos, const char *end) {
+    const size_t numElements[3] = {
+        state->elementOffsets[0] + state->positions.size / 3,
+        state->elementOffsets[1] + state->texCoords.size / 2,
+        state->elementOffsets[2] + state->normals.size / 3
+    };
+    int first[3] = {0}, previous[3] = {0}, corner[3] = {0};
+    int numCorners = 0;
+
+    while (true) {
+        curPos = skipLineSpaces(curPos, end);
+        if (curPos >= end || isLineEnd(*curPos) || (*curPos) == '#') break;
+
+        const char *next = parseFaceCorner(curPos, end, numElements, corner);
+        if (next == curPos) {
+            warning_log("[WfoParser]: Malformed face corner on line #%zu, the rest of the face is ignored", state->lineNumber);
+            break;
+        }
+        curPos = next;
+
+        if (numCorners == 0) {
+            memcpy(first, corner, sizeof(first));
+        } else if (numCorners >= 2) {
+            appendTriangle(state, first, previous, corner);
+        }
+
+        memcpy(previous, corner, sizeof(previous));
+        numCorners++;
+    }
+}
+
+static void parseObjectLine(struct WfoParseState *state, const char *curPos, const char *end) {
+    size_t length = 0;
+    while (curPos + length < end && length < OBJECT_LIST_NAME_SIZE && !isLineSpace(curPos[length]) && !isLineEnd(curPos[length])) {
+        length++;
+    }
+
+    memset(state->objectName, 0, sizeof(state->objectName));
+    memcpy(state->objectName, curPos, length);
+    state->objectNameKnown = true;
+    state->curObject = NULL;
+}
+
+// Reads the record type at the start of a line and returns the position of its first argument
+static const char *readLineType(const char *curPos, const char *end, const char **type, size_t *typeLength) {
+    curPos = skipLineSpaces(curPos, end);
+
+    (*type) = curPos;
+    while (curPos < end && !isLineSpace(*curPos) && !isLineEnd(*curPos)) {
+        curPos++;
+    }
+    (*typeLength) = curPos - (*type);
+
+    return skipLineSpaces(curPos, end);
+}
+
+static void parseWaveFrontData(struct WfoParseState *state, const char *data, size_t size) {
+    const char *curPos = data;
+    const char *end = data + size;
+    float dataBuffer[3];
+
+    while (curPos < end) {
+        state->lineNumber++;
+
+        const char *type = NULL;
+        size_t typeLength = 0;
+        curPos = readLineType(curPos, end, &type, &typeLength);
+
+        if (typeLength == 1 && type[0] == 'v') {
             Vec3Identity(dataBuffer);
-            readFloatsFromLine(curPos, dataBuffer, 3);
-            appendVector3(&posList, dataBuffer[0], dataBuffer[1], dataBuffer[2]);
-            posCount++;
-        } else if (strncmp(typeBuffer, "vn", TYPE_BUFFER_SIZE_IN_ELEMENTS) == 0) {
+            parseFloats(curPos, end, dataBuffer, 3);
+            appendVector3(&state->positions, dataBuffer[0], dataBuffer[1], dataBuffer[2]);
+        } else if (typeLength == 2 && type[0] == 'v' && type[1] == 'n') {
             Vec3Identity(dataBuffer);
-            readFloatsFromLine(curPos, dataBuffer, 3);
-            appendVector3(&normalList, dataBuffer[0], dataBuffer[1], dataBuffer[2]);
-            normalCount++;
-        } else if (strncmp(typeBuffer, "vt", TYPE_BUFFER_SIZE_IN_ELEMENTS) == 0) {
+            parseFloats(curPos, end, dataBuffer, 3);
+            appendVector3(&state->normals, dataBuffer[0], dataBuffer[1], dataBuffer[2]);
+        } else if (typeLength == 2 && type[0] == 'v' && type[1] == 't') {
             Vec3Identity(dataBuffer);
-            readFloatsFromLine(curPos, dataBuffer, 2);
-            appendVector2(&texCoordList, dataBuffer[0], dataBuffer[1]);
-            texCoordCount++;
-        } else if (strncmp(typeBuffer, "o", TYPE_BUFFER_SIZE_IN_ELEMENTS) == 0) {
-            clearCharBuffer(nameBuffer, NAME_BUFFER_SIZE_IN_ELEMENTS + 1);
-            readStringFromLine(curPos, nameBuffer, NAME_BUFFER_SIZE_IN_ELEMENTS);
-        } else if (strncmp(typeBuffer, "f", TYPE_BUFFER_SIZE_IN_ELEMENTS) == 0) {
-            clearIndexBuffer(indexBuffer);
-            readIndicesFromLine(curPos, indexBuffer);
-            appendFaceToObjectList(&objectList, nameBuffer, indexBuffer);
-        } else {
-            debug_log("WFO Parser: Ignoring line #%d: unsupported type '%s'", lineNumber, typeBuffer);
+            parseFloats(curPos, end, dataBuffer, 2);
+            appendVector2(&state->texCoords, dataBuffer[0], dataBuffer[1]);
+        } else if (typeLength == 1 && type[0] == 'f') {
+            parseFaceLine(state, curPos, end);
+        } else if (typeLength == 1 && type[0] == 'o') {
+            parseObjectLine(state, curPos, end);
+        } else if (typeLength > 0 && type[0] != '#') {
+            debug_log("[WfoParser]: Ignoring line #%zu, unsupported type %.*s", state->lineNumber, (int) typeLength, type);
         }
 
-        clearCharBuffer(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS+1);
-        curPos = lineBuffer;
+        curPos = skipToNextLine(curPos, end);
+    }
+}
+
+// A range of whole lines that is parsed on its own, see WfoParseState
+struct WfoChunk {
+    const char *begin;
+    const char *end;
+    size_t numLines;
+    size_t numElements[3];
+    struct WfoParseState state;
+};
+
+static size_t splitWfoChunks(const char *data, size_t size, struct WfoChunk *chunks, size_t maxChunks) {
+    const char *curPos = data;
+    const char *end = data + size;
+    const size_t chunkSize = size / maxChunks + 1;
+
+    size_t numChunks = 0;
+    while (curPos < end && numChunks < maxChunks) {
+        const char *chunkEnd = end;
+        if ((size_t) (end - curPos) > chunkSize && numChunks + 1 < maxChunks) {
+            chunkEnd = skipToNextLine(curPos + chunkSize, end);
+        }
+
+        chunks[numChunks].begin = curPos;
+        chunks[numChunks].end = chunkEnd;
+        numChunks++;
+        curPos = chunkEnd;
+    }
+
+    return numChunks;
+}
+
+static void countWfoChunkJob(void *jobData, size_t jobIndex) {
+    struct WfoChunk *chunk = &((struct WfoChunk *) jobData)[jobIndex];
+
+    const char *curPos = chunk->begin;
+    while (curPos < chunk->end) {
+        chunk->numLines++;
+
+        const char *type = NULL;
+        size_t typeLength = 0;
+        curPos = readLineType(curPos, chunk->end, &type, &typeLength);
+
+        if (typeLength == 1 && type[0] == 'v') {
+            chunk->numElements[0]++;
+        } else if (typeLength == 2 && type[0] == 'v' && type[1] == 't') {
+            chunk->numElements[1]++;
+        } else if (typeLength == 2 && type[0] == 'v' && type[1] == 'n') {
+            chunk->numElements[2]++;
+        }
+
+        curPos = skipToNextLine(curPos, chunk->end);
+    }
+}
+
+static void parseWfoChunkJob(void *jobData, size_t jobIndex) {
+    struct WfoChunk *chunk = &((struct WfoChunk *) jobData)[jobIndex];
+
+    reserveVertexDataList(&chunk->state.positions, chunk->numElements[0] * 3);
+    reserveVertexDataList(&chunk->state.texCoords, chunk->numElements[1] * 2);
+    reserveVertexDataList(&chunk->state.normals, chunk->numElements[2] * 3);
+    parseWaveFrontData(&chunk->state, chunk->begin, chunk->end - chunk->begin);
+}
+
+static bool appendVertexData(struct VertexDataList *dst, const struct VertexDataList *src) {
+    if (src->size == 0) return true;
+    if (!reserveVertexDataList(dst, dst->size + src->size)) return false;
+
+    memcpy(dst->elements + dst->size, src->elements, src->size * sizeof(float));
+    dst->size += src->size;
+
+    return true;
+}
+
+static bool appendObjectFaces(struct WfoParseState *state, const char *name, const struct ObjectListNode *src) {
+    struct ObjectListNode *dst = findOrAppendObject(&state->objectList, name);
+
+    return dst != NULL && appendFacesToObject(dst, src->indexBuffer, src->indexBufferSize / OBJECT_LIST_INDICES_PER_FACE);
+}
+
+// Concatenates the chunks in file order, objects end up in the order their first face appears like in a serial parse
+static bool mergeWfoChunks(struct WfoParseState *state, const struct WfoChunk *chunks, size_t numChunks, const size_t totalElements[3]) {
+    if (
+        !reserveVertexDataList(&state->positions, totalElements[0] * 3) ||
+        !reserveVertexDataList(&state->texCoords, totalElements[1] * 2) ||
+        !reserveVertexDataList(&state->normals, totalElements[2] * 3)
+    ) return false;
+
+    char objectName[OBJECT_LIST_NAME_SIZE + 1];
+    memcpy(objectName, state->objectName, sizeof(objectName));
+
+    for (size_t i = 0; i < numChunks; ++i) {
+        const struct WfoParseState *chunkState = &chunks[i].state;
+
+        bool merged = appendVertexData(&state->positions, &chunkState->positions) &&
+                      appendVertexData(&state->texCoords, &chunkState->texCoords) &&
+                      appendVertexData(&state->normals, &chunkState->normals);
+
+        if (merged && chunkState->leadingObject != NULL) {
+            merged = appendObjectFaces(state, objectName, chunkState->leadingObject);
+        }
+
+        for (const struct ObjectListNode *node = chunkState->objectList; merged && node != NULL; node = node->next) {
+            merged = appendObjectFaces(state, node->name, node);
+        }
+
+        if (!merged) return false;
+
+        if (chunkState->objectNameKnown) {
+            memcpy(objectName, chunkState->objectName, sizeof(objectName));
+        }
+    }
+
+    return true;
+}
+
+// Parses in two parallel passes. The first counts lines and vertex records per chunk so each chunk
+// knows the element counts before it, the second parses every chunk with those offsets
+static bool parseWaveFrontDataParallel(struct WfoParseState *state, const char *data, size_t size, size_t numWorkers) {
+    size_t maxChunks = numWorkers * WFO_CHUNKS_PER_WORKER;
+    struct WfoChunk *chunks = calloc(maxChunks, sizeof(struct WfoChunk));
+    if (chunks == NULL) return false;
+
+    size_t numChunks = splitWfoChunks(data, size, chunks, maxChunks);
+    runParallelJobs(countWfoChunkJob, chunks, numChunks);
+
+    size_t lineOffset = 0;
+    size_t elementOffsets[3] = {0, 0, 0};
+    for (size_t i = 0; i < numChunks; ++i) {
+        initWfoParseState(&chunks[i].state);
+        chunks[i].state.lineNumber = lineOffset;
+        chunks[i].state.objectNameKnown = i == 0;
+        memcpy(chunks[i].state.elementOffsets, elementOffsets, sizeof(elementOffsets));
+
+        lineOffset += chunks[i].numLines;
+        for (int attribute = 0; attribute < 3; ++attribute) {
+            elementOffsets[attribute] += chunks[i].numElements[attribute];
+        }
+    }
+
+    runParallelJobs(parseWfoChunkJob, chunks, numChunks);
+
+    bool merged = mergeWfoChunks(state, chunks, numChunks, elementOffsets);
+    if (!merged) {
+        critical_log("%s", "[WfoParser]: Memory allocation failure while merging parsed chunks");
+        clearWfoParseState(state);
+        initWfoParseState(state);
+    } else {
+        trace_log("[WfoParser]: Parsed %zu lines in %zu chunks on %zu threads", lineOffset, numChunks, numWorkers);
     }
 
-    debug_log("Found %d positions, %d normals, %d texture coordinates", posCount, normalCount, texCoordCount);
+    for (size_t i = 0; i < numChunks; ++i) {
+        clearWfoParseState(&chunks[i].state);
+    }
+    free(chunks);
 
-    float *positionFloatBuffer = NULL, *normalFloatBuffer = NULL, *texCoordFloatBuffer = NULL;
-    size_t positionBufferSize = 0, normalBufferSize = 0, texCoordBufferSize = 0;
+    return merged;
+}
 
-    flattenVectorList(posList, &positionFloatBuffer, &positionBufferSize);
-    flattenVectorList(normalList, &normalFloatBuffer, &normalBufferSize);
-    flattenVectorList(texCoordList, &texCoordFloatBuffer, &texCoordBufferSize);
-    flattenObjectList(objectList);
+// Models are also written to a mesh cache next to cachePath when it is given
+static void createWaveFrontModels(struct Py3dResourceManager *manager, struct WfoParseState *state, const char *cachePath) {
+    debug_log(
+        "[WfoParser]: Found %zu positions, %zu normals, %zu texture coordinates",
+        state->positions.size / 3, state->normals.size / 3, state->texCoords.size / 2
+    );
+
+    struct MeshCacheWriter *cacheWriter = NULL;
+    if (cachePath != NULL) {
+        size_t numObjects = 0;
+        for (struct ObjectListNode *node = state->objectList; node != NULL; node = node->next) {
+            numObjects++;
+        }
 
-    deleteVectorList(&posList);
-    deleteVectorList(&normalList);
-    deleteVectorList(&texCoordList);
+        allocMeshCacheWriter(&cacheWriter, cachePath, numObjects);
+    }
 
-    struct ObjectListNode *curNode = objectList;
+    struct ObjectListNode *curNode = state->objectList;
     while (curNode != NULL) {
         struct VertexPNT *vb = NULL;
         size_t vbSizeInVertices;
+        uint32_t *ib = NULL;
+        size_t ibSizeInIndices;
         generateVertexBuffer(
             &vb, &vbSizeInVertices,
-            positionFloatBuffer, positionBufferSize,
-            normalFloatBuffer, normalBufferSize,
-            texCoordFloatBuffer, texCoordBufferSize,
+            &ib, &ibSizeInIndices,
+            state->positions.elements, state->positions.size,
+            state->normals.elements, state->normals.size,
+            state->texCoords.elements, state->texCoords.size,
             curNode->indexBuffer, curNode->indexBufferSize
         );
         if (vb == NULL) {
@@ -298,14 +934,61 @@ void parseWaveFrontFile(struct Py3dResourceManager *manager, FILE *wfo) {
         struct Model *newModel = NULL;
         allocModel(&newModel);
         if (newModel == NULL) {
+            free(vb);
+            free(ib);
             curNode = curNode->next;
             continue;
         }
         setResourceName((struct BaseResource *) newModel, curNode->name);
-        setModelPNTBuffer(newModel, vb, vbSizeInVertices);
+        struct VertexFormat format;
+        chooseVertexFormat(&format, vb, vbSizeInVertices);
+        void *encoded = encodeVertices(&format, vb, vbSizeInVertices);
+        if (encoded == NULL) {
+            initVertexFormatPNT(&format);
+        }
+        const void *vertices = encoded != NULL ? encoded : vb;
+
+        struct MeshCacheObject cacheObject = {
+            curNode->name, format, vertices, vbSizeInVertices, NULL, 0, 0
+        };
+        calcMeshBoundingSphere(vb, vbSizeInVertices, cacheObject.boundsCenter, &cacheObject.boundsRadius);
+        uint32_t *lodIb = generateLodChain(
+            vb, vbSizeInVertices, ib, ibSizeInIndices, cacheObject.boundsRadius,
+            cacheObject.lods, &cacheObject.numLods, &cacheObject.numIndices
+        );
+        if (lodIb != NULL) {
+            free(ib);
+            ib = lodIb;
+            ibSizeInIndices = cacheObject.numIndices;
+        } else {
+            cacheObject.lods[0] = (struct ModelLod) {0, ibSizeInIndices, 0.0f};
+            cacheObject.numLods = 1;
+            cacheObject.numIndices = ibSizeInIndices;
+        }
+
+        size_t indexSize = packModelIndices(ib, ibSizeInIndices, vbSizeInVertices);
+        setModelVertexBuffer(newModel, vertices, vbSizeInVertices, &format);
+        setModelPackedIndexBuffer(newModel, ib, ibSizeInIndices, indexSize);
+        setModelLods(newModel, cacheObject.lods, cacheObject.numLods);
+        setModelBounds(newModel, cacheObject.boundsCenter, cacheObject.boundsRadius);
+
+        if (cacheWriter != NULL) {
+            cacheObject.indices = ib;
+            cacheObject.indexSize = indexSize;
+            appendMeshCacheObject(cacheWriter, &cacheObject);
+        }
+        trace_log(
+            "[WfoParser]: \"%s\" stores %u bytes per vertex%s",
+            curNode->name, format.stride, isVertexFormatQuantized(&format) ? " with quantised positions" : ""
+        );
+
+        free(encoded);
+        encoded = NULL;
 
         free(vb);
         vb = NULL;
+        free(ib);
+        ib = NULL;
 
         trace_log("[WfoParser]: Storing material named \"%s\"", curNode->name);
         Py3dResourceManager_StoreResource(manager, (struct BaseResource *) newModel);
@@ -314,19 +997,69 @@ void parseWaveFrontFile(struct Py3dResourceManager *manager, FILE *wfo) {
         curNode = curNode->next;
     }
 
-    free(positionFloatBuffer);
-    positionFloatBuffer = NULL;
-    positionBufferSize = 0;
+    commitMeshCacheWriter(cacheWriter);
+    deleteMeshCacheWriter(&cacheWriter);
 
-    free(normalFloatBuffer);
-    normalFloatBuffer = NULL;
-    normalBufferSize = 0;
+}
+
+static void parseWaveFrontBuffer(struct Py3dResourceManager *manager, const char *data, size_t size, const char *cachePath) {
+    struct WfoParseState state;
+    initWfoParseState(&state);
+
+    size_t numWorkers = getParallelJobWorkerCount();
+    bool parsed = false;
+    if (numWorkers > 1 && size >= WFO_PARALLEL_MIN_SIZE_IN_BYTES) {
+        parsed = parseWaveFrontDataParallel(&state, data, size, numWorkers);
+    }
+    if (!parsed) {
+        parseWaveFrontData(&state, data, size);
+    }
 
-    free(texCoordFloatBuffer);
-    texCoordFloatBuffer = NULL;
-    texCoordBufferSize = 0;
+    createWaveFrontModels(manager, &state, cachePath);
 
-    deleteObjectListNode(&objectList);
+    clearWfoParseState(&state);
+}
+
+void importWaveFrontFile(struct Py3dResourceManager *manager, const char *filePath) {
+    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || filePath == NULL) return;
+
+    if (importMeshCache(manager, filePath)) return;
+
+    struct MappedFile *wfoFile = NULL;
+    if (!allocMappedFile(&wfoFile, filePath)) {
+        error_log("[WfoParser]: Could not open \"%s\" for reading", filePath);
+        return;
+    }
+
+    parseWaveFrontBuffer(manager, (const char *) wfoFile->data, wfoFile->size, filePath);
+    deleteMappedFile(&wfoFile);
+}
+
+// Streams that can not be mapped are read into memory whole and parsed the same way
+void parseWaveFrontFile(struct Py3dResourceManager *manager, FILE *wfo) {
+    if (Py3dResourceManager_Check((PyObject *) manager) != 1 || wfo == NULL) return;
+
+    size_t size = 0, capacity = 64 * 1024;
+    char *data = malloc(capacity);
+    while (data != NULL) {
+        size += fread(data + size, 1, capacity - size, wfo);
+        if (size < capacity) break;
+
+        capacity *= 2;
+        char *newData = realloc(data, capacity);
+        if (newData == NULL) {
+            free(data);
+        }
+        data = newData;
+    }
+
+    if (data == NULL) {
+        critical_log("%s", "[WfoParser]: Memory allocation failure while reading wave front file");
+        return;
+    }
+
+    parseWaveFrontBuffer(manager, data, size, NULL);
+    free(data);
 }
 
 void importMaterialFile(struct Py3dResourceManager *manager, const char *filePath) {
@@ -463,3 +1196,36 @@ void parseMaterialFile(struct Py3dResourceManager *manager, FILE *mtl) {
         curMaterial = NULL;
     }
 }
+
+void forEachMaterialFileTexture(const char *filePath, MaterialTextureVisitor visit, void *data) {
+    if (filePath == NULL || visit == NULL) return;
+
+    // importMaterialFile reports files that can not be opened
+    FILE *mtlFile = fopen(filePath, "r");
+    if (mtlFile == NULL) return;
+
+    char lineBuffer[LINE_BUFFER_SIZE_IN_ELEMENTS+1];
+    char *curPos;
+    char typeBuffer[TYPE_BUFFER_SIZE_IN_ELEMENTS+1];
+    char fileNameBuffer[FILE_NAME_BUFFER_SIZE_IN_ELEMENTS+1];
+
+    clearCharBuffer(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS+1);
+    while (fgets(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS, mtlFile)) {
+        if (strnlen(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS) >= 2) {
+            clearCharBuffer(typeBuffer, TYPE_BUFFER_SIZE_IN_ELEMENTS+1);
+            curPos = readStringFromLine(lineBuffer, typeBuffer, TYPE_BUFFER_SIZE_IN_ELEMENTS);
+            curPos = advancePastSpaces(curPos);
+
+            if (strncmp(typeBuffer, "map_Kd", TYPE_BUFFER_SIZE_IN_ELEMENTS) == 0) {
+                clearCharBuffer(fileNameBuffer, FILE_NAME_BUFFER_SIZE_IN_ELEMENTS+1);
+                readStringFromLine(curPos, fileNameBuffer, FILE_NAME_BUFFER_SIZE_IN_ELEMENTS);
+                visit(fileNameBuffer, data);
+            }
+        }
+
+        clearCharBuffer(lineBuffer, LINE_BUFFER_SIZE_IN_ELEMENTS+1);
+    }
+
+    fclose(mtlFile);
+    mtlFile = NULL;
+}